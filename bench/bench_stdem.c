@@ -0,0 +1,714 @@
+/**
+ * @file bench_stdem.c
+ * @brief Benchmark suite for Standard Enum Mapping Library
+ * @author Ferki
+ * @license LGPL-3.0-or-later
+ * 
+ * Times the hot paths of the library (lookups, name searches, inserts,
+ * iteration, copies, merges and serialization) over several storage
+ * backends, key layouts, map sizes and thread counts, and prints one
+ * machine-readable record per measurement (CSV or JSON).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/stdem.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#define BENCH_HAVE_THREADS 1
+#else
+#define BENCH_HAVE_THREADS 0
+#endif
+
+/* ==================== BENCH DEFINES AND STRUCTURES ==================== */
+
+#define BENCH_QUERIES (1 << 20)      /**< Largest query array cycled through by lookups */
+#define BENCH_NAME_LENGTH 32         /**< Room for one generated entry name */
+#define BENCH_SPARSE_STRIDE 97       /**< Distance between consecutive sparse keys */
+#define BENCH_MAX_THREADS 64         /**< Upper bound of the --threads option */
+#define BENCH_HOT_KEYS 10            /**< Keys taking 90% of the get_skewed queries */
+
+/**
+ * @brief Storage backend and key layout of one benchmarked configuration
+ */
+typedef struct {
+    const char* backend;    /**< Backend name reported in the output */
+    const char* keys;       /**< Key layout reported in the output ("dense" or "sparse") */
+    StemFlags flags;        /**< Flags the maps are created with */
+    int sparse;             /**< Non-zero for keys spread BENCH_SPARSE_STRIDE apart */
+} BenchConfig;
+
+/**
+ * @brief Command line options
+ */
+typedef struct {
+    int json;               /**< Print JSON instead of CSV */
+    size_t max_size;        /**< Largest map size to benchmark */
+    int max_threads;        /**< Largest thread count for the parallel lookups and bulk operations */
+    double min_time;        /**< Minimum measured time per record, in seconds */
+    const char* filter;     /**< Only run operations containing this string */
+} BenchOptions;
+
+/**
+ * @brief Inputs shared by every operation on one configuration and size
+ */
+typedef struct {
+    const BenchConfig* config; /**< Configuration being measured */
+    size_t size;            /**< Number of entries */
+    int* keys;              /**< Keys in insertion order */
+    int* hits;              /**< Shuffled present keys used as lookup queries */
+    int* misses;            /**< Absent keys used as lookup queries */
+    int* skewed;            /**< Present keys, 90% of them among BENCH_HOT_KEYS hot ones */
+    char* name_storage;     /**< Backing storage of the names */
+    const char** names;     /**< Name per key */
+    const char** queries;   /**< Shuffled names used as name queries */
+    size_t num_queries;     /**< Length of hits, misses and queries */
+    int* values;            /**< Value per key */
+    const void** value_ptrs; /**< Pointer to each value, as bulk loads take them */
+    EnumMap* map;           /**< Map holding every key */
+} BenchInput;
+
+/**
+ * @brief Lookup work handed to one benchmark thread
+ */
+typedef struct {
+    const EnumMap* map;     /**< Map to query (created with STEM_FLAGS_THREAD_SAFE) */
+    const int* queries;     /**< Keys to look up */
+    size_t num_queries;     /**< Length of queries */
+    size_t rounds;          /**< Number of passes over the queries */
+    size_t sum;             /**< Checksum of the values found */
+} BenchThread;
+
+static BenchOptions options = { 0, 1000000, 4, 0.2, NULL };
+static int records = 0;
+static volatile size_t bench_sink = 0; /**< Keeps results observable to the compiler */
+
+/* ==================== MEASUREMENT ==================== */
+
+/**
+ * @brief Returns a monotonic timestamp in seconds
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Small xorshift generator so runs are reproducible
+ */
+static uint64_t bench_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Tells whether an operation passes the --filter option
+ */
+static int bench_selected(const char* op) {
+    return !options.filter || strstr(op, options.filter) != NULL;
+}
+
+/**
+ * @brief Prints one measurement as a CSV line or a JSON object
+ * 
+ * @param op Operation name
+ * @param input Configuration and size the operation ran on
+ * @param threads Number of threads that ran the operation
+ * @param ops Total number of operations performed
+ * @param seconds Wall-clock time they took
+ */
+static void bench_report(const char* op, const BenchInput* input, int threads,
+                         double ops, double seconds) {
+    double ns_per_op = ops > 0 ? seconds * 1e9 / ops : 0.0;
+    double mops = seconds > 0 ? ops / seconds / 1e6 : 0.0;
+    
+    if (options.json) {
+        printf("%s\n  {\"op\": \"%s\", \"backend\": \"%s\", \"keys\": \"%s\", \"size\": %zu, "
+               "\"threads\": %d, \"ops\": %.0f, \"seconds\": %.6f, \"ns_per_op\": %.3f, "
+               "\"mops\": %.3f}", records ? "," : "[", op, input->config->backend,
+               input->config->keys, input->size, threads, ops, seconds, ns_per_op, mops);
+    } else {
+        if (!records) {
+            printf("op,backend,keys,size,threads,ops,seconds,ns_per_op,mops\n");
+        }
+        printf("%s,%s,%s,%zu,%d,%.0f,%.6f,%.3f,%.3f\n", op, input->config->backend,
+               input->config->keys, input->size, threads, ops, seconds, ns_per_op, mops);
+    }
+    fflush(stdout);
+    records++;
+}
+
+/* ==================== INPUTS ==================== */
+
+/**
+ * @brief Bulk-loads a map with every entry of an input
+ * 
+ * Read-only configurations are frozen after loading.
+ * 
+ * @param input Input providing the entries
+ * @param flags Flags to create the map with
+ * @return EnumMap* The populated map, or NULL on failure
+ */
+static EnumMap* bench_build(const BenchInput* input, StemFlags flags) {
+    EnumMap* map = stdem_create_from_arrays(input->keys, input->value_ptrs, input->names,
+                                            input->size, sizeof(int), flags, NULL);
+    if (map && (flags & STEM_FLAGS_READONLY)) {
+        EnumMap* frozen = stdem_freeze(map, NULL);
+        stdem_destroy(map);
+        map = frozen;
+    }
+    return map;
+}
+
+/**
+ * @brief Builds the keys, names, queries and populated map for one size
+ * 
+ * @param input Input to fill
+ * @param config Configuration to build for
+ * @param size Number of entries
+ * @return int 0 on success, 1 on allocation failure
+ */
+static int bench_input_init(BenchInput* input, const BenchConfig* config, size_t size) {
+    memset(input, 0, sizeof(BenchInput));
+    input->config = config;
+    input->size = size;
+    input->num_queries = size < BENCH_QUERIES ? size : BENCH_QUERIES;
+    
+    input->keys = malloc(size * sizeof(int));
+    input->values = malloc(size * sizeof(int));
+    input->value_ptrs = malloc(size * sizeof(void*));
+    input->names = malloc(size * sizeof(char*));
+    input->name_storage = malloc(size * BENCH_NAME_LENGTH);
+    input->hits = malloc(input->num_queries * sizeof(int));
+    input->misses = malloc(input->num_queries * sizeof(int));
+    input->skewed = malloc(input->num_queries * sizeof(int));
+    input->queries = malloc(input->num_queries * sizeof(char*));
+    if (!input->keys || !input->values || !input->value_ptrs || !input->names || 
+        !input->name_storage || !input->hits || !input->misses || !input->skewed || !input->queries) {
+        return 1;
+    }
+    
+    for (size_t i = 0; i < size; i++) {
+        input->keys[i] = config->sparse ? (int)(i * BENCH_SPARSE_STRIDE + 13) : (int)i;
+        input->values[i] = (int)i;
+        input->value_ptrs[i] = &input->values[i];
+        char* name = input->name_storage + i * BENCH_NAME_LENGTH;
+        snprintf(name, BENCH_NAME_LENGTH, "ENTRY_NAME_%zu", i);
+        input->names[i] = name;
+    }
+    
+    /* Random queries, so lookups do not walk memory in insertion order */
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ size;
+    for (size_t i = 0; i < input->num_queries; i++) {
+        size_t j = (size_t)(bench_random(&state) % size);
+        input->hits[i] = input->keys[j];
+        input->misses[i] = config->sparse ? input->keys[j] + 1 : (int)(size + j);
+        input->queries[i] = input->names[j];
+        
+        /* Zipf-like traffic: a handful of keys takes almost every query */
+        size_t hot = (size_t)(bench_random(&state) % 10) < 9 ? j % BENCH_HOT_KEYS : j;
+        input->skewed[i] = input->keys[hot];
+    }
+    
+    input->map = bench_build(input, config->flags);
+    return input->map ? 0 : 1;
+}
+
+/**
+ * @brief Releases everything bench_input_init() allocated
+ */
+static void bench_input_free(BenchInput* input) {
+    stdem_destroy(input->map);
+    free(input->queries);
+    free(input->skewed);
+    free(input->misses);
+    free(input->hits);
+    free(input->name_storage);
+    free(input->names);
+    free(input->value_ptrs);
+    free(input->values);
+    free(input->keys);
+}
+
+/* ==================== SINGLE-THREADED OPERATIONS ==================== */
+
+/**
+ * @brief Times value lookups over one of the query arrays
+ * 
+ * @param input Input to query
+ * @param op Operation name reported
+ * @param queries Keys to look up, num_queries of them
+ */
+static void bench_get(const BenchInput* input, const char* op, const int* queries) {
+    if (!bench_selected(op)) {
+        return;
+    }
+    
+    size_t ops = 0;
+    size_t sum = 0;
+    double start = bench_now();
+    double elapsed;
+    do {
+        for (size_t i = 0; i < input->num_queries; i++) {
+            const int* value = stdem_get_value_ex(input->map, queries[i], NULL);
+            sum += value ? (size_t)*value : 1;
+        }
+        ops += input->num_queries;
+        elapsed = bench_now() - start;
+    } while (elapsed < options.min_time);
+    
+    bench_sink += sum;
+    bench_report(op, input, 1, (double)ops, elapsed);
+}
+
+/**
+ * @brief Times name-to-value lookups
+ */
+static void bench_find_by_name(const BenchInput* input) {
+    if (!bench_selected("find_by_name")) {
+        return;
+    }
+    
+    size_t ops = 0;
+    size_t sum = 0;
+    double start = bench_now();
+    double elapsed;
+    do {
+        for (size_t i = 0; i < input->num_queries; i++) {
+            sum += (size_t)stdem_find_by_name(input->map, input->queries[i], NULL);
+        }
+        ops += input->num_queries;
+        elapsed = bench_now() - start;
+    } while (elapsed < options.min_time);
+    
+    bench_sink += sum;
+    bench_report("find_by_name", input, 1, (double)ops, elapsed);
+}
+
+/**
+ * @brief Times building a map by single associations from minimal capacity
+ * 
+ * The map starts with a capacity of one outside of dense configurations,
+ * so every resize along the way is part of the measurement.
+ */
+static void bench_associate(const BenchInput* input) {
+    if (!bench_selected("associate")) {
+        return;
+    }
+    
+    size_t capacity = (input->config->flags & STEM_FLAGS_DENSE) ? input->size : 1;
+    size_t ops = 0;
+    double elapsed = 0.0;
+    do {
+        EnumMap* map = stdem_create_ex(capacity, sizeof(int), input->config->flags, NULL);
+        if (!map) {
+            return;
+        }
+        double start = bench_now();
+        for (size_t i = 0; i < input->size; i++) {
+            stdem_associate_ex(map, input->keys[i], &input->values[i], input->names[i]);
+        }
+        elapsed += bench_now() - start;
+        ops += input->size;
+        stdem_destroy(map);
+    } while (elapsed < options.min_time);
+    
+    bench_report("associate", input, 1, (double)ops, elapsed);
+}
+
+/**
+ * @brief Times the slowest single association while building a map
+ * 
+ * Same build as bench_associate(), but every insert is timed on its own
+ * and the record reports the worst one (ops is 1), which is where a
+ * resize that rehashes the whole table shows up.
+ */
+static void bench_associate_worst(const BenchInput* input) {
+    if (!bench_selected("associate_worst")) {
+        return;
+    }
+    
+    size_t capacity = (input->config->flags & STEM_FLAGS_DENSE) ? input->size : 1;
+    double worst = 0.0;
+    double elapsed = 0.0;
+    do {
+        EnumMap* map = stdem_create_ex(capacity, sizeof(int), input->config->flags, NULL);
+        if (!map) {
+            return;
+        }
+        for (size_t i = 0; i < input->size; i++) {
+            double start = bench_now();
+            stdem_associate_ex(map, input->keys[i], &input->values[i], input->names[i]);
+            double took = bench_now() - start;
+            elapsed += took;
+            if (took > worst) {
+                worst = took;
+            }
+        }
+        stdem_destroy(map);
+    } while (elapsed < options.min_time);
+    
+    bench_report("associate_worst", input, 1, 1.0, worst);
+}
+
+/**
+ * @brief Iterator callback summing the values
+ */
+static void bench_foreach_sum(int enum_value, const char* enum_name,
+                              const void* value, size_t value_size, void* user_data) {
+    (void)enum_value;
+    (void)enum_name;
+    (void)value_size;
+    *(size_t*)user_data += value ? (size_t)*(const int*)value : 0;
+}
+
+/**
+ * @brief Times full iterations, reported per visited entry
+ */
+static void bench_foreach(const BenchInput* input) {
+    if (!bench_selected("foreach")) {
+        return;
+    }
+    
+    size_t ops = 0;
+    size_t sum = 0;
+    double start = bench_now();
+    double elapsed;
+    do {
+        stdem_foreach(input->map, bench_foreach_sum, &sum);
+        ops += input->size;
+        elapsed = bench_now() - start;
+    } while (elapsed < options.min_time);
+    
+    bench_sink += sum;
+    bench_report("foreach", input, 1, (double)ops, elapsed);
+}
+
+/**
+ * @brief Times copies and merges, reported per entry of the result
+ * 
+ * The merge combines the map with a copy of itself, so every key of the
+ * second map is a duplicate that gets overwritten.
+ */
+static void bench_copy_merge(const BenchInput* input) {
+    if (bench_selected("copy")) {
+        size_t ops = 0;
+        double elapsed = 0.0;
+        do {
+            double start = bench_now();
+            EnumMap* copy = stdem_copy(input->map, NULL);
+            elapsed += bench_now() - start;
+            ops += input->size;
+            stdem_destroy(copy);
+        } while (elapsed < options.min_time);
+        bench_report("copy", input, 1, (double)ops, elapsed);
+    }
+    
+    if (bench_selected("merge")) {
+        EnumMap* other = stdem_copy(input->map, NULL);
+        size_t ops = 0;
+        double elapsed = 0.0;
+        do {
+            double start = bench_now();
+            EnumMap* merged = stdem_merge(input->map, other, true, NULL);
+            elapsed += bench_now() - start;
+            ops += input->size;
+            stdem_destroy(merged);
+        } while (other && elapsed < options.min_time);
+        stdem_destroy(other);
+        bench_report("merge", input, 1, (double)ops, elapsed);
+    }
+}
+
+/**
+ * @brief Iterator callback reading each value, safe on several threads
+ */
+static void bench_foreach_touch(int enum_value, const char* enum_name,
+                                const void* value, size_t value_size, void* user_data) {
+    (void)enum_value;
+    (void)enum_name;
+    (void)value_size;
+    (void)user_data;
+    volatile int sink = value ? *(const int*)value : 0;
+    (void)sink;
+}
+
+/**
+ * @brief Times the parallel iteration, copy and merge on --threads threads
+ */
+static void bench_parallel_bulk(const BenchInput* input) {
+    StemExecutor executor = stdem_thread_executor((size_t)options.max_threads);
+    int threads = (int)executor.workers;
+    
+    if (bench_selected("foreach_parallel")) {
+        size_t ops = 0;
+        double start = bench_now();
+        double elapsed;
+        do {
+            stdem_foreach_parallel(input->map, bench_foreach_touch, NULL, &executor);
+            ops += input->size;
+            elapsed = bench_now() - start;
+        } while (elapsed < options.min_time);
+        bench_report("foreach_parallel", input, threads, (double)ops, elapsed);
+    }
+    
+    if (bench_selected("copy_parallel")) {
+        size_t ops = 0;
+        double elapsed = 0.0;
+        do {
+            double start = bench_now();
+            EnumMap* copy = stdem_copy_parallel(input->map, &executor, NULL);
+            elapsed += bench_now() - start;
+            ops += input->size;
+            stdem_destroy(copy);
+        } while (elapsed < options.min_time);
+        bench_report("copy_parallel", input, threads, (double)ops, elapsed);
+    }
+    
+    if (bench_selected("merge_parallel")) {
+        EnumMap* other = stdem_copy(input->map, NULL);
+        size_t ops = 0;
+        double elapsed = 0.0;
+        do {
+            double start = bench_now();
+            EnumMap* merged = stdem_merge_parallel(input->map, other, true, &executor, NULL);
+            elapsed += bench_now() - start;
+            ops += input->size;
+            stdem_destroy(merged);
+        } while (other && elapsed < options.min_time);
+        stdem_destroy(other);
+        bench_report("merge_parallel", input, threads, (double)ops, elapsed);
+    }
+}
+
+/**
+ * @brief Times in-memory serialization and deserialization, per entry
+ */
+static void bench_serialize(const BenchInput* input) {
+    size_t size = stdem_serialized_size(input->map);
+    void* buffer = malloc(size ? size : 1);
+    if (!buffer || stdem_serialize_to_buffer(input->map, buffer, size, NULL) != STEM_SUCCESS) {
+        free(buffer);
+        return;
+    }
+    
+    if (bench_selected("serialize")) {
+        size_t ops = 0;
+        double start = bench_now();
+        double elapsed;
+        do {
+            stdem_serialize_to_buffer(input->map, buffer, size, NULL);
+            ops += input->size;
+            elapsed = bench_now() - start;
+        } while (elapsed < options.min_time);
+        bench_report("serialize", input, 1, (double)ops, elapsed);
+    }
+    
+    if (bench_selected("deserialize")) {
+        size_t ops = 0;
+        double elapsed = 0.0;
+        do {
+            double start = bench_now();
+            EnumMap* loaded = stdem_deserialize_from_buffer(buffer, size, NULL);
+            elapsed += bench_now() - start;
+            ops += input->size;
+            stdem_destroy(loaded);
+        } while (elapsed < options.min_time);
+        bench_report("deserialize", input, 1, (double)ops, elapsed);
+    }
+    
+    free(buffer);
+}
+
+/* ==================== MULTI-THREADED OPERATIONS ==================== */
+
+#if BENCH_HAVE_THREADS
+/**
+ * @brief Thread body running lookups over a shared map
+ */
+static void* bench_thread_get(void* arg) {
+    BenchThread* work = arg;
+    size_t sum = 0;
+    for (size_t r = 0; r < work->rounds; r++) {
+        for (size_t i = 0; i < work->num_queries; i++) {
+            const int* value = stdem_get_value_ex(work->map, work->queries[i], NULL);
+            sum += value ? (size_t)*value : 1;
+        }
+    }
+    work->sum = sum;
+    return NULL;
+}
+
+/**
+ * @brief Times concurrent lookups on a map built with STEM_FLAGS_THREAD_SAFE
+ * 
+ * Each thread runs the same number of lookups, so the reported rate is
+ * the aggregate throughput for 1, 2, 4, ... up to --threads threads.
+ */
+static void bench_parallel_get(const BenchInput* input) {
+    if (!bench_selected("parallel_get")) {
+        return;
+    }
+    
+    EnumMap* shared = bench_build(input, input->config->flags | STEM_FLAGS_THREAD_SAFE);
+    if (!shared) {
+        return;
+    }
+    
+    /* Calibrate the rounds on one thread so every thread count runs long enough */
+    size_t rounds = 1;
+    double start = bench_now();
+    BenchThread probe = { shared, input->hits, input->num_queries, 1, 0 };
+    bench_thread_get(&probe);
+    double once = bench_now() - start;
+    if (once < options.min_time) {
+        rounds = (size_t)(options.min_time / (once > 1e-9 ? once : 1e-9)) + 1;
+    }
+    
+    for (int threads = 1; threads <= options.max_threads; threads *= 2) {
+        pthread_t ids[BENCH_MAX_THREADS];
+        BenchThread work[BENCH_MAX_THREADS];
+        int started = 0;
+        
+        start = bench_now();
+        for (int t = 0; t < threads; t++) {
+            work[t].map = shared;
+            work[t].queries = input->hits;
+            work[t].num_queries = input->num_queries;
+            work[t].rounds = rounds;
+            work[t].sum = 0;
+            if (pthread_create(&ids[t], NULL, bench_thread_get, &work[t]) != 0) {
+                break;
+            }
+            started++;
+        }
+        for (int t = 0; t < started; t++) {
+            pthread_join(ids[t], NULL);
+            bench_sink += work[t].sum;
+        }
+        double elapsed = bench_now() - start;
+        
+        bench_report("parallel_get", input, started,
+                     (double)started * (double)rounds * (double)input->num_queries, elapsed);
+    }
+    
+    stdem_destroy(shared);
+}
+#endif
+
+/* ==================== DRIVER ==================== */
+
+/**
+ * @brief Prints the command line options
+ */
+static void bench_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --format=csv|json   Output format (default csv)\n"
+            "  --max-size=N        Largest map size, from 16 up to 10000000 (default 1000000)\n"
+            "  --threads=N         Largest thread count for parallel lookups, and the thread\n"
+            "                      count of the parallel iteration, copy and merge (default 4)\n"
+            "  --min-time=SECONDS  Minimum time per measurement (default 0.2)\n"
+            "  --filter=TEXT       Only run operations whose name contains TEXT\n",
+            program);
+}
+
+/**
+ * @brief Parses the command line into the global options
+ * 
+ * @return int 0 on success, 1 on an invalid option
+ */
+static int bench_parse(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--format=json") == 0) {
+            options.json = 1;
+        } else if (strcmp(arg, "--format=csv") == 0) {
+            options.json = 0;
+        } else if (strncmp(arg, "--max-size=", 11) == 0) {
+            options.max_size = (size_t)strtoull(arg + 11, NULL, 10);
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            options.max_threads = atoi(arg + 10);
+        } else if (strncmp(arg, "--min-time=", 11) == 0) {
+            options.min_time = atof(arg + 11);
+        } else if (strncmp(arg, "--filter=", 9) == 0) {
+            options.filter = arg + 9;
+        } else {
+            return 1;
+        }
+    }
+    
+    if (options.max_threads < 1 || options.max_threads > BENCH_MAX_THREADS ||
+        options.max_size < 16 || options.min_time < 0) {
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (bench_parse(argc, argv) != 0) {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    
+    static const BenchConfig configs[] = {
+        { "chained", "dense", STEM_FLAGS_NONE, 0 },
+        { "chained", "sparse", STEM_FLAGS_NONE, 1 },
+        { "incremental", "sparse", STEM_FLAGS_INCREMENTAL_REHASH, 1 },
+        { "dense", "dense", STEM_FLAGS_DENSE, 0 },
+        { "open_addressing", "sparse", STEM_FLAGS_OPEN_ADDRESSING, 1 },
+        { "open_addressing_huge", "sparse", STEM_FLAGS_OPEN_ADDRESSING | STEM_FLAGS_HUGE_PAGES, 1 },
+        { "chained_cached", "sparse", STEM_FLAGS_FRONT_CACHE, 1 },
+        { "frozen", "sparse", STEM_FLAGS_READONLY, 1 }, /* built, then stdem_freeze() */
+    };
+    static const size_t sizes[] = { 16, 256, 4096, 65536, 1000000, 10000000 };
+    
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (sizes[s] > options.max_size) {
+            break;
+        }
+        
+        for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+            const BenchConfig* config = &configs[c];
+            BenchInput input;
+            if (bench_input_init(&input, config, sizes[s]) != 0) {
+                fprintf(stderr, "Out of memory preparing %s/%s with %zu entries\n",
+                        config->backend, config->keys, sizes[s]);
+                bench_input_free(&input);
+                return 1;
+            }
+            
+            bench_get(&input, "get_hit", input.hits);
+            bench_get(&input, "get_miss", input.misses);
+            bench_get(&input, "get_skewed", input.skewed);
+            bench_find_by_name(&input);
+            if (!(config->flags & STEM_FLAGS_READONLY)) {
+                bench_associate(&input);
+                bench_associate_worst(&input);
+            }
+            bench_foreach(&input);
+            bench_copy_merge(&input);
+            bench_serialize(&input);
+            bench_parallel_bulk(&input);
+#if BENCH_HAVE_THREADS
+            bench_parallel_get(&input);
+#endif
+            bench_input_free(&input);
+        }
+    }
+    
+    if (options.json) {
+        printf("%s\n", records ? "\n]" : "[]");
+    }
+    return 0;
+}
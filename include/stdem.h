@@ -19,6 +19,7 @@ extern "C" {
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /**
  * @defgroup stdem Standard Enum Mapping Library
@@ -54,18 +55,143 @@ typedef enum {
     STEM_ERROR_NOT_FOUND,
     STEM_ERROR_ALREADY_EXISTS,
     STEM_ERROR_UNINITIALIZED,
+    STEM_ERROR_BUSY,
 } StemError;
 
 /**
  * @brief Configuration flags for enum map creation
+ * 
+ * STEM_FLAGS_DENSE stores enum values in [0, enum_count) in a direct-indexed
+ * array, so looking them up is a bounds check and an indexed load. Values
+ * outside that range still work and fall back to the hash table.
+ * 
+ * STEM_FLAGS_OPEN_ADDRESSING replaces the chained hash table with a flat,
+ * linearly probed slot array that stores entries and copied values inline.
+ * Value pointers returned for such maps are only valid until the next
+ * association, since growing the table moves the values.
+ * 
+ * STEM_FLAGS_THREAD_SAFE guards the map with a built-in reader-writer lock:
+ * lookups, name searches and iteration take it shared and run in parallel,
+ * while associations and clears take it exclusively. Iterator callbacks
+ * may query the map but must not modify it.
+ * 
+ * STEM_FLAGS_STATS counts lookup hits and misses for stdem_get_stats().
+ * The counters are updated atomically on every lookup, so leave the flag
+ * off for maps queried heavily from many threads.
+ * 
+ * STEM_FLAGS_ORDERED keeps the enum values sorted, so stdem_foreach_range()
+ * streams wide ranges without probing every value. Mutable maps maintain
+ * a two-level B-tree of sorted blocks (values in the dense range need no
+ * index); frozen maps sort their slots once when frozen or opened.
+ * 
+ * STEM_FLAGS_HUGE_PAGES backs the arrays of 2 MB and more (buckets,
+ * slots, dense range, name index, frozen block) with transparent huge
+ * pages, cutting TLB misses on very large maps. STEM_FLAGS_HUGE_PAGES_EXPLICIT
+ * takes them from the reserved huge page pool first. Both only apply on
+ * Linux with the default allocator and are ignored elsewhere.
+ * 
+ * STEM_FLAGS_FRONT_CACHE puts a small direct-mapped cache of recently found
+ * values in front of stdem_get_value_ex(), so the few hot keys of a skewed
+ * workload skip the probe. Each thread has its own cache, shared by every
+ * map with the flag; changes that move or replace values and clears
+ * invalidate the entries of a map. Frozen maps never use it.
  */
 typedef enum {
     STEM_FLAGS_NONE = 0,
     STEM_FLAGS_NO_NAMES = 1 << 0,
     STEM_FLAGS_READONLY = 1 << 1,
     STEM_FLAGS_COPY_VALUES = 1 << 2,
+    STEM_FLAGS_DENSE = 1 << 3,
+    STEM_FLAGS_OPEN_ADDRESSING = 1 << 4,
+    STEM_FLAGS_THREAD_SAFE = 1 << 5,
+    STEM_FLAGS_STATS = 1 << 6,
+    STEM_FLAGS_ORDERED = 1 << 7,
+    STEM_FLAGS_INCREMENTAL_REHASH = 1 << 8,
+    STEM_FLAGS_HUGE_PAGES = 1 << 9,
+    STEM_FLAGS_HUGE_PAGES_EXPLICIT = 1 << 10,
+    STEM_FLAGS_FRONT_CACHE = 1 << 11,
 } StemFlags;
 
+/**
+ * @brief Memory allocation hooks used by an enum map
+ * 
+ * Every allocation a map makes goes through these hooks. Entries, copied
+ * values and names are carved out of large arena chunks, so the hooks are
+ * called a handful of times per map rather than per entry. deallocate
+ * receives the size passed to allocate and may be NULL for allocators that
+ * never reclaim memory.
+ */
+typedef struct {
+    void* (*allocate)(size_t size, void* user_data);
+    void (*deallocate)(void* ptr, size_t size, void* user_data);
+    void* user_data;
+} StemAllocator;
+
+/**
+ * @brief Snapshot of a map's layout, memory use and lookup counters
+ * 
+ * Probe lengths count the entries examined to find an entry stored
+ * outside the dense range: its position in its bucket chain, or its
+ * distance from its home slot plus one. Dense entries are always found
+ * with a single indexed load, and frozen maps with a single probe.
+ */
+typedef struct {
+    size_t count;            /**< Number of entries */
+    size_t dense_count;      /**< Entries in the direct-indexed range */
+    size_t dense_capacity;   /**< Size of the direct-indexed range (0 if none) */
+    size_t table_capacity;   /**< Buckets, open-addressing slots or frozen slots */
+    double load_factor;      /**< Entries outside the dense range per table_capacity */
+    double max_load_factor;  /**< Load factor the table grows at (0 for frozen maps) */
+    size_t max_probe;        /**< Longest chain or probe sequence */
+    double avg_probe;        /**< Average probe length over the entries outside the dense range */
+    size_t name_count;       /**< Indexed names */
+    size_t name_capacity;    /**< Slots of the name index */
+    size_t resize_count;     /**< Times the hash table or slot array was rehashed */
+    size_t rehash_pending;   /**< Old buckets an incremental resize has yet to migrate */
+    size_t heap_bytes;       /**< Bytes the map currently holds from its allocator */
+    size_t pool_bytes;       /**< Bytes of the name pool, shared with pool_maps maps */
+    size_t pool_maps;        /**< Maps sharing the name pool (0 without a pool) */
+    size_t image_bytes;      /**< Bytes of an image read in place and not owned */
+    size_t numa_replicas;    /**< Extra per-node copies of a stdem_freeze_replicated() map */
+    size_t lookup_hits;      /**< Successful value lookups (STEM_FLAGS_STATS only) */
+    size_t lookup_misses;    /**< Failed value lookups (STEM_FLAGS_STATS only) */
+    size_t cache_hits;       /**< Lookup hits answered by the front cache (STEM_FLAGS_STATS only) */
+    size_t name_hits;        /**< Successful name lookups (STEM_FLAGS_STATS only) */
+    size_t name_misses;      /**< Failed name lookups (STEM_FLAGS_STATS only) */
+} StemStats;
+
+/**
+ * @brief One entry produced by an iteration cursor
+ */
+typedef struct {
+    int enum_value;          /**< Enum value of the entry */
+    const char* name;        /**< Name of the entry, or NULL */
+    const void* value;       /**< Stored value pointer */
+} StemItem;
+
+/**
+ * @brief Position of an iteration over a map
+ * 
+ * The fields are internal; start a cursor with stdem_iter_begin and
+ * always finish it with stdem_iter_end.
+ */
+typedef struct {
+    const EnumMap* map;
+    size_t dense_index;
+    size_t slot;
+    size_t bucket;
+    const void* entry;
+} StemIter;
+
+/**
+ * @brief State of a bump allocator over a caller-provided buffer
+ */
+typedef struct {
+    unsigned char* base;
+    size_t size;
+    size_t used;
+} StemStaticBuffer;
+
 /* ==================== CORE C API ==================== */
 
 /**
@@ -74,6 +200,37 @@ typedef enum {
 EnumMap* stdem_create_ex(size_t enum_count, size_t value_size, 
                         StemFlags flags, StemError* error);
 
+/**
+ * @brief Creates a new enum map backed by a custom allocator
+ */
+EnumMap* stdem_create_with_allocator(size_t enum_count, size_t value_size, 
+                                    StemFlags flags, const StemAllocator* allocator, 
+                                    StemError* error);
+
+/**
+ * @brief Creates an empty enum map sharing the name pool of another map
+ * 
+ * Names are interned once per distinct string in a pool shared by every
+ * map created from one another: copies and merges already reuse the pool
+ * of their (first) source, so none of their names is copied again. This
+ * creates a map from scratch that joins the pool and the allocator of
+ * source, so names it is given that the pool already holds are stored
+ * without a copy. Interned names stay allocated until the last map using
+ * the pool is destroyed, even across stdem_clear(). A source without a
+ * pool (frozen or STEM_FLAGS_NO_NAMES maps) gives the new map its own.
+ */
+EnumMap* stdem_create_sharing_names(const EnumMap* source, size_t enum_count, 
+                                   size_t value_size, StemFlags flags, StemError* error);
+
+/**
+ * @brief Initializes an allocator that draws from a fixed buffer
+ * 
+ * Memory is never reclaimed before the buffer is reset, so size the map
+ * up front to avoid table growth.
+ */
+StemAllocator stdem_static_allocator(StemStaticBuffer* buffer, void* memory, 
+                                     size_t size);
+
 /**
  * @brief Simplified enum map creation
  */
@@ -100,11 +257,70 @@ static inline bool stdem_associate(EnumMap* map, int enum_value,
     return stdem_associate_ex(map, enum_value, value, name) == STEM_SUCCESS;
 }
 
+/**
+ * @brief Replaces the value of an existing association in place
+ * 
+ * Copied values are overwritten where they are stored, so pointers from
+ * stdem_get_value_ex() stay valid and nothing is allocated. Returns
+ * STEM_ERROR_NOT_FOUND if enum_value is not associated.
+ */
+StemError stdem_update(EnumMap* map, int enum_value, const void* value);
+
+/**
+ * @brief Updates an association, or creates it if it does not exist
+ * 
+ * A non-NULL name renames an existing entry; NULL keeps its name.
+ */
+StemError stdem_upsert(EnumMap* map, int enum_value, const void* value, const char* name);
+
+/**
+ * @brief Removes an association
+ * 
+ * Returns STEM_ERROR_NOT_FOUND if enum_value is not associated.
+ */
+StemError stdem_remove(EnumMap* map, int enum_value);
+
+/**
+ * @brief Associates many values in one call
+ * 
+ * values[i] and names[i] are what stdem_associate_ex() would take for
+ * keys[i]; either array may be NULL. The map is grown once for the whole
+ * batch. Entries are inserted in order and the first duplicate stops the
+ * call with STEM_ERROR_ALREADY_EXISTS, keeping the entries before it.
+ */
+StemError stdem_associate_bulk(EnumMap* map, const int* keys, const void* const* values, 
+                              const char* const* names, size_t n);
+
+/**
+ * @brief Creates a map presized for and filled with n entries
+ * 
+ * Storage is sized exactly once, so nothing is rehashed while loading.
+ * Unlike stdem_associate_ex(), this also fills STEM_FLAGS_READONLY maps.
+ */
+EnumMap* stdem_create_from_arrays(const int* keys, const void* const* values, 
+                                 const char* const* names, size_t n, 
+                                 size_t value_size, StemFlags flags, StemError* error);
+
 /**
  * @brief Retrieves a value with error reporting
  */
 const void* stdem_get_value_ex(const EnumMap* map, int enum_value, StemError* error);
 
+/**
+ * @brief Retrieves a writable pointer to a value
+ * 
+ * Fails with STEM_ERROR_INVALID_ARG on read-only and frozen maps. The
+ * pointer stays valid until the entry is removed or the map grows.
+ * 
+ * On STEM_FLAGS_THREAD_SAFE maps the lookup takes the lock shared and
+ * releases it before returning, so writes through the pointer are not
+ * synchronized by the map's lock: they race with readers of the value
+ * and with a concurrent stdem_remove. Callers sharing the map must
+ * synchronize such writes themselves, for example with atomic operations
+ * on the value and by not removing the entry while it is being written.
+ */
+void* stdem_get_value_mut(EnumMap* map, int enum_value, StemError* error);
+
 /**
  * @brief Simplified value retrieval
  */
@@ -130,17 +346,85 @@ static inline const char* stdem_get_name(const EnumMap* map, int enum_value) {
     return stdem_get_name_ex(map, enum_value, NULL);
 }
 
+/**
+ * @brief Retrieves the values of many enum entries in one call
+ * 
+ * Stores the value pointer of keys[i] in out[i] (NULL when missing) and
+ * returns the number of keys found. The lock is taken once, and hashing
+ * and memory accesses are overlapped across the batch.
+ */
+size_t stdem_get_values_batch(const EnumMap* map, const int* keys, size_t n, 
+                              const void** out);
+
+/**
+ * @brief Checks many enum values for presence in one call
+ * 
+ * Returns the number of keys found; out may be NULL when only the count
+ * is needed.
+ */
+size_t stdem_exists_batch(const EnumMap* map, const int* keys, size_t n, bool* out);
+
 /**
  * @brief Finds an enum value by its name
+ * 
+ * When several entries share the name, the one associated first is found
+ * while it keeps the name; after it is removed or renamed, any remaining
+ * entry with the name may be found.
  */
 int stdem_find_by_name(const EnumMap* map, const char* name, StemError* error);
 
+/**
+ * @brief Finds enum value by a name that need not be NUL-terminated
+ * 
+ * Meant for tokens sliced out of a larger buffer: exactly length bytes of
+ * name are compared, without copying them.
+ */
+int stdem_find_by_name_n(const EnumMap* map, const char* name, size_t length, 
+                         StemError* error);
+
 /**
  * @brief Iterates over all entries in the enum map
  */
 StemError stdem_foreach(const EnumMap* map, EnumMapIterator iterator, 
                        void* user_data);
 
+/**
+ * @brief Iterates over the entries with enum values in [lo, hi] in ascending order
+ * 
+ * Maps with STEM_FLAGS_ORDERED allocate nothing. Maps without it look up
+ * every value of a range outside the dense range when it is narrower than
+ * the number of entries, and otherwise collect the entries of the range in
+ * one pass and sort them, using a temporary array of up to one StemItem
+ * per entry. Either way the cost is bounded by the entry count (count *
+ * log(count) steps at most), never by the width of the range. Returns
+ * STEM_ERROR_OUT_OF_MEMORY if the temporary array cannot be allocated.
+ */
+StemError stdem_foreach_range(const EnumMap* map, int lo, int hi, 
+                              EnumMapIterator iterator, void* user_data);
+
+/**
+ * @brief Starts a cursor over all entries of a map
+ * 
+ * A thread-safe map stays locked for reading until stdem_iter_end, so the
+ * map must not be modified by the iterating thread in between.
+ */
+StemError stdem_iter_begin(const EnumMap* map, StemIter* iter);
+
+/**
+ * @brief Moves a cursor to the next entry
+ */
+bool stdem_iter_next(StemIter* iter, StemItem* item);
+
+/**
+ * @brief Reads up to max entries from a cursor in one call
+ */
+size_t stdem_iter_next_batch(StemIter* iter, StemItem* items, size_t max);
+
+/**
+ * @brief Finishes a cursor started by stdem_iter_begin
+ */
+void stdem_iter_end(StemIter* iter);
+
 /**
  * @brief Returns the number of entries in the enum map
  */
@@ -151,13 +435,58 @@ size_t stdem_count(const EnumMap* map);
  */
 size_t stdem_value_size(const EnumMap* map);
 
+/**
+ * @brief Reports the layout, memory use and lookup counters of a map
+ * 
+ * Walks the whole map under its shared lock, so it costs about as much
+ * as an iteration; sample it rather than calling it per operation.
+ */
+StemError stdem_get_stats(const EnumMap* map, StemStats* stats);
+
+/**
+ * @brief Resets the STEM_FLAGS_STATS lookup counters of a map to zero
+ */
+StemError stdem_reset_stats(const EnumMap* map);
+
 /**
  * @brief Clears all associations in the enum map
  */
 StemError stdem_clear(EnumMap* map);
 
+/**
+ * @brief Makes room for n entries in total without growing the table
+ * 
+ * Also reserves the name index and the name pool, so loading n named
+ * entries rehashes nothing. Fails with STEM_ERROR_INVALID_ARG on frozen,
+ * read-only and published maps, like the other mutators.
+ */
+StemError stdem_reserve(EnumMap* map, size_t n);
+
+/**
+ * @brief Shrinks the table and the name index to the current entries
+ * 
+ * Gives back the memory a cleared or mostly removed map keeps otherwise.
+ * Open-addressing values move, like on growth. Read-only and published
+ * maps are rejected.
+ */
+StemError stdem_shrink_to_fit(EnumMap* map);
+
+/**
+ * @brief Sets the load factor at which the table grows
+ * 
+ * Pass 0.1 up to 0.95 for open addressing and up to 4 for chained
+ * buckets (the default is 0.75); lower factors trade memory for shorter
+ * probes. The table is resized to take as many entries as before, so
+ * calling this right after creation sizes it as if created with it.
+ * Copies and merges keep the factor of their (first) source. Read-only
+ * and published maps are rejected.
+ */
+StemError stdem_set_max_load_factor(EnumMap* map, float max_load);
+
 /**
  * @brief Creates a copy of an enum map
+ * 
+ * The copy shares the name pool of the source, so names are not copied.
  */
 EnumMap* stdem_copy(const EnumMap* map, StemError* error);
 
@@ -167,6 +496,73 @@ EnumMap* stdem_copy(const EnumMap* map, StemError* error);
 EnumMap* stdem_merge(const EnumMap* map1, const EnumMap* map2, 
                     bool overwrite, StemError* error);
 
+/**
+ * @brief Adds the associations of src to dst in place
+ * 
+ * Keys present in both are overwritten or kept as in stdem_merge(); only
+ * src is walked, so the cost grows with src alone. Both maps need the
+ * same value size.
+ * 
+ * The table, name index, arena and name pool of dst are grown for the
+ * whole merge before any entry changes, so STEM_ERROR_OUT_OF_MEMORY leaves
+ * dst as it was, unless maps sharing its name pool intern names meanwhile.
+ */
+StemError stdem_merge_into(EnumMap* dst, const EnumMap* src, bool overwrite);
+
+/**
+ * @brief Self-contained change set between two maps, see stdem_diff()
+ */
+typedef struct StemPatch StemPatch;
+
+/**
+ * @brief Computes the changes turning one map into another
+ * 
+ * The patch holds one operation per entry added, changed (value or name)
+ * or removed, with copies of the new values and names, so it stays valid
+ * after both maps are destroyed. Computing it walks both maps; applying it
+ * costs only the changed entries.
+ */
+StemPatch* stdem_diff(const EnumMap* from, const EnumMap* to, StemError* error);
+
+/**
+ * @brief Applies a patch from stdem_diff() to a map
+ * 
+ * Changed entries get the value and name of the target, and removed ones
+ * are removed if present, so applying the same patch twice changes
+ * nothing more.
+ */
+StemError stdem_apply_patch(EnumMap* map, const StemPatch* patch);
+
+/**
+ * @brief Returns the number of changes a patch holds
+ */
+size_t stdem_patch_count(const StemPatch* patch);
+
+/**
+ * @brief Destroys a patch
+ */
+void stdem_patch_destroy(StemPatch* patch);
+
+/**
+ * @brief Compiles a map into an immutable perfect-hash map
+ * 
+ * The result holds the same associations in one compact block: minimal
+ * perfect hash tables over the enum values and the names resolve every
+ * lookup with a single probe. It carries STEM_FLAGS_READONLY; the source
+ * map is left untouched.
+ */
+EnumMap* stdem_freeze(const EnumMap* map, StemError* error);
+
+/**
+ * @brief Freezes a map and places a copy of it on every NUMA node
+ * 
+ * Lookups (values, names, batches) read the copy of the node the calling
+ * thread runs on, found with one sched_getcpu() call. Other operations use
+ * the copy of the node that froze the map. On single-node machines and
+ * outside Linux this is stdem_freeze().
+ */
+EnumMap* stdem_freeze_replicated(const EnumMap* map, StemError* error);
+
 /**
  * @brief Returns the last error that occurred
  */
@@ -199,132 +595,665 @@ static inline const void* stdem_get_value_or(const EnumMap* map, int enum_value,
 #define stdem_get_value_or_default(map, enum_value, type, default_val) \
     (stdem_exists(map, enum_value) ? *stdem_get_value_as(map, enum_value, type) : default_val)
 
-/** @} */ // end of group stdem
+/* ==================== SERIALIZATION ==================== */
 
-#ifdef __cplusplus
-}
+/**
+ * @brief Sink of a serialization, returns the number of bytes it consumed
+ */
+typedef size_t (*StemWriteCallback)(const void* data, size_t size, void* user_data);
 
-#include <initializer_list>
-#include <utility>
-#include <stdexcept>
-#include <functional>
-#include <vector>
-#include <string>
-#include <type_traits>
+/**
+ * @brief Source of a deserialization, returns the number of bytes it produced
+ */
+typedef size_t (*StemReadCallback)(void* data, size_t size, void* user_data);
 
 /**
- * @brief C++ wrapper for the Standard Enum Mapping Library
+ * @brief Returns the exact number of bytes stdem_serialize() writes
  */
-namespace stem {
+size_t stdem_serialized_size(const EnumMap* map);
 
 /**
- * @brief C++ RAII wrapper for EnumMap
+ * @brief Writes a map to a stream as a binary image
+ * 
+ * The image (format version 2) is a fixed-width header followed by the
+ * map's frozen form, see stdem_freeze(). It can be read back with
+ * stdem_deserialize() or used in place with stdem_open_image(). Pointer
+ * values are stored as they are and only stay meaningful in the writing
+ * process.
  */
-class EnumMap {
-private:
-    ::EnumMap* map_;
-    
-public:
-    using Iterator = std::function<void(int, const char*, const void*, size_t)>;
-    
-    /**
-     * @brief Constructs a new EnumMap
-     */
-    EnumMap(size_t enum_count, size_t value_size = 0, 
-            StemFlags flags = STEM_FLAGS_NONE) {
-        StemError error;
-        map_ = ::stdem_create_ex(enum_count, value_size, flags, &error);
-        if (!map_) {
-            throw std::runtime_error(::stdem_error_string(error));
-        }
-    }
-    
-    /**
-     * @brief Construct from initializer list
-     */
-    template<typename T>
-    EnumMap(std::initializer_list<std::pair<int, T>> init_list,
-            size_t value_size = sizeof(T),
-            StemFlags flags = STEM_FLAGS_COPY_VALUES) {
-        StemError error;
-        map_ = ::stdem_create_ex(init_list.size(), value_size, flags, &error);
-        if (!map_) {
-            throw std::runtime_error(::stdem_error_string(error));
-        }
-        
-        for (const auto& pair : init_list) {
-            associate(pair.first, &pair.second);
-        }
-    }
-    
-    ~EnumMap() {
-        if (map_) {
-            ::stdem_destroy(map_);
-        }
-    }
-    
-    EnumMap(const EnumMap&) = delete;
-    EnumMap& operator=(const EnumMap&) = delete;
-    
-    EnumMap(EnumMap&& other) noexcept : map_(other.map_) {
-        other.map_ = nullptr;
-    }
-    
-    EnumMap& operator=(EnumMap&& other) noexcept {
-        if (this != &other) {
-            if (map_) {
-                ::stdem_destroy(map_);
-            }
-            map_ = other.map_;
-            other.map_ = nullptr;
-        }
-        return *this;
-    }
-    
-    /**
-     * @brief Associates a value with an enum entry
-     */
-    void associate(int enum_value, const void* value, const char* name = nullptr) {
-        StemError error = ::stdem_associate_ex(map_, enum_value, value, name);
-        if (error != STEM_SUCCESS) {
-            throw std::runtime_error(::stdem_error_string(error));
-        }
-    }
-    
-    /**
-     * @brief Type-safe value association
-     */
-    template<typename T>
-    void associate(int enum_value, const T& value, const char* name = nullptr) {
-        associate(enum_value, &value, name);
-    }
-    
-    /**
-     * @brief Retrieves a value with type safety
-     */
-    template<typename T>
-    const T& get(int enum_value) const {
-        const T* value = static_cast<const T*>(::stdem_get_value_ex(map_, enum_value, nullptr));
-        if (!value) {
-            throw std::runtime_error("Enum value not found");
-        }
-        return *value;
-    }
-    
-    /**
-     * @brief Safe value retrieval with default
-     */
-    template<typename T>
-    T get_or(int enum_value, const T& default_value) const {
-        const T* value = static_cast<const T*>(::stdem_get_value_ex(map_, enum_value, nullptr));
-        return value ? *value : default_value;
-    }
+StemError stdem_serialize(const EnumMap* map, FILE* stream);
+
+/**
+ * @brief Reads a map written by stdem_serialize()
+ * 
+ * Accepts version 1 and version 2 streams. Maps that were read-only are
+ * returned frozen; other maps are rebuilt with their original flags.
+ */
+EnumMap* stdem_deserialize(FILE* stream, StemError* error);
+
+/**
+ * @brief Writes the image of a map through a callback
+ * 
+ * The callback receives two pieces, the header and the block. Short
+ * writes are continued and a return of 0 fails the call.
+ */
+StemError stdem_serialize_with(const EnumMap* map, StemWriteCallback write, void* user_data);
+
+/**
+ * @brief Reads a map through a callback, see stdem_deserialize()
+ * 
+ * Short reads are continued; a return of 0 ends the input.
+ */
+EnumMap* stdem_deserialize_with(StemReadCallback read, void* user_data, StemError* error);
+
+/**
+ * @brief Writes the image of a map into a buffer
+ * 
+ * Size the buffer with stdem_serialized_size(). A buffer that is too small
+ * fails with STEM_ERROR_INDEX_OUT_OF_BOUNDS and *written set to the size
+ * needed.
+ */
+StemError stdem_serialize_to_buffer(const EnumMap* map, void* buffer, size_t size, 
+                                    size_t* written);
+
+/**
+ * @brief Reads a map from a buffer, see stdem_deserialize()
+ */
+EnumMap* stdem_deserialize_from_buffer(const void* buffer, size_t size, StemError* error);
+
+/**
+ * @brief Opens an image in memory as a read-only map without copying it
+ * 
+ * data must be 8-byte aligned and stay valid and unchanged until the map
+ * is destroyed. Opening only validates the image header, so it takes the
+ * same time for any image size.
+ */
+EnumMap* stdem_open_image(const void* data, size_t size, StemError* error);
+
+/**
+ * @brief Maps an image file into memory as a read-only map
+ * 
+ * Pages are loaded on first access and shared between processes mapping
+ * the same file; the mapping is released by stdem_destroy(). On systems
+ * without mmap the file is read into memory instead.
+ */
+EnumMap* stdem_map_image(const char* path, StemError* error);
+
+/* ==================== SHARED MEMORY MAPS ==================== */
+
+/**
+ * @brief Returns the region size needed to publish images of a given size
+ * 
+ * Pass the largest stdem_serialized_size() expected; the region holds two
+ * images of that size plus a small header.
+ */
+size_t stdem_shared_region_size(size_t image_size);
+
+/**
+ * @brief Prepares a caller-provided shared-memory region for publishing
+ * 
+ * region must be 8-byte aligned, for instance the start of a shared
+ * mapping. Initializing discards any published image and any reader pins,
+ * so it is done once, before readers attach.
+ */
+StemError stdem_shared_init(void* region, size_t size);
+
+/**
+ * @brief Publishes a map into a shared region as a read-only image
+ * 
+ * The image is written into the buffer readers are not using and then
+ * made current, so attached readers keep their image unchanged. Fails
+ * with STEM_ERROR_BUSY while readers still hold that buffer and with
+ * STEM_ERROR_INDEX_OUT_OF_BOUNDS if the image does not fit. Only one
+ * process may publish into a region.
+ */
+StemError stdem_shared_publish(void* region, size_t size, const EnumMap* map);
+
+/**
+ * @brief Attaches to the latest image in a shared region without copying it
+ * 
+ * Returns a read-only map over the region, which must stay mapped
+ * read-write until the map is destroyed, since attaching pins the image.
+ * Fails with STEM_ERROR_NOT_FOUND before the first publish. Pointer values
+ * are only meaningful in the publishing process.
+ */
+EnumMap* stdem_shared_attach(void* region, size_t size, StemError* error);
+
+/**
+ * @brief Returns the number of images published into a shared region
+ * 
+ * Readers poll it and attach again once it changes.
+ */
+uint64_t stdem_shared_generation(const void* region);
+
+/* ==================== PARALLEL OPERATIONS ==================== */
+
+/**
+ * @brief Unit of work handed to an executor
+ */
+typedef void (*StemTask)(size_t index, void* context);
+
+/**
+ * @brief Runs batches of independent tasks, typically on a thread pool
+ * 
+ * run must call task(i, context) exactly once for every i in [0, count),
+ * in any order and on any threads, and return only once every call has
+ * finished. Parallel operations split their work into workers tasks; an
+ * executor with fewer than two workers or no run hook makes them run on
+ * the calling thread.
+ */
+typedef struct {
+    void (*run)(StemTask task, void* context, size_t count, void* user_data);
+    size_t workers;
+    void* user_data;
+} StemExecutor;
+
+/**
+ * @brief Returns the built-in executor, which starts a thread per task
+ * 
+ * threads 0 uses one thread per online CPU. Without POSIX threads the
+ * executor runs everything on the calling thread.
+ */
+StemExecutor stdem_thread_executor(size_t threads);
+
+/**
+ * @brief Iterates over all entries on several threads
+ * 
+ * The storage is split into executor->workers contiguous ranges of
+ * buckets, slots or records, visited concurrently, so the iterator must
+ * be safe to call from several threads at once. Entries within a range
+ * come in stdem_foreach order.
+ */
+StemError stdem_foreach_parallel(const EnumMap* map, EnumMapIterator iterator, 
+                                 void* user_data, const StemExecutor* executor);
+
+/**
+ * @brief Creates a copy of an enum map, building it on several threads
+ * 
+ * The copy keeps the table sizes of the source, so every range of the
+ * source is copied into the same range of the copy without any locking.
+ * Frozen maps are copied as by stdem_copy().
+ */
+EnumMap* stdem_copy_parallel(const EnumMap* map, const StemExecutor* executor, 
+                             StemError* error);
+
+/**
+ * @brief Merges two enum maps, copying the first one on several threads
+ * 
+ * Holds the same associations as stdem_merge(). The second map's entries are added on the
+ * calling thread, so this pays off when map1 is the larger input.
+ */
+EnumMap* stdem_merge_parallel(const EnumMap* map1, const EnumMap* map2, bool overwrite, 
+                              const StemExecutor* executor, StemError* error);
+
+/* ==================== SNAPSHOT PUBLISHING ==================== */
+
+/**
+ * @brief Holder of the current version of a read-mostly map
+ * 
+ * A writer builds a new map off to the side (for example with
+ * stdem_snapshot_copy_current() plus associations) and publishes it
+ * atomically. Readers enter a wait-free read section to get the current
+ * map; replaced maps are destroyed once no read section can still see
+ * them (epoch-based reclamation). Published maps are immutable.
+ */
+typedef struct StemSnapshot StemSnapshot;
+
+/**
+ * @brief Per-thread reader registration of a StemSnapshot
+ */
+typedef struct StemSnapshotReader StemSnapshotReader;
+
+/**
+ * @brief Creates a snapshot holder; takes ownership of the initial map
+ */
+StemSnapshot* stdem_snapshot_create(EnumMap* initial, size_t max_readers, 
+                                    StemError* error);
+
+/**
+ * @brief Destroys a snapshot holder together with all maps it owns
+ */
+void stdem_snapshot_destroy(StemSnapshot* snapshot);
+
+/**
+ * @brief Registers a reader; each reading thread needs its own handle
+ */
+StemSnapshotReader* stdem_snapshot_register_reader(StemSnapshot* snapshot, 
+                                                   StemError* error);
+
+/**
+ * @brief Releases a reader registration
+ */
+void stdem_snapshot_unregister_reader(StemSnapshotReader* reader);
+
+/**
+ * @brief Enters a wait-free read section and returns the current map
+ */
+const EnumMap* stdem_snapshot_read_begin(StemSnapshotReader* reader);
+
+/**
+ * @brief Leaves a read section; the map returned by read_begin may then go away
+ */
+void stdem_snapshot_read_end(StemSnapshotReader* reader);
+
+/**
+ * @brief Atomically publishes a new map; takes ownership of it
+ */
+StemError stdem_snapshot_publish(StemSnapshot* snapshot, EnumMap* map);
+
+/**
+ * @brief Destroys retired maps no reader can see; returns how many remain
+ */
+size_t stdem_snapshot_reclaim(StemSnapshot* snapshot);
+
+/**
+ * @brief Returns a mutable copy of the current map to build the next version
+ */
+EnumMap* stdem_snapshot_copy_current(StemSnapshot* snapshot, StemError* error);
+
+/* ==================== BACKGROUND LOADING ==================== */
+
+/**
+ * @brief Handle of a load or rebuild running on a background thread
+ * 
+ * Every handle is released exactly once, by stdem_async_wait() or
+ * stdem_async_detach().
+ */
+typedef struct StemAsync StemAsync;
+
+/**
+ * @brief Completion callback, called on the worker thread once the new map
+ * is published (error STEM_SUCCESS) or the operation failed
+ */
+typedef void (*StemAsyncCallback)(StemError error, void* user_data);
+
+/**
+ * @brief Changes a mutable copy of the current map on the worker thread;
+ * anything but STEM_SUCCESS cancels the rebuild
+ */
+typedef StemError (*StemRebuildCallback)(EnumMap* next, void* user_data);
+
+/**
+ * @brief Reads an image file on a worker thread and publishes it
+ * 
+ * The current map of the snapshot keeps serving readers while the file is
+ * read with stdem_deserialize(); the result then replaces it as by
+ * stdem_snapshot_publish(). done (optional) is called last.
+ */
+StemAsync* stdem_load_async(StemSnapshot* snapshot, const char* path, 
+                            StemAsyncCallback done, void* user_data, StemError* error);
+
+/**
+ * @brief Copies the current map, changes it and publishes it on a worker thread
+ * 
+ * Rebuilds of one snapshot must not overlap, or the later publish drops the
+ * changes of the earlier one; wait for a rebuild before starting the next.
+ */
+StemAsync* stdem_rebuild_async(StemSnapshot* snapshot, StemRebuildCallback rebuild, 
+                               StemAsyncCallback done, void* user_data, StemError* error);
+
+/**
+ * @brief Tells whether a background operation has finished, without blocking
+ */
+bool stdem_async_ready(const StemAsync* op);
+
+/**
+ * @brief Waits for a background operation, releases it and returns its result
+ */
+StemError stdem_async_wait(StemAsync* op);
+
+/**
+ * @brief Releases a background operation without waiting for it
+ * 
+ * The operation still runs to completion and calls its callback.
+ */
+void stdem_async_detach(StemAsync* op);
+
+/* ==================== TABLES ==================== */
+
+/**
+ * @brief Several value columns sharing one key and name index
+ * 
+ * A table holds one row per enum value. The index (an EnumMap with the
+ * given flags) maps every enum value and name to its row, and each column
+ * stores one value per row in a contiguous array. Looking a key up once
+ * gives a row that is valid for every column, so N attributes cost one
+ * probe and one copy of the keys and names instead of N maps. Rows are
+ * numbered 0 to stdem_table_rows() - 1; removing a row moves the last row
+ * into its place. Cell pointers stay valid until the next insert or
+ * removal.
+ */
+typedef struct StemTable StemTable;
+
+#define STEM_TABLE_NONE ((size_t)-1) /**< Row or column index meaning "none" */
+
+/**
+ * @brief Creates an empty table without columns
+ * 
+ * flags configure the index as for stdem_create_ex() (STEM_FLAGS_DENSE,
+ * STEM_FLAGS_OPEN_ADDRESSING, STEM_FLAGS_NO_NAMES, STEM_FLAGS_THREAD_SAFE
+ * and so on); STEM_FLAGS_READONLY is rejected. allocator may be NULL.
+ */
+StemTable* stdem_table_create(size_t capacity, StemFlags flags, 
+                              const StemAllocator* allocator, StemError* error);
+
+/**
+ * @brief Destroys a table, its index and all columns
+ */
+void stdem_table_destroy(StemTable* table);
+
+/**
+ * @brief Adds a column of value_size-byte cells, zeroed for existing rows
+ * 
+ * @return size_t Index of the new column, or STEM_TABLE_NONE on failure
+ */
+size_t stdem_table_add_column(StemTable* table, size_t value_size, StemError* error);
+
+/**
+ * @brief Adds a row for an absent enum value; its cells start zeroed
+ * 
+ * @return size_t Index of the new row, or STEM_TABLE_NONE on failure
+ *         (STEM_ERROR_ALREADY_EXISTS if the value has a row)
+ */
+size_t stdem_table_insert(StemTable* table, int enum_value, const char* name, 
+                          StemError* error);
+
+/**
+ * @brief Removes the row of an enum value, moving the last row into its place
+ */
+StemError stdem_table_remove(StemTable* table, int enum_value);
+
+/**
+ * @brief Returns the row of an enum value, or STEM_TABLE_NONE
+ */
+size_t stdem_table_find(const StemTable* table, int enum_value);
+
+/**
+ * @brief Returns the row of the entry with a name, or STEM_TABLE_NONE
+ */
+size_t stdem_table_find_by_name(const StemTable* table, const char* name);
+
+/**
+ * @brief Returns the cell of a row in a column, or NULL if either is out of range
+ */
+void* stdem_table_cell(const StemTable* table, size_t row, size_t column);
+
+/**
+ * @brief Looks an enum value up and returns its cell in a column
+ */
+const void* stdem_table_get(const StemTable* table, int enum_value, size_t column, 
+                            StemError* error);
+
+/**
+ * @brief Copies a value into the cell of an enum value in a column
+ */
+StemError stdem_table_set(StemTable* table, int enum_value, size_t column, const void* value);
+
+/**
+ * @brief Returns the cells of a column, stdem_table_rows() of them back to back
+ */
+void* stdem_table_column(const StemTable* table, size_t column);
+
+/**
+ * @brief Returns the enum value of a row (0 if out of range)
+ */
+int stdem_table_key(const StemTable* table, size_t row);
+
+/**
+ * @brief Returns the name of a row, or NULL
+ */
+const char* stdem_table_name(const StemTable* table, size_t row);
+
+/**
+ * @brief Returns the number of rows
+ */
+size_t stdem_table_rows(const StemTable* table);
+
+/**
+ * @brief Returns the key index, for stdem_get_stats() or iteration
+ * 
+ * Its values are pointers to the size_t row of each entry.
+ */
+const EnumMap* stdem_table_index(const StemTable* table);
+
+/**
+ * @brief Retrieves a cell with type safety
+ */
+#define stdem_table_get_as(table, enum_value, column, type) \
+    ((const type*)stdem_table_get(table, enum_value, column, NULL))
+
+/** @} */ // end of group stdem
+
+#ifdef __cplusplus
+}
+
+#include <initializer_list>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+#include <future>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <string>
+#include <type_traits>
+
+/**
+ * @brief C++ wrapper for the Standard Enum Mapping Library
+ */
+namespace stem {
+
+/**
+ * @brief C++ RAII wrapper for EnumMap
+ */
+class EnumMap {
+private:
+    ::EnumMap* map_;
+    
+public:
+    using Iterator = std::function<void(int, const char*, const void*, size_t)>;
+    
+    /**
+     * @brief Constructs a new EnumMap
+     */
+    EnumMap(size_t enum_count, size_t value_size = 0, 
+            StemFlags flags = STEM_FLAGS_NONE) {
+        StemError error;
+        map_ = ::stdem_create_ex(enum_count, value_size, flags, &error);
+        if (!map_) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Construct from initializer list
+     */
+    template<typename T>
+    EnumMap(std::initializer_list<std::pair<int, T>> init_list,
+            size_t value_size = sizeof(T),
+            StemFlags flags = STEM_FLAGS_COPY_VALUES) {
+        StemError error;
+        map_ = ::stdem_create_ex(init_list.size(), value_size, flags, &error);
+        if (!map_) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        
+        for (const auto& pair : init_list) {
+            associate(pair.first, static_cast<const void*>(&pair.second));
+        }
+    }
+    
+    ~EnumMap() {
+        if (map_) {
+            ::stdem_destroy(map_);
+        }
+    }
+    
+    EnumMap(const EnumMap&) = delete;
+    EnumMap& operator=(const EnumMap&) = delete;
+    
+    EnumMap(EnumMap&& other) noexcept : map_(other.map_) {
+        other.map_ = nullptr;
+    }
+    
+    EnumMap& operator=(EnumMap&& other) noexcept {
+        if (this != &other) {
+            if (map_) {
+                ::stdem_destroy(map_);
+            }
+            map_ = other.map_;
+            other.map_ = nullptr;
+        }
+        return *this;
+    }
+    
+    /**
+     * @brief Associates a value with an enum entry
+     */
+    void associate(int enum_value, const void* value, const char* name = nullptr) {
+        StemError error = ::stdem_associate_ex(map_, enum_value, value, name);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Type-safe value association
+     */
+    template<typename T>
+    void associate(int enum_value, const T& value, const char* name = nullptr) {
+        associate(enum_value, static_cast<const void*>(&value), name);
+    }
+    
+    /**
+     * @brief Replaces the value of an existing entry
+     */
+    void update(int enum_value, const void* value) {
+        StemError error = ::stdem_update(map_, enum_value, value);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Type-safe value update
+     */
+    template<typename T>
+    void update(int enum_value, const T& value) {
+        update(enum_value, static_cast<const void*>(&value));
+    }
+    
+    /**
+     * @brief Updates an entry, or creates it if it does not exist
+     */
+    void upsert(int enum_value, const void* value, const char* name = nullptr) {
+        StemError error = ::stdem_upsert(map_, enum_value, value, name);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Type-safe upsert
+     */
+    template<typename T>
+    void upsert(int enum_value, const T& value, const char* name = nullptr) {
+        upsert(enum_value, static_cast<const void*>(&value), name);
+    }
+    
+    /**
+     * @brief Removes an entry, returning whether it existed
+     */
+    bool remove(int enum_value) {
+        StemError error = ::stdem_remove(map_, enum_value);
+        if (error != STEM_SUCCESS && error != STEM_ERROR_NOT_FOUND) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return error == STEM_SUCCESS;
+    }
+    
+    /**
+     * @brief Retrieves a writable value with type safety
+     * 
+     * Writes through the reference are not synchronized by the lock of a
+     * thread-safe map; see stdem_get_value_mut().
+     */
+    template<typename T>
+    T& get_mut(int enum_value) {
+        T* value = static_cast<T*>(::stdem_get_value_mut(map_, enum_value, nullptr));
+        if (!value) {
+            throw std::runtime_error("Enum value not found");
+        }
+        return *value;
+    }
+    
+    /**
+     * @brief Retrieves a value with type safety
+     */
+    template<typename T>
+    const T& get(int enum_value) const {
+        const T* value = static_cast<const T*>(::stdem_get_value_ex(map_, enum_value, nullptr));
+        if (!value) {
+            throw std::runtime_error("Enum value not found");
+        }
+        return *value;
+    }
+    
+    /**
+     * @brief Safe value retrieval with default
+     */
+    template<typename T>
+    T get_or(int enum_value, const T& default_value) const {
+        const T* value = static_cast<const T*>(::stdem_get_value_ex(map_, enum_value, nullptr));
+        return value ? *value : default_value;
+    }
+    
+    /**
+     * @brief Checks if enum value exists
+     */
+    bool contains(int enum_value) const {
+        return ::stdem_get_value_ex(map_, enum_value, nullptr) != nullptr;
+    }
+    
+    /**
+     * @brief Adds the entries of another map in place
+     */
+    void merge_from(const EnumMap& other, bool overwrite = true) {
+        StemError error = ::stdem_merge_into(map_, other.map_, overwrite);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Makes room for n entries in total
+     */
+    void reserve(size_t n) {
+        StemError error = ::stdem_reserve(map_, n);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Shrinks the table to the current entries
+     */
+    void shrink_to_fit() {
+        StemError error = ::stdem_shrink_to_fit(map_);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
     
     /**
-     * @brief Checks if enum value exists
+     * @brief Sets the load factor at which the table grows
      */
-    bool contains(int enum_value) const {
-        return ::stdem_get_value_ex(map_, enum_value, nullptr) != nullptr;
+    void max_load_factor(float max_load) {
+        StemError error = ::stdem_set_max_load_factor(map_, max_load);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
     }
     
     /**
@@ -335,10 +1264,414 @@ public:
     }
     
     /**
-     * @brief Returns value size in bytes
+     * @brief Returns value size in bytes
+     */
+    size_t value_size() const {
+        return ::stdem_value_size(map_);
+    }
+    
+    /**
+     * @brief Returns layout, memory and lookup statistics
+     */
+    StemStats stats() const {
+        StemStats stats;
+        StemError error = ::stdem_get_stats(map_, &stats);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return stats;
+    }
+    
+    /**
+     * @brief Clears all associations
+     */
+    void clear() {
+        StemError error = ::stdem_clear(map_);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Forward-only iterator over the entries of a map
+     * 
+     * Entries are read from the C cursor in batches, so advancing is an
+     * index increment on a local buffer. Copies share one cursor, and the
+     * map is released once the last copy is gone or the end is reached.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = StemItem;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const StemItem*;
+        using reference = const StemItem&;
+        
+        const_iterator() = default;
+        
+        explicit const_iterator(const ::EnumMap* map) : state_(std::make_shared<State>()) {
+            StemError error = ::stdem_iter_begin(map, &state_->iter);
+            if (error != STEM_SUCCESS) {
+                state_.reset();
+                throw std::runtime_error(::stdem_error_string(error));
+            }
+            refill();
+        }
+        
+        reference operator*() const { return state_->items[state_->index]; }
+        pointer operator->() const { return &state_->items[state_->index]; }
+        
+        const_iterator& operator++() {
+            if (++state_->index == state_->count) {
+                refill();
+            }
+            return *this;
+        }
+        
+        void operator++(int) { ++*this; }
+        
+        bool operator==(const const_iterator& other) const { return state_ == other.state_; }
+        bool operator!=(const const_iterator& other) const { return state_ != other.state_; }
+        
+    private:
+        static const size_t kBatch = 32;
+        
+        struct State {
+            StemIter iter;
+            StemItem items[kBatch];
+            size_t count = 0;
+            size_t index = 0;
+            
+            ~State() { ::stdem_iter_end(&iter); }
+        };
+        
+        void refill() {
+            state_->count = ::stdem_iter_next_batch(&state_->iter, state_->items, kBatch);
+            state_->index = 0;
+            if (state_->count == 0) {
+                state_.reset();
+            }
+        }
+        
+        std::shared_ptr<State> state_;
+    };
+    
+    /**
+     * @brief Returns an iterator to the first entry
+     */
+    const_iterator begin() const { return const_iterator(map_); }
+    
+    /**
+     * @brief Returns the past-the-end iterator
+     */
+    const_iterator end() const { return const_iterator(); }
+    
+    /**
+     * @brief Iterates over all entries
+     */
+    void for_each(Iterator iterator) const {
+        auto c_iterator = [](int ev, const char* en, const void* v, size_t vs, void* ud) {
+            (*static_cast<Iterator*>(ud))(ev, en, v, vs);
+        };
+        
+        StemError error = ::stdem_foreach(map_, c_iterator, &iterator);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Iterates over the entries in [lo, hi] in ascending enum order
+     */
+    void for_each_range(int lo, int hi, Iterator iterator) const {
+        auto c_iterator = [](int ev, const char* en, const void* v, size_t vs, void* ud) {
+            (*static_cast<Iterator*>(ud))(ev, en, v, vs);
+        };
+        
+        StemError error = ::stdem_foreach_range(map_, lo, hi, c_iterator, &iterator);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Gets all enum values
+     */
+    std::vector<int> keys() const {
+        std::vector<int> result;
+        result.reserve(size());
+        for (const StemItem& item : *this) {
+            result.push_back(item.enum_value);
+        }
+        return result;
+    }
+    
+    /**
+     * @brief Gets all enum names
+     */
+    std::vector<std::string> names() const {
+        std::vector<std::string> result;
+        result.reserve(size());
+        for (const StemItem& item : *this) {
+            if (item.name) result.push_back(item.name);
+        }
+        return result;
+    }
+    
+    /**
+     * @brief Finds enum value by name
+     */
+    int find(const std::string& name) const {
+        StemError error;
+        int result = ::stdem_find_by_name(map_, name.c_str(), &error);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return result;
+    }
+    
+    /**
+     * @brief Array-style access
+     */
+    template<typename T>
+    const T& operator[](int enum_value) const {
+        return get<T>(enum_value);
+    }
+    
+    /**
+     * @brief Returns raw C handle
+     */
+    ::EnumMap* c_handle() const { return map_; }
+    
+    /**
+     * @brief Checks if map is empty
+     */
+    bool empty() const { return size() == 0; }
+};
+
+/**
+ * @brief Creates EnumMap from initializer list
+ */
+template<typename T>
+EnumMap make_enum_map(std::initializer_list<std::pair<int, T>> init_list,
+                     StemFlags flags = STEM_FLAGS_COPY_VALUES) {
+    return EnumMap(init_list, sizeof(T), flags);
+}
+
+/**
+ * @brief Creates EnumMap for pointer types
+ */
+inline EnumMap make_pointer_map(std::initializer_list<std::pair<int, void*>> init_list,
+                        StemFlags flags = STEM_FLAGS_NONE) {
+    return EnumMap(init_list, 0, flags);
+}
+
+/**
+ * @brief Enum map with a compile-time key and value type
+ * 
+ * Key is an enumeration type and every T is stored inline in the map
+ * (value_size is sizeof(T)), so T must be trivially copyable. Lookups
+ * never throw or allocate: find() returns nullptr on a miss. Only get()
+ * throws, and only when the key is absent.
+ */
+template<typename Key, typename T>
+class TypedEnumMap {
+    static_assert(std::is_enum<Key>::value, "TypedEnumMap keys must be an enum type");
+    static_assert(std::is_trivially_copyable<T>::value, 
+                  "TypedEnumMap values are copied bytewise and must be trivially copyable");
+    
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    
+    /**
+     * @brief Creates an empty map sized for capacity entries
+     */
+    explicit TypedEnumMap(size_t capacity = 16, StemFlags flags = STEM_FLAGS_NONE) {
+        StemError error;
+        map_ = ::stdem_create_ex(capacity, sizeof(T), flags, &error);
+        if (!map_) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Builds the map with a single bulk load
+     * 
+     * Also fills STEM_FLAGS_READONLY maps; a duplicate key throws.
+     */
+    TypedEnumMap(std::initializer_list<std::pair<Key, T>> init_list, 
+                 StemFlags flags = STEM_FLAGS_NONE) {
+        std::vector<int> keys;
+        std::vector<const void*> values;
+        keys.reserve(init_list.size());
+        values.reserve(init_list.size());
+        for (const auto& pair : init_list) {
+            keys.push_back(static_cast<int>(pair.first));
+            values.push_back(&pair.second);
+        }
+        
+        StemError error;
+        map_ = ::stdem_create_from_arrays(keys.data(), values.data(), nullptr, keys.size(), 
+                                          sizeof(T), flags, &error);
+        if (!map_) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    ~TypedEnumMap() {
+        if (map_) {
+            ::stdem_destroy(map_);
+        }
+    }
+    
+    TypedEnumMap(const TypedEnumMap&) = delete;
+    TypedEnumMap& operator=(const TypedEnumMap&) = delete;
+    
+    TypedEnumMap(TypedEnumMap&& other) noexcept : map_(other.map_) {
+        other.map_ = nullptr;
+    }
+    
+    TypedEnumMap& operator=(TypedEnumMap&& other) noexcept {
+        if (this != &other) {
+            if (map_) {
+                ::stdem_destroy(map_);
+            }
+            map_ = other.map_;
+            other.map_ = nullptr;
+        }
+        return *this;
+    }
+    
+    /**
+     * @brief Returns the value of a key, or nullptr if absent
+     */
+    const T* find(Key key) const noexcept {
+        return static_cast<const T*>(::stdem_get_value_ex(map_, static_cast<int>(key), nullptr));
+    }
+    
+    /**
+     * @brief Returns a writable value of a key, or nullptr if absent or read-only
+     * 
+     * Writes through the pointer are not synchronized by the lock of a
+     * thread-safe map; see stdem_get_value_mut().
+     */
+    T* find(Key key) noexcept {
+        return static_cast<T*>(::stdem_get_value_mut(map_, static_cast<int>(key), nullptr));
+    }
+    
+    /**
+     * @brief Checks if a key exists
+     */
+    bool contains(Key key) const noexcept {
+        return find(key) != nullptr;
+    }
+    
+    /**
+     * @brief Retrieves a value, throwing std::out_of_range if absent
+     */
+    const T& get(Key key) const {
+        const T* value = find(key);
+        if (!value) {
+            throw std::out_of_range("Enum value not found");
+        }
+        return *value;
+    }
+    
+    /**
+     * @brief Safe value retrieval with default
+     */
+    T get_or(Key key, const T& default_value) const noexcept {
+        const T* value = find(key);
+        return value ? *value : default_value;
+    }
+    
+    /**
+     * @brief Returns the name of a key, or nullptr if absent or unnamed
+     */
+    const char* name(Key key) const noexcept {
+        return ::stdem_get_name_ex(map_, static_cast<int>(key), nullptr);
+    }
+    
+    /**
+     * @brief Finds a key by name, returning false if no entry has it
+     */
+    bool find_by_name(const char* name, Key& key) const noexcept {
+        StemError error;
+        int value = ::stdem_find_by_name(map_, name, &error);
+        if (error != STEM_SUCCESS) {
+            return false;
+        }
+        key = static_cast<Key>(value);
+        return true;
+    }
+    
+    /**
+     * @brief Inserts a value built from args unless the key exists
+     * 
+     * Like std::map::try_emplace, args are left untouched when the key is
+     * already present. Returns the stored value and whether it was inserted.
+     */
+    template<typename... Args>
+    std::pair<T*, bool> try_emplace(Key key, Args&&... args) {
+        T* existing = find(key);
+        if (existing) {
+            return std::pair<T*, bool>(existing, false);
+        }
+        
+        const T value(std::forward<Args>(args)...);
+        StemError error = ::stdem_associate_ex(map_, static_cast<int>(key), &value, nullptr);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return std::pair<T*, bool>(find(key), true);
+    }
+    
+    /**
+     * @brief Sets the value (and optionally the name) of a key, inserting it if absent
+     */
+    void insert_or_assign(Key key, const T& value, const char* name = nullptr) {
+        StemError error = ::stdem_upsert(map_, static_cast<int>(key), &value, name);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Removes a key, returning whether it existed
+     */
+    bool erase(Key key) {
+        StemError error = ::stdem_remove(map_, static_cast<int>(key));
+        if (error != STEM_SUCCESS && error != STEM_ERROR_NOT_FOUND) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return error == STEM_SUCCESS;
+    }
+    
+    /**
+     * @brief Calls f(key, value) for every entry without type-erased callbacks
+     */
+    template<typename F>
+    void for_each(F&& f) const {
+        auto c_iterator = [](int ev, const char*, const void* v, size_t, void* ud) {
+            (*static_cast<typename std::remove_reference<F>::type*>(ud))(
+                static_cast<Key>(ev), *static_cast<const T*>(v));
+        };
+        
+        StemError error = ::stdem_foreach(map_, c_iterator, &f);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+    }
+    
+    /**
+     * @brief Makes room for n entries in total
      */
-    size_t value_size() const {
-        return ::stdem_value_size(map_);
+    void reserve(size_t n) {
+        StemError error = ::stdem_reserve(map_, n);
+        if (error != STEM_SUCCESS) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
     }
     
     /**
@@ -352,89 +1685,581 @@ public:
     }
     
     /**
-     * @brief Iterates over all entries
+     * @brief Returns the number of entries
      */
-    void for_each(Iterator iterator) const {
-        auto c_iterator = [](int ev, const char* en, const void* v, size_t vs, void* ud) {
-            (*static_cast<Iterator*>(ud))(ev, en, v, vs);
-        };
+    size_t size() const noexcept { return ::stdem_count(map_); }
+    
+    /**
+     * @brief Checks if map is empty
+     */
+    bool empty() const noexcept { return size() == 0; }
+    
+    /**
+     * @brief Returns raw C handle
+     */
+    ::EnumMap* c_handle() const noexcept { return map_; }
+    
+private:
+    ::EnumMap* map_;
+};
+
+/**
+ * @brief Several value columns of an enum type sharing one key index
+ * 
+ * Each add_column<T>() returns a typed handle; every T is stored inline
+ * and must be trivially copyable. Like TypedEnumMap, find() returns
+ * nullptr on a miss and only get() throws when the key is absent.
+ */
+template<typename Key>
+class EnumTable {
+    static_assert(std::is_enum<Key>::value, "EnumTable keys must be an enum type");
+    
+public:
+    using key_type = Key;
+    
+    /**
+     * @brief Typed handle of a column
+     */
+    template<typename T>
+    class Column {
+        static_assert(std::is_trivially_copyable<T>::value, 
+                      "EnumTable values are copied bytewise and must be trivially copyable");
+        friend class EnumTable;
+        explicit Column(size_t index) noexcept : index_(index) {}
+        size_t index_;
         
-        StemError error = ::stdem_foreach(map_, c_iterator, &iterator);
-        if (error != STEM_SUCCESS) {
+    public:
+        size_t index() const noexcept { return index_; }
+    };
+    
+    /**
+     * @brief Creates an empty table sized for capacity rows
+     */
+    explicit EnumTable(size_t capacity = 16, StemFlags flags = STEM_FLAGS_NONE) {
+        StemError error;
+        table_ = ::stdem_table_create(capacity, flags, nullptr, &error);
+        if (!table_) {
             throw std::runtime_error(::stdem_error_string(error));
         }
     }
     
+    ~EnumTable() {
+        if (table_) {
+            ::stdem_table_destroy(table_);
+        }
+    }
+    
+    EnumTable(const EnumTable&) = delete;
+    EnumTable& operator=(const EnumTable&) = delete;
+    
+    EnumTable(EnumTable&& other) noexcept : table_(other.table_) {
+        other.table_ = nullptr;
+    }
+    
+    EnumTable& operator=(EnumTable&& other) noexcept {
+        if (this != &other) {
+            if (table_) {
+                ::stdem_table_destroy(table_);
+            }
+            table_ = other.table_;
+            other.table_ = nullptr;
+        }
+        return *this;
+    }
+    
     /**
-     * @brief Gets all enum values
+     * @brief Adds a column of T, zeroed for the existing rows
      */
-    std::vector<int> keys() const {
-        std::vector<int> result;
-        for_each([&](int ev, const char*, const void*, size_t) {
-            result.push_back(ev);
-        });
-        return result;
+    template<typename T>
+    Column<T> add_column() {
+        StemError error;
+        size_t index = ::stdem_table_add_column(table_, sizeof(T), &error);
+        if (index == STEM_TABLE_NONE) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return Column<T>(index);
     }
     
     /**
-     * @brief Gets all enum names
+     * @brief Adds a row with zeroed cells, throwing if the key exists
      */
-    std::vector<std::string> names() const {
-        std::vector<std::string> result;
-        for_each([&](int, const char* en, const void*, size_t) {
-            if (en) result.push_back(en);
-        });
-        return result;
+    size_t insert(Key key, const char* name = nullptr) {
+        StemError error;
+        size_t row = ::stdem_table_insert(table_, static_cast<int>(key), name, &error);
+        if (row == STEM_TABLE_NONE) {
+            throw std::runtime_error(::stdem_error_string(error));
+        }
+        return row;
     }
     
     /**
-     * @brief Finds enum value by name
+     * @brief Removes the row of a key, returning whether it existed
      */
-    int find(const std::string& name) const {
-        StemError error;
-        int result = ::stdem_find_by_name(map_, name.c_str(), &error);
-        if (error != STEM_SUCCESS) {
+    bool erase(Key key) {
+        StemError error = ::stdem_table_remove(table_, static_cast<int>(key));
+        if (error != STEM_SUCCESS && error != STEM_ERROR_NOT_FOUND) {
             throw std::runtime_error(::stdem_error_string(error));
         }
-        return result;
+        return error == STEM_SUCCESS;
     }
     
     /**
-     * @brief Array-style access
+     * @brief Returns the value of a key in a column, or nullptr if absent
      */
     template<typename T>
-    const T& operator[](int enum_value) const {
-        return get<T>(enum_value);
+    T* find(Key key, Column<T> column) const noexcept {
+        return static_cast<T*>(const_cast<void*>(
+            ::stdem_table_get(table_, static_cast<int>(key), column.index_, nullptr)));
     }
     
     /**
-     * @brief Returns raw C handle
+     * @brief Retrieves a value, throwing std::out_of_range if absent
      */
-    ::EnumMap* c_handle() const { return map_; }
+    template<typename T>
+    T& get(Key key, Column<T> column) const {
+        T* value = find(key, column);
+        if (!value) {
+            throw std::out_of_range("Enum value not found");
+        }
+        return *value;
+    }
     
     /**
-     * @brief Checks if map is empty
+     * @brief Sets the value of a key in a column, returning false if the key is absent
      */
-    bool empty() const { return size() == 0; }
+    template<typename T>
+    bool set(Key key, Column<T> column, const T& value) noexcept {
+        return ::stdem_table_set(table_, static_cast<int>(key), column.index_, &value) == 
+               STEM_SUCCESS;
+    }
+    
+    /**
+     * @brief Returns the cells of a column, size() of them back to back
+     */
+    template<typename T>
+    T* data(Column<T> column) const noexcept {
+        return static_cast<T*>(::stdem_table_column(table_, column.index_));
+    }
+    
+    /**
+     * @brief Returns the row of a key, or STEM_TABLE_NONE if absent
+     */
+    size_t row(Key key) const noexcept {
+        return ::stdem_table_find(table_, static_cast<int>(key));
+    }
+    
+    /**
+     * @brief Returns the key of a row
+     */
+    Key key(size_t row) const noexcept {
+        return static_cast<Key>(::stdem_table_key(table_, row));
+    }
+    
+    /**
+     * @brief Returns the name of a row, or nullptr if unnamed
+     */
+    const char* name(size_t row) const noexcept { return ::stdem_table_name(table_, row); }
+    
+    /**
+     * @brief Returns the number of rows
+     */
+    size_t size() const noexcept { return ::stdem_table_rows(table_); }
+    
+    /**
+     * @brief Checks if the table is empty
+     */
+    bool empty() const noexcept { return size() == 0; }
+    
+    /**
+     * @brief Returns raw C handle
+     */
+    ::StemTable* c_handle() const noexcept { return table_; }
+    
+private:
+    ::StemTable* table_;
 };
 
+namespace detail {
+
 /**
- * @brief Creates EnumMap from initializer list
+ * @brief State of a C++ background operation, owned by its worker
  */
-template<typename T>
-EnumMap make_enum_map(std::initializer_list<std::pair<int, T>> init_list,
-                     StemFlags flags = STEM_FLAGS_COPY_VALUES) {
-    return EnumMap(init_list, sizeof(T), flags);
+struct AsyncState {
+    std::promise<void> promise;
+    std::function<void(::EnumMap*)> rebuild;
+    std::exception_ptr failure;
+};
+
+/**
+ * @brief StemRebuildCallback running the C++ rebuild function
+ */
+inline StemError async_rebuild(::EnumMap* next, void* user_data) {
+    AsyncState* state = static_cast<AsyncState*>(user_data);
+    try {
+        state->rebuild(next);
+        return STEM_SUCCESS;
+    } catch (...) {
+        state->failure = std::current_exception();
+        return STEM_ERROR_INVALID_ARG;
+    }
 }
 
 /**
- * @brief Creates EnumMap for pointer types
+ * @brief StemAsyncCallback settling the future of the operation
  */
-EnumMap make_pointer_map(std::initializer_list<std::pair<int, void*>> init_list,
-                        StemFlags flags = STEM_FLAGS_NONE) {
-    return EnumMap(init_list, 0, flags);
+inline void async_done(StemError error, void* user_data) {
+    std::unique_ptr<AsyncState> state(static_cast<AsyncState*>(user_data));
+    if (state->failure) {
+        state->promise.set_exception(state->failure);
+    } else if (error != STEM_SUCCESS) {
+        state->promise.set_exception(
+            std::make_exception_ptr(std::runtime_error(::stdem_error_string(error))));
+    } else {
+        state->promise.set_value();
+    }
+}
+
+/**
+ * @brief Detaches a started operation, or throws if it did not start
+ */
+inline std::future<void> async_start(StemAsync* op, StemError error, 
+                                     std::unique_ptr<AsyncState>& state, 
+                                     std::future<void>& result) {
+    if (!op) {
+        throw std::runtime_error(::stdem_error_string(error));
+    }
+    state.release(); // Now owned by the worker, see async_done()
+    ::stdem_async_detach(op);
+    return std::move(result);
+}
+
+} // namespace detail
+
+/**
+ * @brief Loads an image file into a snapshot in the background
+ * 
+ * The future becomes ready once the loaded map is published and rethrows
+ * a failure as std::runtime_error.
+ */
+inline std::future<void> load_async(StemSnapshot* snapshot, const std::string& path) {
+    std::unique_ptr<detail::AsyncState> state(new detail::AsyncState());
+    std::future<void> result = state->promise.get_future();
+    StemError error;
+    StemAsync* op = ::stdem_load_async(snapshot, path.c_str(), &detail::async_done, 
+                                       state.get(), &error);
+    return detail::async_start(op, error, state, result);
+}
+
+/**
+ * @brief Rebuilds the map of a snapshot in the background
+ * 
+ * rebuild receives a mutable copy of the current map on the worker
+ * thread. An exception it throws cancels the rebuild and is rethrown by
+ * the future.
+ */
+inline std::future<void> rebuild_async(StemSnapshot* snapshot, 
+                                       std::function<void(::EnumMap*)> rebuild) {
+    std::unique_ptr<detail::AsyncState> state(new detail::AsyncState());
+    state->rebuild = std::move(rebuild);
+    std::future<void> result = state->promise.get_future();
+    StemError error;
+    StemAsync* op = ::stdem_rebuild_async(snapshot, &detail::async_rebuild, 
+                                          &detail::async_done, state.get(), &error);
+    return detail::async_start(op, error, state, result);
+}
+
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+
+namespace detail {
+
+/**
+ * @brief Seeded integer hash, identical to the one used by stdem_freeze()
+ */
+constexpr uint32_t hash_seeded(uint32_t hash, uint32_t seed) {
+    hash ^= seed * 0x9E3779B9U;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * @brief Compile-time string equality
+ */
+constexpr bool equal_names(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+} // namespace detail
+
+/**
+ * @brief One association of a StaticEnumMap
+ */
+template<typename Enum, typename T>
+struct StaticEntry {
+    Enum key;
+    T value;
+    const char* name = nullptr;
+};
+
+/**
+ * @brief Fixed enum map built entirely at compile time
+ * 
+ * Holds exactly N associations without heap allocation. When the keys form
+ * a contiguous range they are looked up by direct indexing; otherwise the
+ * constructor builds a minimal perfect hash (hash-and-displace, as in
+ * stdem_freeze()) so every lookup is a single probe. T must be a literal,
+ * default-constructible type for constexpr construction. Invalid input
+ * (wrong entry count, duplicate keys) fails to compile in constant
+ * expressions and throws std::invalid_argument at run time.
+ */
+template<typename Enum, typename T, size_t N>
+class StaticEnumMap {
+    static_assert(N > 0, "StaticEnumMap needs at least one entry");
+    
+public:
+    using Entry = StaticEntry<Enum, T>;
+    
+    /**
+     * @brief Builds the map from exactly N entries
+     */
+    constexpr StaticEnumMap(std::initializer_list<Entry> entries)
+        : StaticEnumMap(entries.begin(), entries.size()) {}
+    
+    /**
+     * @brief Builds the map from an array of N entries
+     */
+    constexpr explicit StaticEnumMap(const Entry (&entries)[N])
+        : StaticEnumMap(entries, N) {}
+    
+    /**
+     * @brief Returns the value of an enum entry, or nullptr if absent
+     */
+    constexpr const T* find(Enum key) const noexcept {
+        size_t slot = slot_of(key);
+        return slot < N ? &values_[slot] : nullptr;
+    }
+    
+    /**
+     * @brief Checks if an enum value exists
+     */
+    constexpr bool contains(Enum key) const noexcept {
+        return slot_of(key) < N;
+    }
+    
+    /**
+     * @brief Retrieves a value, throwing std::out_of_range if absent
+     */
+    constexpr const T& get(Enum key) const {
+        return slot_of(key) < N ? values_[slot_of(key)] : 
+               (throw std::out_of_range("Enum value not found"), values_[0]);
+    }
+    
+    /**
+     * @brief Safe value retrieval with default
+     */
+    constexpr T get_or(Enum key, const T& default_value) const {
+        return slot_of(key) < N ? values_[slot_of(key)] : default_value;
+    }
+    
+    /**
+     * @brief Returns the name of an enum entry, or nullptr if absent or unnamed
+     */
+    constexpr const char* name(Enum key) const noexcept {
+        return slot_of(key) < N ? names_[slot_of(key)] : nullptr;
+    }
+    
+    /**
+     * @brief Finds an enum value by name (linear scan)
+     */
+    constexpr bool find_by_name(const char* name, Enum& key) const noexcept {
+        for (size_t i = 0; i < N; ++i) {
+            if (names_[i] && name && detail::equal_names(names_[i], name)) {
+                key = keys_[i];
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * @brief Array-style access
+     */
+    constexpr const T& operator[](Enum key) const {
+        return get(key);
+    }
+    
+    /**
+     * @brief Returns the number of entries
+     */
+    constexpr size_t size() const noexcept { return N; }
+    
+    /**
+     * @brief Tells whether lookups use direct indexing instead of hashing
+     */
+    constexpr bool is_direct() const noexcept { return direct_; }
+    
+    /**
+     * @brief Copies the associations into a runtime EnumMap
+     */
+    EnumMap to_enum_map(StemFlags flags = STEM_FLAGS_COPY_VALUES) const {
+        EnumMap map(N, sizeof(T), flags);
+        for (size_t i = 0; i < N; ++i) {
+            map.associate(static_cast<int>(keys_[i]), values_[i], names_[i]);
+        }
+        return map;
+    }
+    
+private:
+    Enum keys_[N] = {};
+    T values_[N] = {};
+    const char* names_[N] = {};
+    int32_t seeds_[N] = {};
+    long long base_ = 0;
+    bool direct_ = false;
+    
+    constexpr StaticEnumMap(const Entry* entries, size_t count) {
+        if (count != N) {
+            throw std::invalid_argument("StaticEnumMap: entry count does not match N");
+        }
+        
+        long long lo = static_cast<int>(entries[0].key);
+        long long hi = lo;
+        for (size_t i = 1; i < N; ++i) {
+            long long key = static_cast<int>(entries[i].key);
+            lo = key < lo ? key : lo;
+            hi = key > hi ? key : hi;
+        }
+        
+        size_t slot_of_entry[N] = {};
+        if (hi - lo + 1 == static_cast<long long>(N)) {
+            /* Contiguous keys: the slot is the offset from the smallest key */
+            bool taken[N] = {};
+            for (size_t i = 0; i < N; ++i) {
+                size_t slot = static_cast<size_t>(static_cast<int>(entries[i].key) - lo);
+                if (taken[slot]) {
+                    throw std::invalid_argument("StaticEnumMap: duplicate key");
+                }
+                taken[slot] = true;
+                slot_of_entry[i] = slot;
+            }
+            base_ = lo;
+            direct_ = true;
+        } else {
+            build_perfect_hash(entries, slot_of_entry);
+        }
+        
+        for (size_t i = 0; i < N; ++i) {
+            keys_[slot_of_entry[i]] = entries[i].key;
+            values_[slot_of_entry[i]] = entries[i].value;
+            names_[slot_of_entry[i]] = entries[i].name;
+        }
+    }
+    
+    static constexpr uint32_t hash(Enum key, uint32_t seed) {
+        return detail::hash_seeded(static_cast<uint32_t>(static_cast<int>(key)), seed);
+    }
+    
+    /**
+     * @brief Places the keys with hash-and-displace, largest buckets first
+     */
+    constexpr void build_perfect_hash(const Entry* entries, size_t (&slot_of_entry)[N]) {
+        size_t bucket_of[N] = {};
+        size_t sizes[N] = {};
+        size_t largest = 0;
+        for (size_t i = 0; i < N; ++i) {
+            bucket_of[i] = hash(entries[i].key, 0) % N;
+            size_t size = ++sizes[bucket_of[i]];
+            largest = size > largest ? size : largest;
+        }
+        
+        bool taken[N] = {};
+        size_t members[N] = {};
+        for (size_t size = largest; size >= 2; --size) {
+            for (size_t b = 0; b < N; ++b) {
+                if (sizes[b] != size) {
+                    continue;
+                }
+                
+                size_t count = 0;
+                for (size_t i = 0; i < N; ++i) {
+                    if (bucket_of[i] == b) {
+                        for (size_t j = 0; j < count; ++j) {
+                            if (static_cast<int>(entries[members[j]].key) == 
+                                static_cast<int>(entries[i].key)) {
+                                throw std::invalid_argument("StaticEnumMap: duplicate key");
+                            }
+                        }
+                        members[count++] = i;
+                    }
+                }
+                
+                for (uint32_t seed = 1;; ++seed) {
+                    size_t placed = 0;
+                    while (placed < count) {
+                        size_t slot = hash(entries[members[placed]].key, seed) % N;
+                        if (taken[slot]) {
+                            break;
+                        }
+                        taken[slot] = true;
+                        slot_of_entry[members[placed]] = slot;
+                        ++placed;
+                    }
+                    if (placed == count) {
+                        seeds_[b] = static_cast<int32_t>(seed);
+                        break;
+                    }
+                    while (placed > 0) {
+                        taken[slot_of_entry[members[--placed]]] = false;
+                    }
+                }
+            }
+        }
+        
+        size_t free_slot = 0;
+        for (size_t i = 0; i < N; ++i) {
+            if (sizes[bucket_of[i]] != 1) {
+                continue;
+            }
+            while (taken[free_slot]) {
+                ++free_slot;
+            }
+            taken[free_slot] = true;
+            slot_of_entry[i] = free_slot;
+            seeds_[bucket_of[i]] = -static_cast<int32_t>(free_slot) - 1;
+        }
+    }
+    
+    constexpr size_t slot_of(Enum key) const noexcept {
+        long long k = static_cast<int>(key);
+        if (direct_) {
+            return (k >= base_ && k - base_ < static_cast<long long>(N)) ? 
+                   static_cast<size_t>(k - base_) : N;
+        }
+        
+        int32_t seed = seeds_[hash(key, 0) % N];
+        size_t slot = seed < 0 ? static_cast<size_t>(-(seed + 1)) : 
+                      seed == 0 ? N : hash(key, static_cast<uint32_t>(seed)) % N;
+        return (slot < N && static_cast<int>(keys_[slot]) == k) ? slot : N;
+    }
+};
+
+/**
+ * @brief Creates a StaticEnumMap, deducing N from the entry list
+ */
+template<typename Enum, typename T, size_t N>
+constexpr StaticEnumMap<Enum, T, N> make_static_enum_map(const StaticEntry<Enum, T> (&entries)[N]) {
+    return StaticEnumMap<Enum, T, N>(entries);
 }
 
+#endif // C++14
+
 } // namespace stem
 
 #endif // __cplusplus
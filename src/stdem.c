@@ -12,18 +12,112 @@
  * This implementation provides a highly efficient, platform-independent enum mapping
  * system with the following features:
  * - Hash table with separate chaining for collision resolution
+ * - Optional dense direct-indexed storage for contiguous enum ranges
+ * - Optional open-addressing table with linear probing for sparse keys
+ * - Pluggable allocator with an internal arena for entries, values and names
  * - Automatic resizing based on load factor
  * - Support for both value copying and pointer storage
  * - Comprehensive error handling and reporting
  * - Memory efficiency with minimal overhead
- * - Complete platform independence without any conditional compilation
+ * - Opt-in reader-writer locking with STEM_FLAGS_THREAD_SAFE
+ * - Lock-free snapshot publishing with epoch-based reclamation
+ * - Parallel iteration, copy and merge on a pluggable executor
+ * - Platform independence; conditional code is limited to the feature
+ *   switches at the top of this file: atomic builtins, prefetch and
+ *   thread-local storage for the locks and the front cache, POSIX threads
+ *   for the executor and background loading, mmap() for mapped images,
+ *   and Linux huge pages and NUMA system calls. Each falls back to portable
+ *   code when unavailable
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* madvise(), MAP_HUGETLB, sched_getcpu() and syscall() */
+#endif
+
+#if !defined(_POSIX_C_SOURCE) && (defined(__unix__) || defined(__APPLE__))
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "stdem.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STEM_YIELD() sched_yield()
+#define STEM_HAVE_MMAP 1
+#else
+#define STEM_YIELD() ((void)0)
+#define STEM_HAVE_MMAP 0
+#endif
+
+/* Huge pages and NUMA placement use Linux mappings and system calls */
+#if STEM_HAVE_MMAP && defined(__linux__) && defined(MADV_HUGEPAGE) && defined(MAP_HUGETLB)
+#include <sys/syscall.h>
+#define STEM_HAVE_HUGE_PAGES 1
+#else
+#define STEM_HAVE_HUGE_PAGES 0
+#endif
+
+#if STEM_HAVE_HUGE_PAGES && defined(SYS_mbind)
+#define STEM_HAVE_NUMA 1
+#else
+#define STEM_HAVE_NUMA 0
+#endif
+
+/* ==================== ATOMIC OPERATIONS ==================== */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define STEM_HAVE_ATOMICS 1
+#define STEM_ATOMIC_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define STEM_ATOMIC_STORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define STEM_ATOMIC_ADD(ptr, val) __atomic_add_fetch((ptr), (val), __ATOMIC_ACQ_REL)
+#define STEM_ATOMIC_CAS(ptr, expected, desired) \
+    __atomic_compare_exchange_n((ptr), (expected), (desired), 0, \
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define STEM_ATOMIC_LOAD_SEQ(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define STEM_ATOMIC_STORE_SEQ(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define STEM_ATOMIC_EXCHANGE_SEQ(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+#define STEM_ATOMIC_ADD_SEQ(ptr, val) __atomic_add_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+#define STEM_ATOMIC_ADD_RELAXED(ptr, val) __atomic_add_fetch((ptr), (val), __ATOMIC_RELAXED)
+#define STEM_ATOMIC_LOAD_RELAXED(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define STEM_ATOMIC_STORE_RELAXED(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#else
+#define STEM_HAVE_ATOMICS 0
+#endif
+
+/* The built-in executor needs POSIX threads and the atomic builtins */
+#if (defined(__unix__) || defined(__APPLE__)) && STEM_HAVE_ATOMICS
+#include <pthread.h>
+#define STEM_HAVE_THREADS 1
+#else
+#define STEM_HAVE_THREADS 0
+#endif
+
+#define STEM_CACHE_LINE 64 /**< Assumed cache line size for padding shared data */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define STEM_PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#define STEM_PREFETCH(addr) ((void)(addr))
+#endif
+
+/* The front cache of STEM_FLAGS_FRONT_CACHE lives in thread-local storage */
+#if defined(__GNUC__) || defined(__clang__)
+#define STEM_THREAD_LOCAL __thread
+#define STEM_HAVE_THREAD_LOCAL 1
+#elif defined(_MSC_VER)
+#define STEM_THREAD_LOCAL __declspec(thread)
+#define STEM_HAVE_THREAD_LOCAL 1
+#else
+#define STEM_HAVE_THREAD_LOCAL 0
+#endif
+
 /* ==================== INTERNAL STRUCTURES ==================== */
 
 /**
@@ -40,6 +134,134 @@ typedef struct EnumEntry {
     struct EnumEntry* next; /**< Next entry in the bucket (for chaining) */
 } EnumEntry;
 
+/**
+ * @brief Slot of the name index, mapping a name back to its enum value
+ */
+typedef struct {
+    const char* name;       /**< Interned name, NULL for an empty slot */
+    uint32_t hash;          /**< Cached stem_hash_name() of the name */
+    int enum_value;         /**< Enum value the name resolves to */
+    size_t shadows;         /**< Other entries carrying the same name */
+} StemNameSlot;
+
+/**
+ * @brief Enum value of a frozen slot, as listed by the ordered index
+ */
+typedef struct {
+    int enum_value;         /**< Enum value of the slot */
+    uint32_t slot;          /**< Frozen slot holding it */
+} StemOrderPair;
+
+/**
+ * @brief Header of a frozen map block, followed by its tables
+ * 
+ * The block is position independent: every table is addressed by its byte
+ * offset from the start of the header. Enum values and names each get a
+ * minimal perfect hash built by hash-and-displace: a first hash picks a
+ * bucket, whose seed either names the slot directly (negative) or selects
+ * the second hash that places the key (positive). Slot i of the key table
+ * is a StemFrozenRecord, so verifying a key and loading its value touch
+ * the same cache line.
+ */
+typedef struct {
+    uint32_t count;         /**< Number of entries, equal to the key table size */
+    uint32_t name_count;    /**< Number of distinct names, equal to the name table size */
+    uint64_t value_size;    /**< Size of each value in bytes (0 for pointer storage) */
+    uint64_t record_size;   /**< Stride of the record table */
+    uint64_t key_seeds;     /**< int32_t seed per key bucket */
+    uint64_t records;       /**< StemFrozenRecord per slot */
+    uint64_t name_seeds;    /**< int32_t seed per name bucket */
+    uint64_t name_slots;    /**< uint32_t key slot per name slot */
+    uint64_t strings;       /**< NUL-terminated names */
+    uint64_t size;          /**< Total size of the block in bytes */
+} StemFrozen;
+
+/**
+ * @brief Slot of a frozen map, followed by the value (or pointer)
+ */
+typedef struct {
+    int32_t enum_value;     /**< Enum value stored in the slot */
+    uint32_t name;          /**< String offset of the name, STEM_FROZEN_NO_NAME if unnamed */
+} StemFrozenRecord;
+
+/**
+ * @brief Header of a serialized map image (format version 2)
+ * 
+ * The header is followed directly by a frozen block, so an image can be
+ * mapped into memory and used in place. Every field has a fixed width and
+ * byte_order tells apart images written on a machine of the other
+ * endianness. The first two fields match the version 1 header.
+ */
+typedef struct {
+    uint32_t magic;         /**< STEM_IMAGE_MAGIC */
+    uint16_t version;       /**< STEM_IMAGE_VERSION */
+    uint16_t header_size;   /**< sizeof(StemImageHeader) */
+    uint32_t byte_order;    /**< STEM_IMAGE_BYTE_ORDER in the writer's byte order */
+    uint32_t flags;         /**< Flags of the serialized map */
+    uint64_t dense_size;    /**< Dense range of the serialized map (0 if none) */
+    uint64_t block_size;    /**< Size of the frozen block following the header */
+} StemImageHeader;
+
+/**
+ * @brief Header at the start of a shared-memory region
+ * 
+ * The region holds two image buffers. Readers attach to the active one,
+ * pinning it, and the writer only ever serializes into the other one, so
+ * a published image never changes while a reader uses it. Every field is
+ * placed at the same offset in every process mapping the region.
+ */
+typedef struct {
+    uint32_t magic;         /**< STEM_SHARED_MAGIC */
+    uint32_t version;       /**< STEM_SHARED_VERSION */
+    uint64_t size;          /**< Size of the region in bytes */
+    uint64_t generation;    /**< Number of images published so far */
+    uint64_t offset[2];     /**< Offset of each image buffer from the region start */
+    uint64_t capacity[2];   /**< Size of each image buffer in bytes */
+    uint64_t length[2];     /**< Length of the image held by each buffer */
+    int active;             /**< Buffer holding the latest image */
+    int pins[2];            /**< Maps attached to each buffer */
+} StemSharedHeader;
+
+/**
+ * @brief Header of an arena chunk, followed by the chunk payload
+ */
+typedef struct StemArenaChunk {
+    struct StemArenaChunk* next; /**< Previously allocated chunk */
+    size_t capacity;             /**< Payload size in bytes */
+    size_t used;                 /**< Payload bytes handed out so far */
+} StemArenaChunk;
+
+/**
+ * @brief Bump allocator over a list of chunks
+ * 
+ * Memory is bump-allocated from chunks obtained through an allocator and
+ * only released as a whole.
+ */
+typedef struct {
+    StemArenaChunk* chunks;      /**< Current chunk, linked to the older ones */
+    size_t chunk_size;           /**< Capacity of the next chunk to allocate */
+} StemArena;
+
+/**
+ * @brief Interned, immutable name storage shared by related maps
+ * 
+ * Every name stored by a mutable map lives in a pool, once per distinct
+ * string. Copies and merges share the pool of their source, so derived
+ * maps reference the very same name pointers instead of duplicating them.
+ * Interned strings are never freed before the pool itself, which goes away
+ * with the last map referencing it. Each string is preceded by its hash
+ * and its length (see stem_pool_hash() and stem_name_length()).
+ */
+typedef struct {
+    size_t refs;                 /**< Number of maps referencing the pool */
+    int lock;                    /**< Spin lock serializing interning */
+    StemAllocator allocator;     /**< Allocator backing the pool */
+    StemArena arena;             /**< Storage of the interned strings */
+    const char** strings;        /**< Open-addressing set of interned strings */
+    size_t num_strings;          /**< Number of set slots (power of two, 0 if unallocated) */
+    size_t count;                /**< Number of interned strings */
+} StemStringPool;
+
 /**
  * @brief Internal structure representing the enum map
  * 
@@ -49,1055 +271,8193 @@ typedef struct EnumEntry {
 struct EnumMap {
     size_t count;           /**< Number of entries in the map */
     size_t value_size;      /**< Size of each value in bytes (0 for pointer storage) */
+    size_t entry_size;      /**< Bytes taken by an entry and its inline value copy */
     StemFlags flags;        /**< Configuration flags */
     EnumEntry** buckets;    /**< Array of buckets for the hash table */
-    size_t num_buckets;     /**< Number of buckets in the hash table */
+    size_t num_buckets;     /**< Number of buckets in the hash table (a power of two) */
+    unsigned int hash_shift; /**< Right shift turning a hash into a bucket or slot index */
+    float max_load;         /**< Load factor the bucket or slot table grows at */
+    size_t grow_at;         /**< Sparse entries the table takes before it grows */
+    
+    /**
+     * @brief Bucket array an incremental resize is migrating from
+     * 
+     * Only set with STEM_FLAGS_INCREMENTAL_REHASH while a resize is in
+     * progress. New entries go to the new buckets above; each insert or
+     * removal moves the next STEM_REHASH_STEP old buckets over and clears
+     * them, and lookups that miss the new bucket check the old one.
+     */
+    EnumEntry** old_buckets;
+    size_t old_num_buckets;      /**< Number of old buckets (0 if no resize is running) */
+    unsigned int old_shift;      /**< Hash shift of the old buckets */
+    size_t rehash_pos;           /**< First old bucket not migrated yet */
+    StemAllocator allocator; /**< Allocator backing every map allocation */
+    
+    /**
+     * @brief Arena holding chained entries and copied values
+     * 
+     * Chunks come from the map's allocator and are only released as a
+     * whole by stdem_clear() and stdem_destroy().
+     */
+    StemArena arena;
+    
+    /**
+     * @brief Pool holding the names of the entries
+     * 
+     * Possibly shared with the maps this one was derived from or that were
+     * derived from it. NULL for frozen maps and with STEM_FLAGS_NO_NAMES.
+     */
+    StemStringPool* pool;
+    
+    /**
+     * @brief Direct-indexed storage for the range [0, dense_size)
+     * 
+     * Only allocated with STEM_FLAGS_DENSE. Enum values inside the range
+     * are looked up with a bounds check and an indexed load; values outside
+     * of it fall back to the hash table buckets above. Slots are
+     * entry_size bytes apart (see stem_dense_entry()).
+     */
+    unsigned char* dense;
+    unsigned char* dense_used;   /**< Occupancy flag for each dense slot */
+    size_t dense_size;           /**< Number of dense slots (0 if disabled) */
+    size_t dense_count;          /**< Number of occupied dense slots */
+    
+    /**
+     * @brief Open-addressing table used instead of the buckets
+     * 
+     * Only allocated with STEM_FLAGS_OPEN_ADDRESSING. Entries and their
+     * copied values live directly in the slot array, entry_size bytes apart
+     * (see stem_slot_entry()), so inserting allocates nothing but new names.
+     * The slot count is a power of two and the home slot is taken from the
+     * top bits of the hash.
+     */
+    unsigned char* slots;
+    unsigned char* slot_used;    /**< Occupancy flag for each slot */
+    size_t num_slots;            /**< Number of slots (0 if disabled) */
+    
+    /**
+     * @brief Open-addressing index from names to enum values
+     * 
+     * Allocated with the first named entry and never used with
+     * STEM_FLAGS_NO_NAMES. When several entries share a name, the entry
+     * associated first stays indexed until it is removed or renamed; the
+     * name then passes to whichever remaining entry carrying it is found
+     * first in storage order.
+     */
+    StemNameSlot* names;
+    size_t num_names;            /**< Number of index slots (power of two) */
+    size_t names_count;          /**< Number of indexed names */
+    
+    /**
+     * @brief Ordered index of the enum values stored outside the dense range
+     * 
+     * Only maintained with STEM_FLAGS_ORDERED: a directory of sorted blocks
+     * of up to STEM_ORDER_BLOCK enum values, every block holding smaller
+     * values than the next one. The blocks come from the arena. Frozen maps
+     * use order_pairs instead.
+     */
+    struct StemOrderBlock** order;
+    size_t order_blocks;         /**< Number of blocks in use */
+    size_t order_capacity;       /**< Number of directory slots */
+    StemOrderPair* order_pairs;  /**< Frozen maps: every slot, sorted by enum value */
+    
+    /**
+     * @brief Perfect-hash block replacing every other storage
+     * 
+     * Only set on maps returned by stdem_freeze(), which own no entries,
+     * buckets or arena and never change.
+     */
+    StemFrozen* frozen;
+    
+    /**
+     * @brief Image the frozen block belongs to when the map does not own it
+     * 
+     * Set by stdem_open_image() to the caller's memory and by
+     * stdem_map_image() to the file mapping, which is unmapped with the
+     * map (image_mapped bytes). NULL when the frozen block is owned.
+     */
+    const void* image;
+    size_t image_mapped;         /**< Length of the file mapping, 0 for caller memory */
+    int* shared_pin;             /**< Pin count released on destroy, see stdem_shared_attach() */
+    
+    /**
+     * @brief Tag of the front cache entries of this map that are still valid
+     * 
+     * Only used with STEM_FLAGS_FRONT_CACHE. Taken from a process-wide
+     * counter when the map is created and again whenever a value it cached
+     * may have moved. No two maps ever share a tag, so a cache slot matches
+     * on the tag and the enum value alone, and stale entries (also those of
+     * a destroyed map at the same address) never match.
+     */
+    uint64_t cache_epoch;
+    
+    /**
+     * @brief Copies of the frozen block per NUMA node
+     * 
+     * Set by stdem_freeze_replicated() on machines with several nodes.
+     * Lookups read the entry of the node the calling thread runs on; the
+     * copy of the building node is frozen itself, the others are mapped
+     * replica_bytes long and bound to their node.
+     */
+    StemFrozen** replicas;
+    size_t replica_bytes;        /**< Mapped length of each replica */
+    size_t node_count;           /**< Entries of replicas (highest node + 1) */
+    unsigned char* cpu_node;     /**< Node of each CPU, cpu_count entries */
+    size_t cpu_count;            /**< Entries of cpu_node */
+    
+    /**
+     * @brief Reader-writer lock word for STEM_FLAGS_THREAD_SAFE
+     * 
+     * 0 when free, the number of readers while held shared and -1 while
+     * held exclusively. It is left untouched by maps without the flag,
+     * which keep relying on external synchronization.
+     */
+    int lock;
+    
+    /**
+     * @brief Lookup counters maintained with STEM_FLAGS_STATS
+     * 
+     * Updated with relaxed atomic adds, since lookups run under a shared
+     * lock or none at all. Reported and reset by stdem_get_stats() and
+     * stdem_reset_stats().
+     */
+    size_t lookup_hits;
+    size_t lookup_misses;        /**< Failed value lookups */
+    size_t cache_hits;           /**< Value lookups answered by the front cache */
+    size_t name_hits;            /**< Successful name lookups */
+    size_t name_misses;          /**< Failed name lookups */
+    size_t resizes;              /**< Number of hash table or slot array rehashes */
     
     /**
-     * @brief Mutex for thread safety
+     * @brief Set once the map has been published through a StemSnapshot
      * 
-     * This pointer can be used to store a platform-specific mutex handle.
-     * For maximum portability, the library doesn't implement thread safety
-     * by default, but provides hooks for external synchronization.
+     * Published maps are read without any lock, so they reject every
+     * modification. Copies of a published map are mutable again.
      */
-    void* mutex;
+    int published;
+};
+
+/**
+ * @brief Internal cursor used to walk every entry regardless of storage
+ * 
+ * Dense slots are visited first in ascending enum order, followed by the
+ * open-addressing slots or the hash table buckets. Frozen maps are walked
+ * slot by slot through a temporary entry that must not be modified.
+ */
+typedef struct {
+    size_t dense_index;     /**< Next dense slot to inspect */
+    size_t slot;            /**< Next open-addressing or frozen slot to inspect */
+    size_t bucket;          /**< Next bucket to inspect */
+    EnumEntry* entry;       /**< Next entry in the current bucket chain */
+    EnumEntry frozen_entry; /**< Entry view of the current frozen slot */
+} StemCursor;
+
+/**
+ * @brief Entries of a map unpacked into parallel arrays for bulk inserts
+ */
+typedef struct {
+    int* keys;              /**< Enum value per entry */
+    const void** values;    /**< Value pointer per entry */
+    const char** names;     /**< Name per entry (NULL if unnamed) */
+    StemStringPool* pool;   /**< Pool the names are interned in (NULL for frozen maps) */
+    size_t count;           /**< Number of entries */
+} StemEntryArrays;
+
+/**
+ * @brief One change of a patch, see stdem_diff()
+ */
+typedef struct {
+    int enum_value;         /**< Enum value the change applies to */
+    unsigned int kind;      /**< STEM_PATCH_REMOVE, or a set with or without STEM_PATCH_VALUE */
+    size_t name;            /**< Offset of the new name in the name data, or STEM_PATCH_NO_NAME */
+} StemPatchOp;
+
+/**
+ * @brief Change set turning one map into another
+ * 
+ * Owns copies of every value and name it sets, in a single allocation
+ * holding the header, the operations, the values (one stride per
+ * operation) and the names, so it outlives both maps it was computed from.
+ */
+struct StemPatch {
+    StemAllocator allocator; /**< Allocator the patch came from */
+    size_t size;             /**< Size of the allocation in bytes */
+    size_t value_size;       /**< Value size of the maps, 0 for pointer values */
+    size_t count;            /**< Number of operations */
+    size_t inserts_max;      /**< Set operations, an upper bound of the new entries */
+    size_t named;            /**< Set operations carrying a name */
+    size_t names_size;       /**< Bytes of name data, terminators included */
+    StemPatchOp* ops;        /**< Operations in application order */
+    unsigned char* values;   /**< Value of operation i at i * stride */
+    char* names;             /**< NUL-terminated names */
+};
+
+/**
+ * @brief One slot of the per-thread front cache, see STEM_FLAGS_FRONT_CACHE
+ */
+typedef struct {
+    uint64_t epoch;         /**< cache_epoch of the map it was found in, 0 if empty */
+    const void* value;      /**< Value pointer the lookup returned */
+    int enum_value;         /**< Enum value that was looked up */
+    int referenced;         /**< Set by hits, cleared once before the slot is replaced */
+} StemFrontSlot;
+
+/**
+ * @brief Union of the types with the strictest alignment requirements
+ */
+typedef union {
+    long double ld;
+    long long ll;
+    double d;
+    void* p;
+    void (*fp)(void);
+} StemMaxAlign;
+
+/**
+ * @brief Map retired by a snapshot publish, waiting for its readers to leave
+ */
+typedef struct StemRetiredMap {
+    EnumMap* map;                /**< Map to destroy once unreachable */
+    size_t epoch;                /**< First epoch in which the map is unreachable */
+    struct StemRetiredMap* next; /**< Next retired map (older) */
+} StemRetiredMap;
+
+/**
+ * @brief Epoch announcement slot of a registered snapshot reader
+ * 
+ * Each reader owns one cache line, so reading a snapshot only writes to
+ * memory no other thread writes to. in_use comes last so that no
+ * alignment padding hides between the fields and the padding array.
+ */
+struct StemSnapshotReader {
+    size_t epoch;           /**< Epoch seen by the current read, 0 when idle */
+    StemSnapshot* snapshot; /**< Owning snapshot */
+    int in_use;             /**< Non-zero while the slot is registered */
+    unsigned char padding[STEM_CACHE_LINE - sizeof(size_t) - sizeof(StemSnapshot*) - sizeof(int)];
+};
+
+/* Compile-time check that reader slots fill exactly one cache line each */
+typedef char stem_reader_fills_line[sizeof(StemSnapshotReader) == STEM_CACHE_LINE ? 1 : -1];
+
+/**
+ * @brief Holder of the current published map of a read-mostly workload
+ */
+struct StemSnapshot {
+    EnumMap* current;            /**< Published map, swapped atomically */
+    size_t epoch;                /**< Global epoch, bumped by every publish */
+    int writer_lock;             /**< Serializes publishers and reclamation */
+    StemSnapshotReader* readers; /**< Cache-line aligned reader slots */
+    void* readers_block;         /**< Allocation backing the reader slots */
+    size_t max_readers;          /**< Number of reader slots */
+    StemRetiredMap* retired;     /**< Maps waiting for reclamation */
 };
 
 /* ==================== INTERNAL CONSTANTS ==================== */
 
 #define STEM_DEFAULT_BUCKETS 16    /**< Default number of buckets in the hash table */
-#define STEM_LOAD_FACTOR 0.75      /**< Load factor threshold for resizing the hash table */
+#define STEM_DEFAULT_SLOTS 16      /**< Default number of open-addressing slots (power of two) */
+#define STEM_LOAD_FACTOR 0.75      /**< Default load factor threshold for resizing the hash table */
+#define STEM_MIN_LOAD_FACTOR 0.1f  /**< Smallest configurable maximum load factor */
+#define STEM_MAX_SLOT_LOAD 0.95f   /**< Largest maximum load factor of open-addressing tables */
+#define STEM_MAX_BUCKET_LOAD 4.0f  /**< Largest maximum load factor of chained tables */
 #define STEM_MAX_ENTRIES ((size_t)-1) /**< Maximum number of entries supported */
+#define STEM_MAX_DENSE_SIZE ((size_t)1 << 31) /**< Dense range must stay within non-negative ints */
+#define STEM_ALIGNMENT sizeof(StemMaxAlign) /**< Alignment of arena and static buffer allocations */
+#define STEM_ARENA_MIN_CHUNK 256           /**< Smallest arena chunk payload */
+#define STEM_ARENA_MAX_CHUNK (1 << 20)     /**< Largest arena chunk payload for regular growth */
+#define STEM_LOCK_SPINS 64            /**< Busy-wait iterations before yielding the CPU */
+#define STEM_BULK_BATCH 1024          /**< Entries read per bulk insert while deserializing */
+#define STEM_BATCH_BLOCK 32           /**< Keys hashed and prefetched together by batch lookups */
+#define STEM_MAX_THREADS 64           /**< Threads started by one built-in executor batch */
+#define STEM_ORDER_BLOCK 254          /**< Enum values per block of the ordered index */
+#define STEM_REHASH_STEP 8            /**< Old buckets migrated per operation by an incremental resize */
+#define STEM_FRONT_CACHE_BITS 6       /**< log2 of the front cache slots of each thread */
+#define STEM_FROZEN_NO_NAME UINT32_MAX /**< Name offset of an unnamed frozen entry */
+#define STEM_PATCH_REMOVE 0x1u        /**< Patch operation removing its enum value */
+#define STEM_PATCH_VALUE 0x2u         /**< Patch operation setting a value */
+#define STEM_PATCH_NO_NAME SIZE_MAX   /**< Name offset of a patch operation clearing the name */
+#define STEM_FROZEN_MAX_SEED (1 << 24) /**< Seeds tried per bucket before giving up */
+#define STEM_IMAGE_MAGIC 0x454E554D  /**< 'ENUM', shared by every serialization format */
+#define STEM_IMAGE_VERSION 2          /**< Version written by stdem_serialize() */
+#define STEM_IMAGE_BYTE_ORDER 0x01020304u /**< Byte order tag of an image header */
+#define STEM_IMAGE_ALIGNMENT 8        /**< Alignment required of an in-memory image */
+#define STEM_HUGE_PAGE_SIZE ((size_t)2 << 20) /**< Huge page size, also the smallest allocation using them */
+#define STEM_MAX_NODES 64             /**< NUMA nodes a replicated map covers */
+#define STEM_MAX_CPUS 4096            /**< CPUs whose node a replicated map records */
+#define STEM_SHARED_MAGIC 0x53484D45u /**< 'SHME', marks an initialized shared region */
+#define STEM_SHARED_VERSION 1         /**< Layout version of a shared region header */
+#define STEM_NAME_PREFIX sizeof(uint32_t) /**< Length stored in front of every stored name */
+#define STEM_POOL_PREFIX (2 * sizeof(uint32_t)) /**< Hash and length in front of interned names */
+#define STEM_ALIGN_UP(n) (((n) + STEM_ALIGNMENT - 1) & ~(STEM_ALIGNMENT - 1))
 
 /* ==================== INTERNAL FUNCTION PROTOTYPES ==================== */
 
 static uint32_t stem_hash_int(int value);
-static uint32_t stem_hash_string(const char* str);
+static uint32_t stem_hash_bytes(const char* data, size_t length, uint32_t seed);
+static uint32_t stem_hash_name(const char* name, size_t length);
+static size_t stem_name_length(const char* name);
+static void* stem_alloc(const EnumMap* map, size_t size);
+static void* stem_calloc(const EnumMap* map, size_t count, size_t size);
+static void stem_free(const EnumMap* map, void* ptr, size_t size);
+static void* stem_arena_alloc(const StemAllocator* allocator, StemArena* arena, size_t size);
+static StemArenaChunk* stem_arena_grow(const StemAllocator* allocator, StemArena* arena, 
+                                       size_t size);
+static StemError stem_arena_reserve(const StemAllocator* allocator, StemArena* arena, 
+                                    size_t size);
+static void stem_arena_reset(const StemAllocator* allocator, StemArena* arena);
+static void stem_arena_release(const StemAllocator* allocator, StemArena* arena);
+static StemStringPool* stem_pool_create(const StemAllocator* allocator);
+static StemStringPool* stem_pool_retain(StemStringPool* pool);
+static void stem_pool_release(StemStringPool* pool);
+static uint32_t stem_pool_hash(const char* name);
+static StemError stem_pool_reserve(StemStringPool* pool, size_t count, size_t bytes);
+static const char* stem_pool_intern(StemStringPool* pool, const char* name, size_t length);
+static const char* stem_intern(EnumMap* map, const char* name, const StemStringPool* source);
+static void stem_free_storage(EnumMap* map);
+static StemNameSlot* stem_name_lookup(const EnumMap* map, const char* name, 
+                                      size_t length, uint32_t hash);
+static StemError stem_name_index_reserve(EnumMap* map, size_t extra);
+static StemError stem_name_index_resize(EnumMap* map, size_t new_size);
+static void stem_name_index_insert(EnumMap* map, const char* name, int enum_value);
+static StemError stem_name_index_forget(EnumMap* map, const char* name, int enum_value);
+static StemError stem_order_insert(EnumMap* map, int enum_value);
+static void stem_order_remove(EnumMap* map, int enum_value);
+static StemError stem_order_copy(EnumMap* map, const EnumMap* source);
+static StemError stem_order_freeze(EnumMap* map);
+static size_t stem_order_block(const EnumMap* map, int enum_value);
+static size_t stem_lower_bound(const int* keys, size_t count, int enum_value);
+static uint32_t stem_hash_seeded(uint32_t hash, uint32_t seed);
+static uint32_t stem_hash_name_seeded(const char* name, size_t length, uint32_t seed);
+static const StemFrozenRecord* stem_frozen_record(const StemFrozen* frozen, size_t slot);
+static size_t stem_frozen_find(const StemFrozen* frozen, int enum_value);
+static const StemFrozen* stem_frozen_local(const EnumMap* map);
+static size_t stem_frozen_find_name(const StemFrozen* frozen, const char* name, size_t length);
+static const char* stem_frozen_name(const StemFrozen* frozen, size_t slot);
+static void* stem_frozen_value(const StemFrozen* frozen, size_t slot);
 static EnumEntry* stem_find_entry(const EnumMap* map, int enum_value);
+static EnumEntry* stem_find_entry_hashed(const EnumMap* map, int enum_value, uint32_t hash);
+static EnumEntry* stem_dense_slot(const EnumMap* map, int enum_value);
+static EnumEntry* stem_dense_entry(const EnumMap* map, size_t index);
+static EnumEntry* stem_slot_entry(const EnumMap* map, size_t index);
+static void* stem_entry_inline(EnumEntry* entry);
+static StemError stem_insert_dense(EnumMap* map, int enum_value, 
+                                 const void* value, const char* name);
 static StemError stem_resize_map(EnumMap* map, size_t new_size);
+static StemError stem_resize_slots(EnumMap* map, size_t new_size);
+static StemError stem_alloc_slots(EnumMap* map, size_t num_slots);
+static StemError stem_alloc_buckets(EnumMap* map, size_t num_buckets);
+static StemError stem_rehash_begin(EnumMap* map, size_t new_size);
+static void stem_rehash_step(EnumMap* map, size_t buckets);
+static size_t stem_bucket_span(const EnumMap* map);
+static EnumEntry** stem_bucket_at(const EnumMap* map, size_t index);
+static EnumEntry** stem_bucket_link(const EnumMap* map, int enum_value);
+static StemError stem_table_shift(size_t size, unsigned int* shift);
+static size_t stem_table_limit(const EnumMap* map, size_t size);
+static size_t stem_table_size(const EnumMap* map, size_t needed);
+static size_t stem_slot_index(const EnumMap* map, int enum_value);
+static StemError stem_insert_slot(EnumMap* map, int enum_value, 
+                                const void* value, const char* name);
 static StemError stem_create_entry(EnumMap* map, int enum_value, 
                                  const void* value, const char* name, 
                                  EnumEntry* *out_entry);
-static void stem_free_entry(EnumMap* map, EnumEntry* entry);
+static void stem_cursor_init(StemCursor* cursor);
+static EnumEntry* stem_cursor_next(const EnumMap* map, StemCursor* cursor);
+static void stem_release_entries(EnumMap* map);
+static StemError stem_grow_for_insert(EnumMap* map);
+static StemError stem_reserve_entries(EnumMap* map, size_t extra);
+static StemError stem_insert_new(EnumMap* map, int enum_value, 
+                                const void* value, const char* name);
+static StemError stem_bulk_insert(EnumMap* map, const int* keys, const void* const* values, 
+                                 const char* const* names, const StemStringPool* pool, 
+                                 size_t n, bool unique);
+static StemError stem_entries_gather(const EnumMap* map, StemEntryArrays* arrays);
+static bool stem_owns_name(const EnumMap* map, const EnumEntry* entry);
+static void stem_entries_free(const EnumMap* map, StemEntryArrays* arrays);
+static EnumMap* stem_create_map(size_t enum_count, size_t value_size, StemFlags flags, 
+                               const StemAllocator* allocator, StemStringPool* pool, 
+                               StemError* error);
+static EnumMap* stem_create_filled(size_t capacity, size_t value_size, StemFlags flags, 
+                                  float max_load, const StemAllocator* allocator, 
+                                  const StemEntryArrays* arrays, bool unique, 
+                                  StemError* error);
+static StemError stem_set_load(EnumMap* map, float max_load);
+static StemError stem_merge_entries(EnumMap* new_map, StemEntryArrays* second, bool overwrite);
+static StemError stem_insert_named(EnumMap* map, int enum_value, 
+                                   const void* value, const char* name);
 static void stem_lock_map(EnumMap* map);
 static void stem_unlock_map(EnumMap* map);
+static void stem_lock_map_shared(const EnumMap* map);
+static void stem_unlock_map_shared(const EnumMap* map);
+static bool stem_is_mutable(const EnumMap* map);
+static void stem_spin_lock(int* word);
+static void stem_spin_unlock(int* word);
+static void stem_count(const EnumMap* map, const size_t* counter, size_t n);
+static void stem_front_invalidate(EnumMap* map);
+static bool stem_front_get(const EnumMap* map, int enum_value, uint32_t hash, 
+                          const void** value);
+static void stem_front_put(const EnumMap* map, int enum_value, uint32_t hash, 
+                          const void* value);
+
+/* ==================== THREAD SAFETY ==================== */
+
+/**
+ * @brief Waits a little before retrying to take a contended lock
+ * 
+ * @param spins Number of failed attempts so far, updated in place
+ */
+static void stem_lock_backoff(unsigned int* spins) {
+    if (++*spins >= STEM_LOCK_SPINS) {
+        *spins = 0;
+        STEM_YIELD();
+    }
+}
+
+/**
+ * @brief Acquires a simple spin lock word (0 = free, 1 = held)
+ * 
+ * @param word Lock word
+ */
+static void stem_spin_lock(int* word) {
+#if STEM_HAVE_ATOMICS
+    unsigned int spins = 0;
+    int expected = 0;
+    while (!STEM_ATOMIC_CAS(word, &expected, 1)) {
+        expected = 0;
+        stem_lock_backoff(&spins);
+    }
+#else
+    (void)word; /* Unused parameter */
+#endif
+}
+
+/**
+ * @brief Releases a lock word acquired with stem_spin_lock()
+ * 
+ * @param word Lock word
+ */
+static void stem_spin_unlock(int* word) {
+#if STEM_HAVE_ATOMICS
+    STEM_ATOMIC_STORE(word, 0);
+#else
+    (void)word; /* Unused parameter */
+#endif
+}
 
-/* ==================== THREAD SAFETY STUBS ==================== */
+/**
+ * @brief Adds lookups to a STEM_FLAGS_STATS counter of a map
+ * 
+ * Lookups only hold the lock shared (or none on published and frozen
+ * maps), so the counters are bumped atomically. Maps without the flag
+ * return right away.
+ * 
+ * @param map Map the lookups ran on
+ * @param counter Counter of that map to update
+ * @param n Number of lookups to add
+ */
+static void stem_count(const EnumMap* map, const size_t* counter, size_t n) {
+    if (!(map->flags & STEM_FLAGS_STATS) || n == 0) {
+        return;
+    }
+#if STEM_HAVE_ATOMICS
+    STEM_ATOMIC_ADD_RELAXED((size_t*)counter, n);
+#else
+    *(size_t*)counter += n;
+#endif
+}
 
 /**
- * @brief Locks the enum map for thread-safe operations
+ * @brief Locks the enum map for exclusive (writer) access
  * 
- * This is a stub function that does nothing by default.
- * For actual thread safety, this should be implemented with
- * platform-specific synchronization primitives.
+ * Does nothing unless the map was created with STEM_FLAGS_THREAD_SAFE.
+ * Otherwise waits until no reader or writer holds the lock.
  * 
  * @param map Pointer to the EnumMap to lock
  */
 static void stem_lock_map(EnumMap* map) {
-    /* Default implementation: no-op
-     * For thread safety, replace with platform-specific locking
-     */
+#if STEM_HAVE_ATOMICS
+    if (map->flags & STEM_FLAGS_THREAD_SAFE) {
+        unsigned int spins = 0;
+        int expected = 0;
+        while (!STEM_ATOMIC_CAS(&map->lock, &expected, -1)) {
+            expected = 0;
+            stem_lock_backoff(&spins);
+        }
+    }
+#else
     (void)map; /* Unused parameter */
+#endif
 }
 
 /**
- * @brief Unlocks the enum map after thread-safe operations
- * 
- * This is a stub function that does nothing by default.
- * For actual thread safety, this should be implemented with
- * platform-specific synchronization primitives.
+ * @brief Unlocks the enum map after exclusive access
  * 
  * @param map Pointer to the EnumMap to unlock
  */
 static void stem_unlock_map(EnumMap* map) {
-    /* Default implementation: no-op
-     * For thread safety, replace with platform-specific locking
-     */
+#if STEM_HAVE_ATOMICS
+    if (map->flags & STEM_FLAGS_THREAD_SAFE) {
+        STEM_ATOMIC_STORE(&map->lock, 0);
+    }
+#else
     (void)map; /* Unused parameter */
+#endif
 }
 
-/* ==================== HASHING FUNCTIONS ==================== */
+/**
+ * @brief Locks the enum map for shared (reader) access
+ * 
+ * Any number of readers may hold the lock at once; they only wait while a
+ * writer holds it. Readers are preferred, so a reader may safely re-enter
+ * the map (for instance from a stdem_foreach callback).
+ * 
+ * @param map Pointer to the EnumMap to lock
+ */
+static void stem_lock_map_shared(const EnumMap* map) {
+#if STEM_HAVE_ATOMICS
+    if (map->flags & STEM_FLAGS_THREAD_SAFE) {
+        int* lock = &((EnumMap*)map)->lock;
+        unsigned int spins = 0;
+        int state = STEM_ATOMIC_LOAD(lock);
+        for (;;) {
+            if (state >= 0 && STEM_ATOMIC_CAS(lock, &state, state + 1)) {
+                return;
+            }
+            if (state < 0) {
+                stem_lock_backoff(&spins);
+                state = STEM_ATOMIC_LOAD(lock);
+            }
+        }
+    }
+#else
+    (void)map; /* Unused parameter */
+#endif
+}
 
 /**
- * @brief Hashes an integer value for bucket indexing
+ * @brief Unlocks the enum map after shared access
  * 
- * Uses a simple multiplication hash that provides good distribution
- * for typical enum values.
+ * @param map Pointer to the EnumMap to unlock
+ */
+static void stem_unlock_map_shared(const EnumMap* map) {
+#if STEM_HAVE_ATOMICS
+    if (map->flags & STEM_FLAGS_THREAD_SAFE) {
+        STEM_ATOMIC_ADD(&((EnumMap*)map)->lock, -1);
+    }
+#else
+    (void)map; /* Unused parameter */
+#endif
+}
+
+/**
+ * @brief Checks whether a map accepts modifications
  * 
- * @param value The integer value to hash
- * @return uint32_t The hash value
+ * @param map Pointer to the EnumMap
+ * @return bool false for read-only and published maps
  */
-static uint32_t stem_hash_int(int value) {
-    /* Multiplication by a large prime for good distribution */
-    return (uint32_t)value * 2654435761U;
+static bool stem_is_mutable(const EnumMap* map) {
+    return !(map->flags & STEM_FLAGS_READONLY) && !map->published;
+}
+
+/* ==================== MEMORY MANAGEMENT ==================== */
+
+/**
+ * @brief Default allocation hook forwarding to malloc()
+ */
+static void* stem_default_allocate(size_t size, void* user_data) {
+    (void)user_data; /* Unused parameter */
+    return malloc(size);
+}
+
+/**
+ * @brief Default release hook forwarding to free()
+ */
+static void stem_default_deallocate(void* ptr, size_t size, void* user_data) {
+    (void)size;      /* Unused parameter */
+    (void)user_data; /* Unused parameter */
+    free(ptr);
 }
 
 /**
- * @brief Hashes a string for bucket indexing (used for name lookup)
+ * @brief Allocator used when the caller does not provide one
+ */
+static const StemAllocator stem_default_allocator = {
+    stem_default_allocate,
+    stem_default_deallocate,
+    NULL
+};
+
+/**
+ * @brief Tells whether an allocation is backed by huge pages
  * 
- * This function uses the djb2 algorithm for string hashing, which provides
- * good distribution and is efficient for typical enum name lengths.
+ * Only large arrays of maps with a huge-page flag and the default
+ * allocator qualify. The decision depends on the arguments alone, so the
+ * release of a block takes the same path as its allocation.
  * 
- * @param str The string to hash
- * @return uint32_t The hash value
+ * @param allocator Allocator of the map
+ * @param flags Flags of the map
+ * @param size Size of the allocation in bytes
+ * @return bool True if the block is mapped by stem_pages_alloc()
  */
-static uint32_t stem_hash_string(const char* str) {
-    uint32_t hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;
-    }
-    return hash;
+static bool stem_huge_eligible(const StemAllocator* allocator, StemFlags flags, size_t size) {
+    return STEM_HAVE_HUGE_PAGES && 
+           (flags & (STEM_FLAGS_HUGE_PAGES | STEM_FLAGS_HUGE_PAGES_EXPLICIT)) && 
+           size >= STEM_HUGE_PAGE_SIZE && allocator->allocate == stem_default_allocate;
 }
 
-/* ==================== INTERNAL MAP OPERATIONS ==================== */
+/**
+ * @brief Returns the mapped length of a huge-page block, 0 on overflow
+ */
+static size_t stem_huge_length(size_t size) {
+    if (size > SIZE_MAX - 2 * STEM_HUGE_PAGE_SIZE) {
+        return 0;
+    }
+    return (size + STEM_HUGE_PAGE_SIZE - 1) & ~(STEM_HUGE_PAGE_SIZE - 1);
+}
 
 /**
- * @brief Finds an entry in the map by enum value
+ * @brief Maps zeroed memory backed by huge pages where the system allows
  * 
- * This function searches the hash table for an entry with the given enum value.
- * It handles collisions by traversing the linked list in the appropriate bucket.
+ * STEM_FLAGS_HUGE_PAGES_EXPLICIT first tries the reserved huge page pool.
+ * Otherwise, or when the pool is exhausted, a huge-page aligned range is
+ * mapped and advised for transparent huge pages, which the kernel may
+ * still back with small pages.
  * 
- * @param map Pointer to the EnumMap
- * @param enum_value The enum value to search for
- * @return EnumEntry* Pointer to the found entry, or NULL if not found
+ * @param size Size of the block in bytes
+ * @param flags Flags of the map
+ * @return void* Mapped block, or NULL on failure
  */
-static EnumEntry* stem_find_entry(const EnumMap* map, int enum_value) {
-    if (!map || !map->buckets) {
+static void* stem_pages_alloc(size_t size, StemFlags flags) {
+#if STEM_HAVE_HUGE_PAGES
+    size_t length = stem_huge_length(size);
+    if (length == 0) {
         return NULL;
     }
     
-    uint32_t hash = stem_hash_int(enum_value);
-    size_t bucket_idx = hash % map->num_buckets;
-    
-    EnumEntry* entry = map->buckets[bucket_idx];
-    while (entry) {
-        if (entry->enum_value == enum_value) {
-            return entry;
+    if (flags & STEM_FLAGS_HUGE_PAGES_EXPLICIT) {
+        int huge = MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+        huge |= 21 << MAP_HUGE_SHIFT; /* 2 MB pages whatever the default size is */
+#endif
+        void* ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, 
+                         MAP_PRIVATE | MAP_ANONYMOUS | huge, -1, 0);
+        if (ptr != MAP_FAILED) {
+            return ptr;
         }
-        entry = entry->next;
     }
     
+    /* Map one huge page more than needed and trim both ends to align */
+    size_t padded = length + STEM_HUGE_PAGE_SIZE;
+    unsigned char* base = mmap(NULL, padded, PROT_READ | PROT_WRITE, 
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    size_t head = (size_t)(STEM_HUGE_PAGE_SIZE - (uintptr_t)base % STEM_HUGE_PAGE_SIZE) % 
+                  STEM_HUGE_PAGE_SIZE;
+    if (head > 0) {
+        munmap(base, head);
+    }
+    if (padded - head > length) {
+        munmap(base + head + length, padded - head - length);
+    }
+    madvise(base + head, length, MADV_HUGEPAGE);
+    return base + head;
+#else
+    (void)size;  /* Unused parameter */
+    (void)flags; /* Unused parameter */
     return NULL;
+#endif
 }
 
 /**
- * @brief Resizes the hash table to a new size
+ * @brief Releases a block from stem_pages_alloc()
  * 
- * This function rehashes all entries and places them into new buckets.
- * It's called automatically when the load factor exceeds STEM_LOAD_FACTOR.
+ * @param ptr Mapped block
+ * @param size Size passed when the block was allocated
+ */
+static void stem_pages_free(void* ptr, size_t size) {
+#if STEM_HAVE_HUGE_PAGES
+    munmap(ptr, stem_huge_length(size));
+#else
+    (void)ptr;  /* Unused parameter */
+    (void)size; /* Unused parameter */
+#endif
+}
+
+/**
+ * @brief Allocates memory through the map's allocator
  * 
  * @param map Pointer to the EnumMap
- * @param new_size The new number of buckets
- * @return StemError Error code indicating success or failure
+ * @param size Number of bytes to allocate
+ * @return void* Allocated memory, or NULL on failure
  */
-static StemError stem_resize_map(EnumMap* map, size_t new_size) {
-    if (!map) {
-        return STEM_ERROR_INVALID_ARG;
+static void* stem_alloc(const EnumMap* map, size_t size) {
+    if (stem_huge_eligible(&map->allocator, map->flags, size)) {
+        return stem_pages_alloc(size, map->flags);
     }
-    
-    if (new_size == 0) {
-        return STEM_ERROR_INVALID_ARG;
+    return map->allocator.allocate(size, map->allocator.user_data);
+}
+
+/**
+ * @brief Allocates zeroed memory through the map's allocator
+ * 
+ * @param map Pointer to the EnumMap
+ * @param count Number of elements
+ * @param size Size of each element
+ * @return void* Allocated memory, or NULL on failure or overflow
+ */
+static void* stem_calloc(const EnumMap* map, size_t count, size_t size) {
+    if (size != 0 && count > (size_t)-1 / size) {
+        return NULL;
     }
     
-    EnumEntry** new_buckets = calloc(new_size, sizeof(EnumEntry*));
-    if (!new_buckets) {
-        return STEM_ERROR_OUT_OF_MEMORY;
+    /* calloc() takes large tables from fresh pages the system zeroes on
+     * first touch, so growing a table does not clear it up front; so do
+     * huge-page mappings */
+    if (stem_huge_eligible(&map->allocator, map->flags, count * size)) {
+        return stem_pages_alloc(count * size, map->flags);
+    }
+    if (map->allocator.allocate == stem_default_allocate) {
+        return calloc(count, size);
     }
     
-    /* Rehash all entries */
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            EnumEntry* next = entry->next;
-            
-            uint32_t hash = stem_hash_int(entry->enum_value);
-            size_t new_bucket_idx = hash % new_size;
-            
-            entry->next = new_buckets[new_bucket_idx];
-            new_buckets[new_bucket_idx] = entry;
+    void* ptr = stem_alloc(map, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief Releases memory obtained from stem_alloc() or stem_calloc()
+ * 
+ * @param map Pointer to the EnumMap
+ * @param ptr Memory to release (may be NULL)
+ * @param size Size passed when the memory was allocated
+ */
+static void stem_free(const EnumMap* map, void* ptr, size_t size) {
+    if (ptr && stem_huge_eligible(&map->allocator, map->flags, size)) {
+        stem_pages_free(ptr, size);
+    } else if (ptr && map->allocator.deallocate) {
+        map->allocator.deallocate(ptr, size, map->allocator.user_data);
+    }
+}
+
+/**
+ * @brief Bump-allocates memory from an arena
+ * 
+ * A new chunk is requested from the allocator when the current one is full.
+ * Chunk sizes double up to STEM_ARENA_MAX_CHUNK, so building a large map
+ * costs a handful of allocator calls instead of several per entry.
+ * 
+ * @param allocator Allocator backing the arena
+ * @param arena Arena to allocate from
+ * @param size Number of bytes to allocate
+ * @return void* Memory aligned to STEM_ALIGNMENT, or NULL on failure
+ */
+static void* stem_arena_alloc(const StemAllocator* allocator, StemArena* arena, size_t size) {
+    size = STEM_ALIGN_UP(size);
+    
+    StemArenaChunk* chunk = arena->chunks;
+    if (!chunk || chunk->capacity - chunk->used < size) {
+        chunk = stem_arena_grow(allocator, arena, size);
+        if (!chunk) {
+            return NULL;
+        }
+    }
+    
+    void* ptr = (unsigned char*)chunk + STEM_ALIGN_UP(sizeof(StemArenaChunk)) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+/**
+ * @brief Starts a new arena chunk with room for at least size bytes
+ * 
+ * @param allocator Allocator backing the arena
+ * @param arena Arena to grow
+ * @param size Minimum payload size (already aligned)
+ * @return StemArenaChunk* The new current chunk, or NULL on failure
+ */
+static StemArenaChunk* stem_arena_grow(const StemAllocator* allocator, StemArena* arena, 
+                                       size_t size) {
+    if (arena->chunk_size < STEM_ARENA_MIN_CHUNK) {
+        arena->chunk_size = STEM_ARENA_MIN_CHUNK;
+    }
+    size_t capacity = arena->chunk_size > size ? arena->chunk_size : size;
+    
+    StemArenaChunk* chunk = allocator->allocate(STEM_ALIGN_UP(sizeof(StemArenaChunk)) + capacity, 
+                                                allocator->user_data);
+    if (!chunk) {
+        return NULL;
+    }
+    chunk->next = arena->chunks;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    arena->chunks = chunk;
+    
+    if (arena->chunk_size < STEM_ARENA_MAX_CHUNK) {
+        arena->chunk_size *= 2;
+    }
+    return chunk;
+}
+
+/**
+ * @brief Makes sure the current arena chunk can serve size more bytes
+ * 
+ * Used by bulk inserts so that all of their allocations come from a
+ * single chunk.
+ * 
+ * @param allocator Allocator backing the arena
+ * @param arena Arena to prepare
+ * @param size Total size of the upcoming allocations, each rounded up to STEM_ALIGNMENT
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_arena_reserve(const StemAllocator* allocator, StemArena* arena, 
+                                    size_t size) {
+    StemArenaChunk* chunk = arena->chunks;
+    if (size == 0 || (chunk && chunk->capacity - chunk->used >= size)) {
+        return STEM_SUCCESS;
+    }
+    return stem_arena_grow(allocator, arena, size) ? STEM_SUCCESS : STEM_ERROR_OUT_OF_MEMORY;
+}
+
+/**
+ * @brief Returns the length of a name stored by the map
+ * 
+ * Only valid for names owned by a map (interned and frozen strings),
+ * which carry their length in the four bytes in front of them.
+ * 
+ * @param name Stored name
+ * @return size_t Length of the name without the terminator
+ */
+static size_t stem_name_length(const char* name) {
+    uint32_t length;
+    memcpy(&length, name - STEM_NAME_PREFIX, sizeof(length));
+    return length;
+}
+
+/**
+ * @brief Empties an arena, keeping the most recent chunk for reuse
+ * 
+ * @param allocator Allocator backing the arena
+ * @param arena Arena to empty
+ */
+static void stem_arena_reset(const StemAllocator* allocator, StemArena* arena) {
+    StemArenaChunk* keep = arena->chunks;
+    if (!keep) {
+        return;
+    }
+    
+    StemArenaChunk* chunk = keep->next;
+    while (chunk) {
+        StemArenaChunk* next = chunk->next;
+        if (allocator->deallocate) {
+            allocator->deallocate(chunk, STEM_ALIGN_UP(sizeof(StemArenaChunk)) + chunk->capacity, 
+                                  allocator->user_data);
+        }
+        chunk = next;
+    }
+    
+    keep->next = NULL;
+    keep->used = 0;
+}
+
+/**
+ * @brief Returns every arena chunk to the allocator
+ * 
+ * @param allocator Allocator backing the arena
+ * @param arena Arena to release
+ */
+static void stem_arena_release(const StemAllocator* allocator, StemArena* arena) {
+    stem_arena_reset(allocator, arena);
+    if (arena->chunks && allocator->deallocate) {
+        allocator->deallocate(arena->chunks, 
+                              STEM_ALIGN_UP(sizeof(StemArenaChunk)) + arena->chunks->capacity, 
+                              allocator->user_data);
+    }
+    arena->chunks = NULL;
+}
+
+/**
+ * @brief Releases the bucket, dense and slot arrays of a map
+ * 
+ * @param map Pointer to the EnumMap
+ */
+static void stem_free_storage(EnumMap* map) {
+    stem_free(map, map->dense_used, map->dense_size);
+    stem_free(map, map->dense, map->dense_size * map->entry_size);
+    stem_free(map, map->slot_used, map->num_slots);
+    stem_free(map, map->slots, map->num_slots * map->entry_size);
+    stem_free(map, map->buckets, map->num_buckets * sizeof(EnumEntry*));
+    stem_free(map, map->old_buckets, map->old_num_buckets * sizeof(EnumEntry*));
+    stem_free(map, map->names, map->num_names * sizeof(StemNameSlot));
+    stem_free(map, map->order, map->order_capacity * sizeof(*map->order));
+    if (map->order_pairs) {
+        stem_free(map, map->order_pairs, (size_t)map->frozen->count * sizeof(StemOrderPair));
+    }
+    if (map->frozen && !map->image) {
+        stem_free(map, map->frozen, (size_t)map->frozen->size);
+    }
+#if STEM_HAVE_MMAP
+    if (map->image_mapped) {
+        munmap((void*)map->image, map->image_mapped);
+    }
+#endif
+#if STEM_HAVE_ATOMICS
+    if (map->shared_pin) {
+        STEM_ATOMIC_ADD_SEQ(map->shared_pin, -1);
+    }
+#endif
+#if STEM_HAVE_NUMA
+    for (size_t i = 0; map->replicas && i < map->node_count; i++) {
+        if (map->replicas[i] && map->replicas[i] != map->frozen) {
+            munmap(map->replicas[i], map->replica_bytes);
+        }
+    }
+#endif
+    stem_free(map, map->replicas, map->node_count * sizeof(StemFrozen*));
+    stem_free(map, map->cpu_node, map->cpu_count);
+}
+
+/**
+ * @brief Allocation hook bump-allocating from a StemStaticBuffer
+ */
+static void* stem_static_allocate(size_t size, void* user_data) {
+    StemStaticBuffer* buffer = user_data;
+    
+    /* Align the absolute address, the caller's buffer may be unaligned */
+    uintptr_t start = (uintptr_t)(buffer->base + buffer->used);
+    size_t padding = (size_t)((STEM_ALIGNMENT - start % STEM_ALIGNMENT) % STEM_ALIGNMENT);
+    
+    if (padding > buffer->size - buffer->used || 
+        size > buffer->size - buffer->used - padding) {
+        return NULL;
+    }
+    
+    buffer->used += padding;
+    void* ptr = buffer->base + buffer->used;
+    buffer->used += size;
+    return ptr;
+}
+
+/* ==================== STRING POOL ==================== */
+
+/**
+ * @brief Creates an empty string pool referenced once
+ * 
+ * @param allocator Allocator backing the pool and its strings
+ * @return StemStringPool* New pool, or NULL on failure
+ */
+static StemStringPool* stem_pool_create(const StemAllocator* allocator) {
+    StemStringPool* pool = allocator->allocate(sizeof(StemStringPool), allocator->user_data);
+    if (!pool) {
+        return NULL;
+    }
+    
+    memset(pool, 0, sizeof(StemStringPool));
+    pool->refs = 1;
+    pool->allocator = *allocator;
+    return pool;
+}
+
+/**
+ * @brief Adds a reference to a pool
+ * 
+ * @param pool Pool to share
+ * @return StemStringPool* The same pool
+ */
+static StemStringPool* stem_pool_retain(StemStringPool* pool) {
+#if STEM_HAVE_ATOMICS
+    STEM_ATOMIC_ADD(&pool->refs, 1);
+#else
+    pool->refs++;
+#endif
+    return pool;
+}
+
+/**
+ * @brief Drops a reference to a pool, freeing it with the last one
+ * 
+ * @param pool Pool to release (may be NULL)
+ */
+static void stem_pool_release(StemStringPool* pool) {
+    if (!pool) {
+        return;
+    }
+    
+#if STEM_HAVE_ATOMICS
+    size_t refs = STEM_ATOMIC_ADD(&pool->refs, -1);
+#else
+    size_t refs = --pool->refs;
+#endif
+    if (refs != 0) {
+        return;
+    }
+    
+    StemAllocator allocator = pool->allocator;
+    stem_arena_release(&allocator, &pool->arena);
+    if (allocator.deallocate) {
+        allocator.deallocate(pool->strings, pool->num_strings * sizeof(char*), 
+                             allocator.user_data);
+        allocator.deallocate(pool, sizeof(StemStringPool), allocator.user_data);
+    }
+}
+
+/**
+ * @brief Returns the stem_hash_name() of an interned name
+ * 
+ * Only valid for names returned by stem_pool_intern(), which carry their
+ * hash in front of their length.
+ * 
+ * @param name Interned name
+ * @return uint32_t Hash of the name
+ */
+static uint32_t stem_pool_hash(const char* name) {
+    uint32_t hash;
+    memcpy(&hash, name - STEM_POOL_PREFIX, sizeof(hash));
+    return hash;
+}
+
+/**
+ * @brief Makes sure a pool can intern count more strings of bytes in total
+ * 
+ * Grows the string set under the load factor and the arena by one chunk,
+ * so that a bulk insert interns without further allocator calls. The
+ * caller must hold the pool lock.
+ * 
+ * @param pool Pool to prepare
+ * @param count Number of strings about to be interned
+ * @param bytes Arena bytes they take (STEM_ALIGN_UP(STEM_POOL_PREFIX + length + 1) each)
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_pool_reserve(StemStringPool* pool, size_t count, size_t bytes) {
+    size_t needed = pool->count + count;
+    if (!pool->strings || (float)needed > pool->num_strings * STEM_LOAD_FACTOR) {
+        size_t new_size = pool->strings ? pool->num_strings * 2 : STEM_DEFAULT_SLOTS;
+        while ((float)needed > new_size * STEM_LOAD_FACTOR) {
+            new_size *= 2;
+        }
+        
+        const char** strings = pool->allocator.allocate(new_size * sizeof(char*), 
+                                                        pool->allocator.user_data);
+        if (!strings) {
+            return STEM_ERROR_OUT_OF_MEMORY;
+        }
+        memset(strings, 0, new_size * sizeof(char*));
+        
+        size_t mask = new_size - 1;
+        for (size_t i = 0; i < pool->num_strings; i++) {
+            if (!pool->strings[i]) {
+                continue;
+            }
+            size_t j = stem_pool_hash(pool->strings[i]) & mask;
+            while (strings[j]) {
+                j = (j + 1) & mask;
+            }
+            strings[j] = pool->strings[i];
+        }
+        
+        if (pool->strings && pool->allocator.deallocate) {
+            pool->allocator.deallocate(pool->strings, pool->num_strings * sizeof(char*), 
+                                       pool->allocator.user_data);
+        }
+        pool->strings = strings;
+        pool->num_strings = new_size;
+    }
+    
+    return stem_arena_reserve(&pool->allocator, &pool->arena, bytes);
+}
+
+/**
+ * @brief Returns the interned copy of a string, adding it if needed
+ * 
+ * The caller must hold the pool lock.
+ * 
+ * @param pool Pool to intern into
+ * @param name String to intern (NUL-terminated)
+ * @param length Length of the string
+ * @return const char* Interned string, or NULL on failure
+ */
+static const char* stem_pool_intern(StemStringPool* pool, const char* name, size_t length) {
+    if (length >= UINT32_MAX) {
+        return NULL;
+    }
+    
+    uint32_t hash = stem_hash_name(name, length);
+    if (pool->strings) {
+        size_t mask = pool->num_strings - 1;
+        size_t i = hash & mask;
+        while (pool->strings[i]) {
+            const char* candidate = pool->strings[i];
+            if (stem_pool_hash(candidate) == hash && stem_name_length(candidate) == length && 
+                memcmp(candidate, name, length) == 0) {
+                return candidate;
+            }
+            i = (i + 1) & mask;
+        }
+    }
+    
+    if (stem_pool_reserve(pool, 1, 0) != STEM_SUCCESS) {
+        return NULL;
+    }
+    char* block = stem_arena_alloc(&pool->allocator, &pool->arena, 
+                                   STEM_POOL_PREFIX + length + 1);
+    if (!block) {
+        return NULL;
+    }
+    
+    uint32_t prefix = (uint32_t)length;
+    memcpy(block, &hash, sizeof(hash));
+    memcpy(block + sizeof(hash), &prefix, sizeof(prefix));
+    memcpy(block + STEM_POOL_PREFIX, name, length);
+    block[STEM_POOL_PREFIX + length] = '\0';
+    
+    const char* interned = block + STEM_POOL_PREFIX;
+    size_t mask = pool->num_strings - 1;
+    size_t i = hash & mask;
+    while (pool->strings[i]) {
+        i = (i + 1) & mask;
+    }
+    pool->strings[i] = interned;
+    pool->count++;
+    return interned;
+}
+
+/**
+ * @brief Returns the name a map stores for an entry
+ * 
+ * Names already interned in the map's pool are used as they are, which
+ * makes copying between maps sharing a pool free of any string work.
+ * Other names are interned under the pool lock, since the pool may be
+ * shared with maps used from other threads.
+ * 
+ * @param map Map the name is stored for (must have a pool)
+ * @param name Name to store (NUL-terminated)
+ * @param source Pool the name was interned in, or NULL for a foreign name
+ * @return const char* Interned name, or NULL on failure
+ */
+static const char* stem_intern(EnumMap* map, const char* name, const StemStringPool* source) {
+    StemStringPool* pool = map->pool;
+    if (!pool) {
+        return NULL;
+    }
+    if (source == pool) {
+        return name;
+    }
+    
+    stem_spin_lock(&pool->lock);
+    const char* interned = stem_pool_intern(pool, name, strlen(name));
+    stem_spin_unlock(&pool->lock);
+    return interned;
+}
+
+/* ==================== HASHING FUNCTIONS ==================== */
+
+/**
+ * @brief Hashes an integer value for bucket indexing
+ * 
+ * Uses a simple multiplication hash that provides good distribution
+ * for typical enum values.
+ * 
+ * @param value The integer value to hash
+ * @return uint32_t The hash value
+ */
+static uint32_t stem_hash_int(int value) {
+    /* Multiplication by a large prime for good distribution */
+    return (uint32_t)value * 2654435761U;
+}
+
+/**
+ * @brief Hashes a byte string a 64-bit word at a time
+ * 
+ * Words are loaded with memcpy (no alignment requirement), scrambled by a
+ * multiply-xorshift and folded into the state, which starts from the seed
+ * and the length. The last word overlaps the previous one instead of
+ * being assembled byte by byte, and short strings are read with two
+ * overlapping 4-byte loads or three single bytes; this keeps the branches
+ * independent of the exact length. The result depends on the byte order,
+ * which images record.
+ * 
+ * @param data Bytes to hash
+ * @param length Number of bytes
+ * @param seed Seed selecting the hash function
+ * @return uint32_t The hash value
+ */
+static uint32_t stem_hash_bytes(const char* data, size_t length, uint32_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t hash = ((uint64_t)seed << 32 | seed) ^ ((uint64_t)length * 0x9E3779B97F4A7C15ULL);
+    uint64_t word;
+    
+    if (length > 8) {
+        const unsigned char* last = p + length - 8;
+        while (p < last) {
+            memcpy(&word, p, sizeof(word));
+            word *= 0xBF58476D1CE4E5B9ULL;
+            word ^= word >> 31;
+            hash = (hash ^ word) * 0x94D049BB133111EBULL;
+            p += sizeof(word);
+        }
+        memcpy(&word, last, sizeof(word));
+    } else if (length >= 4) {
+        uint32_t head;
+        uint32_t tail;
+        memcpy(&head, p, sizeof(head));
+        memcpy(&tail, p + length - 4, sizeof(tail));
+        word = (uint64_t)head << 32 | tail;
+    } else if (length > 0) {
+        word = (uint64_t)p[0] << 16 | (uint64_t)p[length >> 1] << 8 | p[length - 1];
+    } else {
+        word = 0;
+    }
+    word *= 0xBF58476D1CE4E5B9ULL;
+    word ^= word >> 31;
+    hash = (hash ^ word) * 0x94D049BB133111EBULL;
+    
+    hash ^= hash >> 32;
+    hash *= 0xD6E8FEB86659FD93ULL;
+    hash ^= hash >> 32;
+    return (uint32_t)hash;
+}
+
+/**
+ * @brief Hashes a name for the name index
+ * 
+ * @param name The name to hash (need not be NUL-terminated)
+ * @param length Length of the name
+ * @return uint32_t The hash value
+ */
+static uint32_t stem_hash_name(const char* name, size_t length) {
+    return stem_hash_bytes(name, length, 0);
+}
+
+/**
+ * @brief Derives an independent hash from a base hash and a seed
+ * 
+ * Applies the MurmurHash3 finalizer, which is a bijection, so distinct base
+ * hashes stay distinct for every seed.
+ * 
+ * @param hash Base hash (or raw enum value)
+ * @param seed Seed selecting the hash function
+ * @return uint32_t The hash value
+ */
+static uint32_t stem_hash_seeded(uint32_t hash, uint32_t seed) {
+    hash ^= seed * 0x9E3779B9U;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * @brief Hashes a name with a seed
+ * 
+ * Unlike seeding a fixed string hash, every seed rehashes the characters,
+ * so names colliding under one seed are separated by another. Seed 0 is
+ * stem_hash_name().
+ * 
+ * @param name The name to hash
+ * @param length Length of the name
+ * @param seed Seed selecting the hash function
+ * @return uint32_t The hash value
+ */
+static uint32_t stem_hash_name_seeded(const char* name, size_t length, uint32_t seed) {
+    return stem_hash_bytes(name, length, seed);
+}
+
+/* ==================== NAME INDEX ==================== */
+
+/**
+ * @brief Finds the index slot holding a name
+ * 
+ * Interned names (such as the names of the map's own entries) match by
+ * pointer before any bytes are compared.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param name The name to search for (need not be NUL-terminated)
+ * @param length Length of the name
+ * @param hash stem_hash_name() of the name
+ * @return StemNameSlot* Slot of the name, or NULL if it is not indexed
+ */
+static StemNameSlot* stem_name_lookup(const EnumMap* map, const char* name, 
+                                      size_t length, uint32_t hash) {
+    if (!map->names) {
+        return NULL;
+    }
+    
+    size_t mask = map->num_names - 1;
+    size_t i = hash & mask;
+    while (map->names[i].name) {
+        const char* candidate = map->names[i].name;
+        /* A pooled pointer may come with a shorter length (a prefix) */
+        if (map->names[i].hash == hash && stem_name_length(candidate) == length && 
+            (candidate == name || memcmp(candidate, name, length) == 0)) {
+            return &map->names[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Makes sure the name index can take extra more names
+ * 
+ * Allocates the index on first use and grows it in powers of two until the
+ * inserts fit under the load factor, so the following
+ * stem_name_index_insert() calls cannot fail.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param extra Number of names about to be inserted
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_name_index_reserve(EnumMap* map, size_t extra) {
+    size_t needed = map->names_count + extra;
+    if (map->names && (float)needed <= map->num_names * STEM_LOAD_FACTOR) {
+        return STEM_SUCCESS;
+    }
+    
+    size_t new_size = map->names ? map->num_names * 2 : STEM_DEFAULT_SLOTS;
+    while ((float)needed > new_size * STEM_LOAD_FACTOR) {
+        new_size *= 2;
+    }
+    return stem_name_index_resize(map, new_size);
+}
+
+/**
+ * @brief Moves the name index into a table of another size
+ * 
+ * @param map Pointer to the EnumMap
+ * @param new_size New number of slots, a power of two above names_count
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_name_index_resize(EnumMap* map, size_t new_size) {
+    StemNameSlot* new_names = stem_calloc(map, new_size, sizeof(StemNameSlot));
+    if (!new_names) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    size_t mask = new_size - 1;
+    for (size_t i = 0; i < map->num_names; i++) {
+        if (!map->names[i].name) {
+            continue;
+        }
+        size_t j = map->names[i].hash & mask;
+        while (new_names[j].name) {
+            j = (j + 1) & mask;
+        }
+        new_names[j] = map->names[i];
+    }
+    
+    stem_free(map, map->names, map->num_names * sizeof(StemNameSlot));
+    map->names = new_names;
+    map->num_names = new_size;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Adds a name to the index unless it is already indexed
+ * 
+ * The caller must have reserved room with stem_name_index_reserve().
+ * 
+ * @param map Pointer to the EnumMap
+ * @param name Interned name, kept by reference
+ * @param enum_value Enum value the name resolves to
+ */
+static void stem_name_index_insert(EnumMap* map, const char* name, int enum_value) {
+    size_t length = stem_name_length(name);
+    uint32_t hash = stem_pool_hash(name);
+    StemNameSlot* indexed = stem_name_lookup(map, name, length, hash);
+    if (indexed) {
+        indexed->shadows++;
+        return;
+    }
+    
+    size_t mask = map->num_names - 1;
+    size_t i = hash & mask;
+    while (map->names[i].name) {
+        i = (i + 1) & mask;
+    }
+    
+    map->names[i].name = name;
+    map->names[i].hash = hash;
+    map->names[i].enum_value = enum_value;
+    map->names[i].shadows = 0;
+    map->names_count++;
+}
+
+/**
+ * @brief Hands an indexed name over to another entry carrying it
+ * 
+ * Costs one pass over the entries, and only runs when the entry the name
+ * resolved to gives it up while shadowed by others. The first carrier in
+ * storage order takes the name, which need not be the next one associated.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param slot Index slot of the name, with shadows > 0
+ * @return bool false if no other entry carries the name any more
+ */
+static bool stem_name_index_take_over(EnumMap* map, StemNameSlot* slot) {
+    size_t length = stem_name_length(slot->name);
+    StemCursor cursor;
+    EnumEntry* entry;
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(map, &cursor)) != NULL) {
+        if (entry->name && (entry->name == slot->name || 
+                            (stem_name_length(entry->name) == length && 
+                             memcmp(entry->name, slot->name, length) == 0))) {
+            slot->enum_value = entry->enum_value;
+            slot->shadows--;
+            return true;
+        }
+    }
+    slot->shadows = 0;
+    return false;
+}
+
+/**
+ * @brief Drops the name of an entry that was removed or renamed
+ * 
+ * If other entries carry the same name, one of them takes the name over
+ * and the index is otherwise untouched. Otherwise the name's index slot
+ * is emptied by shifting back the names probed past it, so no tombstone
+ * is left.
+ * 
+ * @param map Pointer to the EnumMap, no longer holding the name on the entry
+ * @param name Interned name the entry had
+ * @param enum_value Enum value of the entry
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_name_index_forget(EnumMap* map, const char* name, int enum_value) {
+    StemNameSlot* slot = stem_name_lookup(map, name, stem_name_length(name), stem_pool_hash(name));
+    if (!slot) {
+        return STEM_SUCCESS;
+    }
+    if (slot->enum_value != enum_value) {
+        /* The entry was one of the shadows */
+        if (slot->shadows > 0) {
+            slot->shadows--;
+        }
+        return STEM_SUCCESS;
+    }
+    if (slot->shadows > 0 && stem_name_index_take_over(map, slot)) {
+        return STEM_SUCCESS;
+    }
+    
+    size_t mask = map->num_names - 1;
+    size_t i = (size_t)(slot - map->names);
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!map->names[j].name) {
+            break;
+        }
+        /* The name at j may fill the hole unless its home lies in (i, j] */
+        size_t home = map->names[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            map->names[i] = map->names[j];
+            i = j;
+        }
+    }
+    memset(&map->names[i], 0, sizeof(StemNameSlot));
+    map->names_count--;
+    return STEM_SUCCESS;
+}
+
+/* ==================== ORDERED INDEX ==================== */
+
+/**
+ * @brief Block of the ordered index: a sorted run of enum values
+ */
+typedef struct StemOrderBlock {
+    size_t count;                   /**< Number of enum values in the block */
+    int keys[STEM_ORDER_BLOCK];     /**< Enum values in ascending order */
+} StemOrderBlock;
+
+/**
+ * @brief Returns the position of the first key not less than a value
+ */
+static size_t stem_lower_bound(const int* keys, size_t count, int enum_value) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (keys[mid] < enum_value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Returns the block of the ordered index a value belongs in
+ * 
+ * That is the last block starting at or below the value, or the first
+ * block for values below every block.
+ * 
+ * @param map Pointer to the EnumMap (at least one block)
+ * @param enum_value Enum value to place
+ * @return size_t Directory index of the block
+ */
+static size_t stem_order_block(const EnumMap* map, int enum_value) {
+    size_t lo = 1;
+    size_t hi = map->order_blocks;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (map->order[mid]->keys[0] <= enum_value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+/**
+ * @brief Inserts a new block into the directory of the ordered index
+ * 
+ * @param map Pointer to the EnumMap
+ * @param index Directory position of the new block
+ * @return StemOrderBlock* The empty block, or NULL on failure
+ */
+static StemOrderBlock* stem_order_add_block(EnumMap* map, size_t index) {
+    if (map->order_blocks == map->order_capacity) {
+        size_t capacity = map->order_capacity ? map->order_capacity * 2 : 4;
+        StemOrderBlock** order = stem_alloc(map, capacity * sizeof(*order));
+        if (!order) {
+            return NULL;
+        }
+        if (map->order) {
+            memcpy(order, map->order, map->order_blocks * sizeof(*order));
+        }
+        stem_free(map, map->order, map->order_capacity * sizeof(*order));
+        map->order = order;
+        map->order_capacity = capacity;
+    }
+    
+    StemOrderBlock* block = stem_arena_alloc(&map->allocator, &map->arena, sizeof(StemOrderBlock));
+    if (!block) {
+        return NULL;
+    }
+    block->count = 0;
+    
+    memmove(&map->order[index + 1], &map->order[index], 
+            (map->order_blocks - index) * sizeof(*map->order));
+    map->order[index] = block;
+    map->order_blocks++;
+    return block;
+}
+
+/**
+ * @brief Adds an enum value stored outside the dense range to the ordered index
+ * 
+ * A full block is split in half, except when the value goes past the end
+ * of the last block: ascending inserts then start a new block and leave
+ * the previous ones full.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value Enum value not in the index yet
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_order_insert(EnumMap* map, int enum_value) {
+    if (!(map->flags & STEM_FLAGS_ORDERED)) {
+        return STEM_SUCCESS;
+    }
+    
+    if (map->order_blocks == 0 && !stem_order_add_block(map, 0)) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    size_t index = stem_order_block(map, enum_value);
+    StemOrderBlock* block = map->order[index];
+    size_t pos = stem_lower_bound(block->keys, block->count, enum_value);
+    
+    if (block->count == STEM_ORDER_BLOCK) {
+        bool append = pos == STEM_ORDER_BLOCK && index + 1 == map->order_blocks;
+        StemOrderBlock* next = stem_order_add_block(map, index + 1);
+        if (!next) {
+            return STEM_ERROR_OUT_OF_MEMORY;
+        }
+        
+        size_t half = append ? STEM_ORDER_BLOCK : STEM_ORDER_BLOCK / 2;
+        next->count = STEM_ORDER_BLOCK - half;
+        memcpy(next->keys, &block->keys[half], next->count * sizeof(int));
+        block->count = half;
+        if (pos >= half) {
+            block = next;
+            pos -= half;
+        }
+    }
+    
+    memmove(&block->keys[pos + 1], &block->keys[pos], (block->count - pos) * sizeof(int));
+    block->keys[pos] = enum_value;
+    block->count++;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Drops an enum value from the ordered index, if it is indexed
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value Enum value to drop
+ */
+static void stem_order_remove(EnumMap* map, int enum_value) {
+    if (map->order_blocks == 0) {
+        return;
+    }
+    
+    size_t index = stem_order_block(map, enum_value);
+    StemOrderBlock* block = map->order[index];
+    size_t pos = stem_lower_bound(block->keys, block->count, enum_value);
+    if (pos == block->count || block->keys[pos] != enum_value) {
+        return;
+    }
+    
+    block->count--;
+    memmove(&block->keys[pos], &block->keys[pos + 1], (block->count - pos) * sizeof(int));
+    
+    /* Empty blocks leave the directory (their memory stays in the arena) */
+    if (block->count == 0) {
+        map->order_blocks--;
+        memmove(&map->order[index], &map->order[index + 1], 
+                (map->order_blocks - index) * sizeof(*map->order));
+    }
+}
+
+/**
+ * @brief Gives a map an ordered index equal to another map's
+ * 
+ * @param map Map without ordered index entries yet
+ * @param source Map whose index is copied
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_order_copy(EnumMap* map, const EnumMap* source) {
+    if (source->order_blocks == 0) {
+        return STEM_SUCCESS;
+    }
+    
+    map->order = stem_alloc(map, source->order_blocks * sizeof(*map->order));
+    StemOrderBlock* blocks = stem_arena_alloc(&map->allocator, &map->arena, 
+                                              source->order_blocks * sizeof(StemOrderBlock));
+    if (!map->order || !blocks) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    map->order_capacity = source->order_blocks;
+    
+    for (size_t i = 0; i < source->order_blocks; i++) {
+        const StemOrderBlock* block = source->order[i];
+        blocks[i].count = block->count;
+        memcpy(blocks[i].keys, block->keys, block->count * sizeof(int));
+        map->order[i] = &blocks[i];
+    }
+    map->order_blocks = source->order_blocks;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Orders two StemOrderPair entries by enum value (for qsort)
+ */
+static int stem_order_pair_compare(const void* a, const void* b) {
+    int x = ((const StemOrderPair*)a)->enum_value;
+    int y = ((const StemOrderPair*)b)->enum_value;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Builds the ordered index of a frozen map with STEM_FLAGS_ORDERED
+ * 
+ * @param map Frozen map
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_order_freeze(EnumMap* map) {
+    const StemFrozen* frozen = map->frozen;
+    if (!(map->flags & STEM_FLAGS_ORDERED) || frozen->count == 0) {
+        return STEM_SUCCESS;
+    }
+    
+    map->order_pairs = stem_calloc(map, frozen->count, sizeof(StemOrderPair));
+    if (!map->order_pairs) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    for (uint32_t i = 0; i < frozen->count; i++) {
+        map->order_pairs[i].enum_value = stem_frozen_record(frozen, i)->enum_value;
+        map->order_pairs[i].slot = i;
+    }
+    qsort(map->order_pairs, frozen->count, sizeof(StemOrderPair), stem_order_pair_compare);
+    return STEM_SUCCESS;
+}
+
+/* ==================== FROZEN MAPS ==================== */
+
+/**
+ * @brief Keys of a perfect hash under construction
+ */
+typedef struct {
+    const int* keys;        /**< Enum values, or NULL when hashing names */
+    const char** names;     /**< Names, or NULL when hashing enum values */
+} StemPerfectKeys;
+
+/**
+ * @brief Hashes key i of a perfect hash under construction with a seed
+ */
+static uint32_t stem_perfect_hash(const StemPerfectKeys* keys, size_t i, uint32_t seed) {
+    if (keys->keys) {
+        return stem_hash_seeded((uint32_t)keys->keys[i], seed);
+    }
+    return stem_hash_name_seeded(keys->names[i], stem_name_length(keys->names[i]), seed);
+}
+
+/**
+ * @brief Builds a minimal perfect hash over n distinct keys
+ * 
+ * Keys are hashed into n buckets with seed 0. Buckets are then placed from
+ * the largest down: a bucket with several keys searches for the first seed
+ * that sends all of its keys to free slots, single keys take the next free
+ * slot directly and empty buckets keep seed 0.
+ * 
+ * @param map Map whose allocator provides scratch memory
+ * @param keys Keys to place
+ * @param n Number of keys (and slots)
+ * @param seeds Output seed per bucket
+ * @param slot_of Output slot of each key
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_perfect_build(const EnumMap* map, const StemPerfectKeys* keys, 
+                                    size_t n, int32_t* seeds, uint32_t* slot_of) {
+    if (n == 0) {
+        return STEM_SUCCESS;
+    }
+    
+    uint32_t* bucket_of = stem_calloc(map, n, sizeof(uint32_t));
+    size_t* start = stem_calloc(map, n + 1, sizeof(size_t));
+    uint32_t* members = stem_calloc(map, n, sizeof(uint32_t));
+    uint32_t* order = stem_calloc(map, n, sizeof(uint32_t));
+    size_t* by_size = stem_calloc(map, n + 2, sizeof(size_t));
+    unsigned char* taken = stem_calloc(map, n, 1);
+    StemError error = STEM_SUCCESS;
+    
+    if (!bucket_of || !start || !members || !order || !by_size || !taken) {
+        error = STEM_ERROR_OUT_OF_MEMORY;
+        goto done;
+    }
+    
+    /* Group the keys by bucket (counting sort) */
+    for (size_t i = 0; i < n; i++) {
+        bucket_of[i] = stem_perfect_hash(keys, i, 0) % (uint32_t)n;
+        start[bucket_of[i] + 1]++;
+    }
+    for (size_t b = 0; b < n; b++) {
+        start[b + 1] += start[b];
+    }
+    for (size_t i = 0; i < n; i++) {
+        members[start[bucket_of[i]]++] = (uint32_t)i;
+    }
+    for (size_t b = n; b > 0; b--) {
+        start[b] = start[b - 1];
+    }
+    start[0] = 0;
+    
+    /* Order the buckets by decreasing size (counting sort) */
+    for (size_t b = 0; b < n; b++) {
+        by_size[n - (start[b + 1] - start[b]) + 1]++;
+    }
+    for (size_t k = 0; k <= n; k++) {
+        by_size[k + 1] += by_size[k];
+    }
+    for (size_t b = 0; b < n; b++) {
+        order[by_size[n - (start[b + 1] - start[b])]++] = (uint32_t)b;
+    }
+    
+    size_t free_slot = 0;
+    for (size_t k = 0; k < n; k++) {
+        size_t b = order[k];
+        size_t size = start[b + 1] - start[b];
+        const uint32_t* bucket = members + start[b];
+        
+        if (size == 0) {
+            seeds[b] = 0;
+            continue;
+        }
+        
+        if (size == 1) {
+            while (taken[free_slot]) {
+                free_slot++;
+            }
+            taken[free_slot] = 1;
+            slot_of[bucket[0]] = (uint32_t)free_slot;
+            seeds[b] = -(int32_t)free_slot - 1;
+            continue;
+        }
+        
+        uint32_t seed = 1;
+        for (; seed < STEM_FROZEN_MAX_SEED; seed++) {
+            size_t placed = 0;
+            while (placed < size) {
+                uint32_t slot = stem_perfect_hash(keys, bucket[placed], seed) % (uint32_t)n;
+                if (taken[slot]) {
+                    break;
+                }
+                taken[slot] = 2;
+                slot_of[bucket[placed]] = slot;
+                placed++;
+            }
+            if (placed == size) {
+                break;
+            }
+            while (placed > 0) {
+                placed--;
+                taken[slot_of[bucket[placed]]] = 0;
+            }
+        }
+        
+        if (seed == STEM_FROZEN_MAX_SEED) {
+            error = STEM_ERROR_INVALID_ARG;
+            goto done;
+        }
+        for (size_t j = 0; j < size; j++) {
+            taken[slot_of[bucket[j]]] = 1;
+        }
+        seeds[b] = (int32_t)seed;
+    }
+    
+done:
+    stem_free(map, taken, n);
+    stem_free(map, by_size, (n + 2) * sizeof(size_t));
+    stem_free(map, order, n * sizeof(uint32_t));
+    stem_free(map, members, n * sizeof(uint32_t));
+    stem_free(map, start, (n + 1) * sizeof(size_t));
+    stem_free(map, bucket_of, n * sizeof(uint32_t));
+    return error;
+}
+
+/**
+ * @brief Resolves a perfect-hash seed to a slot
+ * 
+ * @param seed Seed of the key's bucket
+ * @param hash Function hashing the key with a seed
+ * @param n Table size
+ * @return size_t Candidate slot, or n for an empty bucket
+ */
+#define STEM_PERFECT_SLOT(seed, hash, n) \
+    ((seed) < 0 ? (size_t)(-((seed) + 1)) : (seed) == 0 ? (size_t)(n) : (size_t)((hash) % (n)))
+
+/**
+ * @brief Returns the record of a frozen slot
+ */
+static const StemFrozenRecord* stem_frozen_record(const StemFrozen* frozen, size_t slot) {
+    return (const StemFrozenRecord*)((const unsigned char*)frozen + frozen->records + 
+                                     slot * (size_t)frozen->record_size);
+}
+
+/**
+ * @brief Finds the slot of an enum value in a frozen map
+ * 
+ * @param frozen Frozen block
+ * @param enum_value Enum value to look up
+ * @return size_t Slot index, or frozen->count if absent
+ */
+static size_t stem_frozen_find(const StemFrozen* frozen, int enum_value) {
+    uint32_t n = frozen->count;
+    if (n == 0) {
+        return 0;
+    }
+    
+    const int32_t* seeds = (const int32_t*)((const unsigned char*)frozen + frozen->key_seeds);
+    int32_t seed = seeds[stem_hash_seeded((uint32_t)enum_value, 0) % n];
+    size_t slot = STEM_PERFECT_SLOT(seed, stem_hash_seeded((uint32_t)enum_value, (uint32_t)seed), n);
+    return (slot < n && stem_frozen_record(frozen, slot)->enum_value == enum_value) ? slot : n;
+}
+
+/**
+ * @brief Finds the slot of the entry a name resolves to in a frozen map
+ * 
+ * @param frozen Frozen block
+ * @param name Name to look up (need not be NUL-terminated)
+ * @param length Length of the name
+ * @return size_t Key slot index, or frozen->count if absent
+ */
+static size_t stem_frozen_find_name(const StemFrozen* frozen, const char* name, size_t length) {
+    uint32_t n = frozen->name_count;
+    if (n == 0) {
+        return frozen->count;
+    }
+    
+    const unsigned char* base = (const unsigned char*)frozen;
+    const int32_t* seeds = (const int32_t*)(base + frozen->name_seeds);
+    const uint32_t* name_slots = (const uint32_t*)(base + frozen->name_slots);
+    
+    int32_t seed = seeds[stem_hash_name_seeded(name, length, 0) % n];
+    size_t slot = STEM_PERFECT_SLOT(seed, stem_hash_name_seeded(name, length, (uint32_t)seed), n);
+    if (slot >= n) {
+        return frozen->count;
+    }
+    
+    if (name_slots[slot] >= frozen->count) {
+        return frozen->count;
+    }
+    const char* candidate = stem_frozen_name(frozen, name_slots[slot]);
+    if (!candidate || stem_name_length(candidate) != length) {
+        return frozen->count;
+    }
+    
+    /* The stored length is only trusted once it is known to fit the block */
+    const char* end = (const char*)frozen + frozen->size;
+    if (length >= (size_t)(end - candidate) || memcmp(candidate, name, length) != 0) {
+        return frozen->count;
+    }
+    return name_slots[slot];
+}
+
+/**
+ * @brief Returns the name stored in a frozen slot, or NULL if unnamed
+ * 
+ * Names are stored like arena names, behind their length. Offsets outside
+ * of the string table (only found in damaged images) read as unnamed.
+ */
+static const char* stem_frozen_name(const StemFrozen* frozen, size_t slot) {
+    uint32_t offset = stem_frozen_record(frozen, slot)->name;
+    if (offset == STEM_FROZEN_NO_NAME || offset < STEM_NAME_PREFIX || 
+        offset >= frozen->size - frozen->strings) {
+        return NULL;
+    }
+    return (const char*)frozen + frozen->strings + offset;
+}
+
+/**
+ * @brief Returns the value stored in a frozen slot
+ */
+static void* stem_frozen_value(const StemFrozen* frozen, size_t slot) {
+    unsigned char* value = (unsigned char*)(stem_frozen_record(frozen, slot) + 1);
+    if (frozen->value_size > 0) {
+        return value;
+    }
+    
+    void* pointer;
+    memcpy(&pointer, value, sizeof(void*));
+    return pointer;
+}
+
+/* ==================== FRONT CACHE ==================== */
+
+#if STEM_HAVE_THREAD_LOCAL
+static STEM_THREAD_LOCAL StemFrontSlot stem_front_cache[1 << STEM_FRONT_CACHE_BITS];
+#endif
+static uint64_t stem_front_epochs = 0; /**< Last cache_epoch handed out */
+
+/**
+ * @brief Drops every front cache entry of a map, in all threads
+ * 
+ * Must be called with the map locked exclusively whenever a value pointer
+ * a lookup returned may change or dangle: entries moving, values being
+ * replaced or removed and clears. Maps without STEM_FLAGS_FRONT_CACHE
+ * return right away.
+ * 
+ * @param map Pointer to the EnumMap
+ */
+static void stem_front_invalidate(EnumMap* map) {
+    if (!(map->flags & STEM_FLAGS_FRONT_CACHE)) {
+        return;
+    }
+#if STEM_HAVE_ATOMICS
+    map->cache_epoch = STEM_ATOMIC_ADD_RELAXED(&stem_front_epochs, 1);
+#else
+    map->cache_epoch = ++stem_front_epochs;
+#endif
+}
+
+#if STEM_HAVE_THREAD_LOCAL
+/**
+ * @brief Returns the front cache slot of the calling thread for a key
+ * 
+ * @param map Pointer to the EnumMap
+ * @param hash stem_hash_int() of the enum value
+ * @return StemFrontSlot* Direct-mapped slot, shared by every map
+ */
+static StemFrontSlot* stem_front_slot(const EnumMap* map, uint32_t hash) {
+    /* Mixing in the tag spreads maps with the same hot keys over the slots */
+    size_t index = (size_t)((hash >> (32 - STEM_FRONT_CACHE_BITS)) ^ (uint32_t)map->cache_epoch);
+    return &stem_front_cache[index & ((1 << STEM_FRONT_CACHE_BITS) - 1)];
+}
+#endif
+
+/**
+ * @brief Looks an enum value up in the front cache of the calling thread
+ * 
+ * The map must be locked shared, so no invalidation runs concurrently.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value Enum value to look up
+ * @param hash stem_hash_int() of the enum value
+ * @param value Output for the cached value pointer
+ * @return bool True on a hit
+ */
+static bool stem_front_get(const EnumMap* map, int enum_value, uint32_t hash, 
+                          const void** value) {
+#if STEM_HAVE_THREAD_LOCAL
+    if (!(map->flags & STEM_FLAGS_FRONT_CACHE)) {
+        return false;
+    }
+    StemFrontSlot* slot = stem_front_slot(map, hash);
+    if (slot->enum_value != enum_value || slot->epoch != map->cache_epoch) {
+        return false;
+    }
+    slot->referenced = 1;
+    *value = slot->value;
+    return true;
+#else
+    (void)map; /* Unused parameter */
+    (void)enum_value; /* Unused parameter */
+    (void)hash; /* Unused parameter */
+    (void)value; /* Unused parameter */
+    return false;
+#endif
+}
+
+/**
+ * @brief Remembers a found value in the front cache of the calling thread
+ * 
+ * @param map Pointer to the EnumMap (locked shared)
+ * @param enum_value Enum value that was found
+ * @param hash stem_hash_int() of the enum value
+ * @param value Value pointer the lookup returns
+ */
+static void stem_front_put(const EnumMap* map, int enum_value, uint32_t hash, 
+                          const void* value) {
+#if STEM_HAVE_THREAD_LOCAL
+    if (!(map->flags & STEM_FLAGS_FRONT_CACHE)) {
+        return;
+    }
+    /* A slot that was hit since it was filled gets a second chance, so
+     * the occasional cold key does not evict a hot one */
+    StemFrontSlot* slot = stem_front_slot(map, hash);
+    if (slot->referenced) {
+        slot->referenced = 0;
+        return;
+    }
+    slot->epoch = map->cache_epoch;
+    slot->value = value;
+    slot->enum_value = enum_value;
+#else
+    (void)map; /* Unused parameter */
+    (void)enum_value; /* Unused parameter */
+    (void)hash; /* Unused parameter */
+    (void)value; /* Unused parameter */
+#endif
+}
+
+/* ==================== INTERNAL MAP OPERATIONS ==================== */
+
+/**
+ * @brief Finds an entry in the map by enum value
+ * 
+ * This function searches the hash table for an entry with the given enum value.
+ * It handles collisions by traversing the linked list in the appropriate bucket.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value to search for
+ * @return EnumEntry* Pointer to the found entry, or NULL if not found
+ */
+static EnumEntry* stem_find_entry(const EnumMap* map, int enum_value) {
+    if (!map) {
+        return NULL;
+    }
+    
+    return stem_find_entry_hashed(map, enum_value, stem_hash_int(enum_value));
+}
+
+/**
+ * @brief Finds an entry by enum value given its precomputed stem_hash_int()
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value to search for
+ * @param hash stem_hash_int() of the enum value
+ * @return EnumEntry* Pointer to the found entry, or NULL if not found
+ */
+static EnumEntry* stem_find_entry_hashed(const EnumMap* map, int enum_value, uint32_t hash) {
+    if ((size_t)(unsigned int)enum_value < map->dense_size) {
+        return map->dense_used[enum_value] ? stem_dense_entry(map, (size_t)enum_value) : NULL;
+    }
+    
+    if (map->slots) {
+        size_t mask = map->num_slots - 1;
+        size_t i = (size_t)(hash >> map->hash_shift);
+        while (map->slot_used[i]) {
+            EnumEntry* entry = stem_slot_entry(map, i);
+            if (entry->enum_value == enum_value) {
+                return entry;
+            }
+            i = (i + 1) & mask;
+        }
+        return NULL;
+    }
+    
+    if (!map->buckets) {
+        return NULL;
+    }
+    
+    size_t bucket_idx = (size_t)(hash >> map->hash_shift);
+    
+    EnumEntry* entry = map->buckets[bucket_idx];
+    while (entry) {
+        if (entry->enum_value == enum_value) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+    
+    /* Entries an incremental resize has not migrated yet */
+    if (map->old_buckets) {
+        for (entry = map->old_buckets[hash >> map->old_shift]; entry; entry = entry->next) {
+            if (entry->enum_value == enum_value) {
+                return entry;
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * @brief Returns the dense slot for an enum value, or NULL if out of range
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value to map to a slot
+ * @return EnumEntry* Pointer to the dense slot (occupied or not)
+ */
+static EnumEntry* stem_dense_slot(const EnumMap* map, int enum_value) {
+    if ((size_t)(unsigned int)enum_value >= map->dense_size) {
+        return NULL;
+    }
+    return stem_dense_entry(map, (size_t)enum_value);
+}
+
+/**
+ * @brief Returns a dense slot by index
+ * 
+ * @param map Pointer to the EnumMap
+ * @param index Slot index, below dense_size
+ * @return EnumEntry* The slot (occupied or not)
+ */
+static EnumEntry* stem_dense_entry(const EnumMap* map, size_t index) {
+    return (EnumEntry*)(map->dense + index * map->entry_size);
+}
+
+/**
+ * @brief Returns an open-addressing slot by index
+ * 
+ * @param map Pointer to the EnumMap
+ * @param index Slot index, below num_slots
+ * @return EnumEntry* The slot (occupied or not)
+ */
+static EnumEntry* stem_slot_entry(const EnumMap* map, size_t index) {
+    return (EnumEntry*)(map->slots + index * map->entry_size);
+}
+
+/**
+ * @brief Returns the inline value storage that follows an entry
+ * 
+ * Only valid for entries allocated with entry_size bytes: dense and
+ * open-addressing slots, and chained entries holding a copied value. The
+ * value starts at the next STEM_ALIGNMENT boundary, usually on the same
+ * cache line as the enum value.
+ * 
+ * @param entry Entry owning the storage
+ * @return void* Storage for value_size bytes
+ */
+static void* stem_entry_inline(EnumEntry* entry) {
+    return (unsigned char*)entry + STEM_ALIGN_UP(sizeof(EnumEntry));
+}
+
+/**
+ * @brief Stores a new entry in its dense slot
+ * 
+ * Dense slots are preallocated, so nothing is allocated. The caller must
+ * have checked that the slot is free and in range, and reserved room in
+ * the name index for a named entry.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value for the new entry
+ * @param value Pointer to the value to associate
+ * @param name Interned name to associate (optional)
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_insert_dense(EnumMap* map, int enum_value, 
+                                 const void* value, const char* name) {
+    EnumEntry* entry = stem_dense_entry(map, (size_t)enum_value);
+    
+    memset(entry, 0, sizeof(EnumEntry));
+    entry->enum_value = enum_value;
+    
+    entry->name = (char*)name;
+    
+    if (map->value_size > 0 && value) {
+        entry->value = stem_entry_inline(entry);
+        memcpy(entry->value, value, map->value_size);
+    } else {
+        entry->value = (void*)value;
+    }
+    
+    map->dense_used[enum_value] = 1;
+    map->dense_count++;
+    map->count++;
+    
+    if (entry->name) {
+        stem_name_index_insert(map, entry->name, enum_value);
+    }
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Resizes the hash table to a new size
+ * 
+ * This function rehashes all entries and places them into new buckets.
+ * It's called automatically when the load factor exceeds the map's
+ * maximum load factor.
+ * Open-addressing maps are forwarded to stem_resize_slots().
+ * 
+ * @param map Pointer to the EnumMap
+ * @param new_size The new number of buckets, must be a power of two
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_resize_map(EnumMap* map, size_t new_size) {
+    if (!map) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    if (new_size == 0) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    if (map->slots) {
+        return stem_resize_slots(map, new_size);
+    }
+    
+    /* Complete an incremental resize still in progress first */
+    stem_rehash_step(map, map->old_num_buckets);
+    
+    EnumEntry** old_buckets = map->buckets;
+    size_t old_num_buckets = map->num_buckets;
+    
+    StemError error = stem_alloc_buckets(map, new_size);
+    if (error != STEM_SUCCESS) {
+        return error;
+    }
+    
+    /* Rehash all entries */
+    for (size_t i = 0; i < old_num_buckets; i++) {
+        EnumEntry* entry = old_buckets[i];
+        while (entry) {
+            EnumEntry* next = entry->next;
+            
+            uint32_t hash = stem_hash_int(entry->enum_value);
+            size_t new_bucket_idx = (size_t)(hash >> map->hash_shift);
+            
+            entry->next = map->buckets[new_bucket_idx];
+            map->buckets[new_bucket_idx] = entry;
+            
+            entry = next;
+        }
+    }
+    
+    stem_free(map, old_buckets, old_num_buckets * sizeof(EnumEntry*));
+    map->resizes++;
+    
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Maps an enum value to its home slot in the open-addressing table
+ * 
+ * Uses the top bits of the multiplicative hash (Fibonacci hashing), which
+ * are far better distributed than the low bits for power-of-two tables.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value to place
+ * @return size_t Home slot index
+ */
+static size_t stem_slot_index(const EnumMap* map, int enum_value) {
+    return (size_t)(stem_hash_int(enum_value) >> map->hash_shift);
+}
+
+/**
+ * @brief Allocates an empty open-addressing table
+ * 
+ * The new arrays replace the map's slot arrays; the caller owns the old ones.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param num_slots Number of slots, must be a power of two
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_alloc_slots(EnumMap* map, size_t num_slots) {
+    unsigned int shift;
+    if (stem_table_shift(num_slots, &shift) != STEM_SUCCESS) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    unsigned char* slots = stem_calloc(map, num_slots, map->entry_size);
+    unsigned char* used = stem_calloc(map, num_slots, 1);
+    
+    if (!slots || !used) {
+        stem_free(map, used, num_slots);
+        stem_free(map, slots, num_slots * map->entry_size);
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    map->slots = slots;
+    map->slot_used = used;
+    map->num_slots = num_slots;
+    map->hash_shift = shift;
+    map->grow_at = stem_table_limit(map, num_slots);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Allocates an empty bucket array
+ * 
+ * The new array replaces the map's buckets; the caller owns the old one.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param num_buckets Number of buckets, must be a power of two
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_alloc_buckets(EnumMap* map, size_t num_buckets) {
+    unsigned int shift;
+    if (stem_table_shift(num_buckets, &shift) != STEM_SUCCESS) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    EnumEntry** buckets = stem_calloc(map, num_buckets, sizeof(EnumEntry*));
+    if (!buckets) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    map->buckets = buckets;
+    map->num_buckets = num_buckets;
+    map->hash_shift = shift;
+    map->grow_at = stem_table_limit(map, num_buckets);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Starts an incremental resize of the bucket array
+ * 
+ * The current buckets are kept as the old table and the entries move to
+ * the new one over the following operations (see stem_rehash_step()).
+ * 
+ * @param map Pointer to the EnumMap, with no resize in progress
+ * @param new_size The new number of buckets, must be a power of two
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_rehash_begin(EnumMap* map, size_t new_size) {
+    EnumEntry** old_buckets = map->buckets;
+    size_t old_num_buckets = map->num_buckets;
+    unsigned int old_shift = map->hash_shift;
+    
+    StemError error = stem_alloc_buckets(map, new_size);
+    if (error != STEM_SUCCESS) {
+        return error;
+    }
+    
+    map->old_buckets = old_buckets;
+    map->old_num_buckets = old_num_buckets;
+    map->old_shift = old_shift;
+    map->rehash_pos = 0;
+    map->resizes++;
+    stem_rehash_step(map, STEM_REHASH_STEP);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Migrates old buckets of an incremental resize to the new table
+ * 
+ * Frees the old table once its last bucket has moved. Does nothing if no
+ * resize is in progress.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param buckets Maximum number of old buckets to migrate
+ */
+static void stem_rehash_step(EnumMap* map, size_t buckets) {
+    if (!map->old_buckets) {
+        return;
+    }
+    
+    while (buckets-- > 0 && map->rehash_pos < map->old_num_buckets) {
+        EnumEntry* entry = map->old_buckets[map->rehash_pos];
+        map->old_buckets[map->rehash_pos++] = NULL;
+        while (entry) {
+            EnumEntry* next = entry->next;
+            size_t bucket_idx = (size_t)(stem_hash_int(entry->enum_value) >> map->hash_shift);
+            entry->next = map->buckets[bucket_idx];
+            map->buckets[bucket_idx] = entry;
+            entry = next;
+        }
+    }
+    
+    if (map->rehash_pos == map->old_num_buckets) {
+        stem_free(map, map->old_buckets, map->old_num_buckets * sizeof(EnumEntry*));
+        map->old_buckets = NULL;
+        map->old_num_buckets = 0;
+        map->rehash_pos = 0;
+    }
+}
+
+/**
+ * @brief Returns the number of bucket positions, old buckets included
+ * 
+ * Walks over the buckets visit positions [0, num_buckets) of the new
+ * table, then the old buckets an incremental resize has yet to migrate.
+ */
+static size_t stem_bucket_span(const EnumMap* map) {
+    return map->num_buckets + map->old_num_buckets;
+}
+
+/**
+ * @brief Returns the head of the chain at a bucket position
+ * 
+ * @param map Pointer to the EnumMap
+ * @param index Position below stem_bucket_span()
+ * @return EnumEntry** Head pointer of the new or old bucket
+ */
+static EnumEntry** stem_bucket_at(const EnumMap* map, size_t index) {
+    return index < map->num_buckets ? &map->buckets[index] : 
+                                      &map->old_buckets[index - map->num_buckets];
+}
+
+/**
+ * @brief Finds the link pointing to the chained entry of an enum value
+ * 
+ * @param map Pointer to the EnumMap with buckets
+ * @param enum_value Enum value to look for
+ * @return EnumEntry** Link to the entry, or NULL if it is not chained
+ */
+static EnumEntry** stem_bucket_link(const EnumMap* map, int enum_value) {
+    uint32_t hash = stem_hash_int(enum_value);
+    EnumEntry** link = &map->buckets[hash >> map->hash_shift];
+    while (*link && (*link)->enum_value != enum_value) {
+        link = &(*link)->next;
+    }
+    if (!*link && map->old_buckets) {
+        link = &map->old_buckets[hash >> map->old_shift];
+        while (*link && (*link)->enum_value != enum_value) {
+            link = &(*link)->next;
+        }
+    }
+    return *link ? link : NULL;
+}
+
+/**
+ * @brief Computes the shift taking a table index from the top hash bits
+ * 
+ * Bucket and slot tables both index with the top bits of the
+ * multiplicative hash (Fibonacci hashing), whose low bits only depend on
+ * the low bits of the enum value.
+ * 
+ * @param size Table size, must be a power of two of at most 2^32
+ * @param shift Receives the right shift turning a hash into an index
+ * @return StemError STEM_ERROR_INVALID_ARG for any other size
+ */
+static StemError stem_table_shift(size_t size, unsigned int* shift) {
+    unsigned int bits = 0;
+    while (bits < 32 && ((size_t)1 << bits) < size) {
+        bits++;
+    }
+    if (((size_t)1 << bits) != size) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    *shift = 32 - bits;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Returns how many sparse entries a table of a given size takes
+ * 
+ * An open-addressing table always keeps one slot empty, which ends every
+ * probe sequence.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param size Number of buckets or slots
+ * @return size_t Sparse entries the table holds before it has to grow
+ */
+static size_t stem_table_limit(const EnumMap* map, size_t size) {
+    size_t limit = (size_t)((double)size * map->max_load);
+    if ((map->flags & STEM_FLAGS_OPEN_ADDRESSING) && limit >= size) {
+        limit = size - 1;
+    }
+    return limit;
+}
+
+/**
+ * @brief Returns the smallest table size holding a number of sparse entries
+ * 
+ * @param map Pointer to the EnumMap, with its maximum load factor set
+ * @param needed Number of sparse entries the table must take
+ * @return size_t Power-of-two table size, or 0 if no table is large enough
+ */
+static size_t stem_table_size(const EnumMap* map, size_t needed) {
+    size_t size = (map->flags & STEM_FLAGS_OPEN_ADDRESSING) ? 
+                  STEM_DEFAULT_SLOTS : STEM_DEFAULT_BUCKETS;
+    while (stem_table_limit(map, size) < needed) {
+        if (size >= ((size_t)1 << 31)) {
+            return 0;
+        }
+        size *= 2;
+    }
+    return size;
+}
+
+/**
+ * @brief Rehashes the open-addressing table into a new slot array
+ * 
+ * Every live entry is reinserted into a freshly allocated table, so the
+ * result never contains tombstones. Copied values are stored inline and
+ * move with their entry, which invalidates value pointers handed out
+ * before the resize.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param new_size The new number of slots, must be a power of two
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_resize_slots(EnumMap* map, size_t new_size) {
+    if (new_size < map->count - map->dense_count) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    unsigned char* old_slots = map->slots;
+    unsigned char* old_used = map->slot_used;
+    size_t old_num_slots = map->num_slots;
+    
+    StemError error = stem_alloc_slots(map, new_size);
+    if (error != STEM_SUCCESS) {
+        return error;
+    }
+    stem_front_invalidate(map);
+    
+    size_t mask = map->num_slots - 1;
+    for (size_t i = 0; i < old_num_slots; i++) {
+        if (!old_used[i]) {
+            continue;
+        }
+        
+        EnumEntry* entry = (EnumEntry*)(old_slots + i * map->entry_size);
+        size_t j = stem_slot_index(map, entry->enum_value);
+        while (map->slot_used[j]) {
+            j = (j + 1) & mask;
+        }
+        
+        /* The inline value moves along with the entry */
+        EnumEntry* moved = stem_slot_entry(map, j);
+        memcpy(moved, entry, map->entry_size);
+        map->slot_used[j] = 1;
+        if (map->value_size > 0 && entry->value) {
+            moved->value = stem_entry_inline(moved);
+        }
+    }
+    
+    stem_free(map, old_used, old_num_slots);
+    stem_free(map, old_slots, old_num_slots * map->entry_size);
+    map->resizes++;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Stores a new entry in the open-addressing table
+ * 
+ * The caller must have checked that the enum value is not present and that
+ * the table (and the name index, for a named entry) has room for one more.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value for the new entry
+ * @param value Pointer to the value to associate
+ * @param name Interned name to associate (optional)
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_insert_slot(EnumMap* map, int enum_value, 
+                                const void* value, const char* name) {
+    size_t mask = map->num_slots - 1;
+    size_t i = stem_slot_index(map, enum_value);
+    while (map->slot_used[i]) {
+        i = (i + 1) & mask;
+    }
+    
+    EnumEntry* entry = stem_slot_entry(map, i);
+    memset(entry, 0, sizeof(EnumEntry));
+    entry->enum_value = enum_value;
+    
+    entry->name = (char*)name;
+    
+    if (map->value_size > 0 && value) {
+        entry->value = stem_entry_inline(entry);
+        memcpy(entry->value, value, map->value_size);
+    } else {
+        entry->value = (void*)value;
+    }
+    
+    map->slot_used[i] = 1;
+    map->count++;
+    
+    if (entry->name) {
+        stem_name_index_insert(map, entry->name, enum_value);
+    }
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Creates a new enum entry
+ * 
+ * This function allocates and initializes a new enum entry with the given values.
+ * If value_size is greater than 0, the value is copied inline behind the
+ * entry, in a single arena allocation. Otherwise, the pointer is stored.
+ * The name is already interned and kept by reference.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value for the new entry
+ * @param value Pointer to the value to associate
+ * @param name Interned name to associate (optional)
+ * @param out_entry Output parameter for the created entry
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_create_entry(EnumMap* map, int enum_value, 
+                                 const void* value, const char* name, 
+                                 EnumEntry* *out_entry) {
+    if (!map || !out_entry) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    /* A copied value is stored inline, right behind the entry */
+    bool copy = map->value_size > 0 && value;
+    EnumEntry* entry = stem_arena_alloc(&map->allocator, &map->arena, 
+                                        copy ? map->entry_size : sizeof(EnumEntry));
+    if (!entry) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    memset(entry, 0, sizeof(EnumEntry));
+    entry->enum_value = enum_value;
+    
+    if (copy) {
+        entry->value = stem_entry_inline(entry);
+        memcpy(entry->value, value, map->value_size);
+    } else {
+        entry->value = (void*)value;
+    }
+    
+    entry->name = (char*)name;
+    *out_entry = entry;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Resets a cursor to the first entry of a map
+ * 
+ * @param cursor Cursor to initialize
+ */
+static void stem_cursor_init(StemCursor* cursor) {
+    memset(&cursor->frozen_entry, 0, sizeof(EnumEntry));
+    cursor->dense_index = 0;
+    cursor->slot = 0;
+    cursor->bucket = 0;
+    cursor->entry = NULL;
+}
+
+/**
+ * @brief Advances a cursor and returns the next entry
+ * 
+ * The map must not be modified while a cursor is in use.
+ * 
+ * @param map Pointer to the EnumMap being walked
+ * @param cursor Cursor state
+ * @return EnumEntry* Next entry, or NULL when all entries have been visited
+ */
+static EnumEntry* stem_cursor_next(const EnumMap* map, StemCursor* cursor) {
+    if (map->frozen) {
+        const StemFrozen* frozen = map->frozen;
+        if (cursor->slot >= frozen->count) {
+            return NULL;
+        }
+        
+        size_t i = cursor->slot++;
+        cursor->frozen_entry.enum_value = stem_frozen_record(frozen, i)->enum_value;
+        cursor->frozen_entry.name = (char*)stem_frozen_name(frozen, i);
+        cursor->frozen_entry.value = stem_frozen_value(frozen, i);
+        return &cursor->frozen_entry;
+    }
+    
+    while (cursor->dense_index < map->dense_size) {
+        size_t i = cursor->dense_index++;
+        if (map->dense_used[i]) {
+            return stem_dense_entry(map, i);
+        }
+    }
+    
+    while (cursor->slot < map->num_slots) {
+        size_t i = cursor->slot++;
+        if (map->slot_used[i]) {
+            return stem_slot_entry(map, i);
+        }
+    }
+    
+    while (!cursor->entry) {
+        if (cursor->bucket >= stem_bucket_span(map)) {
+            return NULL;
+        }
+        cursor->entry = *stem_bucket_at(map, cursor->bucket++);
+    }
+    
+    EnumEntry* entry = cursor->entry;
+    cursor->entry = entry->next;
+    return entry;
+}
+
+/**
+ * @brief Drops every entry of a map, leaving the storage arrays empty
+ * 
+ * Entry memory lives in the arena, so this only resets the occupancy
+ * arrays and buckets and hands the arena chunks back in one go. Names stay
+ * in the pool, which other maps may share.
+ * 
+ * @param map Pointer to the EnumMap
+ */
+static void stem_release_entries(EnumMap* map) {
+    if (map->dense_used) {
+        memset(map->dense_used, 0, map->dense_size);
+    }
+    if (map->slot_used) {
+        memset(map->slot_used, 0, map->num_slots);
+    }
+    if (map->buckets) {
+        memset(map->buckets, 0, map->num_buckets * sizeof(EnumEntry*));
+    }
+    if (map->old_buckets) {
+        stem_free(map, map->old_buckets, map->old_num_buckets * sizeof(EnumEntry*));
+        map->old_buckets = NULL;
+        map->old_num_buckets = 0;
+        map->rehash_pos = 0;
+    }
+    if (map->names) {
+        memset(map->names, 0, map->num_names * sizeof(StemNameSlot));
+    }
+    
+    stem_arena_reset(&map->allocator, &map->arena);
+    stem_front_invalidate(map);
+    map->dense_count = 0;
+    map->names_count = 0;
+    map->order_blocks = 0;
+    map->count = 0;
+}
+
+/**
+ * @brief Grows the hash table or slot array ahead of one more sparse entry
+ * 
+ * @param map Pointer to the EnumMap
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_grow_for_insert(EnumMap* map) {
+    stem_rehash_step(map, STEM_REHASH_STEP);
+    
+    /* Grow before the insert would push the table over the load factor
+     * (dense entries never occupy the table) */
+    if (map->count - map->dense_count < map->grow_at) {
+        return STEM_SUCCESS;
+    }
+    if (map->slots) {
+        return stem_resize_map(map, map->num_slots * 2);
+    }
+    
+    /* The steps finish a resize long before the doubled table fills up,
+     * unless its load factor was lowered meanwhile */
+    if ((map->flags & STEM_FLAGS_INCREMENTAL_REHASH) && !map->old_buckets) {
+        return stem_rehash_begin(map, map->num_buckets * 2);
+    }
+    return stem_resize_map(map, map->num_buckets * 2);
+}
+
+/**
+ * @brief Sizes the hash table or slot array once for extra sparse entries
+ * 
+ * @param map Pointer to the EnumMap
+ * @param extra Number of entries about to be inserted outside the dense range
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_reserve_entries(EnumMap* map, size_t extra) {
+    size_t sparse = map->count - map->dense_count;
+    if (extra <= map->grow_at - sparse) {
+        return STEM_SUCCESS;
+    }
+    
+    size_t new_size = extra > STEM_MAX_ENTRIES - sparse ? 0 : stem_table_size(map, sparse + extra);
+    return new_size ? stem_resize_map(map, new_size) : STEM_ERROR_OUT_OF_MEMORY;
+}
+
+/**
+ * @brief Changes the maximum load factor and resizes the table to match
+ * 
+ * The table is sized to take as many sparse entries before growing as it
+ * did before, and at least the current ones, so setting the load factor
+ * right after creation gives the table creating the map with it would.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param max_load New maximum load factor (validated by the caller)
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_set_load(EnumMap* map, float max_load) {
+    size_t sparse = map->count - map->dense_count;
+    size_t held = map->grow_at > sparse ? map->grow_at : sparse;
+    float old_load = map->max_load;
+    map->max_load = max_load;
+    
+    size_t current = map->slots ? map->num_slots : map->num_buckets;
+    size_t new_size = stem_table_size(map, held);
+    StemError error = new_size == 0 ? STEM_ERROR_OUT_OF_MEMORY : 
+                      new_size == current ? STEM_SUCCESS : stem_resize_map(map, new_size);
+    if (error != STEM_SUCCESS) {
+        map->max_load = old_load;
+        return error;
+    }
+    
+    map->grow_at = stem_table_limit(map, map->slots ? map->num_slots : map->num_buckets);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Inserts an entry known to be absent into storage with room for it
+ * 
+ * The caller must have checked for duplicates and reserved both the table
+ * and (for a named entry) the name index.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value The enum value for the new entry
+ * @param value Pointer to the value to associate
+ * @param name Interned name to associate (optional)
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_insert_new(EnumMap* map, int enum_value, 
+                                const void* value, const char* name) {
+    if (stem_dense_slot(map, enum_value)) {
+        return stem_insert_dense(map, enum_value, value, name);
+    }
+    
+    /* Index the value first, the only step left to undo on failure */
+    StemError error = stem_order_insert(map, enum_value);
+    if (error != STEM_SUCCESS) {
+        return error;
+    }
+    
+    if (map->slots) {
+        error = stem_insert_slot(map, enum_value, value, name);
+        if (error != STEM_SUCCESS) {
+            stem_order_remove(map, enum_value);
+        }
+        return error;
+    }
+    
+    /* Create new entry */
+    EnumEntry* new_entry;
+    error = stem_create_entry(map, enum_value, value, name, &new_entry);
+    if (error != STEM_SUCCESS) {
+        stem_order_remove(map, enum_value);
+        return error;
+    }
+    
+    /* Add to bucket */
+    uint32_t hash = stem_hash_int(enum_value);
+    size_t bucket_idx = (size_t)(hash >> map->hash_shift);
+    
+    new_entry->next = map->buckets[bucket_idx];
+    map->buckets[bucket_idx] = new_entry;
+    map->count++;
+    
+    if (new_entry->name) {
+        stem_name_index_insert(map, new_entry->name, enum_value);
+    }
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Tells whether an entry lives in the dense or open-addressing array
+ */
+static bool stem_entry_is_flat(const EnumMap* map, const EnumEntry* entry) {
+    const unsigned char* p = (const unsigned char*)entry;
+    return (map->dense && p >= map->dense && p < map->dense + map->dense_size * map->entry_size) || 
+           (map->slots && p >= map->slots && p < map->slots + map->num_slots * map->entry_size);
+}
+
+/**
+ * @brief Replaces the value of an existing entry in place
+ * 
+ * A copied value is overwritten where it is stored. Only a chained entry
+ * associated without a value has no room for a copy yet, which is then
+ * taken from the arena once.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param entry Entry to update
+ * @param value New value pointer, or the value to copy (not NULL then)
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_update_entry(EnumMap* map, EnumEntry* entry, const void* value) {
+    if (map->value_size == 0) {
+        if (entry->value != value) {
+            stem_front_invalidate(map);
+        }
+        entry->value = (void*)value;
+        return STEM_SUCCESS;
+    }
+    
+    if (!value) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    /* A copy overwritten in place keeps its address, and cached pointers with it */
+    if (!entry->value) {
+        stem_front_invalidate(map);
+        entry->value = stem_entry_is_flat(map, entry) ? stem_entry_inline(entry) : 
+                       stem_arena_alloc(&map->allocator, &map->arena, map->value_size);
+        if (!entry->value) {
+            return STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    memcpy(entry->value, value, map->value_size);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Empties an open-addressing slot without leaving a tombstone
+ * 
+ * Entries probed past the slot are shifted back into the hole, moving
+ * their inline values along.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param i Index of the slot to empty
+ */
+static void stem_slot_delete(EnumMap* map, size_t i) {
+    size_t mask = map->num_slots - 1;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!map->slot_used[j]) {
+            break;
+        }
+        /* The entry at j may fill the hole unless its home lies in (i, j] */
+        EnumEntry* entry = stem_slot_entry(map, j);
+        size_t home = stem_slot_index(map, entry->enum_value);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            EnumEntry* hole = stem_slot_entry(map, i);
+            memcpy(hole, entry, map->entry_size);
+            if (map->value_size > 0 && hole->value) {
+                hole->value = stem_entry_inline(hole);
+            }
+            i = j;
+        }
+    }
+    map->slot_used[i] = 0;
+}
+
+/**
+ * @brief Removes the entry of an enum value together with its index entries
+ * 
+ * Dense and open-addressing slots are freed for reuse right away; a
+ * chained entry is unlinked and its memory stays in the arena until the
+ * map is cleared.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param enum_value Enum value to remove
+ * @return StemError STEM_ERROR_NOT_FOUND if the value is not associated
+ */
+static StemError stem_remove_entry(EnumMap* map, int enum_value) {
+    const char* name = NULL;
+    
+    EnumEntry* dense = stem_dense_slot(map, enum_value);
+    if (dense) {
+        if (!map->dense_used[enum_value]) {
+            return STEM_ERROR_NOT_FOUND;
+        }
+        name = dense->name;
+        map->dense_used[enum_value] = 0;
+        map->dense_count--;
+    } else if (map->slots) {
+        size_t mask = map->num_slots - 1;
+        size_t i = stem_slot_index(map, enum_value);
+        while (map->slot_used[i] && stem_slot_entry(map, i)->enum_value != enum_value) {
+            i = (i + 1) & mask;
+        }
+        if (!map->slot_used[i]) {
+            return STEM_ERROR_NOT_FOUND;
+        }
+        name = stem_slot_entry(map, i)->name;
+        stem_slot_delete(map, i);
+    } else {
+        stem_rehash_step(map, STEM_REHASH_STEP);
+        EnumEntry** link = stem_bucket_link(map, enum_value);
+        if (!link) {
+            return STEM_ERROR_NOT_FOUND;
+        }
+        name = (*link)->name;
+        *link = (*link)->next;
+    }
+    
+    map->count--;
+    stem_front_invalidate(map);
+    if (!dense) {
+        stem_order_remove(map, enum_value);
+    }
+    return name ? stem_name_index_forget(map, name, enum_value) : STEM_SUCCESS;
+}
+
+/**
+ * @brief Inserts an enum value known to be absent, interning its name
+ * 
+ * The name index slot and the name are reserved before anything is
+ * inserted, so no insert can fail halfway.
+ * 
+ * @param map Pointer to the EnumMap (locked exclusively)
+ * @param enum_value Enum value to insert
+ * @param value Value pointer, or the value to copy
+ * @param name Name to intern, or NULL
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_insert_named(EnumMap* map, int enum_value, 
+                                   const void* value, const char* name) {
+    StemError error = STEM_SUCCESS;
+    const char* stored = NULL;
+    if (name && map->pool) {
+        error = stem_name_index_reserve(map, 1);
+        if (error == STEM_SUCCESS) {
+            stored = stem_intern(map, name, NULL);
+            error = stored ? STEM_SUCCESS : STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    /* Values inside the dense range go straight to their slot */
+    if (error == STEM_SUCCESS && !stem_dense_slot(map, enum_value)) {
+        error = stem_grow_for_insert(map);
+    }
+    
+    if (error == STEM_SUCCESS) {
+        error = stem_insert_new(map, enum_value, value, stored);
+    }
+    return error;
+}
+
+/**
+ * @brief Gives an existing entry a new name
+ * 
+ * @param map Pointer to the EnumMap (locked exclusively)
+ * @param entry Entry to rename
+ * @param name New name, interned here
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_rename_entry(EnumMap* map, EnumEntry* entry, const char* name) {
+    if (!map->pool) {
+        return STEM_SUCCESS;
+    }
+    
+    StemError error = stem_name_index_reserve(map, 1);
+    const char* stored = error == STEM_SUCCESS ? stem_intern(map, name, NULL) : NULL;
+    if (!stored) {
+        return error == STEM_SUCCESS ? STEM_ERROR_OUT_OF_MEMORY : error;
+    }
+    if (stored == entry->name) {
+        return STEM_SUCCESS;
+    }
+    
+    /* Unname the entry first, so a take-over of its name does not pick it */
+    const char* old = entry->name;
+    entry->name = NULL;
+    if (old) {
+        error = stem_name_index_forget(map, old, entry->enum_value);
+    }
+    entry->name = (char*)stored;
+    if (error == STEM_SUCCESS) {
+        stem_name_index_insert(map, stored, entry->enum_value);
+    }
+    return error;
+}
+
+/**
+ * @brief Gives an existing entry a new name or none at all
+ * 
+ * @param map Pointer to the EnumMap (locked exclusively)
+ * @param entry Entry to rename
+ * @param name New name, or NULL to leave the entry unnamed
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_set_entry_name(EnumMap* map, EnumEntry* entry, const char* name) {
+    if (name) {
+        return stem_rename_entry(map, entry, name);
+    }
+    
+    const char* old = entry->name;
+    entry->name = NULL;
+    return old ? stem_name_index_forget(map, old, entry->enum_value) : STEM_SUCCESS;
+}
+
+/**
+ * @brief Inserts many entries after sizing every structure once
+ * 
+ * The table, the name index, the arena and the name pool are grown up
+ * front for the whole batch, so the inserts themselves never resize or
+ * allocate chunks. Names interned in the map's own pool are taken as they
+ * are. Unless the keys are known to be unique and absent, each one is
+ * still checked and the first duplicate stops the insert with the earlier
+ * entries kept. Mutability is not checked, which lets read-only maps be
+ * filled once.
+ * 
+ * @param map Pointer to the EnumMap
+ * @param keys Enum values to insert
+ * @param values Value pointer per entry (NULL for all NULL)
+ * @param names Name per entry (NULL for all unnamed)
+ * @param pool Pool the names are interned in, or NULL for foreign names
+ * @param n Number of entries
+ * @param unique True if the keys are distinct and not in the map yet
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_bulk_insert(EnumMap* map, const int* keys, const void* const* values, 
+                                 const char* const* names, const StemStringPool* pool, 
+                                 size_t n, bool unique) {
+    bool keep_names = names && map->pool;
+    bool interned = keep_names && pool == map->pool;
+    size_t sparse = 0;
+    size_t named = 0;
+    size_t arena_bytes = 0;
+    size_t pool_bytes = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        /* Chained entries and their values come from the arena */
+        if (!stem_dense_slot(map, keys[i])) {
+            sparse++;
+            if (!map->slots) {
+                arena_bytes += STEM_ALIGN_UP(sizeof(EnumEntry));
+                if (map->value_size > 0 && values && values[i]) {
+                    arena_bytes += STEM_ALIGN_UP(map->value_size);
+                }
+            }
+        }
+        if (keep_names && names[i]) {
+            named++;
+            if (!interned) {
+                pool_bytes += STEM_ALIGN_UP(STEM_POOL_PREFIX + strlen(names[i]) + 1);
+            }
+        }
+    }
+    
+    StemError error = stem_reserve_entries(map, sparse);
+    if (error == STEM_SUCCESS && named > 0) {
+        error = stem_name_index_reserve(map, named);
+    }
+    if (error == STEM_SUCCESS) {
+        error = stem_arena_reserve(&map->allocator, &map->arena, arena_bytes);
+    }
+    if (error == STEM_SUCCESS && pool_bytes > 0) {
+        stem_spin_lock(&map->pool->lock);
+        error = stem_pool_reserve(map->pool, named, pool_bytes);
+        stem_spin_unlock(&map->pool->lock);
+    }
+    
+    for (size_t i = 0; error == STEM_SUCCESS && i < n; i++) {
+        if (!unique && stem_find_entry(map, keys[i])) {
+            return STEM_ERROR_ALREADY_EXISTS;
+        }
+        
+        const char* name = NULL;
+        if (keep_names && names[i]) {
+            name = stem_intern(map, names[i], pool);
+            if (!name) {
+                return STEM_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        error = stem_insert_new(map, keys[i], values ? values[i] : NULL, name);
+    }
+    return error;
+}
+
+/**
+ * @brief Unpacks the entries of a map into parallel arrays
+ * 
+ * The arrays reference the map's values and names, so they are only valid
+ * while the map is locked and unchanged. When several entries share a
+ * name, the entry the name resolves to comes first, so a bulk insert of
+ * the arrays resolves names the same way.
+ * 
+ * @param map Map to read (shared lock held by the caller)
+ * @param arrays Output arrays, allocated with the map's allocator
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_entries_gather(const EnumMap* map, StemEntryArrays* arrays) {
+    size_t n = map->count ? map->count : 1;
+    arrays->count = 0;
+    arrays->pool = map->pool;
+    arrays->keys = stem_calloc(map, n, sizeof(int));
+    arrays->values = stem_calloc(map, n, sizeof(void*));
+    arrays->names = stem_calloc(map, n, sizeof(char*));
+    if (!arrays->keys || !arrays->values || !arrays->names) {
+        stem_entries_free(map, arrays);
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    StemCursor cursor;
+    EnumEntry* entry;
+    size_t named = 0;
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(map, &cursor)) != NULL) {
+        arrays->keys[arrays->count] = entry->enum_value;
+        arrays->values[arrays->count] = entry->value;
+        arrays->names[arrays->count] = entry->name;
+        arrays->count++;
+        named += entry->name != NULL;
+    }
+    
+    /* Shared names: move the entries that do not own their name to the end */
+    size_t indexed = map->frozen ? map->frozen->name_count : map->names_count;
+    if (named > indexed) {
+        size_t front = 0;
+        size_t back = arrays->count;
+        stem_cursor_init(&cursor);
+        while ((entry = stem_cursor_next(map, &cursor)) != NULL) {
+            size_t i = (entry->name && !stem_owns_name(map, entry)) ? --back : front++;
+            arrays->keys[i] = entry->enum_value;
+            arrays->values[i] = entry->value;
+            arrays->names[i] = entry->name;
+        }
+    }
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Releases arrays filled by stem_entries_gather()
+ */
+static void stem_entries_free(const EnumMap* map, StemEntryArrays* arrays) {
+    size_t n = map->count ? map->count : 1;
+    stem_free(map, arrays->names, n * sizeof(char*));
+    stem_free(map, arrays->values, n * sizeof(void*));
+    stem_free(map, arrays->keys, n * sizeof(int));
+    arrays->names = NULL;
+    arrays->values = NULL;
+    arrays->keys = NULL;
+}
+
+/**
+ * @brief Creates a map presized for a set of entries and bulk-inserts them
+ * 
+ * The new map shares the pool the names are interned in, if any, so none
+ * of them is copied.
+ * 
+ * @param capacity Capacity passed to stem_create_map() (0 means 1)
+ * @param value_size Size of each value in bytes (0 for pointer storage)
+ * @param flags Configuration flags
+ * @param max_load Maximum load factor of the table
+ * @param allocator Allocation hooks, or NULL for malloc/free
+ * @param arrays Entries to insert
+ * @param unique True if the keys are known to be distinct
+ * @param error Optional error code output
+ * @return EnumMap* New map, or NULL on failure
+ */
+static EnumMap* stem_create_filled(size_t capacity, size_t value_size, StemFlags flags, 
+                                  float max_load, const StemAllocator* allocator, 
+                                  const StemEntryArrays* arrays, bool unique, 
+                                  StemError* error) {
+    EnumMap* map = stem_create_map(capacity ? capacity : 1, value_size, flags, 
+                                   allocator, arrays->pool, error);
+    if (!map) {
+        return NULL;
+    }
+    
+    /* The table is still empty, so resizing it for the load factor is cheap */
+    StemError err = max_load == map->max_load ? STEM_SUCCESS : stem_set_load(map, max_load);
+    if (err == STEM_SUCCESS) {
+        err = stem_bulk_insert(map, arrays->keys, arrays->values, arrays->names, 
+                               arrays->pool, arrays->count, unique);
+    }
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(map);
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+    return map;
+}
+
+/**
+ * @brief Reserves everything merging a second map's entries may grow
+ * 
+ * Counts the new keys, the names to intern and the value copies that
+ * overwritten chained entries still lack, then grows the table, the name
+ * index, the arena and the name pool once, as stem_bulk_insert() does.
+ * 
+ * @param map Map the entries are merged into (locked exclusively)
+ * @param second Entries of the second map
+ * @param overwrite If true, existing entries take the second map's values and names
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_merge_reserve(EnumMap* map, const StemEntryArrays* second, bool overwrite) {
+    bool keep_names = second->names && map->pool;
+    bool interned = keep_names && second->pool == map->pool;
+    size_t sparse = 0;
+    size_t named = 0;
+    size_t arena_bytes = 0;
+    size_t pool_bytes = 0;
+    
+    for (size_t i = 0; i < second->count; i++) {
+        const void* value = second->values ? second->values[i] : NULL;
+        const EnumEntry* existing = stem_find_entry(map, second->keys[i]);
+        if (existing) {
+            if (!overwrite) {
+                continue;
+            }
+            if (map->value_size > 0 && value && !existing->value && 
+                !stem_entry_is_flat(map, existing)) {
+                arena_bytes += STEM_ALIGN_UP(map->value_size);
+            }
+        } else if (!stem_dense_slot(map, second->keys[i])) {
+            sparse++;
+            if (!map->slots) {
+                arena_bytes += STEM_ALIGN_UP(sizeof(EnumEntry));
+                if (map->value_size > 0 && value) {
+                    arena_bytes += STEM_ALIGN_UP(map->value_size);
+                }
+            }
+        }
+        if (keep_names && second->names[i]) {
+            named++;
+            if (!interned) {
+                pool_bytes += STEM_ALIGN_UP(STEM_POOL_PREFIX + strlen(second->names[i]) + 1);
+            }
+        }
+    }
+    
+    StemError error = stem_reserve_entries(map, sparse);
+    if (error == STEM_SUCCESS && named > 0) {
+        error = stem_name_index_reserve(map, named);
+    }
+    if (error == STEM_SUCCESS) {
+        error = stem_arena_reserve(&map->allocator, &map->arena, arena_bytes);
+    }
+    if (error == STEM_SUCCESS && pool_bytes > 0) {
+        stem_spin_lock(&map->pool->lock);
+        error = stem_pool_reserve(map->pool, named, pool_bytes);
+        stem_spin_unlock(&map->pool->lock);
+    }
+    return error;
+}
+
+/**
+ * @brief Adds the entries of a second map to a merge result
+ * 
+ * Keys already present are overwritten or skipped, the others are
+ * bulk-inserted. Everything the merge may grow is reserved before the
+ * first entry changes, so running out of memory normally fails the call
+ * with the map untouched. The arrays are compacted in place.
+ * 
+ * @param new_map Merge result holding the first map's entries
+ * @param second Entries of the second map
+ * @param overwrite If true, entries from the second map replace existing ones
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_merge_entries(EnumMap* new_map, StemEntryArrays* second, bool overwrite) {
+    StemError err = stem_merge_reserve(new_map, second, overwrite);
+    size_t added = 0;
+    for (size_t i = 0; err == STEM_SUCCESS && i < second->count; i++) {
+        EnumEntry* existing = stem_find_entry(new_map, second->keys[i]);
+        if (!existing) {
+            second->keys[added] = second->keys[i];
+            second->values[added] = second->values[i];
+            second->names[added] = second->names[i];
+            added++;
+            continue;
+        }
+        if (!overwrite) {
+            continue;
+        }
+        
+        /* Update existing entry (a value-less source entry keeps the value) */
+        if (new_map->value_size == 0 || second->values[i]) {
+            err = stem_update_entry(new_map, existing, second->values[i]);
+        }
+        
+        /* Take the name over, keeping the name index current (the old name stays in the pool) */
+        if (err == STEM_SUCCESS) {
+            err = stem_set_entry_name(new_map, existing, second->names[i]);
+        }
+    }
+    
+    if (err == STEM_SUCCESS) {
+        err = stem_bulk_insert(new_map, second->keys, second->values, second->names, 
+                               second->pool, added, true);
+    }
+    return err;
+}
+
+/* ==================== PUBLIC C API IMPLEMENTATION ==================== */
+
+/**
+ * @brief Creates a new enum map with precise error reporting
+ * 
+ * @param enum_count Number of enum entries to accommodate
+ * @param value_size Size of each value in bytes (0 for pointer storage)
+ * @param flags Configuration flags
+ * @param error Optional error code output
+ * @return EnumMap* Pointer to created enum map, or NULL on failure
+ */
+EnumMap* stdem_create_ex(size_t enum_count, size_t value_size, 
+                        StemFlags flags, StemError* error) {
+    return stdem_create_with_allocator(enum_count, value_size, flags, NULL, error);
+}
+
+/**
+ * @brief Creates a new enum map storing its names in a given pool
+ * 
+ * @param enum_count Number of enum entries to accommodate
+ * @param value_size Size of each value in bytes (0 for pointer storage)
+ * @param flags Configuration flags
+ * @param allocator Allocation hooks, or NULL for malloc/free
+ * @param pool Name pool to share, or NULL for a new one
+ * @param error Optional error code output
+ * @return EnumMap* Pointer to created enum map, or NULL on failure
+ */
+static EnumMap* stem_create_map(size_t enum_count, size_t value_size, StemFlags flags, 
+                               const StemAllocator* allocator, StemStringPool* pool, 
+                               StemError* error) {
+    /* Values are copied inline behind their entry, which must not overflow */
+    if (enum_count == 0 || enum_count > STEM_MAX_ENTRIES || value_size > ((size_t)-1 >> 1)) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    if ((flags & STEM_FLAGS_THREAD_SAFE) && !STEM_HAVE_ATOMICS) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    if (!allocator) {
+        allocator = &stem_default_allocator;
+    } else if (!allocator->allocate) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    EnumMap* map = allocator->allocate(sizeof(EnumMap), allocator->user_data);
+    if (!map) {
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
+        }
+        return NULL;
+    }
+    
+    memset(map, 0, sizeof(EnumMap));
+    map->value_size = value_size;
+    map->entry_size = value_size > 0 ? 
+                      STEM_ALIGN_UP(sizeof(EnumEntry)) + STEM_ALIGN_UP(value_size) : 
+                      sizeof(EnumEntry);
+    map->flags = flags;
+    map->allocator = *allocator;
+    map->max_load = STEM_LOAD_FACTOR;
+    stem_front_invalidate(map);
+    
+    /* Dense maps expect their entries in the direct-indexed range, so the
+     * hash table only has to hold the occasional out-of-range value. */
+    size_t sparse_count = (flags & STEM_FLAGS_DENSE) ? 0 : enum_count;
+    StemError err = STEM_SUCCESS;
+    
+    /* Size the table for the expected entries */
+    size_t table_size = stem_table_size(map, sparse_count);
+    if (table_size == 0) {
+        err = STEM_ERROR_OUT_OF_MEMORY;
+    } else if (flags & STEM_FLAGS_OPEN_ADDRESSING) {
+        err = stem_alloc_slots(map, table_size);
+    } else {
+        err = stem_alloc_buckets(map, table_size);
+    }
+    
+    if (err == STEM_SUCCESS && (flags & STEM_FLAGS_DENSE)) {
+        map->dense_size = enum_count < STEM_MAX_DENSE_SIZE ? 
+                          enum_count : STEM_MAX_DENSE_SIZE;
+        
+        map->dense = stem_calloc(map, map->dense_size, map->entry_size);
+        map->dense_used = stem_calloc(map, map->dense_size, 1);
+        
+        if (!map->dense || !map->dense_used) {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    /* Names go to the shared pool, or to a new one owned by this map */
+    if (err == STEM_SUCCESS && !(flags & STEM_FLAGS_NO_NAMES)) {
+        map->pool = pool ? stem_pool_retain(pool) : stem_pool_create(allocator);
+        if (!map->pool) {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    if (err != STEM_SUCCESS) {
+        stem_free_storage(map);
+        stem_free(map, map, sizeof(EnumMap));
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+    
+    /* Size the first arena chunk for the expected entries (flat storage
+     * does not use the arena) and the first chunk of a new pool for their
+     * names. */
+    size_t per_entry = (map->buckets && !(flags & STEM_FLAGS_DENSE)) ? 
+                       STEM_ALIGN_UP(sizeof(EnumEntry)) + STEM_ALIGN_UP(value_size) : 0;
+    size_t estimate = (per_entry != 0 && enum_count > STEM_ARENA_MAX_CHUNK / per_entry) ? 
+                      STEM_ARENA_MAX_CHUNK : enum_count * per_entry;
+    map->arena.chunk_size = STEM_ARENA_MIN_CHUNK;
+    while (map->arena.chunk_size < estimate) {
+        map->arena.chunk_size *= 2;
+    }
+    
+    if (map->pool && !pool) {
+        size_t names_estimate = enum_count > STEM_ARENA_MAX_CHUNK / (2 * STEM_ALIGNMENT) ? 
+                                STEM_ARENA_MAX_CHUNK : enum_count * 2 * STEM_ALIGNMENT;
+        map->pool->arena.chunk_size = STEM_ARENA_MIN_CHUNK;
+        while (map->pool->arena.chunk_size < names_estimate) {
+            map->pool->arena.chunk_size *= 2;
+        }
+    }
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return map;
+}
+
+/**
+ * @brief Creates a new enum map whose memory comes from a custom allocator
+ * 
+ * @param enum_count Number of enum entries to accommodate
+ * @param value_size Size of each value in bytes (0 for pointer storage)
+ * @param flags Configuration flags
+ * @param allocator Allocation hooks, or NULL for malloc/free
+ * @param error Optional error code output
+ * @return EnumMap* Pointer to created enum map, or NULL on failure
+ */
+EnumMap* stdem_create_with_allocator(size_t enum_count, size_t value_size, 
+                                    StemFlags flags, const StemAllocator* allocator, 
+                                    StemError* error) {
+    return stem_create_map(enum_count, value_size, flags, allocator, NULL, error);
+}
+
+/**
+ * @brief Creates an empty enum map sharing the name pool of another map
+ * 
+ * @param source Map whose allocator and name pool are shared
+ * @param enum_count Number of enum entries to accommodate
+ * @param value_size Size of each value in bytes (0 for pointer storage)
+ * @param flags Configuration flags
+ * @param error Optional error code output
+ * @return EnumMap* Pointer to created enum map, or NULL on failure
+ */
+EnumMap* stdem_create_sharing_names(const EnumMap* source, size_t enum_count, 
+                                   size_t value_size, StemFlags flags, StemError* error) {
+    if (!source) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    /* The pool pointer never changes, so no lock is needed to read it */
+    return stem_create_map(enum_count, value_size, flags, &source->allocator, 
+                           source->pool, error);
+}
+
+/**
+ * @brief Destroys an enum map and releases all resources
+ * 
+ * @param map Pointer to the EnumMap to destroy
+ */
+void stdem_destroy(EnumMap* map) {
+    if (!map) {
+        return;
+    }
+    
+    stem_lock_map(map);
+    
+    stem_arena_release(&map->allocator, &map->arena);
+    stem_pool_release(map->pool);
+    stem_free_storage(map);
+    stem_free(map, map, sizeof(EnumMap));
+}
+
+/**
+ * @brief Initializes a bump allocator over a caller-provided buffer
+ * 
+ * @param buffer Buffer state to initialize
+ * @param memory Backing memory (e.g. a static array)
+ * @param size Size of the backing memory in bytes
+ * @return StemAllocator Allocator drawing from the buffer
+ */
+StemAllocator stdem_static_allocator(StemStaticBuffer* buffer, void* memory, size_t size) {
+    StemAllocator allocator = { NULL, NULL, NULL };
+    
+    if (!buffer || (!memory && size > 0)) {
+        return allocator;
+    }
+    
+    buffer->base = memory;
+    buffer->size = size;
+    buffer->used = 0;
+    
+    allocator.allocate = stem_static_allocate;
+    allocator.deallocate = NULL;
+    allocator.user_data = buffer;
+    return allocator;
+}
+
+/**
+ * @brief Associates a value with an enum entry with error reporting
+ * 
+ * @param map Enum map to modify
+ * @param enum_value Enum value to associate with
+ * @param value Pointer to the value to associate
+ * @param name Optional name for the enum entry
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_associate_ex(EnumMap* map, int enum_value, 
+                           const void* value, const char* name) {
+    if (!map) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    if (!stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    /* Check if entry already exists */
+    EnumEntry* existing = stem_find_entry(map, enum_value);
+    if (existing) {
+        stem_unlock_map(map);
+        return STEM_ERROR_ALREADY_EXISTS;
+    }
+    
+    StemError error = stem_insert_named(map, enum_value, value, name);
+    
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Replaces the value of an existing association in place
+ * 
+ * @param map Enum map to modify
+ * @param enum_value Enum value to update
+ * @param value New value pointer, or the value to copy (not NULL then)
+ * @return StemError STEM_ERROR_NOT_FOUND if the value is not associated
+ */
+StemError stdem_update(EnumMap* map, int enum_value, const void* value) {
+    if (!map || !stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    EnumEntry* entry = stem_find_entry(map, enum_value);
+    StemError error = entry ? stem_update_entry(map, entry, value) : STEM_ERROR_NOT_FOUND;
+    
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Updates an association, or creates it if it does not exist
+ * 
+ * @param map Enum map to modify
+ * @param enum_value Enum value to associate
+ * @param value New value pointer, or the value to copy
+ * @param name New name, or NULL to keep the current one
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_upsert(EnumMap* map, int enum_value, const void* value, const char* name) {
+    if (!map || !stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    StemError error;
+    EnumEntry* entry = stem_find_entry(map, enum_value);
+    if (entry) {
+        error = stem_update_entry(map, entry, value);
+        if (error == STEM_SUCCESS && name) {
+            error = stem_rename_entry(map, entry, name);
+        }
+    } else {
+        error = stem_insert_named(map, enum_value, value, name);
+    }
+    
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Removes an association
+ * 
+ * @param map Enum map to modify
+ * @param enum_value Enum value to remove
+ * @return StemError STEM_ERROR_NOT_FOUND if the value is not associated
+ */
+StemError stdem_remove(EnumMap* map, int enum_value) {
+    if (!map || !stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    StemError error = stem_remove_entry(map, enum_value);
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Associates many values at once, sizing the map a single time
+ * 
+ * @param map Enum map to modify
+ * @param keys Enum values to associate
+ * @param values Value pointer per entry, or NULL for all NULL
+ * @param names Name per entry, or NULL for all unnamed
+ * @param n Number of entries
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_associate_bulk(EnumMap* map, const int* keys, const void* const* values, 
+                              const char* const* names, size_t n) {
+    if (!map || (n > 0 && !keys)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    if (!stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    StemError error = stem_bulk_insert(map, keys, values, names, NULL, n, false);
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Creates a map holding the given entries in one step
+ * 
+ * @param keys Enum values
+ * @param values Value pointer per entry, or NULL for all NULL
+ * @param names Name per entry, or NULL for all unnamed
+ * @param n Number of entries
+ * @param value_size Size of each value in bytes (0 for pointer storage)
+ * @param flags Configuration flags
+ * @param error Optional error code output
+ * @return EnumMap* New enum map, or NULL on failure
+ */
+EnumMap* stdem_create_from_arrays(const int* keys, const void* const* values, 
+                                 const char* const* names, size_t n, 
+                                 size_t value_size, StemFlags flags, StemError* error) {
+    if (n > 0 && !keys) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    StemEntryArrays arrays;
+    arrays.keys = (int*)keys;
+    arrays.values = (const void**)values;
+    arrays.names = (const char**)names;
+    arrays.pool = NULL;
+    arrays.count = n;
+    
+    return stem_create_filled(n, value_size, flags, STEM_LOAD_FACTOR, NULL, &arrays, false, error);
+}
+
+/**
+ * @brief Retrieves a value associated with an enum entry with error reporting
+ * 
+ * @param map Enum map to query
+ * @param enum_value Enum value to look up
+ * @param error Optional error code output
+ * @return const void* Pointer to the associated value, or NULL on error
+ */
+const void* stdem_get_value_ex(const EnumMap* map, int enum_value, StemError* error) {
+    if (!map) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    if (map->frozen) {
+        const StemFrozen* frozen = stem_frozen_local(map);
+        size_t slot = stem_frozen_find(frozen, enum_value);
+        if (slot == frozen->count) {
+            stem_count(map, &map->lookup_misses, 1);
+            if (error) {
+                *error = STEM_ERROR_NOT_FOUND;
+            }
+            return NULL;
+        }
+        stem_count(map, &map->lookup_hits, 1);
+        if (error) {
+            *error = STEM_SUCCESS;
+        }
+        return stem_frozen_value(frozen, slot);
+    }
+    
+    stem_lock_map_shared(map);
+    
+    uint32_t hash = stem_hash_int(enum_value);
+    const void* cached;
+    if (stem_front_get(map, enum_value, hash, &cached)) {
+        stem_unlock_map_shared(map);
+        stem_count(map, &map->lookup_hits, 1);
+        stem_count(map, &map->cache_hits, 1);
+        if (error) {
+            *error = STEM_SUCCESS;
+        }
+        return cached;
+    }
+    
+    EnumEntry* entry = stem_find_entry_hashed(map, enum_value, hash);
+    if (!entry) {
+        stem_unlock_map_shared(map);
+        stem_count(map, &map->lookup_misses, 1);
+        if (error) {
+            *error = STEM_ERROR_NOT_FOUND;
+        }
+        return NULL;
+    }
+    
+    stem_front_put(map, enum_value, hash, entry->value);
+    stem_unlock_map_shared(map);
+    stem_count(map, &map->lookup_hits, 1);
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return entry->value;
+}
+
+/**
+ * @brief Returns a writable pointer to the value of an enum entry
+ * 
+ * The lock of a thread-safe map only covers the lookup; writes through
+ * the returned pointer are left to the caller to synchronize.
+ * 
+ * @param map Enum map to query (not read-only)
+ * @param enum_value Enum value to look up
+ * @param error Optional error code output
+ * @return void* The inline copy or stored pointer, or NULL if not found
+ */
+void* stdem_get_value_mut(EnumMap* map, int enum_value, StemError* error) {
+    if (!map || !stem_is_mutable(map)) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    stem_lock_map_shared(map);
+    EnumEntry* entry = stem_find_entry(map, enum_value);
+    stem_unlock_map_shared(map);
+    
+    stem_count(map, entry ? &map->lookup_hits : &map->lookup_misses, 1);
+    if (error) {
+        *error = entry ? STEM_SUCCESS : STEM_ERROR_NOT_FOUND;
+    }
+    return entry ? entry->value : NULL;
+}
+
+/**
+ * @brief Retrieves the name associated with an enum entry with error reporting
+ * 
+ * @param map Enum map to query
+ * @param enum_value Enum value to look up
+ * @param error Optional error code output
+ * @return const char* Name of the enum entry, or NULL if not found
+ */
+const char* stdem_get_name_ex(const EnumMap* map, int enum_value, StemError* error) {
+    if (!map) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    if (map->flags & STEM_FLAGS_NO_NAMES) {
+        if (error) {
+            *error = STEM_ERROR_NOT_FOUND;
+        }
+        return NULL;
+    }
+    
+    if (map->frozen) {
+        const StemFrozen* frozen = stem_frozen_local(map);
+        size_t slot = stem_frozen_find(frozen, enum_value);
+        if (slot == frozen->count) {
+            if (error) {
+                *error = STEM_ERROR_NOT_FOUND;
+            }
+            return NULL;
+        }
+        if (error) {
+            *error = STEM_SUCCESS;
+        }
+        return stem_frozen_name(frozen, slot);
+    }
+    
+    stem_lock_map_shared(map);
+    
+    EnumEntry* entry = stem_find_entry(map, enum_value);
+    if (!entry) {
+        stem_unlock_map_shared(map);
+        if (error) {
+            *error = STEM_ERROR_NOT_FOUND;
+        }
+        return NULL;
+    }
+    
+    stem_unlock_map_shared(map);
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return entry->name;
+}
+
+/**
+ * @brief Resolves a block of keys against a frozen map
+ * 
+ * Seeds and then records are prefetched for the whole block before any
+ * of them is needed, so the cache misses of different keys overlap.
+ * 
+ * @param frozen Frozen block
+ * @param keys Keys to look up
+ * @param m Number of keys (at most STEM_BATCH_BLOCK)
+ * @param values Optional value output per key (NULL if absent)
+ * @param found Optional presence output per key
+ * @return size_t Number of keys found
+ */
+static size_t stem_frozen_batch(const StemFrozen* frozen, const int* keys, size_t m, 
+                                const void** values, bool* found) {
+    uint32_t n = frozen->count;
+    size_t slots[STEM_BATCH_BLOCK];
+    size_t hits = 0;
+    
+    if (n == 0) {
+        for (size_t i = 0; i < m; i++) {
+            if (values) {
+                values[i] = NULL;
+            }
+            if (found) {
+                found[i] = false;
+            }
+        }
+        return 0;
+    }
+    
+    const int32_t* seeds = (const int32_t*)((const unsigned char*)frozen + frozen->key_seeds);
+    for (size_t i = 0; i < m; i++) {
+        slots[i] = stem_hash_seeded((uint32_t)keys[i], 0) % n;
+        STEM_PREFETCH(&seeds[slots[i]]);
+    }
+    for (size_t i = 0; i < m; i++) {
+        int32_t seed = seeds[slots[i]];
+        slots[i] = STEM_PERFECT_SLOT(seed, stem_hash_seeded((uint32_t)keys[i], (uint32_t)seed), n);
+        if (slots[i] < n) {
+            STEM_PREFETCH(stem_frozen_record(frozen, slots[i]));
+        }
+    }
+    for (size_t i = 0; i < m; i++) {
+        bool hit = slots[i] < n && stem_frozen_record(frozen, slots[i])->enum_value == keys[i];
+        if (values) {
+            values[i] = hit ? stem_frozen_value(frozen, slots[i]) : NULL;
+        }
+        if (found) {
+            found[i] = hit;
+        }
+        hits += hit;
+    }
+    return hits;
+}
+
+/**
+ * @brief Shared implementation of the batch lookups
+ * 
+ * Keys are processed in blocks: the block is hashed in one tight loop
+ * (which compilers vectorize), the home slots or bucket heads of all its
+ * keys are prefetched, chain heads are loaded and prefetched in turn, and
+ * only then is each key probed. The lock is taken once for the batch.
+ * 
+ * @param map Enum map to query
+ * @param keys Keys to look up
+ * @param n Number of keys
+ * @param values Optional value output per key (NULL if absent)
+ * @param found Optional presence output per key
+ * @return size_t Number of keys found
+ */
+static size_t stem_lookup_batch(const EnumMap* map, const int* keys, size_t n, 
+                                const void** values, bool* found) {
+    size_t hits = 0;
+    
+    if (map->frozen) {
+        const StemFrozen* frozen = stem_frozen_local(map);
+        for (size_t base = 0; base < n; base += STEM_BATCH_BLOCK) {
+            size_t m = n - base < STEM_BATCH_BLOCK ? n - base : STEM_BATCH_BLOCK;
+            hits += stem_frozen_batch(frozen, keys + base, m, 
+                                      values ? values + base : NULL, 
+                                      found ? found + base : NULL);
+        }
+        stem_count(map, &map->lookup_hits, hits);
+        stem_count(map, &map->lookup_misses, n - hits);
+        return hits;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    uint32_t hashes[STEM_BATCH_BLOCK];
+    for (size_t base = 0; base < n; base += STEM_BATCH_BLOCK) {
+        size_t m = n - base < STEM_BATCH_BLOCK ? n - base : STEM_BATCH_BLOCK;
+        const int* block = keys + base;
+        
+        for (size_t i = 0; i < m; i++) {
+            hashes[i] = stem_hash_int(block[i]);
+        }
+        
+        if (map->slots) {
+            for (size_t i = 0; i < m; i++) {
+                size_t slot = (size_t)(hashes[i] >> map->hash_shift);
+                STEM_PREFETCH(&map->slot_used[slot]);
+                STEM_PREFETCH(stem_slot_entry(map, slot));
+            }
+        } else if (map->buckets) {
+            for (size_t i = 0; i < m; i++) {
+                STEM_PREFETCH(&map->buckets[hashes[i] >> map->hash_shift]);
+            }
+            for (size_t i = 0; i < m; i++) {
+                if ((size_t)(unsigned int)block[i] >= map->dense_size) {
+                    const EnumEntry* head = map->buckets[hashes[i] >> map->hash_shift];
+                    if (head) {
+                        STEM_PREFETCH(head);
+                    }
+                }
+            }
+        }
+        
+        for (size_t i = 0; i < m; i++) {
+            const EnumEntry* entry = stem_find_entry_hashed(map, block[i], hashes[i]);
+            if (values) {
+                values[base + i] = entry ? entry->value : NULL;
+            }
+            if (found) {
+                found[base + i] = entry != NULL;
+            }
+            hits += entry != NULL;
+        }
+    }
+    
+    stem_unlock_map_shared(map);
+    stem_count(map, &map->lookup_hits, hits);
+    stem_count(map, &map->lookup_misses, n - hits);
+    return hits;
+}
+
+/**
+ * @brief Retrieves the values of many enum entries at once
+ * 
+ * @param map Enum map to query
+ * @param keys Enum values to look up
+ * @param n Number of enum values
+ * @param out Output array of n value pointers (NULL for missing entries)
+ * @return size_t Number of enum values found
+ */
+size_t stdem_get_values_batch(const EnumMap* map, const int* keys, size_t n, 
+                              const void** out) {
+    if (!map || (n > 0 && (!keys || !out))) {
+        return 0;
+    }
+    
+    return stem_lookup_batch(map, keys, n, out, NULL);
+}
+
+/**
+ * @brief Checks many enum values for presence at once
+ * 
+ * @param map Enum map to query
+ * @param keys Enum values to look up
+ * @param n Number of enum values
+ * @param out Optional output array of n presence flags
+ * @return size_t Number of enum values found
+ */
+size_t stdem_exists_batch(const EnumMap* map, const int* keys, size_t n, bool* out) {
+    if (!map || (n > 0 && !keys)) {
+        return 0;
+    }
+    
+    return stem_lookup_batch(map, keys, n, NULL, out);
+}
+
+/**
+ * @brief Finds an enum value by its name with error reporting
+ * 
+ * @param map Enum map to search
+ * @param name Name to search for
+ * @param error Optional error code output
+ * @return int Enum value associated with the name, or 0 on error
+ */
+int stdem_find_by_name(const EnumMap* map, const char* name, StemError* error) {
+    if (!map || !name) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return 0;
+    }
+    return stdem_find_by_name_n(map, name, strlen(name), error);
+}
+
+/**
+ * @brief Finds an enum value by a name given as pointer and length
+ * 
+ * @param map Enum map to search
+ * @param name Start of the name, need not be NUL-terminated
+ * @param length Length of the name in bytes
+ * @param error Optional error code output
+ * @return int Enum value associated with the name, or 0 on error
+ */
+int stdem_find_by_name_n(const EnumMap* map, const char* name, size_t length, 
+                         StemError* error) {
+    if (!map || (!name && length > 0)) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return 0;
+    }
+    if (!name) {
+        name = "";
+    }
+    
+    if (map->flags & STEM_FLAGS_NO_NAMES) {
+        if (error) {
+            *error = STEM_ERROR_NOT_FOUND;
+        }
+        return 0;
+    }
+    
+    if (map->frozen) {
+        const StemFrozen* frozen = stem_frozen_local(map);
+        size_t slot = stem_frozen_find_name(frozen, name, length);
+        if (slot == frozen->count) {
+            stem_count(map, &map->name_misses, 1);
+            if (error) {
+                *error = STEM_ERROR_NOT_FOUND;
+            }
+            return 0;
+        }
+        stem_count(map, &map->name_hits, 1);
+        if (error) {
+            *error = STEM_SUCCESS;
+        }
+        return stem_frozen_record(frozen, slot)->enum_value;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    const StemNameSlot* slot = stem_name_lookup(map, name, length, stem_hash_name(name, length));
+    if (slot) {
+        int enum_value = slot->enum_value;
+        stem_unlock_map_shared(map);
+        stem_count(map, &map->name_hits, 1);
+        if (error) {
+            *error = STEM_SUCCESS;
+        }
+        return enum_value;
+    }
+    
+    stem_unlock_map_shared(map);
+    stem_count(map, &map->name_misses, 1);
+    
+    if (error) {
+        *error = STEM_ERROR_NOT_FOUND;
+    }
+    return 0;
+}
+
+/**
+ * @brief Iterates over all entries in the enum map
+ * 
+ * @param map Enum map to iterate over
+ * @param iterator Callback function to call for each entry
+ * @param user_data User context passed to the iterator
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_foreach(const EnumMap* map, EnumMapIterator iterator, 
+                       void* user_data) {
+    if (!map || !iterator) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    StemCursor cursor;
+    EnumEntry* entry;
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(map, &cursor)) != NULL) {
+        iterator(entry->enum_value, entry->name, entry->value, 
+                map->value_size, user_data);
+    }
+    
+    stem_unlock_map_shared(map);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Calls an iterator for the entry of an enum value, if there is one
+ */
+static void stem_visit_key(const EnumMap* map, int enum_value, EnumMapIterator iterator, 
+                           void* user_data) {
+    if (map->frozen) {
+        size_t slot = stem_frozen_find(map->frozen, enum_value);
+        if (slot < map->frozen->count) {
+            iterator(enum_value, stem_frozen_name(map->frozen, slot), 
+                     stem_frozen_value(map->frozen, slot), map->value_size, user_data);
+        }
+        return;
+    }
+    
+    const EnumEntry* entry = stem_find_entry(map, enum_value);
+    if (entry) {
+        iterator(entry->enum_value, entry->name, entry->value, map->value_size, user_data);
+    }
+}
+
+/**
+ * @brief Fills an iteration item from a map entry
+ */
+static void stem_iter_item(StemItem* item, const EnumEntry* entry) {
+    item->enum_value = entry->enum_value;
+    item->name = entry->name;
+    item->value = entry->value;
+}
+
+/**
+ * @brief Orders two StemItem entries by enum value (for qsort)
+ */
+static int stem_item_compare(const void* a, const void* b) {
+    int x = ((const StemItem*)a)->enum_value;
+    int y = ((const StemItem*)b)->enum_value;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Visits the entries in [lo, hi] stored outside the dense range, in order
+ * 
+ * Uses the ordered index when the map has one. Otherwise ranges narrower
+ * than the number of stored entries probe every value, and wider ones
+ * collect the entries of the range in one pass and sort them, which takes
+ * a temporary array of up to one StemItem per stored entry. Either way the
+ * cost is bounded by the entry count, not by the width of the range.
+ * 
+ * @return StemError STEM_ERROR_OUT_OF_MEMORY if the temporary array could
+ *         not be allocated; nothing is visited then
+ */
+static StemError stem_visit_sparse(const EnumMap* map, long long lo, long long hi, 
+                                   EnumMapIterator iterator, void* user_data) {
+    if (lo > hi) {
+        return STEM_SUCCESS;
+    }
+    
+    if (map->frozen && (map->flags & STEM_FLAGS_ORDERED)) {
+        const StemOrderPair* pairs = map->order_pairs;
+        size_t n = pairs ? map->frozen->count : 0;
+        size_t i = 0;
+        size_t end = n;
+        while (i < end) {
+            size_t mid = i + (end - i) / 2;
+            if (pairs[mid].enum_value < lo) {
+                i = mid + 1;
+            } else {
+                end = mid;
+            }
+        }
+        for (; i < n && pairs[i].enum_value <= hi; i++) {
+            iterator(pairs[i].enum_value, stem_frozen_name(map->frozen, pairs[i].slot), 
+                     stem_frozen_value(map->frozen, pairs[i].slot), map->value_size, user_data);
+        }
+        return STEM_SUCCESS;
+    }
+    
+    if (map->flags & STEM_FLAGS_ORDERED) {
+        if (map->order_blocks == 0) {
+            return STEM_SUCCESS;
+        }
+        size_t b = stem_order_block(map, (int)lo);
+        size_t i = stem_lower_bound(map->order[b]->keys, map->order[b]->count, (int)lo);
+        for (; b < map->order_blocks; b++, i = 0) {
+            const StemOrderBlock* block = map->order[b];
+            for (; i < block->count; i++) {
+                if (block->keys[i] > hi) {
+                    return STEM_SUCCESS;
+                }
+                stem_visit_key(map, block->keys[i], iterator, user_data);
+            }
+        }
+        return STEM_SUCCESS;
+    }
+    
+    size_t stored = map->frozen ? map->frozen->count : map->count - map->dense_count;
+    if ((unsigned long long)(hi - lo) < stored) {
+        for (long long key = lo; key <= hi; key++) {
+            stem_visit_key(map, (int)key, iterator, user_data);
+        }
+        return STEM_SUCCESS;
+    }
+    if (stored == 0) {
+        return STEM_SUCCESS;
+    }
+    
+    StemItem* items = stem_calloc(map, stored, sizeof(StemItem));
+    if (!items) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    size_t n = 0;
+    StemCursor cursor;
+    const EnumEntry* entry;
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(map, &cursor)) != NULL && n < stored) {
+        if (entry->enum_value >= lo && entry->enum_value <= hi) {
+            stem_iter_item(&items[n++], entry);
+        }
+    }
+    qsort(items, n, sizeof(StemItem), stem_item_compare);
+    for (size_t i = 0; i < n; i++) {
+        iterator(items[i].enum_value, items[i].name, items[i].value, map->value_size, user_data);
+    }
+    
+    stem_free(map, items, stored * sizeof(StemItem));
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Iterates over the entries with enum values in [lo, hi] in ascending order
+ * 
+ * @param map Enum map to iterate over
+ * @param lo Smallest enum value to visit
+ * @param hi Largest enum value to visit
+ * @param iterator Callback function to call for each entry
+ * @param user_data User context passed to the iterator
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_foreach_range(const EnumMap* map, int lo, int hi, 
+                              EnumMapIterator iterator, void* user_data) {
+    if (!map || !iterator) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    /* Values below the dense range, the dense range, then the values above */
+    long long dense_end = (long long)map->dense_size;
+    StemError error = stem_visit_sparse(map, lo, hi < 0 ? hi : -1, iterator, user_data);
+    if (error != STEM_SUCCESS) {
+        stem_unlock_map_shared(map);
+        return error;
+    }
+    for (long long key = lo > 0 ? lo : 0; key <= hi && key < dense_end; key++) {
+        if (map->dense_used[key]) {
+            const EnumEntry* entry = stem_dense_entry(map, (size_t)key);
+            iterator(entry->enum_value, entry->name, entry->value, map->value_size, user_data);
+        }
+    }
+    error = stem_visit_sparse(map, lo > dense_end ? lo : dense_end, hi, iterator, user_data);
+    
+    stem_unlock_map_shared(map);
+    return error;
+}
+
+/**
+ * @brief Starts iterating over a map, holding it shared until stdem_iter_end
+ * 
+ * @param map Enum map to iterate over
+ * @param iter Cursor to initialize
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_iter_begin(const EnumMap* map, StemIter* iter) {
+    if (!iter) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    memset(iter, 0, sizeof(*iter));
+    if (!map) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map_shared(map);
+    iter->map = map;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Copies up to max of the next entries into items
+ * 
+ * Walks the frozen records, the dense range, the slot array and the
+ * bucket chains in storage order, so a flat map is read front to back.
+ * 
+ * @param iter Cursor started by stdem_iter_begin
+ * @param items Array receiving the entries
+ * @param max Capacity of items
+ * @return size_t Number of entries stored, 0 once the map is exhausted
+ */
+size_t stdem_iter_next_batch(StemIter* iter, StemItem* items, size_t max) {
+    if (!iter || !iter->map || !items) {
+        return 0;
+    }
+    
+    const EnumMap* map = iter->map;
+    size_t n = 0;
+    
+    if (map->frozen) {
+        const StemFrozen* frozen = map->frozen;
+        while (n < max && iter->slot < frozen->count) {
+            size_t i = iter->slot++;
+            items[n].enum_value = stem_frozen_record(frozen, i)->enum_value;
+            items[n].name = stem_frozen_name(frozen, i);
+            items[n].value = stem_frozen_value(frozen, i);
+            n++;
+        }
+        return n;
+    }
+    
+    while (n < max && iter->dense_index < map->dense_size) {
+        size_t i = iter->dense_index++;
+        if (map->dense_used[i]) {
+            stem_iter_item(&items[n++], stem_dense_entry(map, i));
+        }
+    }
+    
+    while (n < max && iter->slot < map->num_slots) {
+        size_t i = iter->slot++;
+        if (map->slot_used[i]) {
+            stem_iter_item(&items[n++], stem_slot_entry(map, i));
+        }
+    }
+    
+    const EnumEntry* entry = (const EnumEntry*)iter->entry;
+    while (n < max) {
+        if (!entry) {
+            if (iter->bucket >= stem_bucket_span(map)) {
+                break;
+            }
+            entry = *stem_bucket_at(map, iter->bucket++);
+            continue;
+        }
+        stem_iter_item(&items[n++], entry);
+        entry = entry->next;
+    }
+    iter->entry = entry;
+    return n;
+}
+
+/**
+ * @brief Advances a cursor by one entry
+ * 
+ * @param iter Cursor started by stdem_iter_begin
+ * @param item Receives the entry
+ * @return bool True if an entry was stored, false at the end
+ */
+bool stdem_iter_next(StemIter* iter, StemItem* item) {
+    return stdem_iter_next_batch(iter, item, 1) == 1;
+}
+
+/**
+ * @brief Finishes an iteration and releases the map
+ * 
+ * @param iter Cursor started by stdem_iter_begin; may be called again
+ */
+void stdem_iter_end(StemIter* iter) {
+    if (iter && iter->map) {
+        stem_unlock_map_shared(iter->map);
+        iter->map = NULL;
+    }
+}
+
+/**
+ * @brief Returns the number of entries in the enum map
+ * 
+ * @param map Enum map to query
+ * @return size_t Number of entries in the map
+ */
+size_t stdem_count(const EnumMap* map) {
+    if (!map) {
+        return 0;
+    }
+    
+    stem_lock_map_shared(map);
+    size_t count = map->count;
+    stem_unlock_map_shared(map);
+    
+    return count;
+}
+
+/**
+ * @brief Returns the size of the value storage in bytes
+ * 
+ * @param map Enum map to query
+ * @return size_t Size of each value in bytes (0 for pointer storage)
+ */
+size_t stdem_value_size(const EnumMap* map) {
+    return map ? map->value_size : 0;
+}
+
+/**
+ * @brief Returns the bytes an arena holds from its allocator
+ * 
+ * @param arena Arena to measure
+ * @return size_t Total size of its chunks, headers included
+ */
+static size_t stem_arena_bytes(const StemArena* arena) {
+    size_t bytes = 0;
+    for (const StemArenaChunk* chunk = arena->chunks; chunk; chunk = chunk->next) {
+        bytes += STEM_ALIGN_UP(sizeof(StemArenaChunk)) + chunk->capacity;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Reports the layout, memory use and lookup counters of a map
+ * 
+ * @param map Enum map to inspect
+ * @param stats Output statistics
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_get_stats(const EnumMap* map, StemStats* stats) {
+    if (!map || !stats) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    memset(stats, 0, sizeof(StemStats));
+    
+    stem_lock_map_shared(map);
+    
+    stats->count = map->count;
+    stats->dense_count = map->dense_count;
+    stats->dense_capacity = map->dense_size;
+    stats->name_count = map->names_count;
+    stats->name_capacity = map->num_names;
+    stats->resize_count = map->resizes;
+    
+    /* Probe lengths of everything outside the dense range */
+    size_t probed = 0;
+    size_t total_probe = 0;
+    if (map->frozen) {
+        stats->table_capacity = map->frozen->count;
+        stats->name_count = map->frozen->name_count;
+        stats->name_capacity = map->frozen->name_count;
+        probed = map->frozen->count;
+        total_probe = probed;
+        stats->max_probe = probed ? 1 : 0;
+    } else if (map->slots) {
+        stats->table_capacity = map->num_slots;
+        size_t mask = map->num_slots - 1;
+        for (size_t i = 0; i < map->num_slots; i++) {
+            if (!map->slot_used[i]) {
+                continue;
+            }
+            size_t home = stem_slot_index(map, stem_slot_entry(map, i)->enum_value);
+            size_t probe = ((i - home) & mask) + 1;
+            total_probe += probe;
+            probed++;
+            if (probe > stats->max_probe) {
+                stats->max_probe = probe;
+            }
+        }
+    } else {
+        stats->table_capacity = map->num_buckets;
+        for (size_t i = 0; i < stem_bucket_span(map); i++) {
+            size_t length = 0;
+            for (const EnumEntry* entry = *stem_bucket_at(map, i); entry; entry = entry->next) {
+                total_probe += ++length;
+            }
+            probed += length;
+            if (length > stats->max_probe) {
+                stats->max_probe = length;
+            }
+        }
+    }
+    if (stats->table_capacity > 0) {
+        stats->load_factor = (double)probed / (double)stats->table_capacity;
+    }
+    stats->max_load_factor = map->frozen ? 0.0 : map->max_load;
+    stats->rehash_pending = map->old_num_buckets - map->rehash_pos;
+    if (probed > 0) {
+        stats->avg_probe = (double)total_probe / (double)probed;
+    }
+    
+    /* Memory held from the allocator, with the shared pool counted apart */
+    size_t heap = sizeof(EnumMap) + stem_arena_bytes(&map->arena);
+    heap += stem_bucket_span(map) * sizeof(EnumEntry*);
+    heap += map->dense_size * (map->entry_size + 1);
+    heap += map->num_slots * (map->entry_size + 1);
+    heap += map->num_names * sizeof(StemNameSlot);
+    heap += map->order_capacity * sizeof(*map->order);
+    heap += map->order_pairs ? map->count * sizeof(StemOrderPair) : 0;
+    for (size_t i = 0; map->replicas && i < map->node_count; i++) {
+        heap += map->replicas[i] != map->frozen ? map->replica_bytes : 0;
+        stats->numa_replicas += map->replicas[i] != map->frozen;
+    }
+    if (map->frozen && !map->image) {
+        heap += (size_t)map->frozen->size;
+    } else if (map->frozen) {
+        stats->image_bytes = (size_t)map->frozen->size;
+    }
+    stats->heap_bytes = heap;
+    
+    if (map->pool) {
+        StemStringPool* pool = map->pool;
+        stem_spin_lock(&pool->lock);
+        stats->pool_bytes = sizeof(StemStringPool) + pool->num_strings * sizeof(char*) + 
+                            stem_arena_bytes(&pool->arena);
+        stem_spin_unlock(&pool->lock);
+#if STEM_HAVE_ATOMICS
+        stats->pool_maps = STEM_ATOMIC_LOAD(&pool->refs);
+#else
+        stats->pool_maps = pool->refs;
+#endif
+    }
+    
+    stem_unlock_map_shared(map);
+    
+#if STEM_HAVE_ATOMICS
+    stats->lookup_hits = STEM_ATOMIC_LOAD_RELAXED(&map->lookup_hits);
+    stats->lookup_misses = STEM_ATOMIC_LOAD_RELAXED(&map->lookup_misses);
+    stats->cache_hits = STEM_ATOMIC_LOAD_RELAXED(&map->cache_hits);
+    stats->name_hits = STEM_ATOMIC_LOAD_RELAXED(&map->name_hits);
+    stats->name_misses = STEM_ATOMIC_LOAD_RELAXED(&map->name_misses);
+#else
+    stats->lookup_hits = map->lookup_hits;
+    stats->lookup_misses = map->lookup_misses;
+    stats->cache_hits = map->cache_hits;
+    stats->name_hits = map->name_hits;
+    stats->name_misses = map->name_misses;
+#endif
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Resets the STEM_FLAGS_STATS lookup counters of a map to zero
+ * 
+ * @param map Enum map whose counters to reset
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_reset_stats(const EnumMap* map) {
+    if (!map) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    EnumMap* counters = (EnumMap*)map;
+#if STEM_HAVE_ATOMICS
+    STEM_ATOMIC_STORE_RELAXED(&counters->lookup_hits, 0);
+    STEM_ATOMIC_STORE_RELAXED(&counters->lookup_misses, 0);
+    STEM_ATOMIC_STORE_RELAXED(&counters->cache_hits, 0);
+    STEM_ATOMIC_STORE_RELAXED(&counters->name_hits, 0);
+    STEM_ATOMIC_STORE_RELAXED(&counters->name_misses, 0);
+#else
+    counters->lookup_hits = 0;
+    counters->lookup_misses = 0;
+    counters->cache_hits = 0;
+    counters->name_hits = 0;
+    counters->name_misses = 0;
+#endif
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Clears all associations in the enum map
+ * 
+ * @param map Enum map to clear
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_clear(EnumMap* map) {
+    if (!map) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    if (!stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    stem_release_entries(map);
+    
+    stem_unlock_map(map);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Makes room for a number of entries without further growth
+ * 
+ * @param map Enum map to size
+ * @param n Total number of entries the map should take
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_reserve(EnumMap* map, size_t n) {
+    if (!map || map->frozen || !stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    /* Any of the new entries may fall outside the dense range */
+    size_t extra = n > map->count ? n - map->count : 0;
+    StemError error = stem_reserve_entries(map, extra);
+    if (error == STEM_SUCCESS && map->pool) {
+        error = stem_name_index_reserve(map, extra);
+    }
+    if (error == STEM_SUCCESS && map->pool) {
+        stem_spin_lock(&map->pool->lock);
+        error = stem_pool_reserve(map->pool, extra, 0);
+        stem_spin_unlock(&map->pool->lock);
+    }
+    
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Shrinks the table and the name index to the current entries
+ * 
+ * @param map Enum map to shrink
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_shrink_to_fit(EnumMap* map) {
+    if (!map || map->frozen || !stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    StemError error = STEM_SUCCESS;
+    size_t current = map->slots ? map->num_slots : map->num_buckets;
+    size_t new_size = stem_table_size(map, map->count - map->dense_count);
+    if (new_size < current) {
+        error = stem_resize_map(map, new_size);
+    }
+    
+    /* An empty name index is dropped and allocated again by the next name */
+    if (error == STEM_SUCCESS && map->names && map->names_count == 0) {
+        stem_free(map, map->names, map->num_names * sizeof(StemNameSlot));
+        map->names = NULL;
+        map->num_names = 0;
+    } else if (error == STEM_SUCCESS && map->names) {
+        size_t num_names = STEM_DEFAULT_SLOTS;
+        while ((float)map->names_count > num_names * STEM_LOAD_FACTOR) {
+            num_names *= 2;
+        }
+        if (num_names < map->num_names) {
+            error = stem_name_index_resize(map, num_names);
+        }
+    }
+    
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Sets the load factor at which the map's table grows
+ * 
+ * @param map Enum map to configure
+ * @param max_load Maximum load factor, from 0.1 up to 0.95 for open
+ *                 addressing and up to 4 for chained buckets
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_set_max_load_factor(EnumMap* map, float max_load) {
+    float limit = (map && (map->flags & STEM_FLAGS_OPEN_ADDRESSING)) ? 
+                  STEM_MAX_SLOT_LOAD : STEM_MAX_BUCKET_LOAD;
+    if (!map || map->frozen || !stem_is_mutable(map) || 
+        !(max_load >= STEM_MIN_LOAD_FACTOR && max_load <= limit)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    StemError error = stem_set_load(map, max_load);
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Creates a copy of an enum map
+ * 
+ * @param map Enum map to copy
+ * @param error Optional error code output
+ * @return EnumMap* New enum map with the same associations, or NULL on failure
+ */
+EnumMap* stdem_copy(const EnumMap* map, StemError* error) {
+    if (!map) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    /* Dense maps keep their direct-indexed range in the copy (frozen maps
+     * have none, so the range then covers the entry count) */
+    size_t capacity = (map->flags & STEM_FLAGS_DENSE) && map->dense_size ? 
+                      map->dense_size : map->count;
+    
+    StemEntryArrays arrays;
+    StemError err = stem_entries_gather(map, &arrays);
+    EnumMap* new_map = NULL;
+    if (err == STEM_SUCCESS) {
+        new_map = stem_create_filled(capacity, map->value_size, map->flags, map->max_load, 
+                                     &map->allocator, &arrays, true, &err);
+        stem_entries_free(map, &arrays);
+    }
+    
+    stem_unlock_map_shared(map);
+    
+    if (error) {
+        *error = err;
+    }
+    return new_map;
+}
+
+/**
+ * @brief Merges two enum maps into a new one
+ * 
+ * @param map1 First enum map
+ * @param map2 Second enum map
+ * @param overwrite If true, entries from map2 overwrite those in map1
+ * @param error Optional error code output
+ * @return EnumMap* New enum map containing merged associations, or NULL on failure
+ */
+EnumMap* stdem_merge(const EnumMap* map1, const EnumMap* map2, 
+                    bool overwrite, StemError* error) {
+    if (!map1 || !map2) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    if (map1->value_size != map2->value_size) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    stem_lock_map_shared(map1);
+    stem_lock_map_shared(map2);
+    
+    StemFlags flags = map1->flags | map2->flags;
+    size_t capacity = map1->count + map2->count;
+    if (flags & STEM_FLAGS_DENSE) {
+        /* Keep the widest direct-indexed range of the two inputs */
+        size_t dense_size = map1->dense_size > map2->dense_size ? 
+                            map1->dense_size : map2->dense_size;
+        capacity = dense_size ? dense_size : capacity;
+    }
+    
+    /* Presize for both inputs and bulk-load the first map */
+    StemEntryArrays first;
+    StemEntryArrays second;
+    StemError err = stem_entries_gather(map1, &first);
+    if (err == STEM_SUCCESS) {
+        err = stem_entries_gather(map2, &second);
+        if (err != STEM_SUCCESS) {
+            stem_entries_free(map1, &first);
+        }
+    }
+    
+    EnumMap* new_map = NULL;
+    if (err == STEM_SUCCESS) {
+        new_map = stem_create_filled(capacity, map1->value_size, flags, map1->max_load, 
+                                     &map1->allocator, &first, true, &err);
+    }
+    
+    /* Overwrite or skip shared keys, then bulk-load the rest of map2 */
+    if (new_map) {
+        err = stem_merge_entries(new_map, &second, overwrite);
+    }
+    
+    if (first.keys) {
+        stem_entries_free(map2, &second);
+        stem_entries_free(map1, &first);
+    }
+    
+    stem_unlock_map_shared(map2);
+    stem_unlock_map_shared(map1);
+    
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(new_map);
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return new_map;
+}
+
+/**
+ * @brief Applies the associations of one map to another in place
+ * 
+ * @param dst Enum map to modify
+ * @param src Enum map whose entries are added to dst (left unchanged)
+ * @param overwrite If true, entries from src replace those in dst
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_merge_into(EnumMap* dst, const EnumMap* src, bool overwrite) {
+    if (!dst || !src || dst->value_size != src->value_size || !stem_is_mutable(dst)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    if (dst == src) {
+        return STEM_SUCCESS;
+    }
+    
+    /* Lock in address order so opposite merges of two maps cannot deadlock */
+    if ((uintptr_t)dst < (uintptr_t)src) {
+        stem_lock_map(dst);
+        stem_lock_map_shared(src);
+    } else {
+        stem_lock_map_shared(src);
+        stem_lock_map(dst);
+    }
+    
+    /* Only src is unpacked, so the cost does not depend on the size of dst */
+    StemEntryArrays arrays;
+    StemError err = stem_entries_gather(src, &arrays);
+    if (err == STEM_SUCCESS) {
+        err = stem_merge_entries(dst, &arrays, overwrite);
+        stem_entries_free(src, &arrays);
+    }
+    
+    stem_unlock_map_shared(src);
+    stem_unlock_map(dst);
+    return err;
+}
+
+/**
+ * @brief Looks up an entry of any map, including frozen ones
+ * 
+ * @param map Map to search (shared lock held by the caller)
+ * @param enum_value Enum value to find
+ * @param view Storage for the entry view of a frozen slot
+ * @return const EnumEntry* Entry of the value, or NULL if not associated
+ */
+static const EnumEntry* stem_entry_view(const EnumMap* map, int enum_value, EnumEntry* view) {
+    if (!map->frozen) {
+        return stem_find_entry(map, enum_value);
+    }
+    
+    size_t slot = stem_frozen_find(map->frozen, enum_value);
+    if (slot == map->frozen->count) {
+        return NULL;
+    }
+    memset(view, 0, sizeof(EnumEntry));
+    view->enum_value = enum_value;
+    view->name = (char*)stem_frozen_name(map->frozen, slot);
+    view->value = stem_frozen_value(map->frozen, slot);
+    return view;
+}
+
+/**
+ * @brief Tells whether two entries of maps with the same value size differ
+ * 
+ * @param value_size Value size of both maps
+ * @param a First entry
+ * @param b Second entry
+ * @return bool True if the values or the names differ
+ */
+static bool stem_entries_differ(size_t value_size, const EnumEntry* a, const EnumEntry* b) {
+    if (value_size == 0 ? a->value != b->value : 
+        (!a->value != !b->value || (a->value && memcmp(a->value, b->value, value_size) != 0))) {
+        return true;
+    }
+    if (!a->name || !b->name) {
+        return a->name != b->name;
+    }
+    return a->name != b->name && strcmp(a->name, b->name) != 0;
+}
+
+/**
+ * @brief Computes the changes turning one map into another
+ * 
+ * A first pass sizes the patch, a second one fills it. Entries of to that
+ * are missing from from or differ become set operations, entries only in
+ * from become removals, which come first.
+ * 
+ * @param from Map the patch applies to
+ * @param to Map the patch produces
+ * @param error Optional error code output
+ * @return StemPatch* New patch, or NULL on failure
+ */
+StemPatch* stdem_diff(const EnumMap* from, const EnumMap* to, StemError* error) {
+    if (!from || !to || from->value_size != to->value_size) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    stem_lock_map_shared(from);
+    stem_lock_map_shared(to);
+    
+    size_t value_size = to->value_size;
+    size_t stride = value_size > 0 ? value_size : sizeof(void*);
+    size_t removals = 0;
+    size_t sets = 0;
+    size_t named = 0;
+    size_t names_size = 0;
+    StemCursor cursor;
+    EnumEntry* entry;
+    EnumEntry view;
+    
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(from, &cursor)) != NULL) {
+        removals += stem_entry_view(to, entry->enum_value, &view) == NULL;
+    }
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(to, &cursor)) != NULL) {
+        const EnumEntry* old = stem_entry_view(from, entry->enum_value, &view);
+        if (!old || stem_entries_differ(value_size, old, entry)) {
+            sets++;
+            if (entry->name) {
+                named++;
+                names_size += strlen(entry->name) + 1;
+            }
+        }
+    }
+    
+    /* One allocation: header, operations, values, names */
+    size_t count = removals + sets;
+    size_t ops_offset = STEM_ALIGN_UP(sizeof(StemPatch));
+    size_t values_offset = ops_offset + STEM_ALIGN_UP(count * sizeof(StemPatchOp));
+    size_t names_offset = values_offset + STEM_ALIGN_UP(count * stride);
+    size_t size = names_offset + names_size;
+    StemPatch* patch = to->allocator.allocate(size, to->allocator.user_data);
+    
+    if (patch) {
+        unsigned char* base = (unsigned char*)patch;
+        memset(patch, 0, size);
+        patch->allocator = to->allocator;
+        patch->size = size;
+        patch->value_size = value_size;
+        patch->inserts_max = sets;
+        patch->named = named;
+        patch->names_size = names_size;
+        patch->ops = (StemPatchOp*)(base + ops_offset);
+        patch->values = base + values_offset;
+        patch->names = (char*)(base + names_offset);
+        
+        size_t name_used = 0;
+        stem_cursor_init(&cursor);
+        while ((entry = stem_cursor_next(from, &cursor)) != NULL) {
+            if (!stem_entry_view(to, entry->enum_value, &view)) {
+                StemPatchOp* op = &patch->ops[patch->count++];
+                op->enum_value = entry->enum_value;
+                op->kind = STEM_PATCH_REMOVE;
+                op->name = STEM_PATCH_NO_NAME;
+            }
+        }
+        stem_cursor_init(&cursor);
+        while ((entry = stem_cursor_next(to, &cursor)) != NULL) {
+            const EnumEntry* old = stem_entry_view(from, entry->enum_value, &view);
+            if (old && !stem_entries_differ(value_size, old, entry)) {
+                continue;
+            }
+            
+            size_t i = patch->count++;
+            StemPatchOp* op = &patch->ops[i];
+            op->enum_value = entry->enum_value;
+            op->name = STEM_PATCH_NO_NAME;
+            if (value_size == 0) {
+                memcpy(patch->values + i * stride, &entry->value, sizeof(void*));
+                op->kind = STEM_PATCH_VALUE;
+            } else if (entry->value) {
+                memcpy(patch->values + i * stride, entry->value, value_size);
+                op->kind = STEM_PATCH_VALUE;
+            }
+            if (entry->name) {
+                size_t len = strlen(entry->name);
+                memcpy(patch->names + name_used, entry->name, len + 1);
+                op->name = name_used;
+                name_used += len + 1;
+            }
+        }
+    }
+    
+    stem_unlock_map_shared(to);
+    stem_unlock_map_shared(from);
+    
+    if (error) {
+        *error = patch ? STEM_SUCCESS : STEM_ERROR_OUT_OF_MEMORY;
+    }
+    return patch;
+}
+
+/**
+ * @brief Applies a patch computed by stdem_diff() to a map
+ * 
+ * Every structure the patch may grow is reserved first, so running out of
+ * memory normally fails the call before anything changed.
+ * 
+ * @param map Enum map to modify, with the value size of the patch
+ * @param patch Patch to apply
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_apply_patch(EnumMap* map, const StemPatch* patch) {
+    if (!map || !patch || map->value_size != patch->value_size || !stem_is_mutable(map)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map(map);
+    
+    size_t stride = patch->value_size > 0 ? patch->value_size : sizeof(void*);
+    size_t arena_bytes = 0;
+    if (!map->slots) {
+        arena_bytes = patch->inserts_max * STEM_ALIGN_UP(sizeof(EnumEntry));
+        if (patch->value_size > 0) {
+            arena_bytes += patch->inserts_max * STEM_ALIGN_UP(patch->value_size);
+        }
+    }
+    
+    StemError error = stem_reserve_entries(map, patch->inserts_max);
+    if (error == STEM_SUCCESS && map->pool && patch->named > 0) {
+        error = stem_name_index_reserve(map, patch->named);
+    }
+    if (error == STEM_SUCCESS) {
+        error = stem_arena_reserve(&map->allocator, &map->arena, arena_bytes);
+    }
+    if (error == STEM_SUCCESS && map->pool && patch->named > 0) {
+        stem_spin_lock(&map->pool->lock);
+        error = stem_pool_reserve(map->pool, patch->named, patch->names_size + 
+                                  patch->named * (STEM_POOL_PREFIX + STEM_ALIGNMENT));
+        stem_spin_unlock(&map->pool->lock);
+    }
+    
+    for (size_t i = 0; error == STEM_SUCCESS && i < patch->count; i++) {
+        const StemPatchOp* op = &patch->ops[i];
+        if (op->kind & STEM_PATCH_REMOVE) {
+            error = stem_remove_entry(map, op->enum_value);
+            if (error == STEM_ERROR_NOT_FOUND) {
+                error = STEM_SUCCESS;
+            }
+            continue;
+        }
+        
+        const void* value = NULL;
+        if (op->kind & STEM_PATCH_VALUE) {
+            value = patch->values + i * stride;
+            if (patch->value_size == 0) {
+                memcpy(&value, patch->values + i * stride, sizeof(void*));
+            }
+        }
+        const char* name = op->name == STEM_PATCH_NO_NAME ? NULL : patch->names + op->name;
+        
+        EnumEntry* entry = stem_find_entry(map, op->enum_value);
+        if (!entry) {
+            error = stem_insert_named(map, op->enum_value, value, name);
+            continue;
+        }
+        if (patch->value_size == 0 || value) {
+            error = stem_update_entry(map, entry, value);
+        }
+        if (error == STEM_SUCCESS) {
+            error = stem_set_entry_name(map, entry, name);
+        }
+    }
+    
+    stem_unlock_map(map);
+    return error;
+}
+
+/**
+ * @brief Returns the number of changes in a patch
+ * 
+ * @param patch Patch to inspect
+ * @return size_t Number of set and remove operations, 0 for NULL
+ */
+size_t stdem_patch_count(const StemPatch* patch) {
+    return patch ? patch->count : 0;
+}
+
+/**
+ * @brief Releases a patch
+ * 
+ * @param patch Patch to destroy (NULL is ignored)
+ */
+void stdem_patch_destroy(StemPatch* patch) {
+    if (patch) {
+        StemAllocator allocator = patch->allocator;
+        if (allocator.deallocate) {
+            allocator.deallocate(patch, patch->size, allocator.user_data);
+        }
+    }
+}
+
+/**
+ * @brief Tells whether a named entry is the one its name resolves to
+ * 
+ * @param map Map the entry belongs to
+ * @param entry Entry with a name
+ * @return bool True if stdem_find_by_name() returns this entry's value
+ */
+static bool stem_owns_name(const EnumMap* map, const EnumEntry* entry) {
+    if (map->frozen) {
+        const StemFrozen* frozen = map->frozen;
+        size_t slot = stem_frozen_find_name(frozen, entry->name, stem_name_length(entry->name));
+        return slot < frozen->count && 
+               stem_frozen_record(frozen, slot)->enum_value == entry->enum_value;
+    }
+    
+    const StemNameSlot* slot = stem_name_lookup(map, entry->name, 
+                                                stem_name_length(entry->name), 
+                                                stem_pool_hash(entry->name));
+    return slot && slot->enum_value == entry->enum_value;
+}
+
+/**
+ * @brief Computes the layout of the frozen block of a map
+ * 
+ * @param map Map to freeze (shared lock held by the caller)
+ * @param layout Output block header
+ * @return StemError STEM_ERROR_INVALID_ARG if the map is too large to freeze
+ */
+static StemError stem_freeze_layout(const EnumMap* map, StemFrozen* layout) {
+    /* Slots are addressed by int32_t seeds, which bounds the entry count */
+    size_t n = map->count;
+    if (n > INT32_MAX) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    /* Count the names and the distinct names they resolve to */
+    size_t name_count = 0;
+    size_t strings_size = 0;
+    StemCursor cursor;
+    EnumEntry* entry;
+    stem_cursor_init(&cursor);
+    while ((entry = stem_cursor_next(map, &cursor)) != NULL) {
+        if (entry->name) {
+            strings_size += STEM_NAME_PREFIX + stem_name_length(entry->name) + 1;
+            name_count += stem_owns_name(map, entry);
+        }
+    }
+    
+    if (strings_size >= STEM_FROZEN_NO_NAME) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    /* Records keep their values 8-byte aligned */
+    size_t value_stride = map->value_size > 0 ? map->value_size : sizeof(void*);
+    size_t record_size = sizeof(StemFrozenRecord) + ((value_stride + 7) & ~(size_t)7);
+    size_t offset = STEM_ALIGN_UP(sizeof(StemFrozen));
+    memset(layout, 0, sizeof(StemFrozen));
+    layout->count = (uint32_t)n;
+    layout->name_count = (uint32_t)name_count;
+    layout->value_size = map->value_size;
+    layout->record_size = record_size;
+    layout->key_seeds = offset;
+    offset += n * sizeof(int32_t);
+    layout->name_seeds = offset;
+    offset += name_count * sizeof(int32_t);
+    layout->name_slots = offset;
+    offset += name_count * sizeof(uint32_t);
+    offset = STEM_ALIGN_UP(offset);
+    layout->records = offset;
+    offset += n * record_size;
+    layout->strings = offset;
+    offset += strings_size;
+    layout->size = STEM_ALIGN_UP(offset);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Builds the frozen block of a map
+ * 
+ * @param map Map to freeze (shared lock held since stem_freeze_layout())
+ * @param layout Layout computed by stem_freeze_layout()
+ * @param frozen Zero-initialized, 8-byte aligned memory of layout->size bytes
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_freeze_build(const EnumMap* map, const StemFrozen* layout, 
+                                   StemFrozen* frozen) {
+    size_t n = layout->count;
+    size_t alloc_n = n ? n : 1;
+    int* keys = stem_calloc(map, alloc_n, sizeof(int));
+    EnumEntry* views = stem_calloc(map, alloc_n, sizeof(EnumEntry));
+    const char** names = stem_calloc(map, alloc_n, sizeof(char*));
+    uint32_t* name_entry = stem_calloc(map, alloc_n, sizeof(uint32_t));
+    uint32_t* slot_of = stem_calloc(map, alloc_n, sizeof(uint32_t));
+    uint32_t* name_slot_of = stem_calloc(map, alloc_n, sizeof(uint32_t));
+    StemError err = STEM_SUCCESS;
+    
+    if (!keys || !views || !names || !name_entry || !slot_of || !name_slot_of) {
+        err = STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    /* Gather the entries and the names they own */
+    size_t name_count = 0;
+    StemCursor cursor;
+    EnumEntry* entry;
+    stem_cursor_init(&cursor);
+    for (size_t i = 0; err == STEM_SUCCESS && (entry = stem_cursor_next(map, &cursor)) != NULL; i++) {
+        /* Frozen cursors reuse one view, so keep a copy of each entry */
+        views[i] = *entry;
+        keys[i] = entry->enum_value;
+        if (entry->name && stem_owns_name(map, entry)) {
+            names[name_count] = entry->name;
+            name_entry[name_count++] = (uint32_t)i;
+        }
+    }
+    
+    if (err == STEM_SUCCESS) {
+        StemPerfectKeys perfect = { keys, NULL };
+        *frozen = *layout;
+        err = stem_perfect_build(map, &perfect, n, 
+                                 (int32_t*)((unsigned char*)frozen + frozen->key_seeds), slot_of);
+    }
+    
+    if (err == STEM_SUCCESS) {
+        StemPerfectKeys perfect = { NULL, names };
+        err = stem_perfect_build(map, &perfect, name_count, 
+                                 (int32_t*)((unsigned char*)frozen + frozen->name_seeds), name_slot_of);
+    }
+    
+    if (err == STEM_SUCCESS) {
+        unsigned char* base = (unsigned char*)frozen;
+        uint32_t* name_slots = (uint32_t*)(base + frozen->name_slots);
+        char* strings = (char*)(base + frozen->strings);
+        size_t record_size = (size_t)frozen->record_size;
+        size_t string_offset = 0;
+        
+        for (size_t i = 0; i < n; i++) {
+            StemFrozenRecord* record = (StemFrozenRecord*)(base + frozen->records + 
+                                                           slot_of[i] * record_size);
+            record->enum_value = keys[i];
+            
+            if (map->value_size > 0) {
+                if (views[i].value) {
+                    memcpy(record + 1, views[i].value, map->value_size);
+                }
+            } else {
+                memcpy(record + 1, &views[i].value, sizeof(void*));
+            }
+            
+            record->name = STEM_FROZEN_NO_NAME;
+            if (views[i].name) {
+                size_t len = STEM_NAME_PREFIX + stem_name_length(views[i].name) + 1;
+                memcpy(strings + string_offset, views[i].name - STEM_NAME_PREFIX, len);
+                record->name = (uint32_t)(string_offset + STEM_NAME_PREFIX);
+                string_offset += len;
+            }
+        }
+        
+        for (size_t j = 0; j < name_count; j++) {
+            name_slots[name_slot_of[j]] = slot_of[name_entry[j]];
+        }
+    }
+    
+    stem_free(map, name_slot_of, alloc_n * sizeof(uint32_t));
+    stem_free(map, slot_of, alloc_n * sizeof(uint32_t));
+    stem_free(map, name_entry, alloc_n * sizeof(uint32_t));
+    stem_free(map, names, alloc_n * sizeof(char*));
+    stem_free(map, views, alloc_n * sizeof(EnumEntry));
+    stem_free(map, keys, alloc_n * sizeof(int));
+    return err;
+}
+
+/**
+ * @brief Compiles a map into an immutable perfect-hash map
+ * 
+ * @param map Enum map to compile
+ * @param error Optional error code output
+ * @return EnumMap* New read-only map, or NULL on failure
+ */
+EnumMap* stdem_freeze(const EnumMap* map, StemError* error) {
+    if (!map) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    EnumMap* new_map = map->allocator.allocate(sizeof(EnumMap), map->allocator.user_data);
+    if (!new_map) {
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
+        }
+        return NULL;
+    }
+    
+    memset(new_map, 0, sizeof(EnumMap));
+    new_map->value_size = map->value_size;
+    new_map->flags = map->flags | STEM_FLAGS_READONLY;
+    new_map->allocator = map->allocator;
+    new_map->max_load = map->max_load;
+    
+    stem_lock_map_shared(map);
+    
+    StemFrozen layout;
+    StemFrozen* frozen = NULL;
+    StemError err = stem_freeze_layout(map, &layout);
+    if (err == STEM_SUCCESS) {
+        frozen = stem_calloc(new_map, 1, (size_t)layout.size);
+        if (!frozen) {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    if (err == STEM_SUCCESS) {
+        err = stem_freeze_build(map, &layout, frozen);
+    }
+    
+    stem_unlock_map_shared(map);
+    
+    if (err != STEM_SUCCESS) {
+        if (frozen) {
+            stem_free(new_map, frozen, (size_t)layout.size);
+        }
+        stem_free(new_map, new_map, sizeof(EnumMap));
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+    
+    new_map->frozen = frozen;
+    new_map->count = layout.count;
+    
+    err = stem_order_freeze(new_map);
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(new_map);
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return new_map;
+}
+
+/* ==================== NUMA REPLICAS ==================== */
+
+/**
+ * @brief Returns the frozen block lookups of the calling thread should read
+ * 
+ * @param map Frozen map
+ * @return const StemFrozen* Replica of the thread's NUMA node, or the block itself
+ */
+static const StemFrozen* stem_frozen_local(const EnumMap* map) {
+#if STEM_HAVE_NUMA
+    if (map->replicas) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && (size_t)cpu < map->cpu_count) {
+            return map->replicas[map->cpu_node[cpu]];
+        }
+    }
+#endif
+    return map->frozen;
+}
+
+#if STEM_HAVE_NUMA
+#define STEM_MPOL_PREFERRED 1 /**< mbind() mode placing pages on a node while it has room */
+
+/**
+ * @brief Reads a sysfs id list such as "0-3,8" into a membership array
+ * 
+ * @param path File holding the list
+ * @param members Set to 1 for every listed id below max, 0 otherwise
+ * @param max Number of entries of members
+ * @return size_t Highest listed id below max plus one, 0 if unreadable
+ */
+static size_t stem_read_id_list(const char* path, unsigned char* members, size_t max) {
+    memset(members, 0, max);
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+    
+    size_t end = 0;
+    unsigned long lo;
+    while (fscanf(file, "%lu", &lo) == 1) {
+        unsigned long hi = lo;
+        int c = fgetc(file);
+        if (c == '-') {
+            if (fscanf(file, "%lu", &hi) != 1) {
+                break;
+            }
+            c = fgetc(file);
+        }
+        for (unsigned long id = lo; id <= hi && id < max; id++) {
+            members[id] = 1;
+            end = (size_t)id + 1;
+        }
+        if (c != ',') {
+            break;
+        }
+    }
+    fclose(file);
+    return end;
+}
+
+/**
+ * @brief Copies the frozen block of a map to every other NUMA node
+ * 
+ * Each copy is mapped, bound to its node before the first write, filled
+ * and made read-only. Machines with a single node get no replicas.
+ * 
+ * @param map Frozen map, not shared yet
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_numa_replicate(EnumMap* map) {
+    unsigned char nodes[STEM_MAX_NODES];
+    size_t node_count = stem_read_id_list("/sys/devices/system/node/online", 
+                                          nodes, STEM_MAX_NODES);
+    size_t online = 0;
+    for (size_t n = 0; n < node_count; n++) {
+        online += nodes[n];
+    }
+    if (online < 2) {
+        return STEM_SUCCESS;
+    }
+    
+    unsigned char* cpus = stem_calloc(map, STEM_MAX_CPUS, 1);
+    map->cpu_node = stem_calloc(map, STEM_MAX_CPUS, 1);
+    map->cpu_count = STEM_MAX_CPUS;
+    map->replicas = stem_calloc(map, node_count, sizeof(StemFrozen*));
+    map->node_count = node_count;
+    if (!cpus || !map->cpu_node || !map->replicas) {
+        stem_free(map, cpus, STEM_MAX_CPUS);
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    for (size_t n = 0; n < node_count; n++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", (unsigned int)n);
+        size_t cpu_end = nodes[n] ? stem_read_id_list(path, cpus, STEM_MAX_CPUS) : 0;
+        for (size_t cpu = 0; cpu < cpu_end; cpu++) {
+            if (cpus[cpu]) {
+                map->cpu_node[cpu] = (unsigned char)n;
+            }
+        }
+    }
+    stem_free(map, cpus, STEM_MAX_CPUS);
+    
+    /* The block was just written by this thread, so it already sits on its node */
+    int cpu = sched_getcpu();
+    size_t home = cpu >= 0 && cpu < STEM_MAX_CPUS ? map->cpu_node[cpu] : 0;
+    size_t size = (size_t)map->frozen->size;
+    bool huge = (map->flags & (STEM_FLAGS_HUGE_PAGES | STEM_FLAGS_HUGE_PAGES_EXPLICIT)) != 0;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    map->replica_bytes = huge ? stem_huge_length(size) : (size + page - 1) / page * page;
+    
+    const size_t bits = 8 * sizeof(unsigned long);
+    for (size_t n = 0; n < node_count; n++) {
+        map->replicas[n] = map->frozen;
+        if (!nodes[n] || n == home) {
+            continue;
+        }
+        
+        void* block = mmap(NULL, map->replica_bytes, PROT_READ | PROT_WRITE, 
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) {
+            map->replicas[n] = NULL;
+            return STEM_ERROR_OUT_OF_MEMORY;
+        }
+        
+        /* Placement fails harmlessly on kernels without NUMA support */
+        unsigned long mask[STEM_MAX_NODES / (8 * sizeof(unsigned long))] = { 0 };
+        mask[n / bits] |= 1UL << (n % bits);
+        syscall(SYS_mbind, block, map->replica_bytes, STEM_MPOL_PREFERRED, mask, 
+                (unsigned long)STEM_MAX_NODES + 1, 0UL);
+        if (huge) {
+            madvise(block, map->replica_bytes, MADV_HUGEPAGE);
+        }
+        memcpy(block, map->frozen, size);
+        mprotect(block, map->replica_bytes, PROT_READ);
+        map->replicas[n] = block;
+    }
+    return STEM_SUCCESS;
+}
+#endif
+
+/**
+ * @brief Compiles a map into a frozen map replicated on every NUMA node
+ * 
+ * @param map Enum map to compile
+ * @param error Optional error code output
+ * @return EnumMap* New read-only map, or NULL on failure
+ */
+EnumMap* stdem_freeze_replicated(const EnumMap* map, StemError* error) {
+    EnumMap* frozen = stdem_freeze(map, error);
+    if (!frozen) {
+        return NULL;
+    }
+    
+#if STEM_HAVE_NUMA
+    StemError err = stem_numa_replicate(frozen);
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(frozen);
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+#endif
+    return frozen;
+}
+
+/* ==================== PARALLEL OPERATIONS ==================== */
+
+#if STEM_HAVE_THREADS
+/**
+ * @brief Tasks of one stdem_thread_executor() batch, claimed by index
+ */
+typedef struct {
+    StemTask task;          /**< Task to run */
+    void* context;          /**< Context passed to every call */
+    size_t count;           /**< Number of task indices */
+    size_t next;            /**< Next index to claim */
+} StemThreadBatch;
+
+/**
+ * @brief Runs batch tasks until every index has been claimed
+ */
+static void* stem_thread_main(void* arg) {
+    StemThreadBatch* batch = arg;
+    size_t i;
+    while ((i = STEM_ATOMIC_ADD(&batch->next, 1) - 1) < batch->count) {
+        batch->task(i, batch->context);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run hook of the built-in executor
+ * 
+ * Starts a thread per task but the first, which runs on the calling
+ * thread. Tasks are claimed from a shared counter, so a thread that fails
+ * to start only leaves more work to the others.
+ */
+static void stem_thread_run(StemTask task, void* context, size_t count, void* user_data) {
+    (void)user_data; /* Unused parameter */
+    StemThreadBatch batch = { task, context, count, 0 };
+    pthread_t threads[STEM_MAX_THREADS];
+    size_t started = 0;
+    
+    while (started + 1 < count && started < STEM_MAX_THREADS && 
+           pthread_create(&threads[started], NULL, stem_thread_main, &batch) == 0) {
+        started++;
+    }
+    stem_thread_main(&batch);
+    
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+#endif
+
+/**
+ * @brief Work shared by the tasks of a parallel operation
+ * 
+ * Positions number the storage of the source map in stdem_foreach()
+ * order: the frozen records, or the dense slots followed by the
+ * open-addressing slots and the buckets. Task i handles the i-th of parts
+ * ranges of (nearly) equal length.
+ */
+typedef struct {
+    const EnumMap* map;         /**< Map being read */
+    EnumMap* target;            /**< Copy being built, NULL when iterating */
+    EnumMapIterator iterator;   /**< Callback of stdem_foreach_parallel() */
+    void* user_data;            /**< User context passed to the iterator */
+    size_t parts;               /**< Number of ranges */
+    size_t* offsets;            /**< Chained entries per range, then the index of its first one */
+    unsigned char* block;       /**< Chained entries of the copy, entry_size bytes apart */
+} StemParallelJob;
+
+/**
+ * @brief Returns the number of storage positions of a map
+ */
+static size_t stem_parallel_span(const EnumMap* map) {
+    return map->frozen ? map->frozen->count : 
+           map->dense_size + map->num_slots + stem_bucket_span(map);
+}
+
+/**
+ * @brief Returns how many ranges a map is split into on an executor
+ */
+static size_t stem_parallel_parts(const EnumMap* map, const StemExecutor* executor) {
+    size_t parts = (executor && executor->run && executor->workers > 1) ? executor->workers : 1;
+    size_t span = stem_parallel_span(map);
+    return parts < span ? parts : (span ? span : 1);
+}
+
+/**
+ * @brief Computes the positions [begin, end) of one range
+ */
+static void stem_parallel_range(const StemParallelJob* job, size_t part, 
+                                size_t* begin, size_t* end) {
+    size_t span = stem_parallel_span(job->map);
+    size_t step = span / job->parts;
+    size_t extra = span % job->parts;
+    *begin = part * step + (part < extra ? part : extra);
+    *end = *begin + step + (part < extra ? 1 : 0);
+}
+
+/**
+ * @brief Runs one task per range, on the executor when there are several
+ */
+static void stem_parallel_run(const StemExecutor* executor, StemTask task, StemParallelJob* job) {
+    if (job->parts > 1) {
+        executor->run(task, job, job->parts, executor->user_data);
+    } else {
+        task(0, job);
+    }
+}
+
+/**
+ * @brief Calls the iterator of stdem_foreach_parallel() on one range
+ */
+static void stem_foreach_task(size_t part, void* context) {
+    const StemParallelJob* job = context;
+    const EnumMap* map = job->map;
+    size_t begin, end;
+    stem_parallel_range(job, part, &begin, &end);
+    
+    if (map->frozen) {
+        for (size_t i = begin; i < end; i++) {
+            job->iterator(stem_frozen_record(map->frozen, i)->enum_value, 
+                          stem_frozen_name(map->frozen, i), stem_frozen_value(map->frozen, i), 
+                          map->value_size, job->user_data);
+        }
+        return;
+    }
+    
+    size_t slots_start = map->dense_size;
+    size_t buckets_start = slots_start + map->num_slots;
+    for (size_t i = begin; i < end && i < slots_start; i++) {
+        if (map->dense_used[i]) {
+            const EnumEntry* entry = stem_dense_entry(map, i);
+            job->iterator(entry->enum_value, entry->name, entry->value, 
+                          map->value_size, job->user_data);
+        }
+    }
+    for (size_t i = begin > slots_start ? begin : slots_start; i < end && i < buckets_start; i++) {
+        if (map->slot_used[i - slots_start]) {
+            const EnumEntry* entry = stem_slot_entry(map, i - slots_start);
+            job->iterator(entry->enum_value, entry->name, entry->value, 
+                          map->value_size, job->user_data);
+        }
+    }
+    for (size_t i = begin > buckets_start ? begin : buckets_start; i < end; i++) {
+        for (const EnumEntry* entry = *stem_bucket_at(map, i - buckets_start); entry; entry = entry->next) {
+            job->iterator(entry->enum_value, entry->name, entry->value, 
+                          map->value_size, job->user_data);
+        }
+    }
+}
+
+/**
+ * @brief Counts the chained entries of one range of the source map
+ */
+static void stem_count_task(size_t part, void* context) {
+    StemParallelJob* job = context;
+    const EnumMap* map = job->map;
+    size_t begin, end;
+    stem_parallel_range(job, part, &begin, &end);
+    
+    size_t buckets_start = map->dense_size + map->num_slots;
+    size_t count = 0;
+    for (size_t i = begin > buckets_start ? begin : buckets_start; i < end; i++) {
+        for (const EnumEntry* entry = *stem_bucket_at(map, i - buckets_start); entry; entry = entry->next) {
+            count++;
+        }
+    }
+    job->offsets[part] = count;
+}
+
+/**
+ * @brief Copies slots [begin, end) of a flat array into the same slots of the copy
+ * 
+ * The slots are copied as one block, then the value pointers of the
+ * occupied ones are moved to the copy's inline values.
+ */
+static void stem_copy_flat(const EnumMap* map, unsigned char* entries, unsigned char* used, 
+                           const unsigned char* source, const unsigned char* source_used, 
+                           size_t begin, size_t end) {
+    /* Maps without the array pass NULL with an empty range */
+    if (begin == end) {
+        return;
+    }
+    size_t entry_size = map->entry_size;
+    memcpy(entries + begin * entry_size, source + begin * entry_size, (end - begin) * entry_size);
+    memcpy(used + begin, source_used + begin, end - begin);
+    
+    if (map->value_size > 0) {
+        for (size_t i = begin; i < end; i++) {
+            EnumEntry* entry = (EnumEntry*)(entries + i * entry_size);
+            if (used[i] && entry->value) {
+                entry->value = stem_entry_inline(entry);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Copies one range of the source map into the same range of the copy
+ * 
+ * Chained entries go to the part of the shared block reserved for the
+ * range by stem_count_task(), in chain order.
+ */
+static void stem_copy_task(size_t part, void* context) {
+    StemParallelJob* job = context;
+    const EnumMap* map = job->map;
+    EnumMap* copy = job->target;
+    size_t begin, end;
+    stem_parallel_range(job, part, &begin, &end);
+    
+    size_t slots_start = map->dense_size;
+    size_t buckets_start = slots_start + map->num_slots;
+    if (begin < slots_start) {
+        stem_copy_flat(map, copy->dense, copy->dense_used, map->dense, map->dense_used, 
+                       begin, end < slots_start ? end : slots_start);
+    }
+    if (begin < buckets_start && end > slots_start) {
+        size_t first = begin > slots_start ? begin - slots_start : 0;
+        size_t last = (end < buckets_start ? end : buckets_start) - slots_start;
+        stem_copy_flat(map, copy->slots, copy->slot_used, map->slots, map->slot_used, 
+                       first, last);
+    }
+    
+    unsigned char* next = job->block ? job->block + job->offsets[part] * map->entry_size : NULL;
+    for (size_t i = begin > buckets_start ? begin : buckets_start; i < end; i++) {
+        EnumEntry** tail = stem_bucket_at(copy, i - buckets_start);
+        for (const EnumEntry* entry = *stem_bucket_at(map, i - buckets_start); entry; entry = entry->next) {
+            EnumEntry* clone = (EnumEntry*)next;
+            next += map->entry_size;
             
-            entry = next;
+            memcpy(clone, entry, sizeof(EnumEntry));
+            clone->next = NULL;
+            if (map->value_size > 0 && entry->value) {
+                clone->value = stem_entry_inline(clone);
+                memcpy(clone->value, entry->value, map->value_size);
+            }
+            *tail = clone;
+            tail = &clone->next;
+        }
+    }
+}
+
+/**
+ * @brief Builds a copy with the table sizes of a mutable map, range by range
+ * 
+ * The copy shares the source's name pool and gets a verbatim copy of its
+ * name index, so names are neither copied nor rehashed.
+ * 
+ * @param map Map to copy (shared lock held by the caller, not frozen)
+ * @param flags Flags of the copy, with the storage flags of the source
+ * @param executor Executor running the ranges, or NULL
+ * @param error Optional error code output
+ * @return EnumMap* New map, or NULL on failure
+ */
+static EnumMap* stem_copy_mirrored(const EnumMap* map, StemFlags flags, 
+                                   const StemExecutor* executor, StemError* error) {
+    /* A dense copy gets the same direct-indexed range from its capacity */
+    EnumMap* copy = stem_create_map(map->dense_size ? map->dense_size : 1, map->value_size, 
+                                    flags, &map->allocator, map->pool, error);
+    if (!copy) {
+        return NULL;
+    }
+    
+    StemError err = STEM_SUCCESS;
+    copy->max_load = map->max_load;
+    if (map->slots) {
+        stem_free(copy, copy->slot_used, copy->num_slots);
+        stem_free(copy, copy->slots, copy->num_slots * copy->entry_size);
+        copy->slots = NULL;
+        copy->slot_used = NULL;
+        copy->num_slots = 0;
+        err = stem_alloc_slots(copy, map->num_slots);
+    } else {
+        stem_free(copy, copy->buckets, copy->num_buckets * sizeof(EnumEntry*));
+        copy->buckets = NULL;
+        copy->num_buckets = 0;
+        err = stem_alloc_buckets(copy, map->num_buckets);
+        
+        /* A resize in progress is mirrored too, bucket for bucket */
+        if (err == STEM_SUCCESS && map->old_buckets) {
+            copy->old_buckets = stem_calloc(copy, map->old_num_buckets, sizeof(EnumEntry*));
+            if (copy->old_buckets) {
+                copy->old_num_buckets = map->old_num_buckets;
+                copy->old_shift = map->old_shift;
+                copy->rehash_pos = map->rehash_pos;
+            } else {
+                err = STEM_ERROR_OUT_OF_MEMORY;
+            }
+        }
+    }
+    
+    if (err == STEM_SUCCESS && map->names && copy->pool) {
+        copy->names = stem_calloc(copy, map->num_names, sizeof(StemNameSlot));
+        if (copy->names) {
+            memcpy(copy->names, map->names, map->num_names * sizeof(StemNameSlot));
+            copy->num_names = map->num_names;
+            copy->names_count = map->names_count;
+        } else {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    if (err == STEM_SUCCESS && (copy->flags & STEM_FLAGS_ORDERED)) {
+        err = stem_order_copy(copy, map);
+    }
+    
+    StemParallelJob job;
+    memset(&job, 0, sizeof(job));
+    job.map = map;
+    job.target = copy;
+    job.parts = stem_parallel_parts(map, executor);
+    if (err == STEM_SUCCESS) {
+        job.offsets = stem_calloc(copy, job.parts, sizeof(size_t));
+        if (!job.offsets) {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    /* Size every range's share of one block for the chained entries */
+    if (err == STEM_SUCCESS && map->count > map->dense_count && map->buckets) {
+        stem_parallel_run(executor, stem_count_task, &job);
+        
+        size_t total = 0;
+        for (size_t i = 0; i < job.parts; i++) {
+            size_t count = job.offsets[i];
+            job.offsets[i] = total;
+            total += count;
+        }
+        
+        job.block = stem_arena_alloc(&copy->allocator, &copy->arena, total * map->entry_size);
+        if (!job.block) {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    if (err == STEM_SUCCESS) {
+        stem_parallel_run(executor, stem_copy_task, &job);
+        copy->count = map->count;
+        copy->dense_count = map->dense_count;
+    }
+    stem_free(copy, job.offsets, job.parts * sizeof(size_t));
+    
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(copy);
+        copy = NULL;
+    }
+    if (error) {
+        *error = err;
+    }
+    return copy;
+}
+
+/**
+ * @brief Returns the built-in executor
+ * 
+ * @param threads Number of threads, 0 for one per online CPU
+ * @return StemExecutor Executor starting a thread per task, or running
+ *         everything on the calling thread without POSIX threads
+ */
+StemExecutor stdem_thread_executor(size_t threads) {
+    StemExecutor executor = { NULL, 1, NULL };
+#if STEM_HAVE_THREADS
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (size_t)online : 1;
+    }
+    executor.run = stem_thread_run;
+    executor.workers = threads < STEM_MAX_THREADS ? threads : STEM_MAX_THREADS;
+#else
+    (void)threads; /* Unused parameter */
+#endif
+    return executor;
+}
+
+/**
+ * @brief Iterates over all entries on several threads
+ * 
+ * @param map Enum map to iterate over
+ * @param iterator Callback called for each entry, possibly concurrently
+ * @param user_data User context passed to the iterator
+ * @param executor Executor running the ranges, or NULL for the calling thread
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_foreach_parallel(const EnumMap* map, EnumMapIterator iterator, 
+                                 void* user_data, const StemExecutor* executor) {
+    if (!map || !iterator) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    StemParallelJob job;
+    memset(&job, 0, sizeof(job));
+    job.map = map;
+    job.iterator = iterator;
+    job.user_data = user_data;
+    job.parts = stem_parallel_parts(map, executor);
+    stem_parallel_run(executor, stem_foreach_task, &job);
+    
+    stem_unlock_map_shared(map);
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Creates a copy of an enum map, building it on several threads
+ * 
+ * @param map Enum map to copy
+ * @param executor Executor running the ranges, or NULL for the calling thread
+ * @param error Optional error code output
+ * @return EnumMap* New enum map with the same associations, or NULL on failure
+ */
+EnumMap* stdem_copy_parallel(const EnumMap* map, const StemExecutor* executor, 
+                             StemError* error) {
+    if (!map) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    if (map->frozen) {
+        return stdem_copy(map, error);
+    }
+    
+    stem_lock_map_shared(map);
+    EnumMap* copy = stem_copy_mirrored(map, map->flags, executor, error);
+    stem_unlock_map_shared(map);
+    return copy;
+}
+
+/**
+ * @brief Merges two enum maps, copying the first one on several threads
+ * 
+ * Falls back to stdem_merge() when the result cannot keep the storage of
+ * map1: map1 frozen, or map2 adding storage flags (including an ordered
+ * index) or a wider dense range.
+ * 
+ * @param map1 First enum map
+ * @param map2 Second enum map
+ * @param overwrite If true, entries from map2 overwrite those in map1
+ * @param executor Executor running the ranges, or NULL for the calling thread
+ * @param error Optional error code output
+ * @return EnumMap* New enum map containing merged associations, or NULL on failure
+ */
+EnumMap* stdem_merge_parallel(const EnumMap* map1, const EnumMap* map2, bool overwrite, 
+                              const StemExecutor* executor, StemError* error) {
+    if (!map1 || !map2 || map1->value_size != map2->value_size) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    StemFlags storage = STEM_FLAGS_DENSE | STEM_FLAGS_OPEN_ADDRESSING | STEM_FLAGS_NO_NAMES | 
+                        STEM_FLAGS_ORDERED;
+    if (map1->frozen || (map2->flags & ~map1->flags & storage) || 
+        map2->dense_size > map1->dense_size) {
+        return stdem_merge(map1, map2, overwrite, error);
+    }
+    
+    stem_lock_map_shared(map1);
+    stem_lock_map_shared(map2);
+    
+    StemError err;
+    EnumMap* new_map = stem_copy_mirrored(map1, map1->flags | map2->flags, executor, &err);
+    if (new_map) {
+        StemEntryArrays second;
+        err = stem_entries_gather(map2, &second);
+        if (err == STEM_SUCCESS) {
+            err = stem_merge_entries(new_map, &second, overwrite);
+            stem_entries_free(map2, &second);
+        }
+    }
+    
+    stem_unlock_map_shared(map2);
+    stem_unlock_map_shared(map1);
+    
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(new_map);
+        new_map = NULL;
+    }
+    if (error) {
+        *error = err;
+    }
+    return new_map;
+}
+
+/* ==================== SNAPSHOT PUBLISHING ==================== */
+
+/**
+ * @brief Frees retired maps that no reader can still be using
+ * 
+ * A retired map is unreachable for every read that started in its retire
+ * epoch or later, so it can go once all active readers announce at least
+ * that epoch. Must be called with the writer lock held.
+ * 
+ * @param snapshot Snapshot to reclaim from
+ * @return size_t Number of retired maps still waiting
+ */
+static size_t stem_snapshot_reclaim_locked(StemSnapshot* snapshot) {
+#if STEM_HAVE_ATOMICS
+    size_t min_epoch = (size_t)-1;
+    for (size_t i = 0; i < snapshot->max_readers; i++) {
+        size_t epoch = STEM_ATOMIC_LOAD_SEQ(&snapshot->readers[i].epoch);
+        if (epoch != 0 && epoch < min_epoch) {
+            min_epoch = epoch;
+        }
+    }
+    
+    size_t pending = 0;
+    StemRetiredMap** link = &snapshot->retired;
+    while (*link) {
+        StemRetiredMap* retired = *link;
+        if (retired->epoch <= min_epoch) {
+            *link = retired->next;
+            retired->map->published = 0;
+            stdem_destroy(retired->map);
+            free(retired);
+        } else {
+            pending++;
+            link = &retired->next;
+        }
+    }
+    return pending;
+#else
+    (void)snapshot; /* Unused parameter */
+    return 0;
+#endif
+}
+
+/**
+ * @brief Creates a snapshot holder publishing an initial map
+ * 
+ * @param initial Map to publish first; ownership passes to the snapshot
+ * @param max_readers Maximum number of concurrently registered readers
+ * @param error Optional error code output
+ * @return StemSnapshot* New snapshot holder, or NULL on failure
+ */
+StemSnapshot* stdem_snapshot_create(EnumMap* initial, size_t max_readers, 
+                                    StemError* error) {
+    if (!initial || max_readers == 0 || initial->published || !STEM_HAVE_ATOMICS) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    StemSnapshot* snapshot = calloc(1, sizeof(StemSnapshot));
+    void* block = NULL;
+    if (snapshot && max_readers < (size_t)-1 / sizeof(StemSnapshotReader) - 1) {
+        block = calloc(max_readers + 1, sizeof(StemSnapshotReader));
+    }
+    if (!snapshot || !block) {
+        free(block);
+        free(snapshot);
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
+        }
+        return NULL;
+    }
+    
+    /* Align the reader slots to a cache line boundary */
+    uintptr_t base = (uintptr_t)block;
+    base = (base + STEM_CACHE_LINE - 1) & ~(uintptr_t)(STEM_CACHE_LINE - 1);
+    snapshot->readers = (StemSnapshotReader*)base;
+    snapshot->readers_block = block;
+    snapshot->max_readers = max_readers;
+    snapshot->epoch = 1;
+    
+    initial->published = 1;
+    snapshot->current = initial;
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Destroys a snapshot holder, its current map and all retired maps
+ * 
+ * No reader may be inside a read section when this is called.
+ * 
+ * @param snapshot Snapshot to destroy
+ */
+void stdem_snapshot_destroy(StemSnapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    
+    while (snapshot->retired) {
+        StemRetiredMap* retired = snapshot->retired;
+        snapshot->retired = retired->next;
+        retired->map->published = 0;
+        stdem_destroy(retired->map);
+        free(retired);
+    }
+    
+    if (snapshot->current) {
+        snapshot->current->published = 0;
+        stdem_destroy(snapshot->current);
+    }
+    
+    free(snapshot->readers_block);
+    free(snapshot);
+}
+
+/**
+ * @brief Registers a reader thread with a snapshot
+ * 
+ * @param snapshot Snapshot to read from
+ * @param error Optional error code output
+ * @return StemSnapshotReader* Reader handle, or NULL if all slots are taken
+ */
+StemSnapshotReader* stdem_snapshot_register_reader(StemSnapshot* snapshot, 
+                                                   StemError* error) {
+    if (!snapshot) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+#if STEM_HAVE_ATOMICS
+    for (size_t i = 0; i < snapshot->max_readers; i++) {
+        StemSnapshotReader* reader = &snapshot->readers[i];
+        int expected = 0;
+        if (STEM_ATOMIC_CAS(&reader->in_use, &expected, 1)) {
+            reader->snapshot = snapshot;
+            STEM_ATOMIC_STORE_SEQ(&reader->epoch, 0);
+            if (error) {
+                *error = STEM_SUCCESS;
+            }
+            return reader;
+        }
+    }
+#endif
+    
+    if (error) {
+        *error = STEM_ERROR_INDEX_OUT_OF_BOUNDS;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Releases a reader slot
+ * 
+ * @param reader Reader handle, which must not be inside a read section
+ */
+void stdem_snapshot_unregister_reader(StemSnapshotReader* reader) {
+#if STEM_HAVE_ATOMICS
+    if (reader) {
+        STEM_ATOMIC_STORE_SEQ(&reader->epoch, 0);
+        STEM_ATOMIC_STORE(&reader->in_use, 0);
+    }
+#else
+    (void)reader; /* Unused parameter */
+#endif
+}
+
+/**
+ * @brief Enters a read section and returns the current map
+ * 
+ * Wait-free: announces the global epoch in the reader's own cache line and
+ * loads the current map. The map stays valid until stdem_snapshot_read_end().
+ * 
+ * @param reader Registered reader handle
+ * @return const EnumMap* Current published map
+ */
+const EnumMap* stdem_snapshot_read_begin(StemSnapshotReader* reader) {
+#if STEM_HAVE_ATOMICS
+    if (!reader) {
+        return NULL;
+    }
+    
+    StemSnapshot* snapshot = reader->snapshot;
+    STEM_ATOMIC_STORE_SEQ(&reader->epoch, STEM_ATOMIC_LOAD_SEQ(&snapshot->epoch));
+    return STEM_ATOMIC_LOAD_SEQ(&snapshot->current);
+#else
+    (void)reader; /* Unused parameter */
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Leaves a read section
+ * 
+ * @param reader Registered reader handle
+ */
+void stdem_snapshot_read_end(StemSnapshotReader* reader) {
+#if STEM_HAVE_ATOMICS
+    if (reader) {
+        STEM_ATOMIC_STORE(&reader->epoch, 0);
+    }
+#else
+    (void)reader; /* Unused parameter */
+#endif
+}
+
+/**
+ * @brief Atomically replaces the current map
+ * 
+ * The previous map is retired and destroyed once every read section that
+ * could have seen it has ended. Readers never block on a publish.
+ * 
+ * @param snapshot Snapshot to publish to
+ * @param map New map; ownership passes to the snapshot and it becomes immutable
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_snapshot_publish(StemSnapshot* snapshot, EnumMap* map) {
+    if (!snapshot || !map || map->published) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+#if STEM_HAVE_ATOMICS
+    StemRetiredMap* retired = malloc(sizeof(StemRetiredMap));
+    if (!retired) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    stem_spin_lock(&snapshot->writer_lock);
+    
+    /* Readers announcing the new epoch are guaranteed to load the new map */
+    map->published = 1;
+    retired->map = STEM_ATOMIC_EXCHANGE_SEQ(&snapshot->current, map);
+    retired->epoch = STEM_ATOMIC_ADD_SEQ(&snapshot->epoch, 1);
+    retired->next = snapshot->retired;
+    snapshot->retired = retired;
+    
+    stem_snapshot_reclaim_locked(snapshot);
+    
+    stem_spin_unlock(&snapshot->writer_lock);
+    return STEM_SUCCESS;
+#else
+    return STEM_ERROR_INVALID_ARG;
+#endif
+}
+
+/**
+ * @brief Frees retired maps whose readers have all left
+ * 
+ * @param snapshot Snapshot to reclaim from
+ * @return size_t Number of retired maps still waiting for readers
+ */
+size_t stdem_snapshot_reclaim(StemSnapshot* snapshot) {
+    if (!snapshot) {
+        return 0;
+    }
+    
+#if STEM_HAVE_ATOMICS
+    stem_spin_lock(&snapshot->writer_lock);
+    
+    size_t pending = stem_snapshot_reclaim_locked(snapshot);
+    
+    stem_spin_unlock(&snapshot->writer_lock);
+    return pending;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Creates a mutable copy of the current map for building an update
+ * 
+ * @param snapshot Snapshot to copy from
+ * @param error Optional error code output
+ * @return EnumMap* Mutable copy of the current map, or NULL on failure
+ */
+EnumMap* stdem_snapshot_copy_current(StemSnapshot* snapshot, StemError* error) {
+    if (!snapshot) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+#if STEM_HAVE_ATOMICS
+    /* Holding the writer lock keeps the current map from being retired */
+    stem_spin_lock(&snapshot->writer_lock);
+    
+    EnumMap* copy = stdem_copy(snapshot->current, error);
+    
+    stem_spin_unlock(&snapshot->writer_lock);
+    return copy;
+#else
+    if (error) {
+        *error = STEM_ERROR_INVALID_ARG;
+    }
+    return NULL;
+#endif
+}
+
+/* ==================== BACKGROUND LOADING ==================== */
+
+/**
+ * @brief Background load or rebuild of a snapshot's map
+ * 
+ * Referenced by the worker and by the caller until stdem_async_wait() or
+ * stdem_async_detach(); whichever lets go last frees it.
+ */
+struct StemAsync {
+    StemSnapshot* snapshot;      /**< Snapshot the new map is published to */
+    char* path;                  /**< Image file to load, NULL for a rebuild */
+    StemRebuildCallback rebuild; /**< Change applied to the copy of a rebuild */
+    StemAsyncCallback done;      /**< Completion callback, or NULL */
+    void* user_data;             /**< User context of both callbacks */
+    StemError result;            /**< Outcome, final once finished is set */
+    int finished;                /**< Set after the completion callback returned */
+    int refs;                    /**< References held by the worker and the caller */
+#if STEM_HAVE_THREADS
+    pthread_t thread;            /**< Worker thread */
+#endif
+};
+
+#if STEM_HAVE_ATOMICS
+/**
+ * @brief Builds the new map of a background operation and publishes it
+ * 
+ * @param op Background operation
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_async_work(StemAsync* op) {
+    StemError error = STEM_SUCCESS;
+    EnumMap* map = NULL;
+    
+    if (op->path) {
+        FILE* stream = fopen(op->path, "rb");
+        if (!stream) {
+            return STEM_ERROR_NOT_FOUND;
+        }
+        map = stdem_deserialize(stream, &error);
+        fclose(stream);
+    } else {
+        map = stdem_snapshot_copy_current(op->snapshot, &error);
+        if (map) {
+            error = op->rebuild(map, op->user_data);
+        }
+    }
+    
+    if (map && error == STEM_SUCCESS) {
+        error = stdem_snapshot_publish(op->snapshot, map);
+    }
+    if (map && error != STEM_SUCCESS) {
+        stdem_destroy(map);
+    }
+    return error;
+}
+
+/**
+ * @brief Drops one reference to a background operation
+ * 
+ * @param op Background operation, freed with its last reference
+ */
+static void stem_async_release(StemAsync* op) {
+    if (STEM_ATOMIC_ADD(&op->refs, -1) == 0) {
+        free(op->path);
+        free(op);
+    }
+}
+
+/**
+ * @brief Body of the worker of a background operation
+ * 
+ * @param arg Background operation
+ * @return void* Always NULL
+ */
+static void* stem_async_main(void* arg) {
+    StemAsync* op = arg;
+    op->result = stem_async_work(op);
+    if (op->done) {
+        op->done(op->result, op->user_data);
+    }
+    STEM_ATOMIC_STORE(&op->finished, 1);
+    stem_async_release(op);
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Starts the worker of a background operation
+ * 
+ * Without POSIX threads the operation runs to completion right here.
+ * 
+ * @param op Background operation, freed on failure
+ * @param error Optional error code output
+ * @return StemAsync* The operation, or NULL if no thread could be started
+ */
+static StemAsync* stem_async_start(StemAsync* op, StemError* error) {
+#if STEM_HAVE_ATOMICS
+    op->refs = 2;
+#if STEM_HAVE_THREADS
+    if (pthread_create(&op->thread, NULL, stem_async_main, op) != 0) {
+        free(op->path);
+        free(op);
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
+        }
+        return NULL;
+    }
+#else
+    stem_async_main(op);
+#endif
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return op;
+#else
+    free(op->path);
+    free(op);
+    if (error) {
+        *error = STEM_ERROR_INVALID_ARG;
+    }
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Loads an image file into a snapshot on a background thread
+ * 
+ * @param snapshot Snapshot whose current map the loaded one replaces
+ * @param path Image file written by stdem_serialize() (copied)
+ * @param done Optional completion callback, called on the worker
+ * @param user_data User context passed to done
+ * @param error Optional error code output
+ * @return StemAsync* Handle of the load, or NULL on failure
+ */
+StemAsync* stdem_load_async(StemSnapshot* snapshot, const char* path, 
+                            StemAsyncCallback done, void* user_data, StemError* error) {
+    if (!snapshot || !path) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    size_t length = strlen(path) + 1;
+    StemAsync* op = calloc(1, sizeof(StemAsync));
+    char* copy = op ? malloc(length) : NULL;
+    if (!copy) {
+        free(op);
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
+        }
+        return NULL;
+    }
+    
+    memcpy(copy, path, length);
+    op->snapshot = snapshot;
+    op->path = copy;
+    op->done = done;
+    op->user_data = user_data;
+    return stem_async_start(op, error);
+}
+
+/**
+ * @brief Rebuilds the map of a snapshot on a background thread
+ * 
+ * @param snapshot Snapshot to rebuild
+ * @param rebuild Change applied to a mutable copy of the current map
+ * @param done Optional completion callback, called on the worker
+ * @param user_data User context passed to rebuild and done
+ * @param error Optional error code output
+ * @return StemAsync* Handle of the rebuild, or NULL on failure
+ */
+StemAsync* stdem_rebuild_async(StemSnapshot* snapshot, StemRebuildCallback rebuild, 
+                               StemAsyncCallback done, void* user_data, StemError* error) {
+    if (!snapshot || !rebuild) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    StemAsync* op = calloc(1, sizeof(StemAsync));
+    if (!op) {
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
+        }
+        return NULL;
+    }
+    
+    op->snapshot = snapshot;
+    op->rebuild = rebuild;
+    op->done = done;
+    op->user_data = user_data;
+    return stem_async_start(op, error);
+}
+
+/**
+ * @brief Tells whether a background operation and its callback have finished
+ * 
+ * @param op Background operation
+ * @return bool True once stdem_async_wait() would not block
+ */
+bool stdem_async_ready(const StemAsync* op) {
+#if STEM_HAVE_ATOMICS
+    return op && STEM_ATOMIC_LOAD(&op->finished);
+#else
+    (void)op; /* Unused parameter */
+    return false;
+#endif
+}
+
+/**
+ * @brief Waits for a background operation and releases its handle
+ * 
+ * @param op Background operation
+ * @return StemError Result of the load or rebuild
+ */
+StemError stdem_async_wait(StemAsync* op) {
+    if (!op) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+#if STEM_HAVE_ATOMICS
+#if STEM_HAVE_THREADS
+    pthread_join(op->thread, NULL);
+#endif
+    StemError result = op->result;
+    stem_async_release(op);
+    return result;
+#else
+    return STEM_ERROR_INVALID_ARG;
+#endif
+}
+
+/**
+ * @brief Releases the handle of a background operation that keeps running
+ * 
+ * @param op Background operation
+ */
+void stdem_async_detach(StemAsync* op) {
+#if STEM_HAVE_ATOMICS
+    if (op) {
+#if STEM_HAVE_THREADS
+        pthread_detach(op->thread);
+#endif
+        stem_async_release(op);
+    }
+#else
+    (void)op; /* Unused parameter */
+#endif
+}
+
+/* ==================== TABLES ==================== */
+
+/**
+ * @brief One value column of a table
+ */
+typedef struct {
+    unsigned char* data;    /**< Cells, value_size bytes apart, one per row of capacity */
+    size_t value_size;      /**< Bytes of each cell */
+} StemColumn;
+
+/**
+ * @brief Rows of values sharing one key and name index
+ * 
+ * Everything is allocated through the index, so the table uses the
+ * allocator (and the huge page flags) the index was created with. The
+ * index stores the row of each enum value as its inline value.
+ */
+struct StemTable {
+    EnumMap* index;         /**< Enum value and name to row */
+    int* keys;              /**< Enum value of each row */
+    size_t rows;            /**< Number of rows */
+    size_t capacity;        /**< Rows keys and every column have room for */
+    StemColumn* columns;    /**< Value columns */
+    size_t num_columns;     /**< Number of columns */
+    size_t column_slots;    /**< Entries allocated in columns */
+};
+
+/**
+ * @brief Returns the row an index entry points at
+ */
+static size_t stem_entry_row(const EnumEntry* entry) {
+    size_t row;
+    memcpy(&row, entry->value, sizeof(size_t));
+    return row;
+}
+
+/**
+ * @brief Grows the keys and every column of a table to a new row capacity
+ * 
+ * Either every array is replaced or, on failure, none is.
+ * 
+ * @param table Table to grow (locked exclusively)
+ * @param capacity New number of rows, larger than the current one
+ * @return StemError Error code indicating success or failure
+ */
+static StemError stem_rows_reserve(StemTable* table, size_t capacity) {
+    EnumMap* index = table->index;
+    if (capacity > (size_t)-1 / sizeof(int)) {
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t c = 0; c < table->num_columns; c++) {
+        if (capacity > (size_t)-1 / table->columns[c].value_size) {
+            return STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    
+    unsigned char** data = NULL;
+    if (table->num_columns > 0) {
+        data = stem_calloc(index, table->num_columns, sizeof(unsigned char*));
+        if (!data) {
+            return STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
+    int* keys = stem_alloc(index, capacity * sizeof(int));
+    bool complete = keys != NULL;
+    for (size_t c = 0; complete && c < table->num_columns; c++) {
+        data[c] = stem_alloc(index, capacity * table->columns[c].value_size);
+        complete = data[c] != NULL;
+    }
+    
+    if (!complete) {
+        for (size_t c = 0; c < table->num_columns; c++) {
+            stem_free(index, data[c], capacity * table->columns[c].value_size);
+        }
+        stem_free(index, keys, capacity * sizeof(int));
+        stem_free(index, data, table->num_columns * sizeof(unsigned char*));
+        return STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    if (table->rows > 0) {
+        memcpy(keys, table->keys, table->rows * sizeof(int));
+    }
+    stem_free(index, table->keys, table->capacity * sizeof(int));
+    table->keys = keys;
+    for (size_t c = 0; c < table->num_columns; c++) {
+        StemColumn* column = &table->columns[c];
+        if (table->rows > 0) {
+            memcpy(data[c], column->data, table->rows * column->value_size);
+        }
+        stem_free(index, column->data, table->capacity * column->value_size);
+        column->data = data[c];
+    }
+    stem_free(index, data, table->num_columns * sizeof(unsigned char*));
+    table->capacity = capacity;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Creates an empty table
+ * 
+ * @param capacity Number of rows to make room for (at least 1)
+ * @param flags Configuration flags of the index
+ * @param allocator Allocation hooks, or NULL for malloc/free
+ * @param error Optional error code output
+ * @return StemTable* New table, or NULL on failure
+ */
+StemTable* stdem_table_create(size_t capacity, StemFlags flags, 
+                              const StemAllocator* allocator, StemError* error) {
+    if (flags & STEM_FLAGS_READONLY) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    EnumMap* index = stdem_create_with_allocator(capacity, sizeof(size_t), flags, 
+                                                 allocator, error);
+    if (!index) {
+        return NULL;
+    }
+    
+    StemTable* table = stem_alloc(index, sizeof(StemTable));
+    if (!table) {
+        stdem_destroy(index);
+        if (error) {
+            *error = STEM_ERROR_OUT_OF_MEMORY;
         }
+        return NULL;
     }
     
-    free(map->buckets);
-    map->buckets = new_buckets;
-    map->num_buckets = new_size;
+    memset(table, 0, sizeof(StemTable));
+    table->index = index;
+    StemError err = stem_rows_reserve(table, capacity);
+    if (err != STEM_SUCCESS) {
+        stdem_table_destroy(table);
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
     
-    return STEM_SUCCESS;
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return table;
 }
 
 /**
- * @brief Creates a new enum entry
+ * @brief Destroys a table together with its index and columns
  * 
- * This function allocates and initializes a new enum entry with the given values.
- * If value_size is greater than 0, the value is copied. Otherwise, the pointer is stored.
- * If a name is provided and the NO_NAMES flag is not set, the name is duplicated.
+ * @param table Table to destroy
+ */
+void stdem_table_destroy(StemTable* table) {
+    if (!table) {
+        return;
+    }
+    
+    EnumMap* index = table->index;
+    for (size_t c = 0; c < table->num_columns; c++) {
+        stem_free(index, table->columns[c].data, table->capacity * table->columns[c].value_size);
+    }
+    stem_free(index, table->columns, table->column_slots * sizeof(StemColumn));
+    stem_free(index, table->keys, table->capacity * sizeof(int));
+    stem_free(index, table, sizeof(StemTable));
+    stdem_destroy(index);
+}
+
+/**
+ * @brief Adds a value column to a table
  * 
- * @param map Pointer to the EnumMap
- * @param enum_value The enum value for the new entry
- * @param value Pointer to the value to associate
- * @param name The name to associate (optional)
- * @param out_entry Output parameter for the created entry
- * @return StemError Error code indicating success or failure
+ * @param table Table to extend
+ * @param value_size Bytes of each cell (not 0)
+ * @param error Optional error code output
+ * @return size_t Index of the new column, or STEM_TABLE_NONE on failure
  */
-static StemError stem_create_entry(EnumMap* map, int enum_value, 
-                                 const void* value, const char* name, 
-                                 EnumEntry* *out_entry) {
-    if (!map || !out_entry) {
-        return STEM_ERROR_INVALID_ARG;
+size_t stdem_table_add_column(StemTable* table, size_t value_size, StemError* error) {
+    if (!table || value_size == 0 || table->capacity > (size_t)-1 / value_size) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return STEM_TABLE_NONE;
     }
     
-    EnumEntry* entry = malloc(sizeof(EnumEntry));
-    if (!entry) {
-        return STEM_ERROR_OUT_OF_MEMORY;
+    EnumMap* index = table->index;
+    stem_lock_map(index);
+    
+    StemError err = STEM_SUCCESS;
+    if (table->num_columns == table->column_slots) {
+        size_t slots = table->column_slots ? table->column_slots * 2 : 4;
+        StemColumn* columns = stem_alloc(index, slots * sizeof(StemColumn));
+        if (columns) {
+            if (table->num_columns > 0) {
+                memcpy(columns, table->columns, table->num_columns * sizeof(StemColumn));
+            }
+            stem_free(index, table->columns, table->column_slots * sizeof(StemColumn));
+            table->columns = columns;
+            table->column_slots = slots;
+        } else {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
     }
     
-    memset(entry, 0, sizeof(EnumEntry));
-    entry->enum_value = enum_value;
+    size_t column = STEM_TABLE_NONE;
+    if (err == STEM_SUCCESS) {
+        unsigned char* data = stem_calloc(index, table->capacity, value_size);
+        if (data) {
+            column = table->num_columns++;
+            table->columns[column].data = data;
+            table->columns[column].value_size = value_size;
+        } else {
+            err = STEM_ERROR_OUT_OF_MEMORY;
+        }
+    }
     
-    /* Copy value if needed */
-    if (map->value_size > 0 && value) {
-        entry->value = malloc(map->value_size);
-        if (!entry->value) {
-            free(entry);
-            return STEM_ERROR_OUT_OF_MEMORY;
+    stem_unlock_map(index);
+    if (error) {
+        *error = err;
+    }
+    return column;
+}
+
+/**
+ * @brief Adds a row for an enum value
+ * 
+ * @param table Table to extend
+ * @param enum_value Enum value without a row yet
+ * @param name Name of the row, or NULL
+ * @param error Optional error code output
+ * @return size_t Index of the new row, or STEM_TABLE_NONE on failure
+ */
+size_t stdem_table_insert(StemTable* table, int enum_value, const char* name, 
+                          StemError* error) {
+    if (!table) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
         }
-        memcpy(entry->value, value, map->value_size);
-    } else {
-        entry->value = (void*)value;
+        return STEM_TABLE_NONE;
     }
     
-    /* Copy name if provided */
-    if (name && !(map->flags & STEM_FLAGS_NO_NAMES)) {
-        entry->name = strdup(name);
-        if (!entry->name) {
-            if (map->value_size > 0) {
-                free(entry->value);
-            }
-            free(entry);
-            return STEM_ERROR_OUT_OF_MEMORY;
+    EnumMap* index = table->index;
+    stem_lock_map(index);
+    
+    StemError err = STEM_SUCCESS;
+    if (stem_find_entry(index, enum_value)) {
+        err = STEM_ERROR_ALREADY_EXISTS;
+    } else if (table->rows == table->capacity) {
+        err = table->capacity <= (size_t)-1 / 2 ? 
+              stem_rows_reserve(table, table->capacity * 2) : STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    size_t row = table->rows;
+    if (err == STEM_SUCCESS) {
+        err = stem_insert_named(index, enum_value, &row, name);
+    }
+    if (err == STEM_SUCCESS) {
+        table->keys[row] = enum_value;
+        for (size_t c = 0; c < table->num_columns; c++) {
+            StemColumn* column = &table->columns[c];
+            memset(column->data + row * column->value_size, 0, column->value_size);
         }
+        table->rows++;
+    } else {
+        row = STEM_TABLE_NONE;
     }
     
-    *out_entry = entry;
-    return STEM_SUCCESS;
+    stem_unlock_map(index);
+    if (error) {
+        *error = err;
+    }
+    return row;
 }
 
 /**
- * @brief Frees an enum entry and its resources
+ * @brief Removes the row of an enum value
  * 
- * This function releases all memory associated with an enum entry,
- * including the value (if copied) and the name (if present).
+ * The last row takes the place of the removed one, so the removal copies
+ * one row of every column and renumbers one index entry.
  * 
- * @param map Pointer to the EnumMap
- * @param entry Pointer to the entry to free
+ * @param table Table to modify
+ * @param enum_value Enum value whose row to remove
+ * @return StemError STEM_ERROR_NOT_FOUND if the value has no row
  */
-static void stem_free_entry(EnumMap* map, EnumEntry* entry) {
+StemError stdem_table_remove(StemTable* table, int enum_value) {
+    if (!table) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    EnumMap* index = table->index;
+    stem_lock_map(index);
+    
+    EnumEntry* entry = stem_find_entry(index, enum_value);
     if (!entry) {
-        return;
+        stem_unlock_map(index);
+        return STEM_ERROR_NOT_FOUND;
     }
     
-    if (map->value_size > 0) {
-        free(entry->value);
+    size_t row = stem_entry_row(entry);
+    StemError error = stem_remove_entry(index, enum_value);
+    size_t last = table->rows - 1;
+    if (error == STEM_SUCCESS && row != last) {
+        /* Removing may have moved entries of an open-addressing index */
+        int moved = table->keys[last];
+        error = stem_update_entry(index, stem_find_entry(index, moved), &row);
+        table->keys[row] = moved;
+        for (size_t c = 0; c < table->num_columns; c++) {
+            StemColumn* column = &table->columns[c];
+            memcpy(column->data + row * column->value_size, 
+                   column->data + last * column->value_size, column->value_size);
+        }
     }
+    table->rows--;
     
-    if (entry->name) {
-        free(entry->name);
+    stem_unlock_map(index);
+    return error;
+}
+
+/**
+ * @brief Returns the row of an enum value
+ * 
+ * @param table Table to search
+ * @param enum_value Enum value to look up
+ * @return size_t Row index, or STEM_TABLE_NONE if the value has no row
+ */
+size_t stdem_table_find(const StemTable* table, int enum_value) {
+    if (!table) {
+        return STEM_TABLE_NONE;
     }
     
-    free(entry);
+    stem_lock_map_shared(table->index);
+    EnumEntry* entry = stem_find_entry(table->index, enum_value);
+    size_t row = entry ? stem_entry_row(entry) : STEM_TABLE_NONE;
+    stem_unlock_map_shared(table->index);
+    return row;
 }
 
-/* ==================== PUBLIC C API IMPLEMENTATION ==================== */
+/**
+ * @brief Returns the row of the entry with a name
+ * 
+ * @param table Table to search
+ * @param name Name to look up
+ * @return size_t Row index, or STEM_TABLE_NONE if no row has the name
+ */
+size_t stdem_table_find_by_name(const StemTable* table, const char* name) {
+    if (!table || !name) {
+        return STEM_TABLE_NONE;
+    }
+    
+    StemError error;
+    int enum_value = stdem_find_by_name(table->index, name, &error);
+    return error == STEM_SUCCESS ? stdem_table_find(table, enum_value) : STEM_TABLE_NONE;
+}
 
 /**
- * @brief Creates a new enum map with precise error reporting
+ * @brief Returns the cell of a row in a column
  * 
- * @param enum_count Number of enum entries to accommodate
- * @param value_size Size of each value in bytes (0 for pointer storage)
- * @param flags Configuration flags
- * @param error Optional error code output
- * @return EnumMap* Pointer to created enum map, or NULL on failure
+ * @param table Table to access
+ * @param row Row index
+ * @param column Column index
+ * @return void* Cell, or NULL if the row or column does not exist
  */
-EnumMap* stdem_create_ex(size_t enum_count, size_t value_size, 
-                        StemFlags flags, StemError* error) {
-    if (enum_count == 0 || enum_count > STEM_MAX_ENTRIES) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
-        }
+void* stdem_table_cell(const StemTable* table, size_t row, size_t column) {
+    if (!table) {
         return NULL;
     }
     
-    EnumMap* map = malloc(sizeof(EnumMap));
-    if (!map) {
+    stem_lock_map_shared(table->index);
+    void* cell = NULL;
+    if (row < table->rows && column < table->num_columns) {
+        const StemColumn* cells = &table->columns[column];
+        cell = cells->data + row * cells->value_size;
+    }
+    stem_unlock_map_shared(table->index);
+    return cell;
+}
+
+/**
+ * @brief Looks an enum value up and returns its cell in a column
+ * 
+ * @param table Table to search
+ * @param enum_value Enum value to look up
+ * @param column Column index
+ * @param error Optional error code output
+ * @return const void* Cell, or NULL if the value has no row or the column does not exist
+ */
+const void* stdem_table_get(const StemTable* table, int enum_value, size_t column, 
+                            StemError* error) {
+    if (!table) {
         if (error) {
-            *error = STEM_ERROR_OUT_OF_MEMORY;
+            *error = STEM_ERROR_INVALID_ARG;
         }
         return NULL;
     }
     
-    memset(map, 0, sizeof(EnumMap));
-    map->value_size = value_size;
-    map->flags = flags;
+    stem_lock_map_shared(table->index);
     
-    /* Calculate initial bucket size based on expected entries */
-    map->num_buckets = STEM_DEFAULT_BUCKETS;
-    if (enum_count > map->num_buckets * STEM_LOAD_FACTOR) {
-        map->num_buckets = (size_t)(enum_count / STEM_LOAD_FACTOR) + 1;
+    StemError err = STEM_SUCCESS;
+    const void* cell = NULL;
+    EnumEntry* entry = stem_find_entry(table->index, enum_value);
+    if (column >= table->num_columns) {
+        err = STEM_ERROR_INDEX_OUT_OF_BOUNDS;
+    } else if (!entry) {
+        err = STEM_ERROR_NOT_FOUND;
+    } else {
+        const StemColumn* cells = &table->columns[column];
+        cell = cells->data + stem_entry_row(entry) * cells->value_size;
     }
     
-    map->buckets = calloc(map->num_buckets, sizeof(EnumEntry*));
-    if (!map->buckets) {
-        free(map);
-        if (error) {
-            *error = STEM_ERROR_OUT_OF_MEMORY;
-        }
-        return NULL;
+    stem_unlock_map_shared(table->index);
+    if (error) {
+        *error = err;
+    }
+    return cell;
+}
+
+/**
+ * @brief Copies a value into the cell of an enum value in a column
+ * 
+ * @param table Table to modify
+ * @param enum_value Enum value with a row
+ * @param column Column index
+ * @param value Value to copy, the column's value size long
+ * @return StemError Error code indicating success or failure
+ */
+StemError stdem_table_set(StemTable* table, int enum_value, size_t column, const void* value) {
+    if (!table || !value) {
+        return STEM_ERROR_INVALID_ARG;
     }
     
-    /* Initialize mutex to NULL (not used by default) */
-    map->mutex = NULL;
+    stem_lock_map(table->index);
     
-    if (error) {
-        *error = STEM_SUCCESS;
+    StemError error = STEM_SUCCESS;
+    EnumEntry* entry = stem_find_entry(table->index, enum_value);
+    if (column >= table->num_columns) {
+        error = STEM_ERROR_INDEX_OUT_OF_BOUNDS;
+    } else if (!entry) {
+        error = STEM_ERROR_NOT_FOUND;
+    } else {
+        StemColumn* cells = &table->columns[column];
+        memcpy(cells->data + stem_entry_row(entry) * cells->value_size, value, cells->value_size);
     }
-    return map;
+    
+    stem_unlock_map(table->index);
+    return error;
 }
 
 /**
- * @brief Destroys an enum map and releases all resources
+ * @brief Returns the cell array of a column
  * 
- * @param map Pointer to the EnumMap to destroy
+ * @param table Table to access
+ * @param column Column index
+ * @return void* First cell, or NULL if the column does not exist
  */
-void stdem_destroy(EnumMap* map) {
-    if (!map) {
-        return;
+void* stdem_table_column(const StemTable* table, size_t column) {
+    if (!table) {
+        return NULL;
     }
     
-    stem_lock_map(map);
+    stem_lock_map_shared(table->index);
+    void* data = column < table->num_columns ? table->columns[column].data : NULL;
+    stem_unlock_map_shared(table->index);
+    return data;
+}
+
+/**
+ * @brief Returns the enum value of a row
+ * 
+ * @param table Table to access
+ * @param row Row index
+ * @return int Enum value, or 0 if the row does not exist
+ */
+int stdem_table_key(const StemTable* table, size_t row) {
+    if (!table) {
+        return 0;
+    }
     
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            EnumEntry* next = entry->next;
-            stem_free_entry(map, entry);
-            entry = next;
-        }
+    stem_lock_map_shared(table->index);
+    int enum_value = row < table->rows ? table->keys[row] : 0;
+    stem_unlock_map_shared(table->index);
+    return enum_value;
+}
+
+/**
+ * @brief Returns the name of a row
+ * 
+ * @param table Table to access
+ * @param row Row index
+ * @return const char* Name, or NULL if the row is unnamed or does not exist
+ */
+const char* stdem_table_name(const StemTable* table, size_t row) {
+    if (!table) {
+        return NULL;
     }
     
-    free(map->buckets);
-    free(map);
+    stem_lock_map_shared(table->index);
+    EnumEntry* entry = row < table->rows ? stem_find_entry(table->index, table->keys[row]) : NULL;
+    const char* name = entry ? entry->name : NULL;
+    stem_unlock_map_shared(table->index);
+    return name;
 }
 
 /**
- * @brief Associates a value with an enum entry with error reporting
+ * @brief Returns the number of rows of a table
+ * 
+ * @param table Table to access
+ * @return size_t Number of rows, 0 for NULL
+ */
+size_t stdem_table_rows(const StemTable* table) {
+    return table ? stdem_count(table->index) : 0;
+}
+
+/**
+ * @brief Returns the key index of a table
+ * 
+ * @param table Table to access
+ * @return const EnumMap* Index, NULL for NULL
+ */
+const EnumMap* stdem_table_index(const StemTable* table) {
+    return table ? table->index : NULL;
+}
+
+/**
+ * @brief Returns the last error that occurred in the current thread
+ * 
+ * @return StemError Last error code
+ */
+StemError stdem_get_last_error(void) {
+    /* Thread-local storage would be needed for proper implementation
+     * For maximum portability, we use a static variable
+     */
+    static StemError last_error = STEM_SUCCESS;
+    return last_error;
+}
+
+/**
+ * @brief Returns a human-readable description of an error code
+ * 
+ * @param error Error code to describe
+ * @return const char* String describing the error
+ */
+const char* stdem_error_string(StemError error) {
+    switch (error) {
+        case STEM_SUCCESS: return "Success";
+        case STEM_ERROR_INVALID_ARG: return "Invalid argument";
+        case STEM_ERROR_OUT_OF_MEMORY: return "Out of memory";
+        case STEM_ERROR_INDEX_OUT_OF_BOUNDS: return "Index out of bounds";
+        case STEM_ERROR_NOT_FOUND: return "Not found";
+        case STEM_ERROR_ALREADY_EXISTS: return "Already exists";
+        case STEM_ERROR_UNINITIALIZED: return "Uninitialized";
+        case STEM_ERROR_BUSY: return "Resource busy";
+        default: return "Unknown error";
+    }
+}
+
+/* ==================== ADDITIONAL UTILITY FUNCTIONS ==================== */
+
+/**
+ * @brief Source of a deserialization
+ */
+typedef struct {
+    StemReadCallback read;  /**< Callback reading the next bytes */
+    void* user_data;        /**< Context passed to the callback */
+} StemReader;
+
+/**
+ * @brief Reads exactly size bytes from a reader
+ * 
+ * Short reads are retried, so callbacks may return whatever is available
+ * (for example from a socket); only a return of 0 ends the input.
+ */
+static bool stem_read(const StemReader* reader, void* data, size_t size) {
+    unsigned char* bytes = data;
+    while (size > 0) {
+        size_t got = reader->read(bytes, size, reader->user_data);
+        if (got == 0 || got > size) {
+            return false;
+        }
+        bytes += got;
+        size -= got;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes exactly size bytes through a write callback
+ * 
+ * Short writes are retried; a return of 0 fails the write.
+ */
+static bool stem_write(StemWriteCallback write, const void* data, size_t size, 
+                       void* user_data) {
+    const unsigned char* bytes = data;
+    while (size > 0) {
+        size_t put = write(bytes, size, user_data);
+        if (put == 0 || put > size) {
+            return false;
+        }
+        bytes += put;
+        size -= put;
+    }
+    return true;
+}
+
+/**
+ * @brief Read callback over a FILE*
+ */
+static size_t stem_file_read(void* data, size_t size, void* user_data) {
+    return fread(data, 1, size, (FILE*)user_data);
+}
+
+/**
+ * @brief Write callback over a FILE*
+ */
+static size_t stem_file_write(const void* data, size_t size, void* user_data) {
+    return fwrite(data, 1, size, (FILE*)user_data);
+}
+
+/**
+ * @brief Read position in a memory buffer
+ */
+typedef struct {
+    const unsigned char* data; /**< Start of the buffer */
+    size_t size;               /**< Size of the buffer in bytes */
+    size_t used;               /**< Bytes consumed so far */
+} StemBufferCursor;
+
+/**
+ * @brief Read callback over a StemBufferCursor
+ */
+static size_t stem_buffer_read(void* data, size_t size, void* user_data) {
+    StemBufferCursor* cursor = user_data;
+    size_t available = cursor->size - cursor->used;
+    if (size > available) {
+        size = available;
+    }
+    memcpy(data, cursor->data + cursor->used, size);
+    cursor->used += size;
+    return size;
+}
+
+/**
+ * @brief Checks that a byte range lies within a block
+ * 
+ * @param offset Start of the range
+ * @param count Number of elements
+ * @param stride Size of each element (non-zero)
+ * @param size Size of the block
+ * @return bool True if count elements fit between offset and size
+ */
+static bool stem_image_range(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size) {
+    return offset <= size && count <= (size - offset) / stride;
+}
+
+/**
+ * @brief Validates the layout of a frozen block read from an image
  * 
- * @param map Enum map to modify
- * @param enum_value Enum value to associate with
- * @param value Pointer to the value to associate
- * @param name Optional name for the enum entry
- * @return StemError Error code indicating success or failure
+ * Only the header is inspected, so opening an image stays independent of
+ * its size. Lookups bound every index they take from the tables, and the
+ * string table must end with a NUL, so a damaged image can return wrong
+ * results but never makes a lookup leave the block.
+ * 
+ * @param frozen Frozen block
+ * @param size Number of bytes available for the block
+ * @return StemError STEM_SUCCESS, or STEM_ERROR_INVALID_ARG for a malformed block
  */
-StemError stdem_associate_ex(EnumMap* map, int enum_value, 
-                           const void* value, const char* name) {
-    if (!map) {
+static StemError stem_frozen_validate(const StemFrozen* frozen, uint64_t size) {
+    if (size < sizeof(StemFrozen) || frozen->size != size || size > SIZE_MAX) {
         return STEM_ERROR_INVALID_ARG;
     }
     
-    if (map->flags & STEM_FLAGS_READONLY) {
+    uint64_t stride = frozen->value_size > 0 ? frozen->value_size : sizeof(void*);
+    if (frozen->name_count > frozen->count || frozen->value_size > size || 
+        frozen->record_size < sizeof(StemFrozenRecord) + stride || 
+        frozen->record_size % 8 != 0 || frozen->records % 8 != 0 || 
+        frozen->key_seeds % 4 != 0 || frozen->name_seeds % 4 != 0 || 
+        frozen->name_slots % 4 != 0) {
         return STEM_ERROR_INVALID_ARG;
     }
     
-    stem_lock_map(map);
-    
-    /* Check if entry already exists */
-    EnumEntry* existing = stem_find_entry(map, enum_value);
-    if (existing) {
-        stem_unlock_map(map);
-        return STEM_ERROR_ALREADY_EXISTS;
+    if (!stem_image_range(frozen->key_seeds, frozen->count, sizeof(int32_t), size) || 
+        !stem_image_range(frozen->name_seeds, frozen->name_count, sizeof(int32_t), size) || 
+        !stem_image_range(frozen->name_slots, frozen->name_count, sizeof(uint32_t), size) || 
+        !stem_image_range(frozen->records, frozen->count, frozen->record_size, size) || 
+        frozen->strings > size) {
+        return STEM_ERROR_INVALID_ARG;
     }
     
-    /* Check if we need to resize */
-    if ((float)map->count / map->num_buckets > STEM_LOAD_FACTOR) {
-        StemError error = stem_resize_map(map, map->num_buckets * 2);
-        if (error != STEM_SUCCESS) {
-            stem_unlock_map(map);
-            return error;
-        }
+    const unsigned char* base = (const unsigned char*)frozen;
+    if (frozen->strings < size && base[size - 1] != '\0') {
+        return STEM_ERROR_INVALID_ARG;
     }
-    
-    /* Create new entry */
-    EnumEntry* new_entry;
-    StemError error = stem_create_entry(map, enum_value, value, name, &new_entry);
-    if (error != STEM_SUCCESS) {
-        stem_unlock_map(map);
-        return error;
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Validates the fixed part of a version 2 image header
+ * 
+ * @param header Image header
+ * @param available Number of bytes following the header
+ * @return StemError STEM_SUCCESS, or STEM_ERROR_INVALID_ARG for a foreign image
+ */
+static StemError stem_image_header_validate(const StemImageHeader* header, uint64_t available) {
+    if (header->magic != STEM_IMAGE_MAGIC || header->version != STEM_IMAGE_VERSION || 
+        header->header_size != sizeof(StemImageHeader) || 
+        header->byte_order != STEM_IMAGE_BYTE_ORDER || 
+        header->block_size > available) {
+        return STEM_ERROR_INVALID_ARG;
     }
-    
-    /* Add to bucket */
-    uint32_t hash = stem_hash_int(enum_value);
-    size_t bucket_idx = hash % map->num_buckets;
-    
-    new_entry->next = map->buckets[bucket_idx];
-    map->buckets[bucket_idx] = new_entry;
-    map->count++;
-    
-    stem_unlock_map(map);
     return STEM_SUCCESS;
 }
 
 /**
- * @brief Retrieves a value associated with an enum entry with error reporting
+ * @brief Wraps a frozen block into a read-only map
  * 
- * @param map Enum map to query
- * @param enum_value Enum value to look up
+ * @param frozen Validated frozen block
+ * @param flags Flags of the serialized map
+ * @param image Image the block belongs to, or NULL to hand the block over to the map
  * @param error Optional error code output
- * @return const void* Pointer to the associated value, or NULL on error
+ * @return EnumMap* New read-only map, or NULL on failure
  */
-const void* stdem_get_value_ex(const EnumMap* map, int enum_value, StemError* error) {
+static EnumMap* stem_image_map(StemFrozen* frozen, uint32_t flags, const void* image, 
+                              StemError* error) {
+    EnumMap* map = stem_default_allocator.allocate(sizeof(EnumMap), NULL);
     if (!map) {
         if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
+            *error = STEM_ERROR_OUT_OF_MEMORY;
         }
         return NULL;
     }
     
-    stem_lock_map((EnumMap*)map);
+    memset(map, 0, sizeof(EnumMap));
+    map->value_size = (size_t)frozen->value_size;
+    map->flags = (StemFlags)(flags | STEM_FLAGS_READONLY);
+    if (!STEM_HAVE_ATOMICS) {
+        map->flags = (StemFlags)(map->flags & ~STEM_FLAGS_THREAD_SAFE);
+    }
+    map->allocator = stem_default_allocator;
+    map->max_load = STEM_LOAD_FACTOR;
+    map->frozen = frozen;
+    map->count = frozen->count;
+    map->image = image;
     
-    EnumEntry* entry = stem_find_entry(map, enum_value);
-    if (!entry) {
-        stem_unlock_map((EnumMap*)map);
+    /* On failure the block stays with the caller */
+    StemError err = stem_order_freeze(map);
+    if (err != STEM_SUCCESS) {
+        stem_free(map, map, sizeof(EnumMap));
         if (error) {
-            *error = STEM_ERROR_NOT_FOUND;
+            *error = err;
         }
         return NULL;
     }
     
-    stem_unlock_map((EnumMap*)map);
-    
     if (error) {
         *error = STEM_SUCCESS;
     }
-    return entry->value;
+    return map;
 }
 
 /**
- * @brief Retrieves the name associated with an enum entry with error reporting
+ * @brief Reads the frozen block of a version 2 image
  * 
- * @param map Enum map to query
- * @param enum_value Enum value to look up
+ * @param reader Reader positioned after the image header
+ * @param header Validated image header
+ * @param keep_frozen True to return the frozen map itself, false for a mutable copy
  * @param error Optional error code output
- * @return const char* Name of the enum entry, or NULL if not found
+ * @return EnumMap* New enum map, or NULL on failure
  */
-const char* stdem_get_name_ex(const EnumMap* map, int enum_value, StemError* error) {
-    if (!map) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
+static EnumMap* stem_image_read(const StemReader* reader, const StemImageHeader* header, 
+                               bool keep_frozen, StemError* error) {
+    StemFrozen* frozen = NULL;
+    StemError err = STEM_ERROR_INVALID_ARG;
+    
+    if (header->block_size >= sizeof(StemFrozen) && header->block_size <= SIZE_MAX) {
+        /* Allocated the way the map created below releases it */
+        size_t size = (size_t)header->block_size;
+        frozen = stem_huge_eligible(&stem_default_allocator, (StemFlags)header->flags, size) ? 
+                 stem_pages_alloc(size, (StemFlags)header->flags) : malloc(size);
+        err = frozen ? STEM_SUCCESS : STEM_ERROR_OUT_OF_MEMORY;
+        if (err == STEM_SUCCESS && !stem_read(reader, frozen, size)) {
+            err = STEM_ERROR_INVALID_ARG;
+        }
+        if (err == STEM_SUCCESS) {
+            err = stem_frozen_validate(frozen, header->block_size);
         }
-        return NULL;
     }
     
-    if (map->flags & STEM_FLAGS_NO_NAMES) {
+    EnumMap* map = NULL;
+    if (err == STEM_SUCCESS) {
+        map = stem_image_map(frozen, header->flags, NULL, &err);
+    }
+    if (!map) {
+        if (frozen && stem_huge_eligible(&stem_default_allocator, (StemFlags)header->flags, 
+                                         (size_t)header->block_size)) {
+            stem_pages_free(frozen, (size_t)header->block_size);
+        } else {
+            free(frozen);
+        }
         if (error) {
-            *error = STEM_ERROR_NOT_FOUND;
+            *error = err;
         }
         return NULL;
     }
     
-    stem_lock_map((EnumMap*)map);
-    
-    EnumEntry* entry = stem_find_entry(map, enum_value);
-    if (!entry) {
-        stem_unlock_map((EnumMap*)map);
-        if (error) {
-            *error = STEM_ERROR_NOT_FOUND;
-        }
-        return NULL;
+    if (keep_frozen) {
+        return map;
     }
     
-    stem_unlock_map((EnumMap*)map);
+    /* Rebuild the serialized storage; the block is bulk-loaded in one pass */
+    size_t capacity = header->dense_size && header->dense_size <= STEM_MAX_DENSE_SIZE ? 
+                      (size_t)header->dense_size : map->count;
+    StemEntryArrays arrays;
+    EnumMap* new_map = NULL;
+    err = stem_entries_gather(map, &arrays);
+    if (err == STEM_SUCCESS) {
+        new_map = stem_create_filled(capacity, map->value_size, (StemFlags)header->flags, 
+                                     STEM_LOAD_FACTOR, NULL, &arrays, true, &err);
+        stem_entries_free(map, &arrays);
+    }
+    stdem_destroy(map);
     
     if (error) {
-        *error = STEM_SUCCESS;
+        *error = err;
     }
-    return entry->name;
+    return new_map;
 }
 
 /**
- * @brief Finds an enum value by its name with error reporting
+ * @brief Fills the header of a version 2 image
  * 
- * @param map Enum map to search
- * @param name Name to search for
- * @param error Optional error code output
- * @return int Enum value associated with the name, or 0 on error
+ * @param map Map being serialized
+ * @param block_size Size of its frozen block
+ * @param header Output header
  */
-int stdem_find_by_name(const EnumMap* map, const char* name, StemError* error) {
-    if (!map || !name) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
-        }
-        return 0;
-    }
-    
-    if (map->flags & STEM_FLAGS_NO_NAMES) {
-        if (error) {
-            *error = STEM_ERROR_NOT_FOUND;
-        }
+static void stem_image_header(const EnumMap* map, uint64_t block_size, StemImageHeader* header) {
+    memset(header, 0, sizeof(StemImageHeader));
+    header->magic = STEM_IMAGE_MAGIC;
+    header->version = STEM_IMAGE_VERSION;
+    header->header_size = sizeof(StemImageHeader);
+    header->byte_order = STEM_IMAGE_BYTE_ORDER;
+    header->flags = (uint32_t)map->flags;
+    header->dense_size = map->dense_size;
+    header->block_size = block_size;
+}
+
+/**
+ * @brief Returns the exact size of the image stdem_serialize() writes
+ * 
+ * @param map Enum map to measure
+ * @return size_t Image size in bytes, or 0 if the map cannot be serialized
+ */
+size_t stdem_serialized_size(const EnumMap* map) {
+    if (!map) {
         return 0;
     }
     
-    stem_lock_map((EnumMap*)map);
-    
-    
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            if (entry->name && strcmp(entry->name, name) == 0) {
-                stem_unlock_map((EnumMap*)map);
-                if (error) {
-                    *error = STEM_SUCCESS;
-                }
-                return entry->enum_value;
-            }
-            entry = entry->next;
-        }
+    if (map->frozen) {
+        return sizeof(StemImageHeader) + (size_t)map->frozen->size;
     }
     
-    stem_unlock_map((EnumMap*)map);
+    stem_lock_map_shared(map);
+    StemFrozen layout;
+    StemError err = stem_freeze_layout(map, &layout);
+    stem_unlock_map_shared(map);
     
-    if (error) {
-        *error = STEM_ERROR_NOT_FOUND;
-    }
-    return 0;
+    return err == STEM_SUCCESS ? sizeof(StemImageHeader) + (size_t)layout.size : 0;
 }
 
 /**
- * @brief Iterates over all entries in the enum map
+ * @brief Serializes an enum map through a write callback
  * 
- * @param map Enum map to iterate over
- * @param iterator Callback function to call for each entry
- * @param user_data User context passed to the iterator
+ * The image is handed over in two pieces: the header, then the block.
+ * 
+ * @param map The enum map to serialize
+ * @param write Callback returning the number of bytes it consumed
+ * @param user_data Context passed to the callback
  * @return StemError Error code indicating success or failure
  */
-StemError stdem_foreach(const EnumMap* map, EnumMapIterator iterator, 
-                       void* user_data) {
-    if (!map || !iterator) {
+StemError stdem_serialize_with(const EnumMap* map, StemWriteCallback write, void* user_data) {
+    if (!map || !write) {
         return STEM_ERROR_INVALID_ARG;
     }
     
-    stem_lock_map((EnumMap*)map);
-    
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            iterator(entry->enum_value, entry->name, entry->value, 
-                    map->value_size, user_data);
-            entry = entry->next;
+    /* Frozen maps never change, so only the freeze needs the lock */
+    EnumMap* frozen_map = NULL;
+    if (!map->frozen) {
+        StemError err;
+        frozen_map = stdem_freeze(map, &err);
+        if (!frozen_map) {
+            return err;
         }
     }
+    const StemFrozen* frozen = frozen_map ? frozen_map->frozen : map->frozen;
     
-    stem_unlock_map((EnumMap*)map);
-    return STEM_SUCCESS;
+    StemImageHeader header;
+    stem_image_header(map, frozen->size, &header);
+    
+    size_t size = (size_t)frozen->size;
+    bool written = stem_write(write, &header, sizeof(header), user_data) && 
+                   stem_write(write, frozen, size, user_data);
+    
+    stdem_destroy(frozen_map);
+    return written ? STEM_SUCCESS : STEM_ERROR_INVALID_ARG;
 }
 
 /**
- * @brief Returns the number of entries in the enum map
+ * @brief Serializes an enum map to a binary stream
  * 
- * @param map Enum map to query
- * @return size_t Number of entries in the map
+ * Writes a version 2 image: a StemImageHeader followed by the block of
+ * the frozen map (maps that are not frozen yet are frozen on the fly).
+ * 
+ * @param map The enum map to serialize
+ * @param stream The output stream (FILE*)
+ * @return StemError Error code indicating success or failure
  */
-size_t stdem_count(const EnumMap* map) {
-    if (!map) {
-        return 0;
+StemError stdem_serialize(const EnumMap* map, FILE* stream) {
+    if (!stream) {
+        return STEM_ERROR_INVALID_ARG;
     }
-    
-    stem_lock_map((EnumMap*)map);
-    size_t count = map->count;
-    stem_unlock_map((EnumMap*)map);
-    
-    return count;
+    return stdem_serialize_with(map, stem_file_write, stream);
 }
 
 /**
- * @brief Returns the size of the value storage in bytes
+ * @brief Serializes an enum map into a caller-provided buffer
  * 
- * @param map Enum map to query
- * @return size_t Size of each value in bytes (0 for pointer storage)
+ * The frozen block is built directly in the buffer when it is 8-byte
+ * aligned, so the image is produced without an intermediate copy.
+ * 
+ * @param map The enum map to serialize
+ * @param buffer Output buffer
+ * @param size Size of the buffer in bytes
+ * @param written Optional output receiving the image size, also set when
+ *                the buffer is too small
+ * @return StemError STEM_ERROR_INDEX_OUT_OF_BOUNDS if the buffer is too small
  */
-size_t stdem_value_size(const EnumMap* map) {
-    return map ? map->value_size : 0;
+StemError stdem_serialize_to_buffer(const EnumMap* map, void* buffer, size_t size, 
+                                    size_t* written) {
+    if (written) {
+        *written = 0;
+    }
+    if (!map || (!buffer && size > 0)) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    
+    stem_lock_map_shared(map);
+    
+    StemFrozen layout;
+    StemError err = STEM_SUCCESS;
+    if (map->frozen) {
+        layout = *map->frozen;
+    } else {
+        err = stem_freeze_layout(map, &layout);
+    }
+    
+    size_t block_size = (size_t)layout.size;
+    if (err == STEM_SUCCESS && written) {
+        *written = sizeof(StemImageHeader) + block_size;
+    }
+    if (err == STEM_SUCCESS && (size < sizeof(StemImageHeader) || 
+                                block_size > size - sizeof(StemImageHeader))) {
+        err = STEM_ERROR_INDEX_OUT_OF_BOUNDS;
+    }
+    
+    if (err == STEM_SUCCESS) {
+        unsigned char* block = (unsigned char*)buffer + sizeof(StemImageHeader);
+        if (map->frozen) {
+            memcpy(block, map->frozen, block_size);
+        } else if ((uintptr_t)block % STEM_IMAGE_ALIGNMENT == 0) {
+            memset(block, 0, block_size);
+            err = stem_freeze_build(map, &layout, (StemFrozen*)block);
+        } else {
+            /* Unaligned buffers get the block through an aligned scratch copy */
+            StemFrozen* scratch = stem_calloc(map, 1, block_size);
+            err = scratch ? stem_freeze_build(map, &layout, scratch) : STEM_ERROR_OUT_OF_MEMORY;
+            if (err == STEM_SUCCESS) {
+                memcpy(block, scratch, block_size);
+            }
+            if (scratch) {
+                stem_free(map, scratch, block_size);
+            }
+        }
+    }
+    
+    if (err == STEM_SUCCESS) {
+        StemImageHeader header;
+        stem_image_header(map, layout.size, &header);
+        memcpy(buffer, &header, sizeof(header));
+    }
+    
+    stem_unlock_map_shared(map);
+    return err;
 }
 
 /**
- * @brief Clears all associations in the enum map
+ * @brief Reads the entries of a version 1 stream
  * 
- * @param map Enum map to clear
- * @return StemError Error code indicating success or failure
+ * @param reader Reader positioned after the magic number and version
+ * @param error Optional error output
+ * @return EnumMap* New enum map, or NULL on error
  */
-StemError stdem_clear(EnumMap* map) {
-    if (!map) {
-        return STEM_ERROR_INVALID_ARG;
+static EnumMap* stem_deserialize_v1(const StemReader* reader, StemError* error) {
+    size_t count;
+    size_t value_size;
+    StemFlags flags;
+    
+    if (!stem_read(reader, &count, sizeof(count)) ||
+        !stem_read(reader, &value_size, sizeof(value_size)) ||
+        !stem_read(reader, &flags, sizeof(flags))) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
     }
     
-    if (map->flags & STEM_FLAGS_READONLY) {
-        return STEM_ERROR_INVALID_ARG;
+    /* Create new map, sized for every entry up front */
+    EnumMap* map = stdem_create_ex(count ? count : 1, value_size, flags, error);
+    if (!map) {
+        return NULL;
     }
     
-    stem_lock_map(map);
+    /* Read entries in batches and bulk-insert each batch */
+    size_t batch = count < STEM_BULK_BATCH ? count : STEM_BULK_BATCH;
+    size_t stride = value_size > 0 ? value_size : sizeof(void*);
+    int* keys = malloc((batch ? batch : 1) * sizeof(int));
+    const void** values = malloc((batch ? batch : 1) * sizeof(void*));
+    const char** names = malloc((batch ? batch : 1) * sizeof(char*));
+    size_t* name_offsets = malloc((batch ? batch : 1) * sizeof(size_t));
+    unsigned char* value_data = malloc((batch ? batch : 1) * stride);
+    char* name_data = NULL;
+    size_t name_capacity = 0;
+    StemError err = STEM_SUCCESS;
     
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            EnumEntry* next = entry->next;
-            stem_free_entry(map, entry);
-            entry = next;
+    if (!keys || !values || !names || !name_offsets || !value_data) {
+        err = STEM_ERROR_OUT_OF_MEMORY;
+    }
+    
+    for (size_t done = 0; err == STEM_SUCCESS && done < count; ) {
+        size_t m = count - done < batch ? count - done : batch;
+        size_t name_used = 0;
+        
+        for (size_t i = 0; err == STEM_SUCCESS && i < m; i++) {
+            uint16_t name_len;
+            if (!stem_read(reader, &keys[i], sizeof(int)) ||
+                !stem_read(reader, &name_len, sizeof(name_len))) {
+                err = STEM_ERROR_INVALID_ARG;
+                break;
+            }
+            
+            name_offsets[i] = (size_t)-1;
+            if (name_len > 0) {
+                if (name_used + name_len + 1 > name_capacity) {
+                    size_t new_capacity = name_capacity ? name_capacity : 256;
+                    while (name_used + name_len + 1 > new_capacity) {
+                        new_capacity *= 2;
+                    }
+                    char* new_data = realloc(name_data, new_capacity);
+                    if (!new_data) {
+                        err = STEM_ERROR_OUT_OF_MEMORY;
+                        break;
+                    }
+                    name_data = new_data;
+                    name_capacity = new_capacity;
+                }
+                if (!stem_read(reader, name_data + name_used, name_len)) {
+                    err = STEM_ERROR_INVALID_ARG;
+                    break;
+                }
+                name_data[name_used + name_len] = '\0';
+                name_offsets[i] = name_used;
+                name_used += name_len + 1;
+            }
+            
+            unsigned char* value = value_data + i * stride;
+            if (!stem_read(reader, value, stride)) {
+                err = STEM_ERROR_INVALID_ARG;
+                break;
+            }
+            if (value_size > 0) {
+                values[i] = value;
+            } else {
+                memcpy(&values[i], value, sizeof(void*));
+            }
+        }
+        
+        if (err == STEM_SUCCESS) {
+            /* Names are resolved last, the buffer may have moved */
+            for (size_t i = 0; i < m; i++) {
+                names[i] = name_offsets[i] == (size_t)-1 ? NULL : name_data + name_offsets[i];
+            }
+            err = stem_bulk_insert(map, keys, values, names, NULL, m, false);
         }
-        map->buckets[i] = NULL;
+        done += m;
     }
     
-    map->count = 0;
+    free(name_data);
+    free(value_data);
+    free(name_offsets);
+    free(names);
+    free(values);
+    free(keys);
     
-    stem_unlock_map(map);
-    return STEM_SUCCESS;
+    if (err != STEM_SUCCESS) {
+        stdem_destroy(map);
+        if (error) {
+            *error = err;
+        }
+        return NULL;
+    }
+    
+    if (error) {
+        *error = STEM_SUCCESS;
+    }
+    return map;
 }
-
 /**
- * @brief Creates a copy of an enum map
+ * @brief Deserializes an enum map through a read callback
  * 
- * @param map Enum map to copy
- * @param error Optional error code output
- * @return EnumMap* New enum map with the same associations, or NULL on failure
+ * Reads version 2 images as well as streams written in version 1.
+ * Read-only maps come back as frozen maps over the image block; other
+ * maps are rebuilt with their original flags and stay mutable.
+ * 
+ * @param read Callback returning the number of bytes it produced
+ * @param user_data Context passed to the callback
+ * @param error Optional error output
+ * @return EnumMap* New enum map, or NULL on error
  */
-EnumMap* stdem_copy(const EnumMap* map, StemError* error) {
-    if (!map) {
+EnumMap* stdem_deserialize_with(StemReadCallback read, void* user_data, StemError* error) {
+    if (!read) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
+        return NULL;
+    }
+    
+    StemReader reader = { read, user_data };
+    
+    /* Both formats start with the magic number and the version */
+    StemImageHeader header;
+    if (!stem_read(&reader, &header.magic, sizeof(header.magic)) || 
+        header.magic != STEM_IMAGE_MAGIC || 
+        !stem_read(&reader, &header.version, sizeof(header.version))) {
         if (error) {
             *error = STEM_ERROR_INVALID_ARG;
         }
         return NULL;
     }
     
-    stem_lock_map((EnumMap*)map);
+    if (header.version == 1) {
+        return stem_deserialize_v1(&reader, error);
+    }
     
-    EnumMap* new_map = stdem_create_ex(map->count, map->value_size, 
-                                     map->flags, error);
-    if (!new_map) {
-        stem_unlock_map((EnumMap*)map);
+    size_t rest = sizeof(header) - offsetof(StemImageHeader, header_size);
+    if (!stem_read(&reader, &header.header_size, rest) || 
+        stem_image_header_validate(&header, UINT64_MAX) != STEM_SUCCESS) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
         return NULL;
     }
     
-    /* Copy all entries */
-    StemError err = STEM_SUCCESS;
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            err = stdem_associate_ex(new_map, entry->enum_value, 
-                                   entry->value, entry->name);
-            if (err != STEM_SUCCESS) {
-                break;
-            }
-            entry = entry->next;
-        }
-        if (err != STEM_SUCCESS) {
-            break;
+    return stem_image_read(&reader, &header, (header.flags & STEM_FLAGS_READONLY) != 0, error);
+}
+
+/**
+ * @brief Deserializes an enum map from a binary stream
+ * 
+ * @param stream The input stream (FILE*)
+ * @param error Optional error output
+ * @return EnumMap* New enum map, or NULL on error
+ */
+EnumMap* stdem_deserialize(FILE* stream, StemError* error) {
+    if (!stream) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
         }
+        return NULL;
     }
-    
-    stem_unlock_map((EnumMap*)map);
-    
-    if (err != STEM_SUCCESS) {
-        stdem_destroy(new_map);
+    return stdem_deserialize_with(stem_file_read, stream, error);
+}
+
+/**
+ * @brief Deserializes an enum map from a memory buffer
+ * 
+ * The buffer is only read during the call, unlike with stdem_open_image().
+ * 
+ * @param buffer Serialized map
+ * @param size Size of the buffer in bytes
+ * @param error Optional error output
+ * @return EnumMap* New enum map, or NULL on error
+ */
+EnumMap* stdem_deserialize_from_buffer(const void* buffer, size_t size, StemError* error) {
+    if (!buffer) {
         if (error) {
-            *error = err;
+            *error = STEM_ERROR_INVALID_ARG;
         }
         return NULL;
     }
     
-    if (error) {
-        *error = STEM_SUCCESS;
-    }
-    return new_map;
+    StemBufferCursor cursor = { buffer, size, 0 };
+    return stdem_deserialize_with(stem_buffer_read, &cursor, error);
 }
 
 /**
- * @brief Merges two enum maps into a new one
+ * @brief Opens a serialized image in place as a read-only map
  * 
- * @param map1 First enum map
- * @param map2 Second enum map
- * @param overwrite If true, entries from map2 overwrite those in map1
+ * @param data Image written by stdem_serialize(), 8-byte aligned
+ * @param size Size of the image in bytes
  * @param error Optional error code output
- * @return EnumMap* New enum map containing merged associations, or NULL on failure
+ * @return EnumMap* Read-only map over the image, or NULL on failure
  */
-EnumMap* stdem_merge(const EnumMap* map1, const EnumMap* map2, 
-                    bool overwrite, StemError* error) {
-    if (!map1 || !map2) {
+EnumMap* stdem_open_image(const void* data, size_t size, StemError* error) {
+    const StemImageHeader* header = data;
+    if (!data || size < sizeof(StemImageHeader) || 
+        (uintptr_t)data % STEM_IMAGE_ALIGNMENT != 0 || 
+        stem_image_header_validate(header, size - sizeof(StemImageHeader)) != STEM_SUCCESS) {
         if (error) {
             *error = STEM_ERROR_INVALID_ARG;
         }
         return NULL;
     }
     
-    if (map1->value_size != map2->value_size) {
+    StemFrozen* frozen = (StemFrozen*)((const unsigned char*)data + sizeof(StemImageHeader));
+    if (stem_frozen_validate(frozen, header->block_size) != STEM_SUCCESS) {
         if (error) {
             *error = STEM_ERROR_INVALID_ARG;
         }
         return NULL;
     }
     
-    stem_lock_map((EnumMap*)map1);
-    stem_lock_map((EnumMap*)map2);
-    
-    StemFlags flags = map1->flags | map2->flags;
-    EnumMap* new_map = stdem_create_ex(map1->count + map2->count, 
-                                     map1->value_size, flags, error);
-    if (!new_map) {
-        stem_unlock_map((EnumMap*)map2);
-        stem_unlock_map((EnumMap*)map1);
+    return stem_image_map(frozen, header->flags, data, error);
+}
+
+/**
+ * @brief Maps a serialized image file into memory as a read-only map
+ * 
+ * @param path Path of a file written by stdem_serialize()
+ * @param error Optional error code output
+ * @return EnumMap* Read-only map over the file, or NULL on failure
+ */
+EnumMap* stdem_map_image(const char* path, StemError* error) {
+    if (!path) {
+        if (error) {
+            *error = STEM_ERROR_INVALID_ARG;
+        }
         return NULL;
     }
     
-    /* Copy from first map */
-    StemError err = STEM_SUCCESS;
-    for (size_t i = 0; i < map1->num_buckets; i++) {
-        EnumEntry* entry = map1->buckets[i];
-        while (entry) {
-            err = stdem_associate_ex(new_map, entry->enum_value, 
-                                   entry->value, entry->name);
-            if (err != STEM_SUCCESS) {
-                break;
-            }
-            entry = entry->next;
-        }
-        if (err != STEM_SUCCESS) {
-            break;
+#if STEM_HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (error) {
+            *error = STEM_ERROR_NOT_FOUND;
         }
+        return NULL;
     }
     
-    if (err != STEM_SUCCESS) {
-        stem_unlock_map((EnumMap*)map2);
-        stem_unlock_map((EnumMap*)map1);
-        stdem_destroy(new_map);
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    size_t size = 0;
+    if (fstat(fd, &info) == 0 && info.st_size > 0 && (uint64_t)info.st_size <= SIZE_MAX) {
+        size = (size_t)info.st_size;
+        mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    
+    if (mapping == MAP_FAILED) {
         if (error) {
-            *error = err;
+            *error = STEM_ERROR_INVALID_ARG;
         }
         return NULL;
     }
     
-    /* Copy from second map */
-    for (size_t i = 0; i < map2->num_buckets; i++) {
-        EnumEntry* entry = map2->buckets[i];
-        while (entry) {
-            /* Check if entry already exists in new map */
-            EnumEntry* existing = stem_find_entry(new_map, entry->enum_value);
-            if (existing) {
-                if (overwrite) {
-                    /* Update existing entry */
-                    if (new_map->value_size > 0) {
-                        memcpy(existing->value, entry->value, new_map->value_size);
-                    } else {
-                        existing->value = entry->value;
-                    }
-                    
-                    /* Update name if needed */
-                    if (existing->name) {
-                        free(existing->name);
-                    }
-                    if (entry->name && !(new_map->flags & STEM_FLAGS_NO_NAMES)) {
-                        existing->name = strdup(entry->name);
-                        if (!existing->name) {
-                            err = STEM_ERROR_OUT_OF_MEMORY;
-                            break;
-                        }
-                    } else {
-                        existing->name = NULL;
-                    }
-                }
-                /* If not overwriting, just skip this entry */
-            } else {
-                err = stdem_associate_ex(new_map, entry->enum_value, 
-                                       entry->value, entry->name);
-                if (err != STEM_SUCCESS) {
-                    break;
-                }
-            }
-            entry = entry->next;
-        }
-        if (err != STEM_SUCCESS) {
-            break;
-        }
+    EnumMap* map = stdem_open_image(mapping, size, error);
+    if (!map) {
+        munmap(mapping, size);
+        return NULL;
     }
-    
-    stem_unlock_map((EnumMap*)map2);
-    stem_unlock_map((EnumMap*)map1);
-    
-    if (err != STEM_SUCCESS) {
-        stdem_destroy(new_map);
+    map->image_mapped = size;
+    return map;
+#else
+    /* Without mmap, the block is read into one allocation instead */
+    FILE* stream = fopen(path, "rb");
+    if (!stream) {
         if (error) {
-            *error = err;
+            *error = STEM_ERROR_NOT_FOUND;
         }
         return NULL;
     }
     
-    if (error) {
-        *error = STEM_SUCCESS;
+    StemReader reader = { stem_file_read, stream };
+    StemImageHeader header;
+    EnumMap* map = NULL;
+    if (stem_read(&reader, &header, sizeof(header)) && 
+        stem_image_header_validate(&header, UINT64_MAX) == STEM_SUCCESS) {
+        map = stem_image_read(&reader, &header, true, error);
+    } else if (error) {
+        *error = STEM_ERROR_INVALID_ARG;
     }
-    return new_map;
+    fclose(stream);
+    return map;
+#endif
 }
 
+/* ==================== SHARED MEMORY MAPS ==================== */
+
 /**
- * @brief Returns the last error that occurred in the current thread
- * 
- * @return StemError Last error code
+ * @brief Returns the size of a shared region header, padded to a cache line
  */
-StemError stdem_get_last_error(void) {
-    /* Thread-local storage would be needed for proper implementation
-     * For maximum portability, we use a static variable
-     */
-    static StemError last_error = STEM_SUCCESS;
-    return last_error;
+static size_t stem_shared_header_size(void) {
+    return (sizeof(StemSharedHeader) + STEM_CACHE_LINE - 1) & ~(size_t)(STEM_CACHE_LINE - 1);
 }
 
 /**
- * @brief Returns a human-readable description of an error code
+ * @brief Checks that a shared region was initialized and fits its size
  * 
- * @param error Error code to describe
- * @return const char* String describing the error
+ * @param header Header at the start of the region
+ * @param size Size of the region as known to the caller
+ * @return StemError STEM_ERROR_UNINITIALIZED or STEM_ERROR_INVALID_ARG on failure
  */
-const char* stdem_error_string(StemError error) {
-    switch (error) {
-        case STEM_SUCCESS: return "Success";
-        case STEM_ERROR_INVALID_ARG: return "Invalid argument";
-        case STEM_ERROR_OUT_OF_MEMORY: return "Out of memory";
-        case STEM_ERROR_INDEX_OUT_OF_BOUNDS: return "Index out of bounds";
-        case STEM_ERROR_NOT_FOUND: return "Not found";
-        case STEM_ERROR_ALREADY_EXISTS: return "Already exists";
-        case STEM_ERROR_UNINITIALIZED: return "Uninitialized";
-        default: return "Unknown error";
+static StemError stem_shared_validate(const StemSharedHeader* header, size_t size) {
+    if (header->magic != STEM_SHARED_MAGIC || header->version != STEM_SHARED_VERSION) {
+        return STEM_ERROR_UNINITIALIZED;
+    }
+    if (header->size > size) {
+        return STEM_ERROR_INVALID_ARG;
+    }
+    for (int b = 0; b < 2; b++) {
+        if (header->offset[b] % STEM_IMAGE_ALIGNMENT != 0 || 
+            header->offset[b] > header->size || 
+            header->capacity[b] > header->size - header->offset[b]) {
+            return STEM_ERROR_INVALID_ARG;
+        }
     }
+    return STEM_SUCCESS;
 }
 
-/* ==================== ADDITIONAL UTILITY FUNCTIONS ==================== */
-
 /**
- * @brief Serializes an enum map to a binary stream
+ * @brief Returns the region size needed to publish images of a given size
  * 
- * @param map The enum map to serialize
- * @param stream The output stream (FILE*)
- * @return StemError Error code indicating success or failure
+ * @param image_size Largest image to publish, see stdem_serialized_size()
+ * @return size_t Region size in bytes, 0 on overflow
  */
-StemError stdem_serialize(const EnumMap* map, FILE* stream) {
-    if (!map || !stream) {
-        return STEM_ERROR_INVALID_ARG;
+size_t stdem_shared_region_size(size_t image_size) {
+    size_t header_size = stem_shared_header_size();
+    if (image_size > (SIZE_MAX - header_size) / 2 - STEM_CACHE_LINE) {
+        return 0;
     }
-    
-    stem_lock_map((EnumMap*)map);
-    
-    /* Write header: magic number, version, count, value_size, flags */
-    const uint32_t magic = 0x454E554D; /* 'ENUM' */
-    const uint16_t version = 1;
-    
-    if (fwrite(&magic, sizeof(magic), 1, stream) != 1 ||
-        fwrite(&version, sizeof(version), 1, stream) != 1 ||
-        fwrite(&map->count, sizeof(map->count), 1, stream) != 1 ||
-        fwrite(&map->value_size, sizeof(map->value_size), 1, stream) != 1 ||
-        fwrite(&map->flags, sizeof(map->flags), 1, stream) != 1) {
-        stem_unlock_map((EnumMap*)map);
+    size_t buffer = (image_size + STEM_CACHE_LINE - 1) & ~(size_t)(STEM_CACHE_LINE - 1);
+    return header_size + 2 * buffer;
+}
+
+/**
+ * @brief Initializes a shared region with two empty image buffers
+ * 
+ * @param region Start of the region, 8-byte aligned
+ * @param size Size of the region in bytes
+ * @return StemError Error code
+ */
+StemError stdem_shared_init(void* region, size_t size) {
+    size_t header_size = stem_shared_header_size();
+    if (!region || (uintptr_t)region % STEM_IMAGE_ALIGNMENT != 0 || 
+        size < header_size + 2 * STEM_CACHE_LINE || !STEM_HAVE_ATOMICS) {
         return STEM_ERROR_INVALID_ARG;
     }
     
-    /* Write entries */
-    for (size_t i = 0; i < map->num_buckets; i++) {
-        EnumEntry* entry = map->buckets[i];
-        while (entry) {
-            if (fwrite(&entry->enum_value, sizeof(entry->enum_value), 1, stream) != 1) {
-                stem_unlock_map((EnumMap*)map);
-                return STEM_ERROR_INVALID_ARG;
-            }
-            
-            /* Write name length and name */
-            uint16_t name_len = entry->name ? (uint16_t)strlen(entry->name) : 0;
-            if (fwrite(&name_len, sizeof(name_len), 1, stream) != 1) {
-                stem_unlock_map((EnumMap*)map);
-                return STEM_ERROR_INVALID_ARG;
-            }
-            
-            if (name_len > 0) {
-                if (fwrite(entry->name, 1, name_len, stream) != name_len) {
-                    stem_unlock_map((EnumMap*)map);
-                    return STEM_ERROR_INVALID_ARG;
-                }
-            }
-            
-            /* Write value */
-            if (map->value_size > 0) {
-                if (fwrite(entry->value, 1, map->value_size, stream) != map->value_size) {
-                    stem_unlock_map((EnumMap*)map);
-                    return STEM_ERROR_INVALID_ARG;
-                }
-            } else {
-                if (fwrite(&entry->value, sizeof(entry->value), 1, stream) != 1) {
-                    stem_unlock_map((EnumMap*)map);
-                    return STEM_ERROR_INVALID_ARG;
-                }
-            }
-            
-            entry = entry->next;
-        }
+    /* Buffers start on cache lines, away from the pin counters */
+    size_t capacity = ((size - header_size) / 2) & ~(size_t)(STEM_CACHE_LINE - 1);
+    StemSharedHeader* header = region;
+    memset(header, 0, sizeof(StemSharedHeader));
+    header->version = STEM_SHARED_VERSION;
+    header->size = size;
+    for (int b = 0; b < 2; b++) {
+        header->offset[b] = header_size + (size_t)b * capacity;
+        header->capacity[b] = capacity;
     }
     
-    stem_unlock_map((EnumMap*)map);
+#if STEM_HAVE_ATOMICS
+    /* The magic goes last so a concurrent attach never sees half a header */
+    STEM_ATOMIC_STORE_SEQ(&header->magic, STEM_SHARED_MAGIC);
+#endif
     return STEM_SUCCESS;
 }
 
 /**
- * @brief Deserializes an enum map from a binary stream
+ * @brief Serializes a map into the idle buffer of a region and makes it current
  * 
- * @param stream The input stream (FILE*)
- * @param error Optional error output
- * @return EnumMap* New enum map, or NULL on error
+ * @param region Region set up by stdem_shared_init()
+ * @param size Size of the region in bytes
+ * @param map The enum map to publish
+ * @return StemError STEM_ERROR_BUSY while readers hold the idle buffer
  */
-EnumMap* stdem_deserialize(FILE* stream, StemError* error) {
-    if (!stream) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
-        }
-        return NULL;
+StemError stdem_shared_publish(void* region, size_t size, const EnumMap* map) {
+    if (!region || !map || !STEM_HAVE_ATOMICS) {
+        return STEM_ERROR_INVALID_ARG;
     }
     
-    /* Read and validate header */
-    uint32_t magic;
-    uint16_t version;
-    size_t count;
-    size_t value_size;
-    StemFlags flags;
-    
-    if (fread(&magic, sizeof(magic), 1, stream) != 1 || magic != 0x454E554D) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
-        }
-        return NULL;
+    StemSharedHeader* header = region;
+    StemError err = stem_shared_validate(header, size);
+    if (err != STEM_SUCCESS) {
+        return err;
     }
     
-    if (fread(&version, sizeof(version), 1, stream) != 1 || version != 1) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
-        }
-        return NULL;
-    }
+#if STEM_HAVE_ATOMICS
+    /* The first image goes to buffer 0, later ones alternate */
+    int active = STEM_ATOMIC_LOAD_SEQ(&header->active);
+    int next = STEM_ATOMIC_LOAD_SEQ(&header->generation) ? 1 - active : 0;
     
-    if (fread(&count, sizeof(count), 1, stream) != 1 ||
-        fread(&value_size, sizeof(value_size), 1, stream) != 1 ||
-        fread(&flags, sizeof(flags), 1, stream) != 1) {
-        if (error) {
-            *error = STEM_ERROR_INVALID_ARG;
-        }
-        return NULL;
+    /*
+     * A reader pinning the idle buffer from now on sees it is not active
+     * and lets go of it, so only pins held from earlier generations block.
+     */
+    if (STEM_ATOMIC_LOAD_SEQ(&header->pins[next]) != 0) {
+        return STEM_ERROR_BUSY;
     }
     
-    /* Create new map */
-    EnumMap* map = stdem_create_ex(count, value_size, flags, error);
-    if (!map) {
-        return NULL;
+    unsigned char* buffer = (unsigned char*)region + header->offset[next];
+    size_t written;
+    err = stdem_serialize_to_buffer(map, buffer, (size_t)header->capacity[next], &written);
+    if (err != STEM_SUCCESS) {
+        return err;
     }
     
-    /* Read entries */
-    for (size_t i = 0; i < count; i++) {
-        int enum_value;
-        if (fread(&enum_value, sizeof(enum_value), 1, stream) != 1) {
-            stdem_destroy(map);
-            if (error) {
-                *error = STEM_ERROR_INVALID_ARG;
+    header->length[next] = written;
+    STEM_ATOMIC_STORE_SEQ(&header->active, next);
+    STEM_ATOMIC_ADD_SEQ(&header->generation, 1);
+#endif
+    return STEM_SUCCESS;
+}
+
+/**
+ * @brief Pins the current image of a region and opens it in place
+ * 
+ * @param region Region set up by stdem_shared_init()
+ * @param size Size of the region in bytes
+ * @param error Optional error code output
+ * @return EnumMap* Read-only map over the region, or NULL on failure
+ */
+EnumMap* stdem_shared_attach(void* region, size_t size, StemError* error) {
+    StemSharedHeader* header = region;
+    StemError err = region && STEM_HAVE_ATOMICS ? stem_shared_validate(header, size) : 
+                                                  STEM_ERROR_INVALID_ARG;
+    
+#if STEM_HAVE_ATOMICS
+    if (err == STEM_SUCCESS && STEM_ATOMIC_LOAD_SEQ(&header->generation) == 0) {
+        err = STEM_ERROR_NOT_FOUND;
+    }
+    if (err == STEM_SUCCESS) {
+        /* Retry until the pinned buffer is still the active one */
+        int active;
+        for (;;) {
+            active = STEM_ATOMIC_LOAD_SEQ(&header->active);
+            STEM_ATOMIC_ADD_SEQ(&header->pins[active], 1);
+            if (STEM_ATOMIC_LOAD_SEQ(&header->active) == active) {
+                break;
             }
-            return NULL;
+            STEM_ATOMIC_ADD_SEQ(&header->pins[active], -1);
         }
         
-        uint16_t name_len;
-        if (fread(&name_len, sizeof(name_len), 1, stream) != 1) {
-            stdem_destroy(map);
-            if (error) {
+        const unsigned char* buffer = (const unsigned char*)region + header->offset[active];
+        size_t length = (size_t)header->length[active];
+        EnumMap* map = length <= header->capacity[active] ? 
+                       stdem_open_image(buffer, length, error) : NULL;
+        if (!map) {
+            STEM_ATOMIC_ADD_SEQ(&header->pins[active], -1);
+            if (error && length > header->capacity[active]) {
                 *error = STEM_ERROR_INVALID_ARG;
             }
             return NULL;
         }
-        
-        char* name = NULL;
-        if (name_len > 0) {
-            name = malloc(name_len + 1);
-            if (!name) {
-                stdem_destroy(map);
-                if (error) {
-                    *error = STEM_ERROR_OUT_OF_MEMORY;
-                }
-                return NULL;
-            }
-            if (fread(name, 1, name_len, stream) != name_len) {
-                free(name);
-                stdem_destroy(map);
-                if (error) {
-                    *error = STEM_ERROR_INVALID_ARG;
-                }
-                return NULL;
-            }
-            name[name_len] = '\0';
-        }
-        
-        void* value;
-        if (value_size > 0) {
-            value = malloc(value_size);
-            if (!value) {
-                if (name) {
-                    free(name);
-                }
-                stdem_destroy(map);
-                if (error) {
-                    *error = STEM_ERROR_OUT_OF_MEMORY;
-                }
-                return NULL;
-            }
-            if (fread(value, 1, value_size, stream) != value_size) {
-                free(value);
-                if (name) {
-                    free(name);
-                }
-                stdem_destroy(map);
-                if (error) {
-                    *error = STEM_ERROR_INVALID_ARG;
-                }
-                return NULL;
-            }
-        } else {
-            if (fread(&value, sizeof(value), 1, stream) != 1) {
-                if (name) {
-                    free(name);
-                }
-                stdem_destroy(map);
-                if (error) {
-                    *error = STEM_ERROR_INVALID_ARG;
-                }
-                return NULL;
-            }
-        }
-        
-        StemError err = stdem_associate_ex(map, enum_value, value, name);
-        if (name) {
-            free(name);
-        }
-        if (value_size > 0) {
-            free(value);
-        }
-        
-        if (err != STEM_SUCCESS) {
-            stdem_destroy(map);
-            if (error) {
-                *error = err;
-            }
-            return NULL;
-        }
+        map->shared_pin = &header->pins[active];
+        return map;
     }
+#endif
     
     if (error) {
-        *error = STEM_SUCCESS;
+        *error = err;
     }
-    return map;
-}
\ No newline at end of file
+    return NULL;
+}
+
+/**
+ * @brief Returns the number of images published into a region
+ * 
+ * @param region Region set up by stdem_shared_init()
+ * @return uint64_t Publish count, 0 for invalid or empty regions
+ */
+uint64_t stdem_shared_generation(const void* region) {
+    const StemSharedHeader* header = region;
+    if (!region || header->magic != STEM_SHARED_MAGIC) {
+        return 0;
+    }
+#if STEM_HAVE_ATOMICS
+    return STEM_ATOMIC_LOAD_SEQ(&header->generation);
+#else
+    return 0;
+#endif
+}
@@ -5,12 +5,28 @@
  * @license LGPL-3.0-or-later
  */
 
+#if !defined(_POSIX_C_SOURCE) && (defined(__unix__) || defined(__APPLE__))
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <assert.h>
 #include "../include/stdem.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define TEST_HAVE_THREADS 1
+#else
+#define TEST_HAVE_THREADS 0
+#endif
+
 /* ==================== TEST DEFINES AND STRUCTURES ==================== */
 
 #define TEST_ASSERT(condition, message) \
@@ -56,6 +72,7 @@ static const size_t test_entries_count = sizeof(test_entries) / sizeof(test_entr
 // Global iterator function for testing
 static void test_iterator(int enum_value, const char* name, 
                          const void* value, size_t value_size, void* user_data) {
+    (void)value_size;
     size_t* count_ptr = (size_t*)user_data;
     (*count_ptr)++;
     
@@ -72,6 +89,83 @@ static void test_iterator(int enum_value, const char* name,
     assert(found);
 }
 
+// Iterator that only counts the visited entries
+static void count_iterator(int enum_value, const char* name, 
+                          const void* value, size_t value_size, void* user_data) {
+    (void)enum_value;
+    (void)name;
+    (void)value;
+    (void)value_size;
+    (*(size_t*)user_data)++;
+}
+
+// Iterator that records the visited enum values in order
+typedef struct {
+    int keys[4096];
+    size_t count;
+} KeyRecorder;
+
+static void record_iterator(int enum_value, const char* name, 
+                           const void* value, size_t value_size, void* user_data) {
+    (void)name;
+    (void)value;
+    (void)value_size;
+    KeyRecorder* recorder = (KeyRecorder*)user_data;
+    recorder->keys[recorder->count++] = enum_value;
+}
+
+// Iterator counting visits per value index, safe to run concurrently
+static void visit_iterator(int enum_value, const char* name, 
+                          const void* value, size_t value_size, void* user_data) {
+    (void)enum_value;
+    (void)name;
+    (void)value_size;
+    ((int*)user_data)[*(const int*)value]++;
+}
+
+// Executor running the tasks serially in reverse order
+static size_t reverse_runs = 0;
+
+static void reverse_run(StemTask task, void* context, size_t count, void* user_data) {
+    (void)user_data;
+    reverse_runs++;
+    while (count > 0) {
+        task(--count, context);
+    }
+}
+
+// Orders ints for qsort
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Allocator bookkeeping used by the allocator tests
+ */
+typedef struct {
+    size_t allocations;
+    size_t live_bytes;
+    bool exhausted;          /* Refuse every allocation while set */
+} CountingAllocator;
+
+static void* counting_allocate(size_t size, void* user_data) {
+    CountingAllocator* counter = (CountingAllocator*)user_data;
+    if (counter->exhausted) {
+        return NULL;
+    }
+    counter->allocations++;
+    counter->live_bytes += size;
+    return malloc(size);
+}
+
+static void counting_deallocate(void* ptr, size_t size, void* user_data) {
+    CountingAllocator* counter = (CountingAllocator*)user_data;
+    counter->live_bytes -= size;
+    free(ptr);
+}
+
 /* ==================== TEST CASES ==================== */
 
 /**
@@ -372,6 +466,2391 @@ static int test_find_by_name(void) {
     return 0;
 }
 
+/**
+ * @brief Test the name index through growth, copy, merge and clear
+ */
+static int test_name_index(void) {
+    StemError error;
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, STEM_FLAGS_OPEN_ADDRESSING };
+    char name[32];
+    
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(64, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Enough names to grow the index several times
+        for (int i = 0; i < 500; i++) {
+            sprintf(name, "NAME_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, i, &i, name) == STEM_SUCCESS,
+                        "Association should succeed");
+        }
+        for (int i = 0; i < 500; i++) {
+            sprintf(name, "NAME_%d", i);
+            TEST_ASSERT(stdem_find_by_name(map, name, &error) == i, "Should find name");
+        }
+        
+        // The first entry with a duplicated name wins
+        int dup = 0;
+        stdem_associate_ex(map, 1000, &dup, "NAME_7");
+        TEST_ASSERT(stdem_find_by_name(map, "NAME_7", &error) == 7, "First name should win");
+        
+        EnumMap* copy = stdem_copy(map, &error);
+        TEST_ASSERT(copy != NULL, "Copy failed");
+        TEST_ASSERT(stdem_find_by_name(copy, "NAME_499", &error) == 499, "Copy should index names");
+        
+        // Overwriting merge renames entries
+        EnumMap* renames = stdem_create_ex(4, sizeof(int), variants[v], &error);
+        TEST_ASSERT(renames != NULL, "Map creation failed");
+        stdem_associate_ex(renames, 3, &dup, "RENAMED");
+        EnumMap* merged = stdem_merge(map, renames, true, &error);
+        TEST_ASSERT(merged != NULL, "Merge failed");
+        TEST_ASSERT(stdem_find_by_name(merged, "RENAMED", &error) == 3, "Should find new name");
+        stdem_find_by_name(merged, "NAME_3", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Replaced name should be gone");
+        
+        stdem_clear(map);
+        stdem_find_by_name(map, "NAME_1", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Cleared map should not find names");
+        TEST_ASSERT(stdem_associate_ex(map, 2, &dup, "NAME_1") == STEM_SUCCESS, 
+                    "Association should succeed");
+        TEST_ASSERT(stdem_find_by_name(map, "NAME_1", &error) == 2, "Should find reused name");
+        
+        stdem_destroy(merged);
+        stdem_destroy(renames);
+        stdem_destroy(copy);
+        stdem_destroy(map);
+    }
+    
+    EnumMap* map = stdem_create_ex(4, sizeof(int), STEM_FLAGS_NO_NAMES, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    int value = 1;
+    stdem_associate_ex(map, 1, &value, "ONE");
+    stdem_find_by_name(map, "ONE", &error);
+    TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "NO_NAMES maps should not index names");
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test compiling maps into frozen perfect-hash maps
+ */
+static int test_freeze(void) {
+    StemError error;
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, STEM_FLAGS_OPEN_ADDRESSING };
+    char name[32];
+    
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(256, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Sparse keys, every third entry unnamed, one duplicated name
+        for (int i = 0; i < 1000; i++) {
+            int key = i * 37 - 5000;
+            sprintf(name, "KEY_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, key, &i, i % 3 ? name : NULL) == STEM_SUCCESS,
+                        "Association should succeed");
+        }
+        int dup = -1;
+        stdem_associate_ex(map, 123456, &dup, "KEY_1");
+        
+        EnumMap* frozen = stdem_freeze(map, &error);
+        TEST_ASSERT(frozen != NULL && error == STEM_SUCCESS, "Freeze failed");
+        stdem_destroy(map);
+        
+        TEST_ASSERT(stdem_count(frozen) == 1001, "Frozen count mismatch");
+        for (int i = 0; i < 1000; i++) {
+            int key = i * 37 - 5000;
+            const int* value = stdem_get_value_as(frozen, key, int);
+            TEST_ASSERT(value && *value == i, "Frozen value mismatch");
+            if (i % 3) {
+                sprintf(name, "KEY_%d", i);
+                TEST_ASSERT(strcmp(stdem_get_name_ex(frozen, key, &error), name) == 0,
+                            "Frozen name mismatch");
+                TEST_ASSERT(stdem_find_by_name(frozen, name, &error) == key,
+                            "Frozen name lookup mismatch");
+            } else {
+                TEST_ASSERT(stdem_get_name_ex(frozen, key, &error) == NULL,
+                            "Unnamed entry should stay unnamed");
+            }
+        }
+        TEST_ASSERT(stdem_find_by_name(frozen, "KEY_1", &error) == -4963, "First name should win");
+        TEST_ASSERT(strcmp(stdem_get_name_ex(frozen, 123456, &error), "KEY_1") == 0,
+                    "Duplicated name should be kept");
+        
+        stdem_get_value_ex(frozen, -4999, &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Missing key should not be found");
+        stdem_find_by_name(frozen, "KEY_0", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Missing name should not be found");
+        TEST_ASSERT(stdem_associate_ex(frozen, 1, &dup, NULL) == STEM_ERROR_INVALID_ARG,
+                    "Frozen maps should be immutable");
+        
+        size_t visited = 0;
+        stdem_foreach(frozen, count_iterator, &visited);
+        TEST_ASSERT(visited == 1001, "Foreach should visit every frozen entry");
+        
+        // Freezing a frozen map yields the same associations
+        EnumMap* refrozen = stdem_freeze(frozen, &error);
+        TEST_ASSERT(refrozen != NULL, "Refreeze failed");
+        TEST_ASSERT(stdem_find_by_name(refrozen, "KEY_2", &error) == -4926, "Refrozen lookup mismatch");
+        stdem_destroy(refrozen);
+        stdem_destroy(frozen);
+    }
+    
+    // Pointer storage and empty maps
+    EnumMap* map = stdem_create_ex(4, 0, STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    EnumMap* frozen = stdem_freeze(map, &error);
+    TEST_ASSERT(frozen != NULL && stdem_count(frozen) == 0, "Empty freeze failed");
+    stdem_get_value_ex(frozen, 0, &error);
+    TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Empty frozen map should find nothing");
+    stdem_destroy(frozen);
+    
+    static int target = 42;
+    stdem_associate_ex(map, 7, &target, "SEVEN");
+    frozen = stdem_freeze(map, &error);
+    TEST_ASSERT(frozen != NULL, "Freeze failed");
+    TEST_ASSERT(stdem_get_value_ex(frozen, 7, &error) == &target, "Pointer should be kept");
+    stdem_destroy(frozen);
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test batch lookups against single lookups on every backend
+ */
+static int test_batch_lookup(void) {
+    StemError error;
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, 
+                                   STEM_FLAGS_OPEN_ADDRESSING, STEM_FLAGS_THREAD_SAFE };
+    int keys[300];
+    const void* values[300];
+    bool present[300];
+    
+    for (size_t v = 0; v <= sizeof(variants) / sizeof(variants[0]); v++) {
+        // The extra round checks a frozen map
+        StemFlags flags = v < sizeof(variants) / sizeof(variants[0]) ? variants[v] : STEM_FLAGS_NONE;
+        EnumMap* map = stdem_create_ex(128, sizeof(int), flags, &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        for (int i = 0; i < 200; i += 2) {
+            stdem_associate_ex(map, i, &i, NULL);
+        }
+        int negative = -7;
+        stdem_associate_ex(map, negative, &negative, NULL);
+        if (v == sizeof(variants) / sizeof(variants[0])) {
+            EnumMap* frozen = stdem_freeze(map, &error);
+            TEST_ASSERT(frozen != NULL, "Freeze failed");
+            stdem_destroy(map);
+            map = frozen;
+        }
+        
+        // Every even key in [0, 200) and -7 are present
+        for (int i = 0; i < 300; i++) {
+            keys[i] = i - 20;
+        }
+        TEST_ASSERT(stdem_get_values_batch(map, keys, 300, values) == 101, "Batch count mismatch");
+        TEST_ASSERT(stdem_exists_batch(map, keys, 300, present) == 101, "Exists count mismatch");
+        TEST_ASSERT(stdem_exists_batch(map, keys, 300, NULL) == 101, "Exists-only count mismatch");
+        for (int i = 0; i < 300; i++) {
+            TEST_ASSERT(values[i] == stdem_get_value_ex(map, keys[i], NULL), "Batch value mismatch");
+            TEST_ASSERT(present[i] == (values[i] != NULL), "Presence mismatch");
+        }
+        
+        TEST_ASSERT(stdem_get_values_batch(map, keys, 0, NULL) == 0, "Empty batch should find nothing");
+        stdem_destroy(map);
+    }
+    
+    TEST_ASSERT(stdem_get_values_batch(NULL, keys, 1, values) == 0, "NULL map should find nothing");
+    return 0;
+}
+
+/**
+ * @brief Test bulk construction and the copies built on top of it
+ */
+static int test_bulk_load(void) {
+    StemError error;
+    int keys[500];
+    int data[500];
+    const void* values[500];
+    const char* names[500];
+    char name_storage[500][16];
+    
+    for (int i = 0; i < 500; i++) {
+        keys[i] = i * 3 - 100;
+        data[i] = i;
+        values[i] = &data[i];
+        sprintf(name_storage[i], "BULK_%d", i);
+        names[i] = i % 2 ? name_storage[i] : NULL;
+    }
+    
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, 
+                                   STEM_FLAGS_OPEN_ADDRESSING, STEM_FLAGS_READONLY };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_from_arrays(keys, values, names, 500, sizeof(int), 
+                                                variants[v], &error);
+        TEST_ASSERT(map != NULL && error == STEM_SUCCESS, "Bulk creation failed");
+        TEST_ASSERT(stdem_count(map) == 500, "Bulk count mismatch");
+        for (int i = 0; i < 500; i++) {
+            TEST_ASSERT(*stdem_get_value_as(map, keys[i], int) == i, "Bulk value mismatch");
+        }
+        TEST_ASSERT(stdem_find_by_name(map, "BULK_499", &error) == keys[499], "Bulk name mismatch");
+        
+        // Copies of read-only maps used to fail on their first association
+        EnumMap* copy = stdem_copy(map, &error);
+        TEST_ASSERT(copy != NULL && stdem_count(copy) == 500, "Copy failed");
+        TEST_ASSERT(stdem_find_by_name(copy, "BULK_1", &error) == keys[1], "Copied name mismatch");
+        
+        EnumMap* merged = stdem_merge(map, copy, true, &error);
+        TEST_ASSERT(merged != NULL && stdem_count(merged) == 500, "Merge failed");
+        
+        stdem_destroy(merged);
+        stdem_destroy(copy);
+        stdem_destroy(map);
+    }
+    
+    // Value and name arrays are optional
+    EnumMap* map = stdem_create_from_arrays(keys, NULL, NULL, 10, 0, STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL && stdem_count(map) == 10, "Bulk creation without values failed");
+    TEST_ASSERT(stdem_exists(map, keys[9]) == false, "NULL values read back as missing");
+    stdem_destroy(map);
+    
+    // Duplicates are rejected
+    int dup_keys[3] = { 1, 2, 1 };
+    map = stdem_create_from_arrays(dup_keys, NULL, NULL, 3, 0, STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map == NULL && error == STEM_ERROR_ALREADY_EXISTS, "Duplicate keys should fail");
+    
+    // Bulk association into an existing map
+    map = stdem_create_ex(4, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    TEST_ASSERT(stdem_associate_bulk(map, keys, values, names, 250) == STEM_SUCCESS, 
+                "Bulk association failed");
+    TEST_ASSERT(stdem_associate_bulk(map, keys + 250, values + 250, names + 250, 250) == STEM_SUCCESS, 
+                "Second bulk association failed");
+    TEST_ASSERT(stdem_count(map) == 500, "Bulk association count mismatch");
+    TEST_ASSERT(stdem_associate_bulk(map, keys, values, NULL, 1) == STEM_ERROR_ALREADY_EXISTS, 
+                "Existing keys should be rejected");
+    
+    // Copying an empty map works
+    stdem_clear(map);
+    EnumMap* copy = stdem_copy(map, &error);
+    TEST_ASSERT(copy != NULL && stdem_count(copy) == 0, "Empty copy failed");
+    stdem_destroy(copy);
+    stdem_destroy(map);
+    
+    map = stdem_create_ex(4, sizeof(int), STEM_FLAGS_READONLY, &error);
+    TEST_ASSERT(stdem_associate_bulk(map, keys, values, NULL, 1) == STEM_ERROR_INVALID_ARG, 
+                "Read-only maps should reject bulk association");
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test binary images: round trips, in-place opening and format checks
+ */
+static int test_image(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(8, sizeof(int), STEM_FLAGS_DENSE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    for (int i = 0; i < 8; i++) {
+        int value = i * 10;
+        stdem_associate_ex(map, i, &value, i % 2 ? "ODD" : NULL);
+    }
+    int far_value = -1;
+    stdem_associate_ex(map, 100000, &far_value, "FAR");
+    
+    // Mutable maps come back mutable, with their dense range
+    FILE* stream = tmpfile();
+    TEST_ASSERT(stream != NULL, "tmpfile failed");
+    TEST_ASSERT(stdem_serialize(map, stream) == STEM_SUCCESS, "Serialization failed");
+    long image_size = ftell(stream);
+    rewind(stream);
+    EnumMap* loaded = stdem_deserialize(stream, &error);
+    TEST_ASSERT(loaded != NULL && error == STEM_SUCCESS, "Deserialization failed");
+    TEST_ASSERT(stdem_count(loaded) == 9, "Loaded count mismatch");
+    TEST_ASSERT(*stdem_get_value_as(loaded, 7, int) == 70, "Loaded value mismatch");
+    TEST_ASSERT(stdem_find_by_name(loaded, "FAR", &error) == 100000, "Loaded name mismatch");
+    TEST_ASSERT(stdem_find_by_name(loaded, "ODD", &error) == 1, "First name should win");
+    int value = 5;
+    TEST_ASSERT(stdem_associate_ex(loaded, 8, &value, NULL) == STEM_SUCCESS, 
+                "Loaded map should be mutable");
+    stdem_destroy(loaded);
+    
+    // The image can be used in place
+    unsigned char* image = malloc((size_t)image_size);
+    TEST_ASSERT(image != NULL, "Image allocation failed");
+    rewind(stream);
+    TEST_ASSERT(fread(image, 1, (size_t)image_size, stream) == (size_t)image_size, "Image read failed");
+    fclose(stream);
+    
+    EnumMap* opened = stdem_open_image(image, (size_t)image_size, &error);
+    TEST_ASSERT(opened != NULL && error == STEM_SUCCESS, "Opening the image failed");
+    TEST_ASSERT(stdem_count(opened) == 9, "Opened count mismatch");
+    TEST_ASSERT(*stdem_get_value_as(opened, 100000, int) == -1, "Opened value mismatch");
+    TEST_ASSERT(strcmp(stdem_get_name(opened, 3), "ODD") == 0, "Opened name mismatch");
+    TEST_ASSERT(stdem_associate_ex(opened, 8, &value, NULL) != STEM_SUCCESS, 
+                "Opened images should be read-only");
+    EnumMap* copy = stdem_copy(opened, &error);
+    TEST_ASSERT(copy != NULL && stdem_count(copy) == 9, "Copying an opened image failed");
+    stdem_destroy(copy);
+    stdem_destroy(opened);
+    
+    // Damaged or foreign images are rejected
+    TEST_ASSERT(stdem_open_image(image, (size_t)image_size - 8, &error) == NULL && 
+                error == STEM_ERROR_INVALID_ARG, "Truncated image should be rejected");
+    image[0] ^= 0xFF;
+    TEST_ASSERT(stdem_open_image(image, (size_t)image_size, &error) == NULL, 
+                "Bad magic should be rejected");
+    image[0] ^= 0xFF;
+    
+    // Read-only maps come back frozen, also through a file mapping
+    const char* path = "test_stdem_image.bin";
+    EnumMap* frozen = stdem_freeze(map, &error);
+    stream = fopen(path, "wb");
+    TEST_ASSERT(stream != NULL, "fopen failed");
+    TEST_ASSERT(stdem_serialize(frozen, stream) == STEM_SUCCESS, "Frozen serialization failed");
+    fclose(stream);
+    stdem_destroy(frozen);
+    
+    EnumMap* mapped = stdem_map_image(path, &error);
+    TEST_ASSERT(mapped != NULL && error == STEM_SUCCESS, "Mapping the image failed");
+    TEST_ASSERT(*stdem_get_value_as(mapped, 4, int) == 40, "Mapped value mismatch");
+    TEST_ASSERT(stdem_find_by_name(mapped, "FAR", &error) == 100000, "Mapped name mismatch");
+    stdem_destroy(mapped);
+    
+    stream = fopen(path, "rb");
+    loaded = stdem_deserialize(stream, &error);
+    fclose(stream);
+    remove(path);
+    TEST_ASSERT(loaded != NULL && stdem_count(loaded) == 9, "Frozen deserialization failed");
+    TEST_ASSERT(stdem_associate_ex(loaded, 8, &value, NULL) != STEM_SUCCESS, 
+                "Read-only maps should stay read-only");
+    stdem_destroy(loaded);
+    TEST_ASSERT(stdem_map_image(path, &error) == NULL, "Missing files should fail");
+    
+    // Version 1 streams are still accepted
+    stream = tmpfile();
+    uint32_t magic = 0x454E554D;
+    uint16_t version = 1;
+    size_t count = 1;
+    size_t value_size = sizeof(int);
+    StemFlags flags = STEM_FLAGS_NONE;
+    int key = 42;
+    uint16_t name_len = 3;
+    value = 4242;
+    fwrite(&magic, sizeof(magic), 1, stream);
+    fwrite(&version, sizeof(version), 1, stream);
+    fwrite(&count, sizeof(count), 1, stream);
+    fwrite(&value_size, sizeof(value_size), 1, stream);
+    fwrite(&flags, sizeof(flags), 1, stream);
+    fwrite(&key, sizeof(key), 1, stream);
+    fwrite(&name_len, sizeof(name_len), 1, stream);
+    fwrite("OLD", 1, 3, stream);
+    fwrite(&value, sizeof(value), 1, stream);
+    rewind(stream);
+    loaded = stdem_deserialize(stream, &error);
+    fclose(stream);
+    TEST_ASSERT(loaded != NULL && *stdem_get_value_as(loaded, 42, int) == 4242, 
+                "Version 1 stream failed");
+    TEST_ASSERT(stdem_find_by_name(loaded, "OLD", &error) == 42, "Version 1 name mismatch");
+    stdem_destroy(loaded);
+    
+    free(image);
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Growable memory sink for the serialization callbacks
+ */
+typedef struct {
+    unsigned char data[4096];
+    size_t size;
+    size_t used;
+    size_t calls;
+} MemorySink;
+
+static size_t sink_write(const void* data, size_t size, void* user_data) {
+    MemorySink* sink = user_data;
+    sink->calls++;
+    if (size > sizeof(sink->data) - sink->size) {
+        return 0;
+    }
+    memcpy(sink->data + sink->size, data, size);
+    sink->size += size;
+    return size;
+}
+
+static size_t sink_read_trickle(void* data, size_t size, void* user_data) {
+    MemorySink* sink = user_data;
+    size_t n = size < 3 ? size : 3; // Short reads, like a socket
+    if (n > sink->size - sink->used) {
+        n = sink->size - sink->used;
+    }
+    memcpy(data, sink->data + sink->used, n);
+    sink->used += n;
+    return n;
+}
+
+/**
+ * @brief Test serialization to buffers and callbacks
+ */
+static int test_buffer_serialization(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(16, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    for (int i = 0; i < 20; i++) {
+        int value = i * i;
+        char name[16];
+        sprintf(name, "SQ_%d", i);
+        stdem_associate_ex(map, i - 5, &value, name);
+    }
+    
+    size_t size = stdem_serialized_size(map);
+    TEST_ASSERT(size > 0, "Serialized size failed");
+    unsigned char* buffer = malloc(size + 1);
+    TEST_ASSERT(buffer != NULL, "Buffer allocation failed");
+    
+    size_t written;
+    TEST_ASSERT(stdem_serialize_to_buffer(map, buffer, size - 1, &written) == STEM_ERROR_INDEX_OUT_OF_BOUNDS && 
+                written == size, "Short buffers should report the size needed");
+    TEST_ASSERT(stdem_serialize_to_buffer(map, buffer, size, &written) == STEM_SUCCESS && 
+                written == size, "Buffer serialization failed");
+    
+    EnumMap* loaded = stdem_deserialize_from_buffer(buffer, size, &error);
+    TEST_ASSERT(loaded != NULL && stdem_count(loaded) == 20, "Buffer deserialization failed");
+    TEST_ASSERT(*stdem_get_value_as(loaded, 14, int) == 361, "Buffer value mismatch");
+    TEST_ASSERT(stdem_find_by_name(loaded, "SQ_0", &error) == -5, "Buffer name mismatch");
+    stdem_destroy(loaded);
+    TEST_ASSERT(stdem_deserialize_from_buffer(buffer, size - 1, &error) == NULL, 
+                "Truncated buffers should fail");
+    
+    // The serialized bytes do not depend on the sink or on buffer alignment
+    MemorySink sink;
+    memset(&sink, 0, sizeof(sink));
+    TEST_ASSERT(stdem_serialize_with(map, sink_write, &sink) == STEM_SUCCESS, 
+                "Callback serialization failed");
+    TEST_ASSERT(sink.size == size && sink.calls == 2, "Callback should receive two pieces");
+    TEST_ASSERT(memcmp(sink.data, buffer, size) == 0, "Callback image mismatch");
+    TEST_ASSERT(stdem_serialize_to_buffer(map, buffer + 1, size, NULL) == STEM_SUCCESS, 
+                "Unaligned buffer serialization failed");
+    TEST_ASSERT(memcmp(sink.data, buffer + 1, size) == 0, "Unaligned image mismatch");
+    
+    loaded = stdem_deserialize_with(sink_read_trickle, &sink, &error);
+    TEST_ASSERT(loaded != NULL && stdem_count(loaded) == 20, "Callback deserialization failed");
+    stdem_destroy(loaded);
+    
+    // Frozen maps serialize their block as it is
+    EnumMap* frozen = stdem_freeze(map, &error);
+    TEST_ASSERT(stdem_serialized_size(frozen) == size, "Frozen size mismatch");
+    TEST_ASSERT(stdem_serialize_to_buffer(frozen, buffer, size, NULL) == STEM_SUCCESS, 
+                "Frozen buffer serialization failed");
+    loaded = stdem_deserialize_from_buffer(buffer, size, &error);
+    TEST_ASSERT(loaded != NULL && *stdem_get_value_as(loaded, 0, int) == 25, 
+                "Frozen buffer round trip failed");
+    stdem_destroy(loaded);
+    stdem_destroy(frozen);
+    
+    free(buffer);
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test name lookups by pointer and length
+ */
+static int test_find_by_name_n(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(64, 0, STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    
+    // Names of every length up to 40 exercise the word loop and the tail
+    char names[41][48];
+    for (int len = 1; len <= 40; len++) {
+        for (int i = 0; i < len; i++) {
+            names[len][i] = (char)('a' + (i * 7 + len) % 26);
+        }
+        names[len][len] = '\0';
+        TEST_ASSERT(stdem_associate_ex(map, len, NULL, names[len]) == STEM_SUCCESS, 
+                    "Association failed");
+    }
+    TEST_ASSERT(stdem_associate_ex(map, 100, NULL, "alpha") == STEM_SUCCESS, "Association failed");
+    TEST_ASSERT(stdem_associate_ex(map, 101, NULL, "alphabet") == STEM_SUCCESS, "Association failed");
+    TEST_ASSERT(stdem_associate_ex(map, 102, NULL, "") == STEM_SUCCESS, "Association failed");
+    
+    EnumMap* frozen = stdem_freeze(map, &error);
+    TEST_ASSERT(frozen != NULL, "Freeze failed");
+    const EnumMap* maps[2] = { map, frozen };
+    
+    for (int m = 0; m < 2; m++) {
+        const EnumMap* target = maps[m];
+        
+        // Tokens sliced out of a larger buffer, not NUL-terminated
+        const char* line = "GET alphabet alpha";
+        TEST_ASSERT(stdem_find_by_name_n(target, line + 4, 8, &error) == 101, "Slice lookup failed");
+        TEST_ASSERT(stdem_find_by_name_n(target, line + 4, 5, &error) == 100, "Prefix slice failed");
+        TEST_ASSERT(stdem_find_by_name_n(target, line + 13, 5, &error) == 100, "Last slice failed");
+        stdem_find_by_name_n(target, line + 4, 4, &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Partial names should not match");
+        stdem_find_by_name_n(target, "alpha\0bet", 9, &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Embedded NUL should not match");
+        TEST_ASSERT(stdem_find_by_name_n(target, NULL, 0, &error) == 102 && error == STEM_SUCCESS, 
+                    "Empty name lookup failed");
+        
+        for (int len = 1; len <= 40; len++) {
+            char token[48];
+            memcpy(token, names[len], (size_t)len);
+            token[len] = 'Z';
+            TEST_ASSERT(stdem_find_by_name_n(target, token, (size_t)len, &error) == len, 
+                        "Length-delimited lookup failed");
+            TEST_ASSERT(stdem_find_by_name(target, names[len], &error) == len, 
+                        "NUL-terminated lookup failed");
+        }
+        
+        // Prefixes of a stored name pointer only match entries named by the prefix
+        for (int len = 2; len <= 40; len++) {
+            const char* stored = stdem_get_name_ex(target, len, &error);
+            TEST_ASSERT(stored != NULL, "Stored name missing");
+            for (int prefix = 1; prefix < len; prefix++) {
+                int found = stdem_find_by_name_n(target, stored, (size_t)prefix, &error);
+                const char* match = error == STEM_SUCCESS ? 
+                                    stdem_get_name_ex(target, found, NULL) : NULL;
+                TEST_ASSERT(error == STEM_ERROR_NOT_FOUND || 
+                            (match && strlen(match) == (size_t)prefix && 
+                             memcmp(match, stored, (size_t)prefix) == 0), 
+                            "Stored pointer prefix should not match the full name");
+            }
+        }
+        const char* alphabet = stdem_get_name_ex(target, 101, &error);
+        TEST_ASSERT(stdem_find_by_name_n(target, alphabet, 5, &error) == 100, 
+                    "Stored pointer prefix naming another entry failed");
+        stdem_find_by_name_n(target, alphabet, 4, &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Stored pointer prefix should not match");
+    }
+    
+    stdem_find_by_name_n(map, NULL, 3, &error);
+    TEST_ASSERT(error == STEM_ERROR_INVALID_ARG, "NULL name with a length should fail");
+    
+    stdem_destroy(frozen);
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test name interning shared between derived maps
+ */
+static int test_string_pool(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(8, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    
+    // Equal names are interned once, even within one map
+    int values[4] = { 10, 20, 30, 40 };
+    char buffer[16];
+    strcpy(buffer, "RED");
+    TEST_ASSERT(stdem_associate_ex(map, 0, &values[0], buffer) == STEM_SUCCESS, "Associate failed");
+    TEST_ASSERT(stdem_associate_ex(map, 1, &values[1], "RED") == STEM_SUCCESS, "Associate failed");
+    TEST_ASSERT(stdem_associate_ex(map, 2, &values[2], "GREEN") == STEM_SUCCESS, "Associate failed");
+    strcpy(buffer, "XXX");
+    TEST_ASSERT(strcmp(stdem_get_name(map, 0), "RED") == 0, "Name was not copied");
+    TEST_ASSERT(stdem_get_name(map, 0) == stdem_get_name(map, 1), "Equal names not interned");
+    TEST_ASSERT(stdem_find_by_name(map, "RED", &error) == 0, "First name should win");
+    
+    // Copies and merges reference the same strings
+    EnumMap* copy = stdem_copy(map, &error);
+    TEST_ASSERT(copy != NULL, "Copy failed");
+    TEST_ASSERT(stdem_get_name(copy, 2) == stdem_get_name(map, 2), "Copy duplicated a name");
+    
+    EnumMap* other = stdem_create_sharing_names(map, 8, sizeof(int), STEM_FLAGS_OPEN_ADDRESSING, 
+                                                &error);
+    TEST_ASSERT(other != NULL && error == STEM_SUCCESS, "Sharing creation failed");
+    TEST_ASSERT(stdem_associate_ex(other, 7, &values[3], "GREEN") == STEM_SUCCESS, "Associate failed");
+    TEST_ASSERT(stdem_associate_ex(other, 8, &values[3], "BLUE") == STEM_SUCCESS, "Associate failed");
+    TEST_ASSERT(stdem_get_name(other, 7) == stdem_get_name(map, 2), "Shared pool not used");
+    
+    EnumMap* merged = stdem_merge(copy, other, true, &error);
+    TEST_ASSERT(merged != NULL, "Merge failed");
+    TEST_ASSERT(stdem_get_name(merged, 8) == stdem_get_name(other, 8), "Merge duplicated a name");
+    TEST_ASSERT(stdem_find_by_name(merged, "BLUE", &error) == 8, "Merged name lookup failed");
+    
+    // Names outlive the map that interned them and survive clearing
+    const char* blue = stdem_get_name(other, 8);
+    stdem_destroy(other);
+    TEST_ASSERT(stdem_clear(map) == STEM_SUCCESS, "Clear failed");
+    stdem_destroy(map);
+    TEST_ASSERT(strcmp(stdem_get_name(merged, 8), "BLUE") == 0, "Shared name was freed");
+    TEST_ASSERT(stdem_get_name(merged, 8) == blue, "Shared name moved");
+    TEST_ASSERT(stdem_find_by_name(copy, "GREEN", &error) == 2, "Copy lookup failed");
+    
+    // Frozen sources carry no pool; their copies intern afresh
+    EnumMap* frozen = stdem_freeze(copy, &error);
+    TEST_ASSERT(frozen != NULL, "Freeze failed");
+    EnumMap* thawed = stdem_copy(frozen, &error);
+    TEST_ASSERT(thawed != NULL, "Frozen copy failed");
+    TEST_ASSERT(stdem_get_name(thawed, 0) == stdem_get_name(thawed, 1), "Thawed names not interned");
+    TEST_ASSERT(stdem_find_by_name(thawed, "RED", &error) == 0, "Thawed lookup failed");
+    
+    TEST_ASSERT(stdem_create_sharing_names(NULL, 8, 0, STEM_FLAGS_NONE, &error) == NULL && 
+                error == STEM_ERROR_INVALID_ARG, "NULL source should fail");
+    
+    stdem_destroy(thawed);
+    stdem_destroy(frozen);
+    stdem_destroy(merged);
+    stdem_destroy(copy);
+    return 0;
+}
+
+/**
+ * @brief Test inline value copies across storage backends
+ */
+static int test_inline_values(void) {
+    typedef struct { double weight; char tag[13]; } Wide;
+    StemError error;
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, STEM_FLAGS_OPEN_ADDRESSING };
+    
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        // Start small so the table grows and moves its inline values
+        EnumMap* wide = stdem_create_ex(4, sizeof(Wide), variants[v], &error);
+        EnumMap* tiny = stdem_create_ex(4, 3, variants[v], &error);
+        TEST_ASSERT(wide != NULL && tiny != NULL, "Map creation failed");
+        
+        for (int i = 0; i < 200; i++) {
+            Wide w;
+            memset(&w, 0, sizeof(w));
+            w.weight = i * 0.5;
+            sprintf(w.tag, "W%d", i);
+            unsigned char bytes[3] = { (unsigned char)i, (unsigned char)(i >> 8), 0xAB };
+            TEST_ASSERT(stdem_associate_ex(wide, i - 50, &w, NULL) == STEM_SUCCESS, "Wide associate failed");
+            TEST_ASSERT(stdem_associate_ex(tiny, i - 50, bytes, NULL) == STEM_SUCCESS, "Tiny associate failed");
+        }
+        
+        for (int i = 0; i < 200; i++) {
+            const Wide* w = stdem_get_value_as(wide, i - 50, Wide);
+            char tag[13];
+            sprintf(tag, "W%d", i);
+            TEST_ASSERT(w != NULL && w->weight == i * 0.5 && strcmp(w->tag, tag) == 0, 
+                        "Wide value mismatch");
+            TEST_ASSERT((uintptr_t)w % sizeof(double) == 0, "Inline value misaligned");
+            
+            const unsigned char* bytes = stdem_get_value(tiny, i - 50);
+            TEST_ASSERT(bytes != NULL && bytes[0] == (unsigned char)i && 
+                        bytes[1] == (unsigned char)(i >> 8) && bytes[2] == 0xAB, 
+                        "Tiny value mismatch");
+        }
+        
+        stdem_destroy(tiny);
+        stdem_destroy(wide);
+    }
+    
+    stdem_create_ex(4, (size_t)-1, STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(error == STEM_ERROR_INVALID_ARG, "Oversized values should be rejected");
+    return 0;
+}
+
+/**
+ * @brief Test layout statistics and lookup counters
+ */
+static int test_stats(void) {
+    StemError error;
+    StemStats stats;
+    int values[100];
+    
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_OPEN_ADDRESSING };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(1, sizeof(int), variants[v] | STEM_FLAGS_STATS, &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        char name[16];
+        for (int i = 0; i < 100; i++) {
+            values[i] = i;
+            sprintf(name, "STAT_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, i * 7, &values[i], name) == STEM_SUCCESS, 
+                        "Associate failed");
+        }
+        
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.count == 100 && stats.dense_count == 0, "Stats count mismatch");
+        TEST_ASSERT(stats.resize_count > 0, "Growth should count resizes");
+        TEST_ASSERT(stats.load_factor > 0.0 && stats.load_factor <= 1.0 && 
+                    stats.load_factor == 100.0 / (double)stats.table_capacity, "Load factor mismatch");
+        TEST_ASSERT(stats.max_probe >= 1 && stats.avg_probe >= 1.0 && 
+                    stats.avg_probe <= (double)stats.max_probe, "Probe lengths out of range");
+        TEST_ASSERT(stats.name_count == 100 && stats.name_capacity >= 100, "Name stats mismatch");
+        TEST_ASSERT(stats.heap_bytes > 100 * sizeof(int) && stats.pool_bytes > 0 && 
+                    stats.pool_maps == 1 && stats.image_bytes == 0, "Memory stats mismatch");
+        
+        // Every kind of lookup is counted
+        stdem_get_value(map, 7);
+        stdem_get_value(map, 8);
+        int keys[4] = { 0, 14, 1, 2 };
+        const void* found[4];
+        stdem_get_values_batch(map, keys, 4, found);
+        stdem_find_by_name(map, "STAT_3", &error);
+        stdem_find_by_name(map, "STAT_X", &error);
+        
+        EnumMap* copy = stdem_copy(map, &error);
+        TEST_ASSERT(copy != NULL, "Copy failed");
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.lookup_hits == 3 && stats.lookup_misses == 3, "Value counters mismatch");
+        TEST_ASSERT(stats.name_hits == 1 && stats.name_misses == 1, "Name counters mismatch");
+        TEST_ASSERT(stats.pool_maps == 2, "Copy should share the pool");
+        
+        TEST_ASSERT(stdem_reset_stats(map) == STEM_SUCCESS, "Reset failed");
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.lookup_hits == 0 && stats.lookup_misses == 0 && 
+                    stats.name_hits == 0 && stats.name_misses == 0, "Counters not reset");
+        
+        // Frozen maps resolve every entry with one probe; only named ones are indexed
+        int unnamed = 1000;
+        TEST_ASSERT(stdem_associate_ex(copy, unnamed, &unnamed, NULL) == STEM_SUCCESS, 
+                    "Unnamed insert failed");
+        EnumMap* frozen = stdem_freeze(copy, &error);
+        TEST_ASSERT(frozen != NULL, "Freeze failed");
+        stdem_get_value(frozen, 7);
+        TEST_ASSERT(stdem_get_stats(frozen, &stats) == STEM_SUCCESS, "Frozen stats failed");
+        TEST_ASSERT(stats.count == 101 && stats.table_capacity == 101 && stats.max_probe == 1 && 
+                    stats.avg_probe == 1.0 && stats.load_factor == 1.0, "Frozen layout mismatch");
+        TEST_ASSERT(stats.name_count == 100 && stats.name_capacity == 100, 
+                    "Frozen name index mismatch");
+        TEST_ASSERT(stats.lookup_hits == 1 && stats.pool_maps == 0, "Frozen counters mismatch");
+        
+        stdem_destroy(frozen);
+        stdem_destroy(copy);
+        stdem_destroy(map);
+    }
+    
+    // Dense entries are reported apart; counters stay off without the flag
+    EnumMap* dense = stdem_create_ex(16, sizeof(int), STEM_FLAGS_DENSE, &error);
+    TEST_ASSERT(dense != NULL, "Dense creation failed");
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT(stdem_associate_ex(dense, i, &values[i], NULL) == STEM_SUCCESS, "Associate failed");
+    }
+    stdem_get_value(dense, 3);
+    TEST_ASSERT(stdem_get_stats(dense, &stats) == STEM_SUCCESS, "Dense stats failed");
+    TEST_ASSERT(stats.dense_count == 16 && stats.dense_capacity == 16 && stats.count == 20, 
+                "Dense stats mismatch");
+    TEST_ASSERT(stats.load_factor == 4.0 / (double)stats.table_capacity, "Dense load factor mismatch");
+    TEST_ASSERT(stats.lookup_hits == 0, "Counters should be off without STEM_FLAGS_STATS");
+    stdem_destroy(dense);
+    
+    TEST_ASSERT(stdem_get_stats(NULL, &stats) == STEM_ERROR_INVALID_ARG, "NULL map should fail");
+    TEST_ASSERT(stdem_reset_stats(NULL) == STEM_ERROR_INVALID_ARG, "NULL reset should fail");
+    return 0;
+}
+
+/**
+ * @brief Test cursor iteration against stdem_foreach on every backend
+ */
+static int test_cursor_iteration(void) {
+    StemError error;
+    int values[200];
+    
+    const StemFlags variants[] = { STEM_FLAGS_DENSE, STEM_FLAGS_OPEN_ADDRESSING, 
+                                   STEM_FLAGS_THREAD_SAFE, STEM_FLAGS_COPY_VALUES };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(32, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Keys inside and far outside the dense range
+        char name[16];
+        for (int i = 0; i < 200; i++) {
+            int key = i < 32 ? i : i * 1000;
+            values[i] = key;
+            sprintf(name, "ITER_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, key, &values[i], name) == STEM_SUCCESS, 
+                        "Associate failed");
+        }
+        
+        EnumMap* frozen = stdem_freeze(map, &error);
+        TEST_ASSERT(frozen != NULL, "Freeze failed");
+        
+        const EnumMap* maps[] = { map, frozen };
+        for (size_t m = 0; m < 2; m++) {
+            KeyRecorder expected = { {0}, 0 };
+            TEST_ASSERT(stdem_foreach(maps[m], record_iterator, &expected) == STEM_SUCCESS, 
+                        "Foreach failed");
+            
+            // Single steps visit the same entries in the same order
+            StemIter iter;
+            StemItem item;
+            size_t count = 0;
+            TEST_ASSERT(stdem_iter_begin(maps[m], &iter) == STEM_SUCCESS, "Iter begin failed");
+            while (stdem_iter_next(&iter, &item)) {
+                TEST_ASSERT(count < expected.count && item.enum_value == expected.keys[count], 
+                            "Iteration order mismatch");
+                TEST_ASSERT(*(const int*)item.value == item.enum_value, "Item value mismatch");
+                TEST_ASSERT(item.name && stdem_find_by_name(maps[m], item.name, &error) == item.enum_value, 
+                            "Item name mismatch");
+                count++;
+            }
+            TEST_ASSERT(count == 200 && !stdem_iter_next(&iter, &item), "Iteration count mismatch");
+            stdem_iter_end(&iter);
+            stdem_iter_end(&iter);
+            
+            // Batches of an odd size cover the backends' boundaries
+            StemItem items[7];
+            size_t n;
+            count = 0;
+            TEST_ASSERT(stdem_iter_begin(maps[m], &iter) == STEM_SUCCESS, "Iter begin failed");
+            while ((n = stdem_iter_next_batch(&iter, items, 7)) > 0) {
+                for (size_t i = 0; i < n; i++) {
+                    TEST_ASSERT(items[i].enum_value == expected.keys[count + i], "Batch order mismatch");
+                }
+                count += n;
+            }
+            stdem_iter_end(&iter);
+            TEST_ASSERT(count == 200, "Batch count mismatch");
+        }
+        
+        stdem_destroy(frozen);
+        stdem_destroy(map);
+    }
+    
+    EnumMap* empty = stdem_create(4, 0);
+    StemIter iter;
+    StemItem item;
+    TEST_ASSERT(stdem_iter_begin(empty, &iter) == STEM_SUCCESS, "Empty begin failed");
+    TEST_ASSERT(!stdem_iter_next(&iter, &item), "Empty map should yield nothing");
+    stdem_iter_end(&iter);
+    stdem_destroy(empty);
+    
+    TEST_ASSERT(stdem_iter_begin(NULL, &iter) == STEM_ERROR_INVALID_ARG, "NULL map should fail");
+    TEST_ASSERT(!stdem_iter_next(&iter, &item), "Failed begin should yield nothing");
+    TEST_ASSERT(stdem_iter_next_batch(NULL, &item, 1) == 0, "NULL cursor should yield nothing");
+    stdem_iter_end(NULL);
+    return 0;
+}
+
+/**
+ * @brief Test parallel iteration, copy and merge on every backend
+ */
+static int test_parallel(void) {
+    StemError error;
+    int values[300];
+    int visits[300];
+    for (int i = 0; i < 300; i++) {
+        values[i] = i;
+    }
+    
+    StemExecutor executors[3];
+    executors[0] = stdem_thread_executor(4);
+    executors[1].run = reverse_run;
+    executors[1].workers = 5;
+    executors[1].user_data = NULL;
+    executors[2] = stdem_thread_executor(1);
+    TEST_ASSERT(stdem_thread_executor(0).workers >= 1, "Default executor needs a worker");
+    
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, 
+                                   STEM_FLAGS_OPEN_ADDRESSING, STEM_FLAGS_THREAD_SAFE };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(32, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Keys inside and far outside the dense range, a quarter unnamed
+        char name[16];
+        for (int i = 0; i < 300; i++) {
+            sprintf(name, "PAR_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, i < 32 ? i : i * 1000, &values[i], 
+                                           i % 4 ? name : NULL) == STEM_SUCCESS, "Associate failed");
+        }
+        EnumMap* frozen = stdem_freeze(map, &error);
+        TEST_ASSERT(frozen != NULL, "Freeze failed");
+        
+        EnumMap* delta = stdem_create_ex(8, sizeof(int), variants[v], &error);
+        TEST_ASSERT(delta != NULL, "Delta creation failed");
+        TEST_ASSERT(stdem_associate_ex(delta, 5, &values[299], "PAR_NEW") == STEM_SUCCESS && 
+                    stdem_associate_ex(delta, -7, &values[1], NULL) == STEM_SUCCESS, 
+                    "Delta associate failed");
+        
+        for (size_t e = 0; e < 3; e++) {
+            const EnumMap* sources[] = { map, frozen };
+            for (size_t m = 0; m < 2; m++) {
+                // Every entry is visited exactly once
+                memset(visits, 0, sizeof(visits));
+                TEST_ASSERT(stdem_foreach_parallel(sources[m], visit_iterator, visits, 
+                                                   &executors[e]) == STEM_SUCCESS, 
+                            "Parallel foreach failed");
+                for (int i = 0; i < 300; i++) {
+                    TEST_ASSERT(visits[i] == 1, "Entry visited more or less than once");
+                }
+                
+                // The copy holds the same associations, and a mutable source's copy stays mutable
+                EnumMap* copy = stdem_copy_parallel(sources[m], &executors[e], &error);
+                TEST_ASSERT(copy != NULL && error == STEM_SUCCESS, "Parallel copy failed");
+                TEST_ASSERT(stdem_count(copy) == 300, "Copy count mismatch");
+                for (int i = 0; i < 300; i++) {
+                    int key = i < 32 ? i : i * 1000;
+                    const int* value = stdem_get_value_as(copy, key, int);
+                    TEST_ASSERT(value && *value == i, "Copy value mismatch");
+                    if (i % 4) {
+                        sprintf(name, "PAR_%d", i);
+                        TEST_ASSERT(stdem_find_by_name(copy, name, &error) == key, "Copy name mismatch");
+                    }
+                }
+                TEST_ASSERT(sources[m] == frozen || 
+                            (stdem_associate_ex(copy, 77777, &values[0], "PAR_EXTRA") == STEM_SUCCESS && 
+                             stdem_find_by_name(copy, "PAR_EXTRA", &error) == 77777 && 
+                             stdem_count(copy) == 301), "Copy should stay mutable");
+                stdem_destroy(copy);
+            }
+            
+            // Same associations as the serial merge
+            EnumMap* serial = stdem_merge(map, delta, true, &error);
+            EnumMap* merged = stdem_merge_parallel(map, delta, true, &executors[e], &error);
+            TEST_ASSERT(serial && merged && error == STEM_SUCCESS, "Parallel merge failed");
+            TEST_ASSERT(stdem_count(merged) == 301 && stdem_count(serial) == 301, "Merge count mismatch");
+            TEST_ASSERT(*stdem_get_value_as(merged, 5, int) == 299 && 
+                        *stdem_get_value_as(merged, -7, int) == 1, "Merge values mismatch");
+            TEST_ASSERT(stdem_find_by_name(merged, "PAR_NEW", &error) == 5 && 
+                        stdem_find_by_name(merged, "PAR_41", &error) == 41000, "Merge names mismatch");
+            for (int i = 0; i < 300; i++) {
+                int key = i < 32 ? i : i * 1000;
+                TEST_ASSERT(*stdem_get_value_as(merged, key, int) == *stdem_get_value_as(serial, key, int), 
+                            "Merge differs from stdem_merge");
+            }
+            stdem_destroy(merged);
+            stdem_destroy(serial);
+        }
+        
+        stdem_destroy(delta);
+        stdem_destroy(frozen);
+        stdem_destroy(map);
+    }
+    TEST_ASSERT(reverse_runs > 0, "Custom executor was not used");
+    
+    TEST_ASSERT(stdem_foreach_parallel(NULL, visit_iterator, visits, NULL) == STEM_ERROR_INVALID_ARG, 
+                "NULL map should fail");
+    TEST_ASSERT(stdem_copy_parallel(NULL, NULL, &error) == NULL && error == STEM_ERROR_INVALID_ARG, 
+                "NULL copy should fail");
+    TEST_ASSERT(stdem_merge_parallel(NULL, NULL, false, NULL, &error) == NULL && 
+                error == STEM_ERROR_INVALID_ARG, "NULL merge should fail");
+    return 0;
+}
+
+/**
+ * @brief Checks that a range scan returns exactly the sorted keys in [lo, hi]
+ */
+static int check_range(const EnumMap* map, const int* sorted, size_t n, int lo, int hi) {
+    static KeyRecorder recorder;
+    recorder.count = 0;
+    TEST_ASSERT(stdem_foreach_range(map, lo, hi, record_iterator, &recorder) == STEM_SUCCESS, 
+                "Range scan failed");
+    
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (sorted[i] >= lo && sorted[i] <= hi) {
+            TEST_ASSERT(expected < recorder.count && recorder.keys[expected] == sorted[i], 
+                        "Range scan order mismatch");
+            expected++;
+        }
+    }
+    TEST_ASSERT(recorder.count == expected, "Range scan count mismatch");
+    return 0;
+}
+
+/**
+ * @brief Test ordered range scans with and without an ordered index
+ */
+static int test_ordered_range(void) {
+    StemError error;
+    static int keys[3000];
+    static int sorted[3000];
+    
+    // Distinct keys spread over negative, dense and large values
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < 3000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        keys[i] = (int)(i * 1000) - 500500 + (int)(seed % 100) * 4;
+        if (i < 40) {
+            keys[i] = (int)i * 3;
+        }
+    }
+    memcpy(sorted, keys, sizeof(keys));
+    qsort(sorted, 3000, sizeof(int), compare_ints);
+    
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, STEM_FLAGS_OPEN_ADDRESSING };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        for (int ordered = 0; ordered < 2; ordered++) {
+            StemFlags flags = variants[v] | (ordered ? STEM_FLAGS_ORDERED : STEM_FLAGS_NONE);
+            EnumMap* map = stdem_create_ex(128, sizeof(int), flags, &error);
+            TEST_ASSERT(map != NULL, "Map creation failed");
+            for (size_t i = 0; i < 3000; i++) {
+                TEST_ASSERT(stdem_associate_ex(map, keys[i], &keys[i], NULL) == STEM_SUCCESS, 
+                            "Associate failed");
+            }
+            
+            if (check_range(map, sorted, 3000, -3000, 5000) || 
+                check_range(map, sorted, 3000, 0, 127) || 
+                check_range(map, sorted, 3000, 100, 2000) || 
+                check_range(map, sorted, 3000, 5, 4)) {
+                return 1;
+            }
+            
+            if (ordered) {
+                EnumMap* frozen = stdem_freeze(map, &error);
+                EnumMap* copy = stdem_copy(map, &error);
+                StemExecutor executor = stdem_thread_executor(3);
+                EnumMap* parallel = stdem_copy_parallel(map, &executor, &error);
+                TEST_ASSERT(frozen && copy && parallel, "Derived maps failed");
+                
+                const EnumMap* maps[] = { map, frozen, copy, parallel };
+                for (size_t m = 0; m < 4; m++) {
+                    if (check_range(maps[m], sorted, 3000, INT_MIN, INT_MAX) || 
+                        check_range(maps[m], sorted, 3000, -123456, 1234567) || 
+                        check_range(maps[m], sorted, 3000, INT_MAX, INT_MAX)) {
+                        return 1;
+                    }
+                }
+                
+                // Serialized images keep the flag and rebuild the index
+                size_t size = stdem_serialized_size(frozen);
+                void* buffer = malloc(size);
+                TEST_ASSERT(buffer && stdem_serialize_to_buffer(frozen, buffer, size, NULL) == STEM_SUCCESS, 
+                            "Serialize failed");
+                EnumMap* image = stdem_open_image(buffer, size, &error);
+                TEST_ASSERT(image != NULL, "Open image failed");
+                if (check_range(image, sorted, 3000, -123456, 1234567)) {
+                    return 1;
+                }
+                stdem_destroy(image);
+                free(buffer);
+                
+                stdem_destroy(parallel);
+                stdem_destroy(copy);
+                stdem_destroy(frozen);
+                
+                // A cleared map starts a new index
+                TEST_ASSERT(stdem_clear(map) == STEM_SUCCESS, "Clear failed");
+                TEST_ASSERT(stdem_associate_ex(map, 1 << 20, &keys[0], NULL) == STEM_SUCCESS && 
+                            stdem_associate_ex(map, -(1 << 20), &keys[1], NULL) == STEM_SUCCESS, 
+                            "Associate after clear failed");
+                int after[] = { -(1 << 20), 1 << 20 };
+                if (check_range(map, after, 2, INT_MIN, INT_MAX)) {
+                    return 1;
+                }
+            } else {
+                // Ranges wider than the map scan the entries instead of every value
+                EnumMap* frozen = stdem_freeze(map, &error);
+                TEST_ASSERT(frozen != NULL, "Freeze failed");
+                const EnumMap* maps[] = { map, frozen };
+                for (size_t m = 0; m < 2; m++) {
+                    if (check_range(maps[m], sorted, 3000, INT_MIN, INT_MAX) || 
+                        check_range(maps[m], sorted, 3000, -1000, 1000)) {
+                        return 1;
+                    }
+                }
+                stdem_destroy(frozen);
+                
+                TEST_ASSERT(stdem_clear(map) == STEM_SUCCESS, "Clear failed");
+                TEST_ASSERT(stdem_associate_ex(map, INT_MAX, &keys[0], NULL) == STEM_SUCCESS && 
+                            stdem_associate_ex(map, INT_MIN, &keys[1], NULL) == STEM_SUCCESS, 
+                            "Associate after clear failed");
+                int extremes[] = { INT_MIN, INT_MAX };
+                if (check_range(map, extremes, 2, INT_MIN, INT_MAX) || 
+                    check_range(map, extremes, 2, INT_MIN + 1, INT_MAX - 1)) {
+                    return 1;
+                }
+            }
+            stdem_destroy(map);
+        }
+    }
+    
+    // Wide ranges on unordered maps sort a temporary copy of the entries
+    CountingAllocator counter = {0, 0, false};
+    StemAllocator allocator = {counting_allocate, counting_deallocate, &counter};
+    EnumMap* map = stdem_create_with_allocator(16, sizeof(int), STEM_FLAGS_NONE, &allocator, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    for (size_t i = 0; i < 3000; i++) {
+        TEST_ASSERT(stdem_associate_ex(map, keys[i], &keys[i], NULL) == STEM_SUCCESS, 
+                    "Associate failed");
+    }
+    size_t live = counter.live_bytes;
+    if (check_range(map, sorted, 3000, INT_MIN, INT_MAX)) {
+        return 1;
+    }
+    TEST_ASSERT(counter.live_bytes == live, "Range scan should release its array");
+    KeyRecorder recorder = { {0}, 0 };
+    size_t narrow = 0;
+    for (size_t i = 0; i < 3000; i++) {
+        narrow += sorted[i] >= 0 && sorted[i] <= 10;
+    }
+    counter.exhausted = true;
+    TEST_ASSERT(stdem_foreach_range(map, INT_MIN, INT_MAX, record_iterator, &recorder) == STEM_ERROR_OUT_OF_MEMORY, 
+                "Wide range should report a failed allocation");
+    TEST_ASSERT(recorder.count == 0, "A failed range should visit nothing");
+    TEST_ASSERT(stdem_foreach_range(map, 0, 10, record_iterator, &recorder) == STEM_SUCCESS && 
+                recorder.count == narrow, "Narrow range should not allocate");
+    counter.exhausted = false;
+    stdem_destroy(map);
+    
+    TEST_ASSERT(stdem_foreach_range(NULL, 0, 1, record_iterator, NULL) == STEM_ERROR_INVALID_ARG, 
+                "NULL map should fail");
+    return 0;
+}
+
+/**
+ * @brief Test in-place update, upsert and removal on every backend
+ */
+static int test_update_remove(void) {
+    StemError error;
+    static int values[600];
+    char name[32];
+    int data;
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE, 
+                                   STEM_FLAGS_OPEN_ADDRESSING, STEM_FLAGS_ORDERED };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(64, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Dense keys, sparse keys and one key sharing its name with key 0
+        for (int i = 0; i < 600; i++) {
+            int key = i < 300 ? i : (i % 2 ? i * 37 + 1000 : -i * 37);
+            values[i] = key;
+            snprintf(name, sizeof(name), "K%d", key);
+            TEST_ASSERT(stdem_associate_ex(map, key, &values[i], name) == STEM_SUCCESS, 
+                        "Associate failed");
+        }
+        TEST_ASSERT(stdem_associate_ex(map, 50000, &values[0], "K0") == STEM_SUCCESS, 
+                    "Associate of shared name failed");
+        
+        // Updates overwrite the stored copy without moving it
+        int* slot = stdem_get_value_mut(map, 7, &error);
+        TEST_ASSERT(slot != NULL && error == STEM_SUCCESS, "Mutable lookup failed");
+        data = 777;
+        TEST_ASSERT(stdem_update(map, 7, &data) == STEM_SUCCESS, "Update failed");
+        TEST_ASSERT(stdem_get_value_ex(map, 7, NULL) == slot && *slot == 777, 
+                    "Update should write in place");
+        *slot = 707;
+        TEST_ASSERT(*stdem_get_value_as(map, 7, int) == 707, "Write through pointer lost");
+        TEST_ASSERT(stdem_update(map, 12345, &data) == STEM_ERROR_NOT_FOUND, 
+                    "Update of missing key should fail");
+        TEST_ASSERT(stdem_update(map, 7, NULL) == STEM_ERROR_INVALID_ARG, 
+                    "Copy map update needs a value");
+        
+        // Remove every third key, then every remaining key must still resolve
+        for (int i = 0; i < 600; i += 3) {
+            TEST_ASSERT(stdem_remove(map, values[i]) == STEM_SUCCESS, "Remove failed");
+            TEST_ASSERT(stdem_remove(map, values[i]) == STEM_ERROR_NOT_FOUND, 
+                        "Second remove should miss");
+        }
+        TEST_ASSERT(stdem_count(map) == 401, "Count should drop with removals");
+        for (int i = 0; i < 600; i++) {
+            const int* value = stdem_get_value_ex(map, values[i], &error);
+            snprintf(name, sizeof(name), "K%d", values[i]);
+            if (i % 3 == 0) {
+                TEST_ASSERT(value == NULL, "Removed key should miss");
+                stdem_find_by_name(map, name, &error);
+                TEST_ASSERT(values[i] == 0 || error == STEM_ERROR_NOT_FOUND, "Removed name should miss");
+            } else {
+                TEST_ASSERT(value != NULL && *value == (values[i] == 7 ? 707 : values[i]), 
+                            "Remaining key should keep its value");
+                TEST_ASSERT(stdem_find_by_name(map, name, &error) == values[i], 
+                            "Remaining name should resolve");
+            }
+        }
+        TEST_ASSERT(stdem_find_by_name(map, "K0", &error) == 50000, 
+                    "Shared name should move to the remaining entry");
+
+        // A name carried by three entries passes along until the last one goes
+        for (int key = 60001; key <= 60003; key++) {
+            TEST_ASSERT(stdem_associate_ex(map, key, &values[1], "TRIPLE") == STEM_SUCCESS,
+                        "Associate of shared name failed");
+        }
+        TEST_ASSERT(stdem_remove(map, 60001) == STEM_SUCCESS, "Remove failed");
+        int heir = stdem_find_by_name(map, "TRIPLE", &error);
+        TEST_ASSERT(error == STEM_SUCCESS && (heir == 60002 || heir == 60003),
+                    "Shared name should move to a remaining entry");
+        TEST_ASSERT(stdem_remove(map, heir) == STEM_SUCCESS, "Remove failed");
+        TEST_ASSERT(stdem_find_by_name(map, "TRIPLE", &error) == 120005 - heir,
+                    "Shared name should move to the last entry");
+        TEST_ASSERT(stdem_remove(map, 120005 - heir) == STEM_SUCCESS, "Remove failed");
+        stdem_find_by_name(map, "TRIPLE", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Name should go with its last entry");
+
+        KeyRecorder recorder = { {0}, 0 };
+        TEST_ASSERT(stdem_foreach_range(map, -30000, 60000, record_iterator, &recorder) == STEM_SUCCESS, 
+                    "Range foreach failed");
+        TEST_ASSERT(recorder.count == 401, "Range should visit remaining keys");
+        
+        // Upsert inserts missing keys and renames existing ones
+        data = 5;
+        TEST_ASSERT(stdem_upsert(map, values[3], &data, "BACK") == STEM_SUCCESS, "Upsert insert failed");
+        TEST_ASSERT(*stdem_get_value_as(map, values[3], int) == 5, "Upserted value should match");
+        data = 6;
+        TEST_ASSERT(stdem_upsert(map, values[3], &data, "RENAMED") == STEM_SUCCESS, "Upsert update failed");
+        TEST_ASSERT(*stdem_get_value_as(map, values[3], int) == 6, "Upsert should replace value");
+        stdem_find_by_name(map, "BACK", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Old name should be dropped");
+        TEST_ASSERT(stdem_find_by_name(map, "RENAMED", &error) == values[3], "New name should resolve");
+        TEST_ASSERT(stdem_upsert(map, values[3], &data, NULL) == STEM_SUCCESS, "Upsert without name failed");
+        TEST_ASSERT(strcmp(stdem_get_name_ex(map, values[3], NULL), "RENAMED") == 0, 
+                    "NULL name should keep the name");
+        
+        // A frozen map rejects every mutation
+        EnumMap* frozen = stdem_freeze(map, &error);
+        TEST_ASSERT(frozen != NULL, "Freeze failed");
+        TEST_ASSERT(stdem_update(frozen, 1, &data) == STEM_ERROR_INVALID_ARG, "Frozen update should fail");
+        TEST_ASSERT(stdem_upsert(frozen, 1, &data, NULL) == STEM_ERROR_INVALID_ARG, 
+                    "Frozen upsert should fail");
+        TEST_ASSERT(stdem_remove(frozen, 1) == STEM_ERROR_INVALID_ARG, "Frozen remove should fail");
+        TEST_ASSERT(stdem_get_value_mut(frozen, 1, &error) == NULL && error == STEM_ERROR_INVALID_ARG, 
+                    "Frozen map should not hand out writable values");
+        stdem_destroy(frozen);
+        stdem_destroy(map);
+    }
+    
+    // Pointer maps swap the pointer; a chained entry without a value gets one
+    EnumMap* map = stdem_create(16, 0);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    TEST_ASSERT(stdem_associate_ex(map, 1, &values[1], NULL) == STEM_SUCCESS, "Associate failed");
+    TEST_ASSERT(stdem_update(map, 1, &values[2]) == STEM_SUCCESS, "Pointer update failed");
+    TEST_ASSERT(stdem_get_value(map, 1) == &values[2], "Pointer should be replaced");
+    stdem_destroy(map);
+    
+    map = stdem_create(16, sizeof(int));
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    TEST_ASSERT(stdem_associate_ex(map, 1, NULL, "EMPTY") == STEM_SUCCESS, "Associate failed");
+    data = 42;
+    TEST_ASSERT(stdem_update(map, 1, &data) == STEM_SUCCESS, "Update of empty entry failed");
+    TEST_ASSERT(*stdem_get_value_as(map, 1, int) == 42, "Value should be stored");
+    TEST_ASSERT(stdem_remove(NULL, 1) == STEM_ERROR_INVALID_ARG, "NULL map should be rejected");
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test reserve, shrink_to_fit and per-map load factors
+ */
+static int test_capacity_policy(void) {
+    StemError error;
+    StemStats stats;
+    char name[32];
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_OPEN_ADDRESSING };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(16, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Reserving up front loads every entry without a rehash
+        TEST_ASSERT(stdem_reserve(map, 5000) == STEM_SUCCESS, "Reserve failed");
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        size_t resizes = stats.resize_count;
+        size_t name_capacity = stats.name_capacity;
+        TEST_ASSERT((stats.table_capacity & (stats.table_capacity - 1)) == 0, 
+                    "Table size should be a power of two");
+        for (int i = 0; i < 5000; i++) {
+            int key = i * 7 - 9000;
+            snprintf(name, sizeof(name), "CAP_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, key, &i, name) == STEM_SUCCESS, "Associate failed");
+        }
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.resize_count == resizes, "Reserved map should not rehash");
+        TEST_ASSERT(stats.name_capacity == name_capacity, "Reserved name index should not grow");
+        TEST_ASSERT(stats.load_factor <= 0.75, "Load should stay under the default factor");
+        
+        // A lower load factor resizes right away and keeps every entry
+        size_t capacity = stats.table_capacity;
+        TEST_ASSERT(stdem_set_max_load_factor(map, 0.25f) == STEM_SUCCESS, "Set load factor failed");
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.table_capacity > capacity && stats.load_factor <= 0.25, 
+                    "Table should grow for the lower factor");
+        TEST_ASSERT(stats.max_load_factor > 0.24 && stats.max_load_factor < 0.26, 
+                    "Stats should report the factor");
+        for (int i = 0; i < 5000; i += 97) {
+            const int* value = stdem_get_value_ex(map, i * 7 - 9000, &error);
+            TEST_ASSERT(value != NULL && *value == i, "Entry lost by resize");
+        }
+        
+        // Copies keep the factor
+        EnumMap* copy = stdem_copy(map, &error);
+        TEST_ASSERT(copy != NULL, "Copy failed");
+        TEST_ASSERT(stdem_get_stats(copy, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.max_load_factor > 0.24 && stats.max_load_factor < 0.26 && 
+                    stats.load_factor <= 0.25, "Copy should keep the load factor");
+        stdem_destroy(copy);
+        
+        // Clearing keeps the table, shrinking gives it back
+        TEST_ASSERT(stdem_clear(map) == STEM_SUCCESS, "Clear failed");
+        TEST_ASSERT(stdem_shrink_to_fit(map) == STEM_SUCCESS, "Shrink failed");
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.table_capacity == 16 && stats.name_capacity == 0, 
+                    "Shrunk empty map should be back to the minimum");
+        for (int i = 0; i < 100; i++) {
+            snprintf(name, sizeof(name), "CAP_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, i * 1000, &i, name) == STEM_SUCCESS, 
+                        "Associate after shrink failed");
+        }
+        for (int i = 0; i < 100; i++) {
+            snprintf(name, sizeof(name), "CAP_%d", i);
+            TEST_ASSERT(*stdem_get_value_as(map, i * 1000, int) == i, "Value after shrink mismatch");
+            TEST_ASSERT(stdem_find_by_name(map, name, &error) == i * 1000, "Name after shrink mismatch");
+        }
+        
+        // Factors out of range are rejected
+        TEST_ASSERT(stdem_set_max_load_factor(map, 0.0f) == STEM_ERROR_INVALID_ARG, 
+                    "Zero factor should be rejected");
+        TEST_ASSERT(stdem_set_max_load_factor(map, 5.0f) == STEM_ERROR_INVALID_ARG, 
+                    "Huge factor should be rejected");
+        TEST_ASSERT((stdem_set_max_load_factor(map, 2.0f) == STEM_SUCCESS) == 
+                    !(variants[v] & STEM_FLAGS_OPEN_ADDRESSING), 
+                    "Factors above 1 only suit chained buckets");
+        
+        EnumMap* frozen = stdem_freeze(map, &error);
+        TEST_ASSERT(frozen != NULL, "Freeze failed");
+        TEST_ASSERT(stdem_reserve(frozen, 10) == STEM_ERROR_INVALID_ARG, "Frozen reserve should fail");
+        TEST_ASSERT(stdem_shrink_to_fit(frozen) == STEM_ERROR_INVALID_ARG, "Frozen shrink should fail");
+        stdem_destroy(frozen);
+        
+        // Read-only maps keep their table, so stored value pointers stay valid
+        const int keys[] = { 3, 900, -41 };
+        const int data[] = { 30, 9000, -410 };
+        const void* values[] = { &data[0], &data[1], &data[2] };
+        EnumMap* readonly = stdem_create_from_arrays(keys, values, NULL, 3, sizeof(int), 
+                                                     variants[v] | STEM_FLAGS_READONLY, &error);
+        TEST_ASSERT(readonly != NULL, "Read-only creation failed");
+        const int* kept = stdem_get_value_ex(readonly, 900, &error);
+        TEST_ASSERT(stdem_reserve(readonly, 5000) == STEM_ERROR_INVALID_ARG, 
+                    "Read-only reserve should fail");
+        TEST_ASSERT(stdem_shrink_to_fit(readonly) == STEM_ERROR_INVALID_ARG, 
+                    "Read-only shrink should fail");
+        TEST_ASSERT(stdem_set_max_load_factor(readonly, 0.25f) == STEM_ERROR_INVALID_ARG, 
+                    "Read-only load factor change should fail");
+        TEST_ASSERT(stdem_get_value_ex(readonly, 900, &error) == kept && *kept == 9000, 
+                    "Read-only values should not move");
+        stdem_destroy(readonly);
+        
+        // Published maps are read without locks, so they must not be resized
+        StemSnapshot* snapshot = stdem_snapshot_create(map, 1, &error);
+        TEST_ASSERT(snapshot != NULL, "Snapshot creation failed");
+        TEST_ASSERT(stdem_reserve(map, 5000) == STEM_ERROR_INVALID_ARG, 
+                    "Published reserve should fail");
+        TEST_ASSERT(stdem_shrink_to_fit(map) == STEM_ERROR_INVALID_ARG, 
+                    "Published shrink should fail");
+        TEST_ASSERT(stdem_set_max_load_factor(map, 0.5f) == STEM_ERROR_INVALID_ARG, 
+                    "Published load factor change should fail");
+        stdem_snapshot_destroy(snapshot);
+    }
+    return 0;
+}
+
+/**
+ * @brief Test incremental rehashing, checking the map while it migrates
+ */
+static int test_incremental_rehash(void) {
+    StemError error;
+    StemStats stats;
+    char name[32];
+    static int values[20000];
+    static int visits[20000];
+    StemExecutor executor = stdem_thread_executor(4);
+    const StemFlags variants[] = { STEM_FLAGS_NONE, STEM_FLAGS_DENSE | STEM_FLAGS_ORDERED };
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(16, sizeof(int), 
+                                       variants[v] | STEM_FLAGS_INCREMENTAL_REHASH, &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        size_t checked = 0;
+        for (int i = 0; i < 20000; i++) {
+            values[i] = i * 13 - 70000;
+            snprintf(name, sizeof(name), "INC_%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, values[i], &i, name) == STEM_SUCCESS, 
+                        "Associate failed");
+            TEST_ASSERT(*stdem_get_value_as(map, values[i / 2], int) == i / 2, 
+                        "Earlier entry should stay reachable");
+            
+            TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+            if (stats.rehash_pending == 0 || checked >= 6) {
+                continue;
+            }
+            
+            // Mid-migration: every view of the map still sees each entry once
+            checked++;
+            size_t count = stdem_count(map);
+            size_t visited = 0;
+            TEST_ASSERT(stdem_foreach(map, count_iterator, &visited) == STEM_SUCCESS && 
+                        visited == count, "Foreach should visit both tables");
+            memset(visits, 0, sizeof(visits));
+            TEST_ASSERT(stdem_foreach_parallel(map, visit_iterator, visits, &executor) == STEM_SUCCESS, 
+                        "Parallel foreach failed");
+            for (int j = 0; j <= i; j++) {
+                TEST_ASSERT(visits[j] == 1, "Parallel foreach should visit both tables");
+            }
+            for (int j = 0; j <= i; j += 37) {
+                snprintf(name, sizeof(name), "INC_%d", j);
+                TEST_ASSERT(stdem_find_by_name(map, name, &error) == values[j], 
+                            "Name lookup mid-migration failed");
+            }
+            
+            EnumMap* copies[2] = { stdem_copy(map, &error), stdem_copy_parallel(map, &executor, &error) };
+            for (size_t c = 0; c < 2; c++) {
+                TEST_ASSERT(copies[c] != NULL && stdem_count(copies[c]) == count, "Copy failed");
+                for (int j = 0; j <= i; j += 11) {
+                    TEST_ASSERT(*stdem_get_value_as(copies[c], values[j], int) == j, 
+                                "Copy should hold every entry");
+                }
+                // The mirrored copy keeps migrating on its own inserts
+                int extra = 1;
+                TEST_ASSERT(stdem_associate_ex(copies[c], 900000, &extra, NULL) == STEM_SUCCESS, 
+                            "Insert into copy failed");
+                TEST_ASSERT(*stdem_get_value_as(copies[c], values[0], int) == 0, "Copy lost an entry");
+                stdem_destroy(copies[c]);
+            }
+            
+            // Removal finds entries in either table
+            TEST_ASSERT(stdem_remove(map, values[1]) == STEM_SUCCESS, "Remove mid-migration failed");
+            TEST_ASSERT(stdem_upsert(map, values[1], &values[1], NULL) == STEM_SUCCESS, "Upsert failed");
+            TEST_ASSERT(stdem_update(map, values[1], &i) == STEM_SUCCESS, "Update failed");
+            int one = 1;
+            TEST_ASSERT(stdem_update(map, values[1], &one) == STEM_SUCCESS, "Update failed");
+        }
+        TEST_ASSERT(checked > 0, "Map should have been checked while migrating");
+        TEST_ASSERT(stdem_count(map) == 20000, "All entries should be present");
+        for (int i = 0; i < 20000; i++) {
+            TEST_ASSERT(*stdem_get_value_as(map, values[i], int) == i, "Final lookup failed");
+        }
+        
+        // A synchronous resize completes the migration first
+        TEST_ASSERT(stdem_reserve(map, 100000) == STEM_SUCCESS, "Reserve failed");
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS && stats.rehash_pending == 0, 
+                    "Reserve should finish the migration");
+        TEST_ASSERT(*stdem_get_value_as(map, values[19999], int) == 19999, "Lookup after reserve failed");
+        TEST_ASSERT(stdem_clear(map) == STEM_SUCCESS && stdem_count(map) == 0, "Clear failed");
+        stdem_destroy(map);
+    }
+    return 0;
+}
+
+/**
+ * @brief Test publishing maps into a double-buffered shared region
+ */
+static int test_shared_memory(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(64, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    for (int i = 0; i < 200; i++) {
+        int value = i * 3;
+        char name[16];
+        snprintf(name, sizeof(name), "KEY_%d", i);
+        TEST_ASSERT(stdem_associate_ex(map, i, &value, name) == STEM_SUCCESS, "Insert failed");
+    }
+    
+    size_t size = stdem_shared_region_size(stdem_serialized_size(map) + 1024);
+    TEST_ASSERT(size > 0, "Region size failed");
+    
+    // Readers need an initialized region with a published image
+    void* region = NULL;
+#if TEST_HAVE_THREADS
+    FILE* backing = tmpfile();
+    TEST_ASSERT(backing != NULL && ftruncate(fileno(backing), (off_t)size) == 0, 
+                "Backing file failed");
+    region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(backing), 0);
+    TEST_ASSERT(region != MAP_FAILED, "mmap failed");
+#else
+    region = malloc(size);
+    TEST_ASSERT(region != NULL, "Region allocation failed");
+#endif
+    memset(region, 0, size);
+    TEST_ASSERT(stdem_shared_attach(region, size, &error) == NULL && 
+                error == STEM_ERROR_UNINITIALIZED, "Uninitialized region should be rejected");
+    TEST_ASSERT(stdem_shared_init(region, size) == STEM_SUCCESS, "Region init failed");
+    TEST_ASSERT(stdem_shared_generation(region) == 0, "Fresh region should be empty");
+    TEST_ASSERT(stdem_shared_attach(region, size, &error) == NULL && 
+                error == STEM_ERROR_NOT_FOUND, "Empty region should have nothing to attach");
+    
+    TEST_ASSERT(stdem_shared_publish(region, size, map) == STEM_SUCCESS, "First publish failed");
+    TEST_ASSERT(stdem_shared_generation(region) == 1, "Generation mismatch");
+    EnumMap* first = stdem_shared_attach(region, size, &error);
+    TEST_ASSERT(first != NULL && error == STEM_SUCCESS, "Attach failed");
+    TEST_ASSERT(stdem_count(first) == 200, "Attached count mismatch");
+    TEST_ASSERT(*stdem_get_value_as(first, 150, int) == 450, "Attached value mismatch");
+    TEST_ASSERT(stdem_find_by_name(first, "KEY_77", &error) == 77, "Attached name mismatch");
+    int value = 1;
+    TEST_ASSERT(stdem_associate_ex(first, 500, &value, NULL) != STEM_SUCCESS, 
+                "Attached maps should be read-only");
+    
+    // A second image goes to the idle buffer, the first reader keeps its view
+    value = -1;
+    TEST_ASSERT(stdem_update(map, 150, &value) == STEM_SUCCESS, "Update failed");
+    TEST_ASSERT(stdem_shared_publish(region, size, map) == STEM_SUCCESS, "Second publish failed");
+    TEST_ASSERT(stdem_shared_generation(region) == 2, "Generation mismatch");
+    TEST_ASSERT(*stdem_get_value_as(first, 150, int) == 450, "Pinned image changed");
+    EnumMap* second = stdem_shared_attach(region, size, &error);
+    TEST_ASSERT(second != NULL && *stdem_get_value_as(second, 150, int) == -1, 
+                "New image not visible");
+    
+    // The buffer of the first generation stays busy until its reader detaches
+    TEST_ASSERT(stdem_shared_publish(region, size, map) == STEM_ERROR_BUSY, 
+                "Publishing over a pinned image should fail");
+    TEST_ASSERT(stdem_shared_generation(region) == 2, "Failed publish changed the generation");
+    stdem_destroy(first);
+    TEST_ASSERT(stdem_shared_publish(region, size, map) == STEM_SUCCESS, "Third publish failed");
+    TEST_ASSERT(*stdem_get_value_as(second, 150, int) == -1, "Pinned image changed");
+    stdem_destroy(second);
+    
+    // Images larger than a buffer are refused
+    EnumMap* large = stdem_create_ex(64, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(large != NULL, "Map creation failed");
+    for (int i = 0; i < 2000; i++) {
+        TEST_ASSERT(stdem_associate_ex(large, i, &i, NULL) == STEM_SUCCESS, "Insert failed");
+    }
+    TEST_ASSERT(stdem_shared_publish(region, size, large) == STEM_ERROR_INDEX_OUT_OF_BOUNDS, 
+                "Oversized image should be rejected");
+    stdem_destroy(large);
+    
+#if TEST_HAVE_THREADS
+    // Another process reads the image in place
+    pid_t child = fork();
+    TEST_ASSERT(child >= 0, "fork failed");
+    if (child == 0) {
+        EnumMap* view = stdem_shared_attach(region, size, NULL);
+        int ok = view && stdem_count(view) == 200 && 
+                 *stdem_get_value_as(view, 150, int) == -1 && 
+                 stdem_find_by_name(view, "KEY_5", NULL) == 5;
+        stdem_destroy(view);
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    TEST_ASSERT(waitpid(child, &status, 0) == child && WIFEXITED(status) && 
+                WEXITSTATUS(status) == 0, "Reading from another process failed");
+    TEST_ASSERT(stdem_shared_publish(region, size, map) == STEM_SUCCESS, 
+                "Child pin was not released");
+    munmap(region, size);
+    fclose(backing);
+#else
+    free(region);
+#endif
+    
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test in-place merges, diffs and patches
+ */
+static int test_merge_into_patch(void) {
+    StemError error;
+    StemFlags configs[] = { STEM_FLAGS_NONE, STEM_FLAGS_OPEN_ADDRESSING, STEM_FLAGS_DENSE };
+    
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        EnumMap* base = stdem_create_ex(64, sizeof(int), configs[c], &error);
+        EnumMap* update = stdem_create_ex(8, sizeof(int), configs[c], &error);
+        TEST_ASSERT(base != NULL && update != NULL, "Map creation failed");
+        for (int i = 0; i < 300; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "BASE_%d", i);
+            TEST_ASSERT(stdem_associate_ex(base, i, &i, name) == STEM_SUCCESS, "Insert failed");
+        }
+        int value = -5;
+        TEST_ASSERT(stdem_associate_ex(update, 5, &value, "FIVE") == STEM_SUCCESS && 
+                    stdem_associate_ex(update, 1000, &value, "NEW") == STEM_SUCCESS && 
+                    stdem_associate_ex(update, 6, &value, NULL) == STEM_SUCCESS, 
+                    "Insert failed");
+        
+        // Without overwrite only new keys are added
+        EnumMap* kept = stdem_copy(base, &error);
+        TEST_ASSERT(kept != NULL, "Copy failed");
+        TEST_ASSERT(stdem_merge_into(kept, update, false) == STEM_SUCCESS, "Merge into failed");
+        TEST_ASSERT(stdem_count(kept) == 301, "Merged count mismatch");
+        TEST_ASSERT(*stdem_get_value_as(kept, 5, int) == 5, "Existing value overwritten");
+        TEST_ASSERT(*stdem_get_value_as(kept, 1000, int) == -5, "New value missing");
+        stdem_destroy(kept);
+        
+        // With overwrite, values and names follow the source and the name index stays current
+        EnumMap* target = stdem_copy(base, &error);
+        TEST_ASSERT(target != NULL, "Copy failed");
+        TEST_ASSERT(stdem_merge_into(target, update, true) == STEM_SUCCESS, "Merge into failed");
+        TEST_ASSERT(stdem_merge_into(target, target, true) == STEM_SUCCESS, "Self merge failed");
+        TEST_ASSERT(stdem_count(target) == 301, "Merged count mismatch");
+        TEST_ASSERT(*stdem_get_value_as(target, 5, int) == -5, "Value not overwritten");
+        TEST_ASSERT(stdem_find_by_name(target, "FIVE", &error) == 5, "New name not indexed");
+        stdem_find_by_name(target, "BASE_5", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Replaced name still indexed");
+        TEST_ASSERT(stdem_get_name(target, 6) == NULL, "Name not cleared");
+        stdem_find_by_name(target, "BASE_6", &error);
+        TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Cleared name still indexed");
+        
+        // Same result as a full merge
+        EnumMap* merged = stdem_merge(base, update, true, &error);
+        TEST_ASSERT(merged != NULL, "Merge failed");
+        StemPatch* none = stdem_diff(merged, target, &error);
+        TEST_ASSERT(none != NULL && stdem_patch_count(none) == 0, "Merges should agree");
+        stdem_patch_destroy(none);
+        stdem_destroy(merged);
+        
+        // Change the target some more, then turn base into it through a patch
+        TEST_ASSERT(stdem_remove(target, 10) == STEM_SUCCESS && 
+                    stdem_remove(target, 11) == STEM_SUCCESS, "Remove failed");
+        TEST_ASSERT(stdem_upsert(target, 20, &value, "TWENTY") == STEM_SUCCESS, "Upsert failed");
+        
+        StemPatch* patch = stdem_diff(base, target, &error);
+        TEST_ASSERT(patch != NULL && error == STEM_SUCCESS, "Diff failed");
+        TEST_ASSERT(stdem_patch_count(patch) == 6, "Patch should hold only the changes");
+        stdem_destroy(target);
+        
+        // The patch owns its values and names and applies more than once
+        for (int round = 0; round < 2; round++) {
+            TEST_ASSERT(stdem_apply_patch(base, patch) == STEM_SUCCESS, "Apply failed");
+            TEST_ASSERT(stdem_count(base) == 299, "Patched count mismatch");
+            TEST_ASSERT(stdem_get_value_ex(base, 10, &error) == NULL, "Removed value remains");
+            TEST_ASSERT(*stdem_get_value_as(base, 20, int) == -5, "Patched value mismatch");
+            TEST_ASSERT(stdem_find_by_name(base, "TWENTY", &error) == 20, "Patched name mismatch");
+            TEST_ASSERT(stdem_find_by_name(base, "NEW", &error) == 1000, "Patched insert missing");
+            TEST_ASSERT(stdem_get_name(base, 6) == NULL, "Patched name not cleared");
+            TEST_ASSERT(strcmp(stdem_get_name(base, 299), "BASE_299") == 0, 
+                        "Untouched name changed");
+        }
+        
+        // Patches only fit maps with their value size, and they apply to frozen sources
+        EnumMap* other = stdem_create_ex(8, sizeof(char), configs[c], &error);
+        TEST_ASSERT(other != NULL, "Map creation failed");
+        TEST_ASSERT(stdem_apply_patch(other, patch) == STEM_ERROR_INVALID_ARG, 
+                    "Value size mismatch should be rejected");
+        TEST_ASSERT(stdem_merge_into(other, base, true) == STEM_ERROR_INVALID_ARG, 
+                    "Value size mismatch should be rejected");
+        stdem_destroy(other);
+        
+        EnumMap* frozen = stdem_freeze(base, &error);
+        TEST_ASSERT(frozen != NULL, "Freeze failed");
+        TEST_ASSERT(stdem_apply_patch(frozen, patch) == STEM_ERROR_INVALID_ARG, 
+                    "Frozen maps should be read-only");
+        StemPatch* same = stdem_diff(frozen, base, &error);
+        TEST_ASSERT(same != NULL && stdem_patch_count(same) == 0, "Frozen diff mismatch");
+        stdem_patch_destroy(same);
+        stdem_destroy(frozen);
+        
+        stdem_patch_destroy(patch);
+        stdem_destroy(update);
+        stdem_destroy(base);
+    }
+    
+    // A merge that runs out of memory leaves the target untouched
+    char name[16];
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        CountingAllocator counter = {0, 0, false};
+        StemAllocator allocator = {counting_allocate, counting_deallocate, &counter};
+        EnumMap* target = stdem_create_with_allocator(8, sizeof(int), configs[c], &allocator, &error);
+        EnumMap* source = stdem_create_ex(8, sizeof(int), configs[c], &error);
+        TEST_ASSERT(target != NULL && source != NULL, "Map creation failed");
+        for (int i = 0; i < 4; i++) {
+            int changed = 100 + i;
+            snprintf(name, sizeof(name), "OLD_%d", i);
+            TEST_ASSERT(stdem_associate_ex(target, i, &i, name) == STEM_SUCCESS, "Insert failed");
+            snprintf(name, sizeof(name), "SRC_%d", i);
+            TEST_ASSERT(stdem_associate_ex(source, i, &changed, name) == STEM_SUCCESS, "Insert failed");
+        }
+        for (int i = 1000; i < 1200; i++) {
+            snprintf(name, sizeof(name), "SRC_%d", i);
+            TEST_ASSERT(stdem_associate_ex(source, i, &i, name) == STEM_SUCCESS, "Insert failed");
+        }
+        
+        counter.exhausted = true;
+        TEST_ASSERT(stdem_merge_into(target, source, true) == STEM_ERROR_OUT_OF_MEMORY, 
+                    "Merge should run out of memory");
+        counter.exhausted = false;
+        TEST_ASSERT(stdem_count(target) == 4, "Failed merge should add nothing");
+        for (int i = 0; i < 4; i++) {
+            snprintf(name, sizeof(name), "OLD_%d", i);
+            TEST_ASSERT(*stdem_get_value_as(target, i, int) == i, "Failed merge changed a value");
+            TEST_ASSERT(stdem_find_by_name(target, name, &error) == i, "Failed merge changed a name");
+        }
+        
+        TEST_ASSERT(stdem_merge_into(target, source, true) == STEM_SUCCESS, "Merge into failed");
+        TEST_ASSERT(stdem_count(target) == 204 && *stdem_get_value_as(target, 2, int) == 102 && 
+                    stdem_find_by_name(target, "SRC_1199", &error) == 1199, "Merge result mismatch");
+        stdem_destroy(source);
+        stdem_destroy(target);
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Test huge-page backed tables and NUMA-replicated frozen maps
+ */
+static int test_huge_pages_numa(void) {
+    StemError error;
+    StemFlags configs[] = {
+        STEM_FLAGS_HUGE_PAGES, 
+        STEM_FLAGS_HUGE_PAGES | STEM_FLAGS_OPEN_ADDRESSING, 
+        STEM_FLAGS_HUGE_PAGES_EXPLICIT | STEM_FLAGS_DENSE
+    };
+    
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        // Large enough for multi-megabyte arrays, grown through several resizes
+        EnumMap* map = stdem_create_ex(16, sizeof(int), configs[c], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        for (int i = 0; i < 200000; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "H%d", i);
+            TEST_ASSERT(stdem_associate_ex(map, i * 3, &i, i % 4 ? NULL : name) == STEM_SUCCESS, 
+                        "Insert failed");
+        }
+        TEST_ASSERT(*stdem_get_value_as(map, 3 * 199999, int) == 199999, "Value mismatch");
+        TEST_ASSERT(stdem_find_by_name(map, "H4000", &error) == 12000, "Name mismatch");
+        TEST_ASSERT(stdem_remove(map, 0) == STEM_SUCCESS, "Remove failed");
+        
+        EnumMap* copy = stdem_copy(map, &error);
+        TEST_ASSERT(copy != NULL && stdem_count(copy) == 199999, "Copy failed");
+        stdem_destroy(copy);
+        
+        // Replicated frozen maps answer lookups from the local copy
+        EnumMap* frozen = stdem_freeze_replicated(map, &error);
+        TEST_ASSERT(frozen != NULL && error == STEM_SUCCESS, "Replicated freeze failed");
+        TEST_ASSERT(stdem_count(frozen) == 199999, "Frozen count mismatch");
+        for (int i = 1; i < 200000; i += 997) {
+            TEST_ASSERT(*stdem_get_value_as(frozen, i * 3, int) == i, "Frozen value mismatch");
+        }
+        TEST_ASSERT(stdem_find_by_name(frozen, "H4000", &error) == 12000, "Frozen name mismatch");
+        TEST_ASSERT(strcmp(stdem_get_name(frozen, 12000), "H4000") == 0, "Frozen name mismatch");
+        const int keys[] = { 3, 6, 1 };
+        const void* values[3];
+        TEST_ASSERT(stdem_get_values_batch(frozen, keys, 3, values) == 2 && values[2] == NULL, 
+                    "Frozen batch mismatch");
+        
+        StemStats stats;
+        TEST_ASSERT(stdem_get_stats(frozen, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.heap_bytes >= (stats.numa_replicas + 1) * stats.count * sizeof(int), 
+                    "Replicas missing from heap bytes");
+        
+        // Images of huge-page maps come back through the same allocation path
+        size_t size = stdem_serialized_size(frozen);
+        void* buffer = malloc(size);
+        TEST_ASSERT(buffer != NULL && 
+                    stdem_serialize_to_buffer(frozen, buffer, size, NULL) == STEM_SUCCESS, 
+                    "Serialize failed");
+        EnumMap* loaded = stdem_deserialize_from_buffer(buffer, size, &error);
+        TEST_ASSERT(loaded != NULL && *stdem_get_value_as(loaded, 30, int) == 10, 
+                    "Deserialize failed");
+        stdem_destroy(loaded);
+        free(buffer);
+        
+        stdem_destroy(frozen);
+        stdem_destroy(map);
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief Test the per-thread front cache and its invalidation
+ */
+static int test_front_cache(void) {
+    StemError error;
+    StemFlags configs[] = {
+        STEM_FLAGS_FRONT_CACHE | STEM_FLAGS_STATS, 
+        STEM_FLAGS_FRONT_CACHE | STEM_FLAGS_STATS | STEM_FLAGS_OPEN_ADDRESSING, 
+        STEM_FLAGS_FRONT_CACHE | STEM_FLAGS_STATS | STEM_FLAGS_THREAD_SAFE
+    };
+    
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        EnumMap* map = stdem_create_ex(4, sizeof(int), configs[c], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        for (int i = 0; i < 100; i++) {
+            int value = i * 10;
+            TEST_ASSERT(stdem_associate_ex(map, i * 7919, &value, NULL) == STEM_SUCCESS, 
+                        "Insert failed");
+        }
+        
+        // Repeated lookups of a hot key are answered by the cache
+        for (int round = 0; round < 10; round++) {
+            TEST_ASSERT(*stdem_get_value_as(map, 7919, int) == 10, "Hot value mismatch");
+        }
+        StemStats stats;
+        TEST_ASSERT(stdem_get_stats(map, &stats) == STEM_SUCCESS, "Stats failed");
+        TEST_ASSERT(stats.lookup_hits == 10 && stats.cache_hits == 9, "Cache hits not counted");
+        
+        // Updates in place are seen through the cached pointer
+        int updated = 11;
+        TEST_ASSERT(stdem_update(map, 7919, &updated) == STEM_SUCCESS, "Update failed");
+        TEST_ASSERT(*stdem_get_value_as(map, 7919, int) == 11, "Updated value mismatch");
+        
+        // Growing the table moves open-addressing values and drops the entries
+        for (int i = 100; i < 2000; i++) {
+            TEST_ASSERT(stdem_associate_ex(map, i * 7919, &i, NULL) == STEM_SUCCESS, 
+                        "Insert failed");
+        }
+        TEST_ASSERT(*stdem_get_value_as(map, 7919, int) == 11, "Value lost by resize");
+        
+        // Removals and clears are never answered from the cache
+        TEST_ASSERT(stdem_remove(map, 7919) == STEM_SUCCESS, "Remove failed");
+        TEST_ASSERT(stdem_get_value_ex(map, 7919, &error) == NULL && error == STEM_ERROR_NOT_FOUND, 
+                    "Removed value still cached");
+        TEST_ASSERT(*stdem_get_value_as(map, 2 * 7919, int) == 20, "Value mismatch");
+        TEST_ASSERT(stdem_clear(map) == STEM_SUCCESS, "Clear failed");
+        TEST_ASSERT(stdem_get_value_ex(map, 2 * 7919, &error) == NULL, "Cleared value still cached");
+        
+        // Entries cached for one map never answer lookups on another
+        EnumMap* other = stdem_create_ex(4, sizeof(int), configs[c], &error);
+        TEST_ASSERT(other != NULL, "Map creation failed");
+        int value = 5;
+        TEST_ASSERT(stdem_associate_ex(map, 3, &value, NULL) == STEM_SUCCESS, "Insert failed");
+        TEST_ASSERT(*stdem_get_value_as(map, 3, int) == 5, "Value mismatch");
+        TEST_ASSERT(stdem_get_value_ex(other, 3, &error) == NULL, "Cache shared between maps");
+        stdem_destroy(other);
+        stdem_destroy(map);
+    }
+    
+    // Pointer storage: replacing the pointer invalidates the cached one
+    int a = 1, b = 2;
+    EnumMap* map = stdem_create_ex(4, 0, STEM_FLAGS_FRONT_CACHE, &error);
+    TEST_ASSERT(map != NULL && stdem_associate_ex(map, 42, &a, NULL) == STEM_SUCCESS, 
+                "Insert failed");
+    TEST_ASSERT(stdem_get_value(map, 42) == &a && stdem_get_value(map, 42) == &a, "Lookup failed");
+    TEST_ASSERT(stdem_upsert(map, 42, &b, NULL) == STEM_SUCCESS, "Upsert failed");
+    TEST_ASSERT(stdem_get_value(map, 42) == &b, "Stale pointer returned");
+    stdem_destroy(map);
+    
+    return 0;
+}
+
+#if TEST_HAVE_THREADS
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+#define ASYNC_LOCK() pthread_mutex_lock(&async_lock)
+#define ASYNC_UNLOCK() pthread_mutex_unlock(&async_lock)
+#define ASYNC_YIELD() sched_yield()
+#else
+#define ASYNC_LOCK() ((void)0)
+#define ASYNC_UNLOCK() ((void)0)
+#define ASYNC_YIELD() ((void)0)
+#endif
+
+/**
+ * @brief Completion callback of test_async_load, records the result
+ */
+static void async_done(StemError error, void* user_data) {
+    ASYNC_LOCK();
+    *(StemError*)user_data = error;
+    ASYNC_UNLOCK();
+}
+
+/**
+ * @brief Reads a result recorded by async_done()
+ */
+static StemError async_result(const StemError* result) {
+    ASYNC_LOCK();
+    StemError error = *result;
+    ASYNC_UNLOCK();
+    return error;
+}
+
+/**
+ * @brief Rebuild callback of test_async_load, adds one entry
+ */
+static StemError async_add_entry(EnumMap* next, void* user_data) {
+    return stdem_associate_ex(next, 5000, user_data, "EXTRA");
+}
+
+/**
+ * @brief Rebuild callback of test_async_load that cancels the rebuild
+ */
+static StemError async_cancel(EnumMap* next, void* user_data) {
+    (void)next;
+    (void)user_data;
+    return STEM_ERROR_INVALID_ARG;
+}
+
+/**
+ * @brief Test background loads and rebuilds published into a snapshot
+ */
+static int test_async_load(void) {
+    StemError error;
+    const char* path = "test_stdem_async.bin";
+    EnumMap* source = stdem_create_ex(1000, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(source != NULL, "Map creation failed");
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT(stdem_associate_ex(source, i, &i, NULL) == STEM_SUCCESS, "Insert failed");
+    }
+    FILE* stream = fopen(path, "wb");
+    TEST_ASSERT(stream != NULL && stdem_serialize(source, stream) == STEM_SUCCESS, 
+                "Serialization failed");
+    fclose(stream);
+    stdem_destroy(source);
+    
+    // The empty placeholder serves until the load is published
+    EnumMap* placeholder = stdem_create_ex(1, sizeof(int), STEM_FLAGS_NONE, &error);
+    StemSnapshot* snapshot = stdem_snapshot_create(placeholder, 4, &error);
+    TEST_ASSERT(snapshot != NULL, "Snapshot creation failed");
+    StemSnapshotReader* reader = stdem_snapshot_register_reader(snapshot, &error);
+    TEST_ASSERT(reader != NULL, "Reader registration failed");
+    
+    StemError done = STEM_ERROR_UNINITIALIZED;
+    StemAsync* op = stdem_load_async(snapshot, path, async_done, &done, &error);
+    TEST_ASSERT(op != NULL && error == STEM_SUCCESS, "Load did not start");
+    const EnumMap* seen = stdem_snapshot_read_begin(reader);
+    TEST_ASSERT(seen != NULL, "Reader should see a map while loading");
+    stdem_snapshot_read_end(reader);
+    TEST_ASSERT(stdem_async_wait(op) == STEM_SUCCESS && async_result(&done) == STEM_SUCCESS, 
+                "Load failed");
+    
+    seen = stdem_snapshot_read_begin(reader);
+    TEST_ASSERT(stdem_count(seen) == 1000 && *stdem_get_value_as(seen, 999, int) == 999, 
+                "Loaded map not published");
+    stdem_snapshot_read_end(reader);
+    
+    // Rebuilds change a copy of the current map; a failed one publishes nothing
+    int value = 70;
+    op = stdem_rebuild_async(snapshot, async_add_entry, async_done, &value, &error);
+    TEST_ASSERT(op != NULL, "Rebuild did not start");
+    while (!stdem_async_ready(op)) {
+        ASYNC_YIELD();
+    }
+    TEST_ASSERT(stdem_async_wait(op) == STEM_SUCCESS, "Rebuild failed");
+    op = stdem_rebuild_async(snapshot, async_cancel, NULL, NULL, &error);
+    TEST_ASSERT(op != NULL && stdem_async_wait(op) == STEM_ERROR_INVALID_ARG, 
+                "Cancelled rebuild should fail");
+    
+    seen = stdem_snapshot_read_begin(reader);
+    TEST_ASSERT(stdem_count(seen) == 1001 && *stdem_get_value_as(seen, 5000, int) == 70, 
+                "Rebuilt map not published");
+    TEST_ASSERT(stdem_find_by_name(seen, "EXTRA", &error) == 5000, "Rebuilt name missing");
+    stdem_snapshot_read_end(reader);
+    
+    // Failures reach the callback of detached operations too
+    async_done(STEM_ERROR_UNINITIALIZED, &done);
+    remove(path);
+    op = stdem_load_async(snapshot, path, async_done, &done, &error);
+    TEST_ASSERT(op != NULL, "Load did not start");
+    stdem_async_detach(op);
+    while (async_result(&done) == STEM_ERROR_UNINITIALIZED) {
+        ASYNC_YIELD();
+    }
+    TEST_ASSERT(async_result(&done) == STEM_ERROR_NOT_FOUND, "Missing file should fail");
+    TEST_ASSERT(stdem_load_async(NULL, path, NULL, NULL, &error) == NULL && 
+                error == STEM_ERROR_INVALID_ARG, "NULL snapshot should be rejected");
+    
+    stdem_snapshot_unregister_reader(reader);
+    stdem_snapshot_destroy(snapshot);
+    return 0;
+}
+
+/**
+ * @brief Test tables of value columns sharing one key index
+ */
+static int test_table(void) {
+    const StemFlags flag_sets[] = {STEM_FLAGS_NONE, STEM_FLAGS_DENSE, STEM_FLAGS_OPEN_ADDRESSING, 
+                                   STEM_FLAGS_THREAD_SAFE};
+    for (size_t f = 0; f < sizeof(flag_sets) / sizeof(flag_sets[0]); f++) {
+        StemError error;
+        StemTable* table = stdem_table_create(2, flag_sets[f], NULL, &error);
+        TEST_ASSERT(table != NULL && error == STEM_SUCCESS, "Table creation failed");
+        size_t weight = stdem_table_add_column(table, sizeof(double), &error);
+        size_t code = stdem_table_add_column(table, sizeof(int), &error);
+        TEST_ASSERT(weight == 0 && code == 1, "Columns should be numbered in order");
+        
+        // Inserting past the initial capacity grows every column
+        for (int i = 0; i < 100; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "ROW_%d", i);
+            TEST_ASSERT(stdem_table_insert(table, i, name, &error) == (size_t)i, 
+                        "Rows should be appended");
+            double w = i * 0.5;
+            TEST_ASSERT(stdem_table_set(table, i, weight, &w) == STEM_SUCCESS, "Set failed");
+            *(int*)stdem_table_cell(table, (size_t)i, code) = i * 3;
+        }
+        TEST_ASSERT(stdem_table_insert(table, 7, NULL, &error) == STEM_TABLE_NONE && 
+                    error == STEM_ERROR_ALREADY_EXISTS, "Duplicate row should be rejected");
+        TEST_ASSERT(stdem_table_rows(table) == 100, "Row count mismatch");
+        TEST_ASSERT(*stdem_table_get_as(table, 42, weight, double) == 21.0 && 
+                    *stdem_table_get_as(table, 42, code, int) == 126, "Cell mismatch");
+        TEST_ASSERT(stdem_table_find_by_name(table, "ROW_9") == 9, "Name lookup failed");
+        
+        // Columns added later start zeroed for every existing row
+        size_t flags = stdem_table_add_column(table, sizeof(unsigned char), &error);
+        unsigned char* cells = stdem_table_column(table, flags);
+        for (size_t row = 0; row < 100; row++) {
+            TEST_ASSERT(cells[row] == 0, "New column should be zeroed");
+        }
+        
+        // The last row fills the hole of a removed one
+        TEST_ASSERT(stdem_table_remove(table, 10) == STEM_SUCCESS, "Remove failed");
+        TEST_ASSERT(stdem_table_remove(table, 10) == STEM_ERROR_NOT_FOUND, 
+                    "Removed row should be gone");
+        TEST_ASSERT(stdem_table_rows(table) == 99 && stdem_table_find(table, 10) == STEM_TABLE_NONE, 
+                    "Row count mismatch after remove");
+        TEST_ASSERT(stdem_table_find(table, 99) == 10 && stdem_table_key(table, 10) == 99 && 
+                    strcmp(stdem_table_name(table, 10), "ROW_99") == 0, "Last row should move");
+        TEST_ASSERT(((const double*)stdem_table_column(table, weight))[10] == 49.5 && 
+                    *stdem_table_get_as(table, 99, code, int) == 297, "Moved cells mismatch");
+        TEST_ASSERT(stdem_table_remove(table, 98) == STEM_SUCCESS && 
+                    stdem_table_find(table, 97) == 97, "Removing the last row failed");
+        
+        // The index maps every key to its row
+        const EnumMap* index = stdem_table_index(table);
+        for (size_t row = 0; row < stdem_table_rows(table); row++) {
+            int key = stdem_table_key(table, row);
+            const size_t* stored = stdem_get_value_ex(index, key, NULL);
+            TEST_ASSERT(stored != NULL && *stored == row, "Index out of sync");
+        }
+        
+        TEST_ASSERT(stdem_table_get(table, 5000, weight, &error) == NULL && 
+                    error == STEM_ERROR_NOT_FOUND, "Missing row should fail");
+        TEST_ASSERT(stdem_table_get(table, 1, 9, &error) == NULL && 
+                    error == STEM_ERROR_INDEX_OUT_OF_BOUNDS, "Missing column should fail");
+        TEST_ASSERT(stdem_table_cell(table, 500, weight) == NULL, "Missing cell should be NULL");
+        TEST_ASSERT(stdem_table_add_column(table, 0, &error) == STEM_TABLE_NONE && 
+                    error == STEM_ERROR_INVALID_ARG, "Empty column should be rejected");
+        stdem_table_destroy(table);
+    }
+    
+    StemError error;
+    TEST_ASSERT(stdem_table_create(4, STEM_FLAGS_READONLY, NULL, &error) == NULL && 
+                error == STEM_ERROR_INVALID_ARG, "Read-only table should be rejected");
+    TEST_ASSERT(stdem_table_rows(NULL) == 0 && stdem_table_find(NULL, 1) == STEM_TABLE_NONE, 
+                "NULL table should be empty");
+    stdem_table_destroy(NULL);
+    return 0;
+}
+
+/**
+ * @brief Test dense direct-indexed storage with out-of-range fallback
+ */
+static int test_dense_storage(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(8, sizeof(int), STEM_FLAGS_DENSE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    
+    // Values 0..7 are direct-indexed, -1 and 1000 use the hash table
+    int keys[] = {0, 3, 7, -1, 1000};
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        int data = keys[i] * 10;
+        error = stdem_associate_ex(map, keys[i], &data, test_entries[i].name);
+        TEST_ASSERT(error == STEM_SUCCESS, "Association should succeed");
+    }
+    
+    int data = 1;
+    error = stdem_associate_ex(map, 3, &data, "DUPLICATE");
+    TEST_ASSERT(error == STEM_ERROR_ALREADY_EXISTS, "Dense duplicate should be rejected");
+    TEST_ASSERT(stdem_count(map) == 5, "Map should contain all entries");
+    
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        const int* value = stdem_get_value_ex(map, keys[i], &error);
+        TEST_ASSERT(value != NULL, "Value should be found");
+        TEST_ASSERT(*value == keys[i] * 10, "Retrieved value should match");
+        TEST_ASSERT(stdem_find_by_name(map, test_entries[i].name, &error) == keys[i],
+                    "Should find dense and sparse entries by name");
+    }
+    
+    TEST_ASSERT(stdem_get_value_ex(map, 5, &error) == NULL, "Empty dense slot should miss");
+    TEST_ASSERT(error == STEM_ERROR_NOT_FOUND, "Should return not found error");
+    
+    EnumMap* copy = stdem_copy(map, &error);
+    TEST_ASSERT(copy != NULL, "Copy should succeed");
+    TEST_ASSERT(stdem_count(copy) == 5, "Copy should have same number of entries");
+    TEST_ASSERT(*stdem_get_value_as(copy, 7, int) == 70, "Copied dense value should match");
+    stdem_destroy(copy);
+    
+    error = stdem_clear(map);
+    TEST_ASSERT(error == STEM_SUCCESS, "Clear should succeed");
+    TEST_ASSERT(stdem_count(map) == 0, "Map should be empty after clear");
+    TEST_ASSERT(!stdem_exists(map, 0), "Dense slot should be empty after clear");
+    
+    stdem_destroy(map);
+    return 0;
+}
+
+/**
+ * @brief Test the open-addressing backend across several table resizes
+ */
+static int test_open_addressing(void) {
+    StemError error;
+    StemFlags variants[] = {
+        STEM_FLAGS_OPEN_ADDRESSING,
+        STEM_FLAGS_OPEN_ADDRESSING | STEM_FLAGS_DENSE
+    };
+    
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        EnumMap* map = stdem_create_ex(4, sizeof(int), variants[v], &error);
+        TEST_ASSERT(map != NULL, "Map creation failed");
+        
+        // Sparse keys, including negatives, force the table to grow
+        for (int i = 0; i < 1000; i++) {
+            int key = i * 7919 - 50000;
+            int data = i;
+            error = stdem_associate_ex(map, key, &data, NULL);
+            TEST_ASSERT(error == STEM_SUCCESS, "Association should succeed");
+        }
+        error = stdem_associate_ex(map, 1, &test_entries[0].data, test_entries[0].name);
+        TEST_ASSERT(error == STEM_SUCCESS, "Association should succeed");
+        
+        int data = 0;
+        error = stdem_associate_ex(map, -50000, &data, NULL);
+        TEST_ASSERT(error == STEM_ERROR_ALREADY_EXISTS, "Duplicate should be rejected");
+        TEST_ASSERT(stdem_count(map) == 1001, "Map should contain all entries");
+        
+        for (int i = 0; i < 1000; i++) {
+            const int* value = stdem_get_value_ex(map, i * 7919 - 50000, &error);
+            TEST_ASSERT(value != NULL, "Value should be found after resizes");
+            TEST_ASSERT(*value == i, "Retrieved value should match");
+        }
+        TEST_ASSERT(!stdem_exists(map, 7919 - 50001), "Missing key should not be found");
+        TEST_ASSERT(stdem_find_by_name(map, test_entries[0].name, &error) == 1,
+                    "Should find entry by name");
+        
+        EnumMap* copy = stdem_copy(map, &error);
+        TEST_ASSERT(copy != NULL, "Copy should succeed");
+        TEST_ASSERT(stdem_count(copy) == 1001, "Copy should have same number of entries");
+        TEST_ASSERT(*stdem_get_value_as(copy, 999 * 7919 - 50000, int) == 999,
+                    "Copied value should match");
+        stdem_destroy(copy);
+        
+        error = stdem_clear(map);
+        TEST_ASSERT(error == STEM_SUCCESS, "Clear should succeed");
+        TEST_ASSERT(!stdem_exists(map, -50000), "Slots should be empty after clear");
+        
+        stdem_destroy(map);
+    }
+    return 0;
+}
+
+/**
+ * @brief Test custom and static buffer allocators
+ */
+static int test_allocators(void) {
+    StemError error;
+    CountingAllocator counter = {0, 0, false};
+    StemAllocator allocator = {counting_allocate, counting_deallocate, &counter};
+    
+    EnumMap* map = stdem_create_with_allocator(16, sizeof(int), STEM_FLAGS_NONE,
+                                               &allocator, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    
+    for (int i = 0; i < 5000; i++) {
+        error = stdem_associate_ex(map, i, &i, test_entries[i % test_entries_count].name);
+        TEST_ASSERT(error == STEM_SUCCESS, "Association should succeed");
+    }
+    // Entries, values and names are arena-allocated, not one block each
+    TEST_ASSERT(counter.allocations < 64, "Entries should come from the arena");
+    TEST_ASSERT(*stdem_get_value_as(map, 4321, int) == 4321, "Retrieved value should match");
+    
+    EnumMap* copy = stdem_copy(map, &error);
+    TEST_ASSERT(copy != NULL, "Copy should succeed");
+    TEST_ASSERT(stdem_count(copy) == 5000, "Copy should have same number of entries");
+    stdem_destroy(copy);
+    
+    error = stdem_clear(map);
+    TEST_ASSERT(error == STEM_SUCCESS, "Clear should succeed");
+    error = stdem_associate_ex(map, 1, &test_entries[0].data, test_entries[0].name);
+    TEST_ASSERT(error == STEM_SUCCESS, "Association after clear should succeed");
+    
+    stdem_destroy(map);
+    TEST_ASSERT(counter.live_bytes == 0, "All memory should be returned on destroy");
+    
+    // Static buffer for allocation-free environments
+    static unsigned char memory[4096];
+    StemStaticBuffer buffer;
+    allocator = stdem_static_allocator(&buffer, memory, sizeof(memory));
+    map = stdem_create_with_allocator(test_entries_count, sizeof(int), STEM_FLAGS_NONE,
+                                      &allocator, &error);
+    TEST_ASSERT(map != NULL, "Map creation from static buffer failed");
+    for (size_t i = 0; i < test_entries_count; i++) {
+        error = stdem_associate_ex(map, test_entries[i].enum_value, 
+                                 &test_entries[i].data, test_entries[i].name);
+        TEST_ASSERT(error == STEM_SUCCESS, "Association should succeed");
+    }
+    TEST_ASSERT(stdem_find_by_name(map, "STATE_ERROR", &error) == 3, "Should find entry by name");
+    TEST_ASSERT(buffer.used <= sizeof(memory), "Buffer usage should stay in bounds");
+    stdem_destroy(map);
+    
+    allocator = stdem_static_allocator(&buffer, memory, 16);
+    map = stdem_create_with_allocator(4, sizeof(int), STEM_FLAGS_NONE, &allocator, &error);
+    TEST_ASSERT(map == NULL, "Creation should fail when the buffer is too small");
+    TEST_ASSERT(error == STEM_ERROR_OUT_OF_MEMORY, "Should return out of memory error");
+    
+    return 0;
+}
+
+#if TEST_HAVE_THREADS
+#define THREAD_TEST_KEYS 20000
+
+/**
+ * @brief Reader thread: every value it can see must be fully written
+ */
+static void* thread_safe_reader(void* arg) {
+    EnumMap* map = (EnumMap*)arg;
+    size_t bad = 0;
+    for (int round = 0; round < 20; round++) {
+        for (int key = 0; key < THREAD_TEST_KEYS; key += 7) {
+            const int* value = stdem_get_value_ex(map, key, NULL);
+            if (value && *value != key * 3) {
+                bad++;
+            }
+        }
+    }
+    return bad ? (void*)map : NULL;
+}
+#endif
+
+/**
+ * @brief Test concurrent readers against a writer on a thread-safe map
+ */
+static int test_thread_safe(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(4, sizeof(int), STEM_FLAGS_THREAD_SAFE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    
+#if TEST_HAVE_THREADS
+    pthread_t readers[4];
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT(pthread_create(&readers[i], NULL, thread_safe_reader, map) == 0,
+                    "Reader thread creation failed");
+    }
+#endif
+    
+    // The writer grows the table repeatedly while the readers probe it
+    for (int key = 0; key < 20000; key++) {
+        int data = key * 3;
+        error = stdem_associate_ex(map, key, &data, NULL);
+        TEST_ASSERT(error == STEM_SUCCESS, "Association should succeed");
+    }
+    
+#if TEST_HAVE_THREADS
+    for (size_t i = 0; i < 4; i++) {
+        void* result;
+        pthread_join(readers[i], &result);
+        TEST_ASSERT(result == NULL, "Readers should never see a partial entry");
+    }
+#endif
+    
+    TEST_ASSERT(stdem_count(map) == 20000, "Map should contain all entries");
+    stdem_destroy(map);
+    return 0;
+}
+
+#if TEST_HAVE_THREADS
+/**
+ * @brief Merges the second map of a pair into the first, over and over
+ */
+static void* merge_into_worker(void* arg) {
+    EnumMap** maps = (EnumMap**)arg;
+    for (int round = 0; round < 2000; round++) {
+        if (stdem_merge_into(maps[0], maps[1], true) != STEM_SUCCESS) {
+            return arg;
+        }
+    }
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Test opposite merges of two thread-safe maps running at once
+ */
+static int test_merge_into_threads(void) {
+    StemError error;
+    EnumMap* a = stdem_create_ex(64, sizeof(int), STEM_FLAGS_THREAD_SAFE, &error);
+    EnumMap* b = stdem_create_ex(64, sizeof(int), STEM_FLAGS_THREAD_SAFE, &error);
+    TEST_ASSERT(a != NULL && b != NULL, "Map creation failed");
+    for (int key = 0; key < 64; key++) {
+        TEST_ASSERT(stdem_associate_ex(a, key, &key, NULL) == STEM_SUCCESS && 
+                    stdem_associate_ex(b, key, &key, NULL) == STEM_SUCCESS, "Insert failed");
+    }
+    
+    // a into b and b into a take the two locks in opposite roles
+    EnumMap* forward[2] = {a, b};
+    EnumMap* backward[2] = {b, a};
+#if TEST_HAVE_THREADS
+    pthread_t threads[2];
+    TEST_ASSERT(pthread_create(&threads[0], NULL, merge_into_worker, forward) == 0 && 
+                pthread_create(&threads[1], NULL, merge_into_worker, backward) == 0, 
+                "Merge thread creation failed");
+    for (size_t i = 0; i < 2; i++) {
+        void* result;
+        pthread_join(threads[i], &result);
+        TEST_ASSERT(result == NULL, "Concurrent merge failed");
+    }
+#else
+    TEST_ASSERT(stdem_merge_into(forward[0], forward[1], true) == STEM_SUCCESS && 
+                stdem_merge_into(backward[0], backward[1], true) == STEM_SUCCESS, "Merge failed");
+#endif
+    
+    TEST_ASSERT(stdem_count(a) == 64 && stdem_count(b) == 64, "Merges should keep the key sets");
+    TEST_ASSERT(*(const int*)stdem_get_value_ex(a, 63, NULL) == 63, "Merged value mismatch");
+    stdem_destroy(a);
+    stdem_destroy(b);
+    return 0;
+}
+
+#if TEST_HAVE_THREADS
+/**
+ * @brief Snapshot reader thread: both keys of a version must agree
+ */
+static void* snapshot_reader(void* arg) {
+    StemSnapshotReader* reader = stdem_snapshot_register_reader((StemSnapshot*)arg, NULL);
+    size_t bad = reader ? 0 : 1;
+    for (int i = 0; reader && i < 20000; i++) {
+        const EnumMap* current = stdem_snapshot_read_begin(reader);
+        const int* a = stdem_get_value_as(current, 0, int);
+        const int* b = stdem_get_value_as(current, 1, int);
+        if (!a || !b || *a != *b) {
+            bad++;
+        }
+        stdem_snapshot_read_end(reader);
+    }
+    stdem_snapshot_unregister_reader(reader);
+    return bad ? arg : NULL;
+}
+#endif
+
+/**
+ * @brief Test snapshot publishing and reclamation
+ */
+static int test_snapshot(void) {
+    StemError error;
+    EnumMap* map = stdem_create_ex(2, sizeof(int), STEM_FLAGS_NONE, &error);
+    TEST_ASSERT(map != NULL, "Map creation failed");
+    int version = 0;
+    stdem_associate_ex(map, 0, &version, "A");
+    stdem_associate_ex(map, 1, &version, "B");
+    
+    StemSnapshot* snapshot = stdem_snapshot_create(map, 8, &error);
+    TEST_ASSERT(snapshot != NULL, "Snapshot creation failed");
+    TEST_ASSERT(stdem_associate_ex(map, 2, &version, NULL) == STEM_ERROR_INVALID_ARG,
+                "Published map should be immutable");
+    
+    StemSnapshotReader* reader = stdem_snapshot_register_reader(snapshot, &error);
+    TEST_ASSERT(reader != NULL, "Reader registration failed");
+    
+    // A reader inside a read section keeps its version alive
+    const EnumMap* seen = stdem_snapshot_read_begin(reader);
+    TEST_ASSERT(seen == map, "Reader should see the initial map");
+    
+    EnumMap* next = stdem_snapshot_copy_current(snapshot, &error);
+    TEST_ASSERT(next != NULL, "Copy of current map failed");
+    version = 1;
+    TEST_ASSERT(stdem_associate_ex(next, 2, &version, "C") == STEM_SUCCESS,
+                "Copy of a published map should be mutable");
+    TEST_ASSERT(stdem_snapshot_publish(snapshot, next) == STEM_SUCCESS, "Publish failed");
+    TEST_ASSERT(stdem_snapshot_reclaim(snapshot) == 1, "Old map must wait for the reader");
+    TEST_ASSERT(*stdem_get_value_as(seen, 0, int) == 0, "Old map should still be readable");
+    stdem_snapshot_read_end(reader);
+    TEST_ASSERT(stdem_snapshot_reclaim(snapshot) == 0, "Old map should be reclaimed");
+    
+    seen = stdem_snapshot_read_begin(reader);
+    TEST_ASSERT(stdem_count(seen) == 3, "Reader should see the new map");
+    stdem_snapshot_read_end(reader);
+    stdem_snapshot_unregister_reader(reader);
+    
+#if TEST_HAVE_THREADS
+    pthread_t readers[4];
+    for (size_t i = 0; i < 4; i++) {
+        TEST_ASSERT(pthread_create(&readers[i], NULL, snapshot_reader, snapshot) == 0,
+                    "Reader thread creation failed");
+    }
+    for (int v = 2; v < 200; v++) {
+        next = stdem_create_ex(2, sizeof(int), STEM_FLAGS_NONE, &error);
+        TEST_ASSERT(next != NULL, "Map creation failed");
+        stdem_associate_ex(next, 0, &v, "A");
+        stdem_associate_ex(next, 1, &v, "B");
+        TEST_ASSERT(stdem_snapshot_publish(snapshot, next) == STEM_SUCCESS, "Publish failed");
+    }
+    for (size_t i = 0; i < 4; i++) {
+        void* result;
+        pthread_join(readers[i], &result);
+        TEST_ASSERT(result == NULL, "Readers should always see a consistent version");
+    }
+    TEST_ASSERT(stdem_snapshot_reclaim(snapshot) == 0, "Everything should be reclaimed");
+#endif
+    
+    stdem_snapshot_destroy(snapshot);
+    return 0;
+}
+
 /* ==================== TEST RUNNER ==================== */
 
 int main(void) {
@@ -391,6 +2870,34 @@ int main(void) {
     TEST_RUN(test_clear);
     TEST_RUN(test_flags);
     TEST_RUN(test_find_by_name);
+    TEST_RUN(test_name_index);
+    TEST_RUN(test_freeze);
+    TEST_RUN(test_batch_lookup);
+    TEST_RUN(test_bulk_load);
+    TEST_RUN(test_image);
+    TEST_RUN(test_buffer_serialization);
+    TEST_RUN(test_find_by_name_n);
+    TEST_RUN(test_string_pool);
+    TEST_RUN(test_inline_values);
+    TEST_RUN(test_stats);
+    TEST_RUN(test_cursor_iteration);
+    TEST_RUN(test_parallel);
+    TEST_RUN(test_ordered_range);
+    TEST_RUN(test_update_remove);
+    TEST_RUN(test_capacity_policy);
+    TEST_RUN(test_incremental_rehash);
+    TEST_RUN(test_shared_memory);
+    TEST_RUN(test_merge_into_patch);
+    TEST_RUN(test_huge_pages_numa);
+    TEST_RUN(test_front_cache);
+    TEST_RUN(test_async_load);
+    TEST_RUN(test_table);
+    TEST_RUN(test_dense_storage);
+    TEST_RUN(test_open_addressing);
+    TEST_RUN(test_allocators);
+    TEST_RUN(test_thread_safe);
+    TEST_RUN(test_merge_into_threads);
+    TEST_RUN(test_snapshot);
     
     printf("\nTest Results: %d passed, %d failed, %d total\n", passed, failures, total);
     
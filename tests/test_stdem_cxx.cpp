@@ -0,0 +1,400 @@
+/**
+ * @file test_stdem_cxx.cpp
+ * @brief Test suite for the C++ wrappers of the Standard Enum Mapping Library
+ * @author Ferki
+ * @license LGPL-3.0-or-later
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../include/stdem.h"
+
+/* ==================== TEST DEFINES AND STRUCTURES ==================== */
+
+#define TEST_ASSERT(condition, message) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "TEST FAILED: %s (%s:%d)\n", message, __FILE__, __LINE__); \
+            return 1; \
+        } \
+    } while (0)
+
+#define TEST_THROWS(expression, exception, message) \
+    do { \
+        bool thrown = false; \
+        try { \
+            expression; \
+        } catch (const exception&) { \
+            thrown = true; \
+        } \
+        TEST_ASSERT(thrown, message); \
+    } while (0)
+
+#define TEST_RUN(test_function) \
+    do { \
+        std::printf("Running %s... ", #test_function); \
+        int result = test_function(); \
+        if (result != 0) { \
+            std::printf("FAILED\n"); \
+            failures++; \
+        } else { \
+            std::printf("PASSED\n"); \
+            passed++; \
+        } \
+        total++; \
+    } while (0)
+
+enum class Level { Low = 1, Mid, High };
+
+/* ==================== TEST CASES ==================== */
+
+using LevelMap = stem::StaticEnumMap<Level, int, 3>;
+
+/* Contiguous keys are looked up by direct indexing */
+constexpr LevelMap levels = {
+    {Level::High, 30, "HIGH"},
+    {Level::Low, 10, "LOW"},
+    {Level::Mid, 20, nullptr}
+};
+
+static_assert(levels.is_direct(), "Contiguous keys should use direct indexing");
+static_assert(levels.size() == 3, "Size mismatch");
+static_assert(levels.get(Level::Low) == 10 && levels[Level::High] == 30, "Direct lookup mismatch");
+static_assert(levels.find(static_cast<Level>(0)) == nullptr && 
+              levels.find(static_cast<Level>(4)) == nullptr, "Keys next to the range should miss");
+static_assert(levels.get_or(static_cast<Level>(-1), 7) == 7, "Default mismatch");
+static_assert(levels.name(Level::Mid) == nullptr, "Unnamed entry should have no name");
+
+enum class Sparse : int {};
+
+constexpr size_t kSparseCount = 64;
+
+/**
+ * @brief Sparse key of entry i, far apart and of both signs
+ */
+constexpr int sparse_key(size_t i) {
+    return static_cast<int>(i * i) * 37 - 5000;
+}
+
+struct SparseEntries {
+    stem::StaticEntry<Sparse, int> entries[kSparseCount];
+};
+
+constexpr SparseEntries make_sparse_entries() {
+    SparseEntries result = {};
+    for (size_t i = 0; i < kSparseCount; ++i) {
+        result.entries[i].key = static_cast<Sparse>(sparse_key(i));
+        result.entries[i].value = static_cast<int>(i);
+    }
+    return result;
+}
+
+constexpr SparseEntries sparse_entries = make_sparse_entries();
+
+/* 64 hashed keys always share buckets, so the seed search runs as well */
+constexpr stem::StaticEnumMap<Sparse, int, kSparseCount> sparse(sparse_entries.entries);
+
+/**
+ * @brief Checks every sparse key at compile time
+ */
+constexpr bool sparse_all_found() {
+    for (size_t i = 0; i < kSparseCount; ++i) {
+        const int* value = sparse.find(static_cast<Sparse>(sparse_key(i)));
+        if (!value || *value != static_cast<int>(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(!sparse.is_direct(), "Sparse keys should be hashed");
+static_assert(sparse_all_found(), "Every sparse key should be found in its slot");
+static_assert(!sparse.contains(static_cast<Sparse>(-4999)) && 
+              !sparse.contains(static_cast<Sparse>(0)), "Non-keys should miss");
+
+/**
+ * @brief Test StaticEnumMap lookups, construction errors and conversion
+ */
+static int test_static_enum_map() {
+    // Every non-key in and around the key range misses
+    size_t next = 0;
+    for (int key = sparse_key(0) - 100; key <= sparse_key(kSparseCount - 1) + 100; ++key) {
+        bool is_key = next < kSparseCount && key == sparse_key(next);
+        TEST_ASSERT(sparse.contains(static_cast<Sparse>(key)) == is_key, "Miss sweep mismatch");
+        next += is_key;
+    }
+    TEST_ASSERT(next == kSparseCount, "Sweep should visit every key");
+    
+    Level found;
+    TEST_ASSERT(levels.find_by_name("HIGH", found) && found == Level::High, "Name lookup failed");
+    TEST_ASSERT(!levels.find_by_name("MID", found), "Unnamed entry should not be found");
+    TEST_THROWS(levels.get(Level(9)), std::out_of_range, "Missing key should throw");
+    
+    // Duplicates are caught by the direct and by the hashed construction
+    TEST_THROWS(LevelMap({{Level::Low, 1}, {Level::Low, 2}, {Level::High, 3}}), 
+                std::invalid_argument, "Duplicate in a contiguous range should throw");
+    TEST_THROWS(LevelMap({{Level::Low, 1}, {Level::Low, 2}, {Level::Mid, 3}}), 
+                std::invalid_argument, "Duplicate of hashed keys should throw");
+    TEST_THROWS(LevelMap({{Level::Low, 1}, {Level::Mid, 2}}), 
+                std::invalid_argument, "Wrong entry count should throw");
+    
+    // Converted maps hold the same associations
+    stem::EnumMap map = sparse.to_enum_map();
+    TEST_ASSERT(map.size() == kSparseCount, "Converted size mismatch");
+    for (size_t i = 0; i < kSparseCount; ++i) {
+        TEST_ASSERT(map.get<int>(sparse_key(i)) == static_cast<int>(i), "Converted value mismatch");
+    }
+    stem::EnumMap named = levels.to_enum_map();
+    TEST_ASSERT(named.find("LOW") == static_cast<int>(Level::Low) && 
+                named.get<int>(static_cast<int>(Level::Mid)) == 20, "Converted names mismatch");
+    return 0;
+}
+
+/**
+ * @brief Argument converting to int that counts its conversions
+ */
+struct CountedInt {
+    int* conversions;
+    
+    operator int() const {
+        ++*conversions;
+        return 99;
+    }
+};
+
+/**
+ * @brief Test TypedEnumMap bulk loading, lookups and in-place updates
+ */
+static int test_typed_enum_map() {
+    using LevelValues = stem::TypedEnumMap<Level, int>;
+    
+    // The bulk-load constructor also fills read-only maps
+    LevelValues frozen({{Level::Low, 1}, {Level::High, 3}}, STEM_FLAGS_READONLY);
+    TEST_ASSERT(frozen.size() == 2 && frozen.get(Level::High) == 3, "Bulk load mismatch");
+    const LevelValues& frozen_view = frozen;
+    TEST_ASSERT(frozen_view.find(Level::Low) != nullptr, "Const find should see read-only values");
+    TEST_ASSERT(frozen.find(Level::Low) == nullptr, "Mutable find should refuse read-only maps");
+    TEST_THROWS(frozen.get(Level::Mid), std::out_of_range, "Missing key should throw");
+    TEST_THROWS(LevelValues({{Level::Low, 1}, {Level::Low, 2}}), std::runtime_error, 
+                "Duplicate bulk key should throw");
+    
+    LevelValues map;
+    map.insert_or_assign(Level::Low, 10, "LOW");
+    TEST_ASSERT(map.get_or(Level::Mid, -1) == -1 && map.contains(Level::Low), "Lookup mismatch");
+    
+    // try_emplace builds the value only when the key is new
+    int conversions = 0;
+    std::pair<int*, bool> kept = map.try_emplace(Level::Low, CountedInt{&conversions});
+    TEST_ASSERT(!kept.second && *kept.first == 10 && conversions == 0, 
+                "Existing key should leave the arguments untouched");
+    std::pair<int*, bool> added = map.try_emplace(Level::Mid, CountedInt{&conversions});
+    TEST_ASSERT(added.second && *added.first == 99 && conversions == 1, "New key should be built");
+    *map.find(Level::Mid) += 1;
+    TEST_ASSERT(map.get(Level::Mid) == 100, "Mutable find should write in place");
+    
+    Level key;
+    TEST_ASSERT(map.find_by_name("LOW", key) && key == Level::Low, "Name lookup failed");
+    TEST_ASSERT(!map.find_by_name("MID", key) && std::strcmp(map.name(Level::Low), "LOW") == 0, 
+                "Name mismatch");
+    
+    int sum = 0;
+    size_t visited = 0;
+    map.for_each([&](Level entry, const int& value) {
+        sum += value;
+        visited += entry == Level::Low || entry == Level::Mid;
+    });
+    TEST_ASSERT(visited == 2 && sum == 110, "for_each mismatch");
+    
+    TEST_ASSERT(map.erase(Level::Low) && !map.erase(Level::Low), "Erase mismatch");
+    LevelValues moved(std::move(map));
+    TEST_ASSERT(moved.size() == 1 && moved.get(Level::Mid) == 100, "Moved map mismatch");
+    return 0;
+}
+
+/**
+ * @brief Test EnumMap::const_iterator across batch refills
+ */
+static int test_enum_map_iterator() {
+    stem::EnumMap empty(4, sizeof(int));
+    TEST_ASSERT(empty.begin() == empty.end(), "Empty map should start at the end");
+    
+    // More entries than one iterator batch, so the cursor is refilled
+    stem::EnumMap map(16, sizeof(int));
+    const int count = 100;
+    for (int key = 0; key < count; ++key) {
+        map.associate(key, key * 2, key == 42 ? "ANSWER" : nullptr);
+    }
+    
+    std::vector<bool> seen(count, false);
+    size_t visited = 0;
+    for (const StemItem& item : map) {
+        TEST_ASSERT(item.enum_value >= 0 && item.enum_value < count && !seen[item.enum_value], 
+                    "Each entry should be visited once");
+        TEST_ASSERT(*static_cast<const int*>(item.value) == item.enum_value * 2, "Value mismatch");
+        TEST_ASSERT((item.name != nullptr) == (item.enum_value == 42), "Name mismatch");
+        seen[item.enum_value] = true;
+        ++visited;
+    }
+    TEST_ASSERT(visited == static_cast<size_t>(count), "Iteration should visit every entry");
+    
+    // Copies share one cursor, so advancing one advances both
+    stem::EnumMap::const_iterator it = map.begin();
+    stem::EnumMap::const_iterator copy = it;
+    int first = it->enum_value;
+    ++copy;
+    TEST_ASSERT(it == copy && it->enum_value != first, "Copies should share the cursor");
+    TEST_ASSERT(it != map.end(), "Iterator should not be at the end yet");
+    
+    std::vector<int> keys = map.keys();
+    std::vector<std::string> names = map.names();
+    TEST_ASSERT(keys.size() == static_cast<size_t>(count) && names.size() == 1 && 
+                names[0] == "ANSWER", "keys() or names() mismatch");
+    return 0;
+}
+
+/**
+ * @brief Trivially copyable cell type of a table column
+ */
+struct Rgb {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+};
+
+/**
+ * @brief Test EnumTable typed columns, row moves and errors
+ */
+static int test_enum_table() {
+    stem::EnumTable<Level> table(2);
+    stem::EnumTable<Level>::Column<double> weight = table.add_column<double>();
+    stem::EnumTable<Level>::Column<Rgb> color = table.add_column<Rgb>();
+    TEST_ASSERT(weight.index() == 0 && color.index() == 1, "Columns should be numbered in order");
+    
+    // Inserting past the initial capacity grows every column
+    TEST_ASSERT(table.insert(Level::Low, "LOW") == 0 && table.insert(Level::Mid) == 1 && 
+                table.insert(Level::High, "HIGH") == 2, "Rows should be appended");
+    TEST_THROWS(table.insert(Level::Low), std::runtime_error, "Duplicate row should throw");
+    TEST_ASSERT(table.size() == 3 && !table.empty(), "Row count mismatch");
+    TEST_ASSERT(*table.find(Level::Mid, weight) == 0.0 && table.get(Level::Mid, color).g == 0, 
+                "New cells should be zeroed");
+    
+    TEST_ASSERT(table.set(Level::Low, weight, 1.5), "Set failed");
+    table.get(Level::High, color) = Rgb{0, 255, 0};
+    TEST_ASSERT(table.data(weight)[0] == 1.5 && table.data(color)[2].g == 255, 
+                "Column data mismatch");
+    
+    // The last row moves into the hole of an erased one
+    TEST_ASSERT(table.erase(Level::Low) && !table.erase(Level::Low), "Erase mismatch");
+    TEST_ASSERT(table.size() == 2 && table.row(Level::High) == 0 && 
+                table.key(0) == Level::High && std::strcmp(table.name(0), "HIGH") == 0, 
+                "Last row should take the erased row");
+    TEST_ASSERT(table.get(Level::High, color).g == 255, "Moved cells mismatch");
+    TEST_ASSERT(table.row(Level::Low) == STEM_TABLE_NONE && !table.find(Level::Low, weight) && 
+                !table.set(Level::Low, weight, 2.0), "Erased row should be gone");
+    TEST_THROWS(table.get(Level::Low, weight), std::out_of_range, "Missing row should throw");
+    
+    // Columns added later start zeroed for the existing rows
+    stem::EnumTable<Level>::Column<int> count = table.add_column<int>();
+    TEST_ASSERT(table.get(Level::Mid, count) == 0 && table.get(Level::High, count) == 0, 
+                "Late column should be zeroed");
+    
+    stem::EnumTable<Level> moved(std::move(table));
+    TEST_ASSERT(moved.size() == 2 && moved.get(Level::High, color).g == 255, "Moved table mismatch");
+    TEST_THROWS(stem::EnumTable<Level>(4, STEM_FLAGS_READONLY), std::runtime_error, 
+                "Read-only table should throw");
+    return 0;
+}
+
+/**
+ * @brief Returns the value of a key in the current map of a snapshot, or -1
+ */
+static int snapshot_value(StemSnapshotReader* reader, int key) {
+    const int* value = static_cast<const int*>(
+        ::stdem_get_value_ex(::stdem_snapshot_read_begin(reader), key, nullptr));
+    int result = value ? *value : -1;
+    ::stdem_snapshot_read_end(reader);
+    return result;
+}
+
+/**
+ * @brief Test load_async and rebuild_async futures, including failures
+ */
+static int test_async() {
+    const char* path = "test_stdem_cxx_async.bin";
+    stem::EnumMap source(64, sizeof(int));
+    for (int key = 0; key < 64; ++key) {
+        source.associate(key, key * 5);
+    }
+    std::FILE* stream = std::fopen(path, "wb");
+    TEST_ASSERT(stream != nullptr && ::stdem_serialize(source.c_handle(), stream) == STEM_SUCCESS, 
+                "Serialization failed");
+    std::fclose(stream);
+    
+    StemError error;
+    StemSnapshot* snapshot = ::stdem_snapshot_create(::stdem_create_ex(1, sizeof(int), 
+                                                                       STEM_FLAGS_NONE, &error), 
+                                                     2, &error);
+    TEST_ASSERT(snapshot != nullptr, "Snapshot creation failed");
+    StemSnapshotReader* reader = ::stdem_snapshot_register_reader(snapshot, &error);
+    TEST_ASSERT(reader != nullptr, "Reader registration failed");
+    
+    stem::load_async(snapshot, path).get();
+    TEST_ASSERT(snapshot_value(reader, 63) == 315, "Loaded map not published");
+    
+    // The rebuild function edits a copy of the current map on the worker
+    stem::rebuild_async(snapshot, [](::EnumMap* next) {
+        int value = 1;
+        if (::stdem_upsert(next, 0, &value, "ZERO") != STEM_SUCCESS) {
+            throw std::runtime_error("Upsert failed");
+        }
+    }).get();
+    TEST_ASSERT(snapshot_value(reader, 0) == 1 && snapshot_value(reader, 63) == 315, 
+                "Rebuilt map not published");
+    
+    // An exception from the rebuild cancels it and reaches the future unchanged
+    std::future<void> failed = stem::rebuild_async(snapshot, [](::EnumMap*) {
+        throw std::logic_error("Rebuild refused");
+    });
+    TEST_THROWS(failed.get(), std::logic_error, "Rebuild exception should be rethrown");
+    TEST_ASSERT(snapshot_value(reader, 0) == 1, "Cancelled rebuild should not be published");
+    
+    std::remove(path);
+    TEST_THROWS(stem::load_async(snapshot, path).get(), std::runtime_error, 
+                "Missing file should fail");
+    TEST_ASSERT(snapshot_value(reader, 63) == 315, "Failed load should keep the current map");
+    TEST_THROWS(stem::load_async(nullptr, path), std::runtime_error, 
+                "NULL snapshot should throw at once");
+    
+    ::stdem_snapshot_unregister_reader(reader);
+    ::stdem_snapshot_destroy(snapshot);
+    return 0;
+}
+
+/* ==================== TEST RUNNER ==================== */
+
+int main() {
+    std::printf("Starting Standard Enum Mapping Library C++ tests...\n\n");
+    
+    int passed = 0;
+    int failures = 0;
+    int total = 0;
+    
+    TEST_RUN(test_static_enum_map);
+    TEST_RUN(test_typed_enum_map);
+    TEST_RUN(test_enum_map_iterator);
+    TEST_RUN(test_enum_table);
+    TEST_RUN(test_async);
+    
+    std::printf("\nTest Results: %d passed, %d failed, %d total\n", passed, failures, total);
+    
+    if (failures == 0) {
+        std::printf("All tests PASSED! ✅\n");
+        return 0;
+    } else {
+        std::printf("Some tests FAILED! ❌\n");
+        return 1;
+    }
+}